@@ -0,0 +1,301 @@
+//  capture.cpp -- record and replay connexion traffic
+//  Copyright (C) 2026  SEIKO EPSON CORPORATION
+//
+//  License: GPL-3.0+
+//  Author : EPSON AVASYS CORPORATION
+//
+//  This file is part of the 'Utsushi' package.
+//  This package is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License or, at
+//  your option, any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//  You ought to have received a copy of the GNU General Public License
+//  along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <arpa/inet.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include <boost/throw_exception.hpp>
+
+#include <utsushi/atomic.hpp>
+#include <utsushi/clock.hpp>
+#include <utsushi/format.hpp>
+#include <utsushi/log.hpp>
+
+#include "capture.hpp"
+
+namespace utsushi {
+namespace _cnx_ {
+
+extern "C" {
+
+  //! Records to \a filename, numbering the files of later connexions
+  /*! The first connexion recorded uses \a filename as is.  Those that
+   *  follow get a sequence number appended, \a filename.1, \a
+   *  filename.2 and so on, so no capture overwrites another.
+   */
+  void
+  libcnx_capture_LTX_record_factory (connexion::ptr& cnx,
+                                     const std::string& filename)
+  {
+    static atomic< unsigned > sequence (0);
+
+    unsigned n = sequence++;
+    cnx = make_shared< recorder >
+      (cnx, (n ? (format ("%1%.%2%") % filename % n).str () : filename));
+  }
+
+  void
+  libcnx_capture_LTX_replay_factory (connexion::ptr& cnx,
+                                     const std::string& type,
+                                     const std::string& path)
+  {
+    const char *env = getenv (PACKAGE_ENV_VAR_PREFIX "REPLAY_TIMED");
+    bool timed = (env && 0 != strtoul (env, NULL, 10));
+
+    cnx = make_shared< replay > (path, timed);
+  }
+}
+
+using std::runtime_error;
+
+namespace {
+
+const char signature[] = "UTSUSHI-CNX1";
+const std::size_t signature_size = sizeof (signature) - 1;
+
+}       // namespace
+
+recorder::recorder (connexion::ptr instance, const std::string& filename)
+  : base_(instance)
+  , file_(filename.c_str (), std::ios_base::binary | std::ios_base::trunc)
+{
+  if (!file_)
+    BOOST_THROW_EXCEPTION
+      (runtime_error ((format ("cannot create capture file: '%1%'")
+                       % filename).str ()));
+
+  file_.write (signature, signature_size);
+}
+
+recorder::~recorder ()
+{
+  file_.flush ();
+  if (!file_)
+    log::error ("failed to write capture file");
+}
+
+void
+recorder::send (const octet *message, streamsize size)
+{
+  uint64_t start = microseconds ();
+  try
+    {
+      instance_->send (message, size);
+    }
+  catch (...)
+    {
+      record_failure_(start);
+      throw;
+    }
+  record_('>', message, size, microseconds () - start);
+}
+
+void
+recorder::send (const octet *message, streamsize size, double timeout)
+{
+  uint64_t start = microseconds ();
+  try
+    {
+      instance_->send (message, size, timeout);
+    }
+  catch (...)
+    {
+      record_failure_(start);
+      throw;
+    }
+  record_('>', message, size, microseconds () - start);
+}
+
+void
+recorder::recv (octet *message, streamsize size)
+{
+  uint64_t start = microseconds ();
+  try
+    {
+      instance_->recv (message, size);
+    }
+  catch (...)
+    {
+      record_failure_(start);
+      throw;
+    }
+  record_('<', message, size, microseconds () - start);
+}
+
+void
+recorder::recv (octet *message, streamsize size, double timeout)
+{
+  uint64_t start = microseconds ();
+  try
+    {
+      instance_->recv (message, size, timeout);
+    }
+  catch (...)
+    {
+      record_failure_(start);
+      throw;
+    }
+  record_('<', message, size, microseconds () - start);
+}
+
+void
+recorder::record_(char direction, const octet *message, streamsize size,
+                   uint64_t duration)
+{
+  uint32_t hdr[2];
+
+  hdr[0] = htonl (duration);
+  hdr[1] = htonl (size);
+
+  file_.put (direction);
+  file_.write (reinterpret_cast< const char * > (hdr), sizeof (hdr));
+  file_.write (message, size);
+
+  if (!file_)
+    log::error ("failed to record %1% octets") % size;
+}
+
+/*! Meant to be called from a \c catch block, this records the error
+ *  that is being handled.  The file is flushed so the record makes it
+ *  to disk even if the error brings the program down.
+ */
+void
+recorder::record_failure_(uint64_t start)
+{
+  uint64_t duration = microseconds () - start;
+  std::string what ("unknown error");
+
+  try
+    {
+      throw;
+    }
+  catch (const std::exception& e)
+    {
+      what = e.what ();
+    }
+  catch (...)
+    {}
+
+  record_('!', what.data (), what.size (), duration);
+  file_.flush ();
+}
+
+replay::replay (const std::string& filename, bool timed)
+  : file_(filename.c_str (), std::ios_base::binary)
+  , timed_(timed)
+  , count_(0)
+{
+  char buf[signature_size];
+
+  file_.read (buf, signature_size);
+  if (!file_ || 0 != memcmp (buf, signature, signature_size))
+    BOOST_THROW_EXCEPTION
+      (runtime_error ((format ("not a capture file: '%1%'")
+                       % filename).str ()));
+}
+
+void
+replay::send (const octet *message, streamsize size)
+{
+  const std::string& expected (next_('>', size));
+
+  if (0 != memcmp (expected.data (), message, size))
+    BOOST_THROW_EXCEPTION
+      (runtime_error ((format ("replay diverged at record %1%")
+                       % count_).str ()));
+}
+
+void
+replay::send (const octet *message, streamsize size, double)
+{
+  send (message, size);
+}
+
+void
+replay::recv (octet *message, streamsize size)
+{
+  const std::string& reply (next_('<', size));
+
+  traits::copy (message, reply.data (), size);
+}
+
+void
+replay::recv (octet *message, streamsize size, double)
+{
+  recv (message, size);
+}
+
+//! Reads the next record and checks it against a call's expectations
+/*! When replaying with timing, this waits as long as the recorded
+ *  call took on the device.  A recorded failure is thrown again as a
+ *  std::runtime_error with the recorded message.
+ */
+const std::string&
+replay::next_(char direction, streamsize size)
+{
+  char     dir;
+  uint32_t hdr[2];
+
+  ++count_;
+  file_.get (dir);
+  file_.read (reinterpret_cast< char * > (hdr), sizeof (hdr));
+  if (!file_)
+    BOOST_THROW_EXCEPTION
+      (runtime_error ((format ("replay ran out of records at %1%")
+                       % count_).str ()));
+
+  if ('!' == dir)
+    {
+      std::string what (ntohl (hdr[1]), '\0');
+
+      if (!what.empty ()) file_.read (&what[0], what.size ());
+      if (timed_) delay (ntohl (hdr[0]));
+      BOOST_THROW_EXCEPTION (runtime_error (what));
+    }
+
+  if (dir != direction || streamsize (ntohl (hdr[1])) != size)
+    BOOST_THROW_EXCEPTION
+      (runtime_error ((format ("replay diverged at record %1%: "
+                               "expected %2%%3%, got %4%%5%")
+                       % count_
+                       % dir % ntohl (hdr[1])
+                       % direction % size).str ()));
+
+  payload_.resize (size);
+  if (0 < size) file_.read (&payload_[0], size);
+  if (!file_)
+    BOOST_THROW_EXCEPTION
+      (runtime_error ((format ("replay ran out of records at %1%")
+                       % count_).str ()));
+
+  if (timed_) delay (ntohl (hdr[0]));
+
+  return payload_;
+}
+
+}       // namespace _cnx_
+}       // namespace utsushi
@@ -0,0 +1,115 @@
+//  capture.hpp -- record and replay connexion traffic
+//  Copyright (C) 2026  SEIKO EPSON CORPORATION
+//
+//  License: GPL-3.0+
+//  Author : EPSON AVASYS CORPORATION
+//
+//  This file is part of the 'Utsushi' package.
+//  This package is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License or, at
+//  your option, any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//  You ought to have received a copy of the GNU General Public License
+//  along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef connexions_capture_hpp_
+#define connexions_capture_hpp_
+
+#include <fstream>
+#include <string>
+
+#include <utsushi/connexion.hpp>
+#include <utsushi/cstdint.hpp>
+
+namespace utsushi {
+
+extern "C" {
+  void libcnx_capture_LTX_record_factory (connexion::ptr& cnx,
+                                          const std::string& filename);
+  void libcnx_capture_LTX_replay_factory (connexion::ptr& cnx,
+                                          const std::string& type,
+                                          const std::string& path);
+}
+
+namespace _cnx_ {
+
+//! Save all traffic on a connexion to a capture file
+/*! A capture file starts with a twelve octet signature.  It is then
+ *  followed by one record per send() or recv() call.  Each record
+ *  consists of a direction octet, '>' for send() and '<' for recv(),
+ *  the time in microseconds that the call took to complete, the
+ *  payload size and the payload itself.  Time and size are 32-bit
+ *  unsigned integers in network byte order.
+ *
+ *  A call that throws gets a '!' record instead.  Its payload is the
+ *  exception's message.  The file is only flushed after such records
+ *  and when the recorder is destroyed.
+ *
+ *  Setting \c UTSUSHI_CNX_RECORD to a file name records the traffic
+ *  of every connexion created.  Each connexion after the first gets
+ *  its own file, named after the first with a sequence number added.
+ */
+class recorder
+  : public decorator< connexion >
+{
+public:
+  recorder (connexion::ptr instance, const std::string& filename);
+  ~recorder ();
+
+  virtual void send (const octet *message, streamsize size);
+  virtual void send (const octet *message, streamsize size, double timeout);
+  virtual void recv (octet *message, streamsize size);
+  virtual void recv (octet *message, streamsize size, double timeout);
+
+protected:
+  void record_(char direction, const octet *message, streamsize size,
+               uint64_t duration);
+  void record_failure_(uint64_t start);
+
+  std::ofstream file_;
+};
+
+//! Act as the device that a capture file was recorded from
+/*! Every send() has to match the next recorded one exactly and every
+ *  recv() gets the next recorded reply.  Calls that failed while the
+ *  conversation was recorded fail again, with the same message.  Any
+ *  divergence from the recorded conversation results in a
+ *  std::runtime_error as well.
+ *
+ *  By default replies are served as fast as possible.  With \a timed
+ *  set, each call takes as long as it did while recording.
+ *
+ *  Drivers get a replay connexion for a UDI such as
+ *  \c esci:replay:/path/to/file.cap.  Setting \c UTSUSHI_REPLAY_TIMED
+ *  to a non-zero number replays with recorded timing.
+ */
+class replay
+  : public connexion
+{
+public:
+  replay (const std::string& filename, bool timed = false);
+
+  virtual void send (const octet *message, streamsize size);
+  virtual void send (const octet *message, streamsize size, double timeout);
+  virtual void recv (octet *message, streamsize size);
+  virtual void recv (octet *message, streamsize size, double timeout);
+
+protected:
+  const std::string& next_(char direction, streamsize size);
+
+  std::ifstream file_;
+  bool          timed_;
+  std::string   payload_;
+  std::size_t   count_;
+};
+
+} // namespace _cnx_
+} // namespace utsushi
+
+#endif  /* connexions_capture_hpp_ */
@@ -0,0 +1,329 @@
+//  usb-ring.cpp -- unit tests for the bulk IN transfer ring
+//  Copyright (C) 2026  SEIKO EPSON CORPORATION
+//
+//  License: GPL-3.0+
+//  Author : EPSON AVASYS CORPORATION
+//
+//  This file is part of the 'Utsushi' package.
+//  This package is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License or, at
+//  your option, any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//  You ought to have received a copy of the GNU General Public License
+//  along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <algorithm>
+#include <deque>
+#include <list>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <utsushi/clock.hpp>
+
+#include "../usb-ring.hpp"
+
+//  Rather than talking to real hardware, the libusb API used by the
+//  ring is replaced by a simulated bulk IN endpoint.  The device side
+//  queues packets of at most max_packet_size octets that are handed
+//  out to submitted transfers, in order, when events are handled.
+
+namespace {
+
+const int max_packet_size = 64;
+
+typedef std::vector< unsigned char > packet;
+
+std::deque< packet > fifo;              // what the device has to send
+std::list< libusb_transfer * > queue;   // transfers waiting for data
+bool is_halted = false;
+
+//! Queues a reply of \a size octets, without trailing zero-length packet
+void
+reply (int size, unsigned char value)
+{
+  while (0 < size)
+    {
+      int n = std::min (size, max_packet_size);
+      fifo.push_back (packet (n, value));
+      size -= n;
+    }
+}
+
+//! Queues the zero-length packet that may follow a reply
+void
+zero_length_packet ()
+{
+  fifo.push_back (packet ());
+}
+
+void
+complete (libusb_transfer *xfer, libusb_transfer_status status)
+{
+  queue.remove (xfer);
+  xfer->status = status;
+  xfer->callback (xfer);
+}
+
+//! Hands out as many packets as possible and completes transfers
+bool
+run_device ()
+{
+  bool progress = false;
+
+  while (!queue.empty ())
+    {
+      libusb_transfer *xfer = queue.front ();
+
+      if (is_halted)
+        {
+          complete (xfer, LIBUSB_TRANSFER_STALL);
+          progress = true;
+          continue;
+        }
+      if (fifo.empty ()) break;
+
+      packet p (fifo.front ());
+      fifo.pop_front ();
+      progress = true;
+
+      if (xfer->length - xfer->actual_length < int (p.size ()))
+        {
+          complete (xfer, LIBUSB_TRANSFER_OVERFLOW);
+          continue;
+        }
+      std::copy (p.begin (), p.end (), xfer->buffer + xfer->actual_length);
+      xfer->actual_length += p.size ();
+
+      if (int (p.size ()) < max_packet_size
+          || xfer->actual_length == xfer->length)
+        complete (xfer, LIBUSB_TRANSFER_COMPLETED);
+    }
+  return progress;
+}
+
+std::list< libusb_transfer * > cancelled;
+
+void
+reset ()
+{
+  fifo.clear ();
+  queue.clear ();
+  cancelled.clear ();
+  is_halted = false;
+}
+
+}       // namespace
+
+extern "C" {
+
+libusb_transfer *
+libusb_alloc_transfer (int)
+{
+  return new libusb_transfer ();
+}
+
+void
+libusb_free_transfer (libusb_transfer *xfer)
+{
+  delete xfer;
+}
+
+int
+libusb_submit_transfer (libusb_transfer *xfer)
+{
+  xfer->actual_length = 0;
+  queue.push_back (xfer);
+  return 0;
+}
+
+int
+libusb_cancel_transfer (libusb_transfer *xfer)
+{
+  queue.remove (xfer);
+  cancelled.push_back (xfer);
+  return 0;
+}
+
+int
+libusb_handle_events (libusb_context *)
+{
+  while (!cancelled.empty ())
+    {
+      libusb_transfer *xfer = cancelled.front ();
+      cancelled.pop_front ();
+      xfer->status = LIBUSB_TRANSFER_CANCELLED;
+      xfer->callback (xfer);
+    }
+  run_device ();
+  return 0;
+}
+
+int
+libusb_handle_events_timeout (libusb_context *ctx, struct timeval *tv)
+{
+  libusb_handle_events (ctx);
+  if (!run_device ())
+    utsushi::delay (std::min (1000L, tv->tv_sec * 1000000L + tv->tv_usec));
+  return 0;
+}
+
+int
+libusb_clear_halt (libusb_device_handle *, unsigned char)
+{
+  is_halted = false;
+  return 0;
+}
+
+#if HAVE_LIBUSB_ERROR_NAME
+const char *
+libusb_error_name (int)
+{
+  return "libusb error";
+}
+#endif
+
+}       // extern "C"
+
+using utsushi::_cnx_::bulk_in_ring;
+
+//! A reply that fills the last packet completely is read right away
+/*! Devices need not send a zero-length packet after such a reply.
+ *  Transfers larger than the reply would then never complete.
+ */
+BOOST_AUTO_TEST_CASE (max_packet_size_reply)
+{
+  reset ();
+  bulk_in_ring ring (0, 0, 0x81, 4, 128 * 1024, max_packet_size);
+  std::vector< unsigned char > buf (max_packet_size);
+
+  reply (max_packet_size, 0x5a);
+  uint64_t t = utsushi::microseconds ();
+  ring.read (&buf[0], buf.size (), 1.0);
+
+  BOOST_CHECK (utsushi::microseconds () - t < 500000);
+  BOOST_CHECK (packet (max_packet_size, 0x5a) == buf);
+  BOOST_CHECK (queue.empty ());
+}
+
+BOOST_AUTO_TEST_CASE (read_across_transfers)
+{
+  reset ();
+  bulk_in_ring ring (0, 0, 0x81, 2, 300, max_packet_size);
+  std::vector< unsigned char > buf (1000);
+
+  reply (1000, 0xa5);
+  ring.read (&buf[0], buf.size (), 1.0);
+
+  BOOST_CHECK (packet (1000, 0xa5) == buf);
+  BOOST_CHECK (queue.empty ());
+  BOOST_CHECK (fifo.empty ());
+}
+
+//! Consecutive reads take just what they ask for off the device
+BOOST_AUTO_TEST_CASE (split_reply)
+{
+  reset ();
+  bulk_in_ring ring (0, 0, 0x81, 4, 128 * 1024, max_packet_size);
+  std::vector< unsigned char > buf (max_packet_size);
+
+  reply (max_packet_size, 0x01);
+  reply (max_packet_size, 0x02);
+
+  ring.read (&buf[0], buf.size (), 1.0);
+  BOOST_CHECK (packet (max_packet_size, 0x01) == buf);
+  BOOST_CHECK_EQUAL (1, fifo.size ());
+
+  ring.read (&buf[0], buf.size (), 1.0);
+  BOOST_CHECK (packet (max_packet_size, 0x02) == buf);
+  BOOST_CHECK (fifo.empty ());
+}
+
+//! Nothing is left queued after a time-out to swallow the next reply
+BOOST_AUTO_TEST_CASE (in_sync_after_timeout)
+{
+  reset ();
+  bulk_in_ring ring (0, 0, 0x81, 4, 128 * 1024, max_packet_size);
+  std::vector< unsigned char > buf (2 * max_packet_size);
+
+  BOOST_CHECK_THROW (ring.read (&buf[0], buf.size (), 0.01),
+                     std::runtime_error);
+  BOOST_CHECK (queue.empty ());
+
+  reply (buf.size (), 0x33);
+  ring.read (&buf[0], buf.size (), 1.0);
+  BOOST_CHECK (packet (buf.size (), 0x33) == buf);
+}
+
+//! Data queued behind a short packet is not lost or misplaced
+/*! The read is spread over several transfers.  The first completes
+ *  short and the next one already holds part of the following reply
+ *  when the read ends.
+ */
+BOOST_AUTO_TEST_CASE (short_reply)
+{
+  reset ();
+  bulk_in_ring ring (0, 0, 0x81, 4, 128 * 1024, max_packet_size);
+  std::vector< unsigned char > buf (8 * max_packet_size);
+
+  reply (100, 0x01);
+  reply (max_packet_size + 10, 0x02);
+
+  ring.read (&buf[0], buf.size (), 1.0);
+  BOOST_CHECK (packet (100, 0x01) == packet (buf.begin (), buf.begin () + 100));
+  BOOST_CHECK (queue.empty ());
+  BOOST_CHECK (fifo.empty ());
+
+  buf.resize (max_packet_size + 10);
+  ring.read (&buf[0], buf.size (), 1.0);
+  BOOST_CHECK (packet (buf.size (), 0x02) == buf);
+}
+
+//! A zero-length packet ends the reply before it, not the next one
+BOOST_AUTO_TEST_CASE (zero_length_packet_after_reply)
+{
+  reset ();
+  bulk_in_ring ring (0, 0, 0x81, 4, 128 * 1024, max_packet_size);
+  std::vector< unsigned char > buf (2 * max_packet_size);
+
+  reply (buf.size (), 0x11);
+  zero_length_packet ();
+  reply (buf.size (), 0x22);
+
+  ring.read (&buf[0], buf.size (), 1.0);
+  BOOST_CHECK (packet (buf.size (), 0x11) == buf);
+
+  ring.read (&buf[0], buf.size (), 1.0);
+  BOOST_CHECK (packet (buf.size (), 0x22) == buf);
+  BOOST_CHECK (fifo.empty ());
+}
+
+BOOST_AUTO_TEST_CASE (clear_stall)
+{
+  reset ();
+  bulk_in_ring ring (0, 0, 0x81, 4, 128 * 1024, max_packet_size);
+  std::vector< unsigned char > buf (max_packet_size);
+
+  is_halted = true;
+  ring.read (&buf[0], buf.size (), 1.0);
+  BOOST_CHECK (!is_halted);
+  BOOST_CHECK (queue.empty ());
+
+  reply (max_packet_size, 0x44);
+  ring.read (&buf[0], buf.size (), 1.0);
+  BOOST_CHECK (packet (max_packet_size, 0x44) == buf);
+}
+
+#include "utsushi/test/runner.ipp"
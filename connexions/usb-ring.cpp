@@ -0,0 +1,312 @@
+//  usb-ring.cpp -- bulk IN reads spread over several USB transfers
+//  Copyright (C) 2026  SEIKO EPSON CORPORATION
+//
+//  License: GPL-3.0+
+//  Author : EPSON AVASYS CORPORATION
+//
+//  This file is part of the 'Utsushi' package.
+//  This package is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License or, at
+//  your option, any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//  You ought to have received a copy of the GNU General Public License
+//  along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#if HAVE_LIBUSB
+
+#include <sys/time.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <boost/throw_exception.hpp>
+
+#include <utsushi/clock.hpp>
+#include <utsushi/log.hpp>
+
+#include "usb-ring.hpp"
+
+namespace utsushi {
+namespace _cnx_ {
+
+#if !HAVE_LIBUSB_ERROR_NAME
+#include <sstream>
+#include <string>
+
+static std::string
+libusb_error_name (int err)
+{
+  std::ostringstream os;
+  os << err;
+  return os.str ();
+}
+#endif  /* !HAVE_LIBUSB_ERROR_NAME */
+
+using std::runtime_error;
+
+//! Maps the outcome of a failed transfer onto a libusb error code
+static int
+transfer_error (libusb_transfer_status status)
+{
+  switch (status)
+    {
+    case LIBUSB_TRANSFER_TIMED_OUT: return LIBUSB_ERROR_TIMEOUT;
+    case LIBUSB_TRANSFER_STALL    : return LIBUSB_ERROR_PIPE;
+    case LIBUSB_TRANSFER_NO_DEVICE: return LIBUSB_ERROR_NO_DEVICE;
+    case LIBUSB_TRANSFER_OVERFLOW : return LIBUSB_ERROR_OVERFLOW;
+    case LIBUSB_TRANSFER_CANCELLED: return LIBUSB_ERROR_INTERRUPTED;
+    default:
+      return LIBUSB_ERROR_IO;
+    }
+}
+
+static void
+throw_error (int err)
+{
+  log::error (libusb_error_name (err));
+  BOOST_THROW_EXCEPTION (runtime_error (libusb_error_name (err)));
+}
+
+/*! The \a size of the chunks is rounded down to a multiple of the
+ *  \a max_packet_size.  If not all transfers can be allocated, the
+ *  ring is left empty() and should not be used.
+ */
+bulk_in_ring::bulk_in_ring (libusb_context *ctx,
+                            libusb_device_handle *handle,
+                            unsigned char endpoint, std::size_t count,
+                            int size, int max_packet_size)
+  : ctx_(ctx)
+  , handle_(handle)
+  , endpoint_(endpoint)
+  , packet_size_(std::max (1, max_packet_size))
+  , chunk_size_(std::max (1, size / packet_size_) * packet_size_)
+{
+  for (std::size_t i = 0; i < count; ++i)
+    {
+      in_transfer t;
+      t.xfer = libusb_alloc_transfer (0);
+      t.is_pending = false;
+
+      if (!t.xfer)
+        {
+          log::error ("unable to allocate USB transfer");
+          for (std::size_t j = 0; j < ring_.size (); ++j)
+            libusb_free_transfer (ring_[j].xfer);
+          ring_.clear ();
+          return;
+        }
+      ring_.push_back (t);
+      ring_.back ().buf.resize (chunk_size_);
+    }
+}
+
+bulk_in_ring::~bulk_in_ring ()
+{
+  cancel_();
+  for (std::size_t i = 0; i < ring_.size (); ++i)
+    {
+      libusb_free_transfer (ring_[i].xfer);
+    }
+}
+
+bool
+bulk_in_ring::empty () const
+{
+  return ring_.empty ();
+}
+
+/*! Like a blocking transfer, the whole read needs to complete within
+ *  \a timeout seconds.
+ */
+void
+bulk_in_ring::read (unsigned char *buf, streamsize size, double timeout)
+{
+  const uint64_t deadline = microseconds () + uint64_t (1000000 * timeout);
+
+  bool has_data = false;        // a short packet ends the read
+
+  while (0 < size && !spill_.empty ())
+    {
+      segment& s (spill_.front ());
+      streamsize n = std::min (streamsize (s.data.size () - s.pos), size);
+
+      std::copy (s.data.begin () + s.pos, s.data.begin () + s.pos + n, buf);
+      buf   += n;
+      size  -= n;
+      s.pos += n;
+
+      if (0 < n) has_data = true;
+      if (s.pos < s.data.size ()) return;
+
+      bool is_done = (s.ends_reply && has_data);
+      spill_.pop_front ();
+      if (is_done) return;
+    }
+
+  // Spread what is still needed evenly over the transfers but never
+  // go below a single packet or beyond the chunk size.
+
+  streamsize chunk = (size + ring_.size () - 1) / ring_.size ();
+  chunk = (chunk + packet_size_ - 1) / packet_size_ * packet_size_;
+  chunk = std::min (chunk, streamsize (chunk_size_));
+
+  streamsize  queued = 0;       // octets asked for but not received
+  std::size_t head   = 0;       // oldest transfer in flight
+  std::size_t busy   = 0;       // number of transfers in flight
+
+  try
+    {
+      while (0 < size)
+        {
+          while (busy < ring_.size () && queued < size)
+            {
+              int n = std::min (chunk, size - queued);
+              submit_(ring_[(head + busy) % ring_.size ()], n);
+              queued += n;
+              ++busy;
+            }
+
+          in_transfer& t (ring_[head]);
+          wait_(t, deadline);
+          head = (head + 1) % ring_.size ();
+          --busy;
+
+          if (LIBUSB_TRANSFER_COMPLETED != t.xfer->status)
+            {
+              int err = transfer_error (t.xfer->status);
+
+              cancel_();
+              if (LIBUSB_ERROR_PIPE == err)
+                err = libusb_clear_halt (handle_, endpoint_);
+              if (err) throw_error (err);
+              return;
+            }
+
+          int n = t.xfer->actual_length;
+          std::copy (t.buf.begin (), t.buf.begin () + n, buf);
+          buf    += n;
+          size   -= n;
+          queued -= t.xfer->length;
+
+          if (0 < n) has_data = true;
+          if (n < t.xfer->length && has_data)
+            break;              // short packet, the device is done
+        }
+    }
+  catch (...)
+    {
+      cancel_();
+      throw;
+    }
+  keep_(head, busy);
+}
+
+void
+bulk_in_ring::submit_(in_transfer& t, int size)
+{
+  libusb_fill_bulk_transfer (t.xfer, handle_, endpoint_, &t.buf[0], size,
+                             on_completion_, &t, 0);
+
+  int err = libusb_submit_transfer (t.xfer);
+  if (err) throw_error (err);
+
+  t.is_pending = true;
+}
+
+void
+bulk_in_ring::wait_(in_transfer& t, uint64_t deadline)
+{
+  while (t.is_pending)
+    {
+      uint64_t now = microseconds ();
+      if (deadline <= now) throw_error (LIBUSB_ERROR_TIMEOUT);
+
+      uint64_t left = deadline - now;
+      struct timeval tv;
+      tv.tv_sec  = left / 1000000;
+      tv.tv_usec = left % 1000000;
+
+      int err = libusb_handle_events_timeout (ctx_, &tv);
+      if (err && LIBUSB_ERROR_INTERRUPTED != err)
+        throw_error (err);
+    }
+}
+
+/*! Cancels all pending transfers and waits for that to take effect.
+ *  Whatever those transfers received is dropped, as is anything left
+ *  over from earlier reads.
+ */
+void
+bulk_in_ring::cancel_()
+{
+  for (std::size_t i = 0; i < ring_.size (); ++i)
+    {
+      if (ring_[i].is_pending)
+        libusb_cancel_transfer (ring_[i].xfer);
+    }
+
+  for (std::size_t i = 0; i < ring_.size (); ++i)
+    {
+      while (ring_[i].is_pending)
+        {
+          int err = libusb_handle_events (ctx_);
+          if (err && LIBUSB_ERROR_INTERRUPTED != err)
+            {
+              log::error ("%1%: %2%")
+                % __func__
+                % libusb_error_name (err);
+              ring_[i].is_pending = false;      // give up rather than hang
+            }
+        }
+    }
+  spill_.clear ();
+}
+
+/*! Cancels the \a busy transfers starting at \a head and holds on to
+ *  what they received, in order, for the next read().
+ */
+void
+bulk_in_ring::keep_(std::size_t head, std::size_t busy)
+{
+  if (0 == busy) return;
+
+  std::deque< segment > spill;
+  spill.swap (spill_);
+  cancel_();
+  spill.swap (spill_);
+
+  for (std::size_t i = 0; i < busy; ++i)
+    {
+      in_transfer& t (ring_[(head + i) % ring_.size ()]);
+      segment s;
+
+      s.data.assign (t.buf.begin (), t.buf.begin () + t.xfer->actual_length);
+      s.pos = 0;
+      s.ends_reply = (LIBUSB_TRANSFER_COMPLETED == t.xfer->status
+                      && t.xfer->actual_length < t.xfer->length);
+
+      if (!s.data.empty () || s.ends_reply)
+        spill_.push_back (s);
+    }
+}
+
+void LIBUSB_CALL
+bulk_in_ring::on_completion_(libusb_transfer *xfer)
+{
+  static_cast< in_transfer * > (xfer->user_data)->is_pending = false;
+}
+
+}       // namespace _cnx_
+}       // namespace utsushi
+
+#endif  /* HAVE_LIBUSB */
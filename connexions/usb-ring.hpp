@@ -0,0 +1,116 @@
+//  usb-ring.hpp -- bulk IN reads spread over several USB transfers
+//  Copyright (C) 2026  SEIKO EPSON CORPORATION
+//
+//  License: GPL-3.0+
+//  Author : EPSON AVASYS CORPORATION
+//
+//  This file is part of the 'Utsushi' package.
+//  This package is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License or, at
+//  your option, any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//  You ought to have received a copy of the GNU General Public License
+//  along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef connexions_usb_ring_hpp_
+#define connexions_usb_ring_hpp_
+
+#if HAVE_LIBUSB
+
+#include <libusb.h>
+
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+#include <utsushi/cstdint.hpp>
+#include <utsushi/octet.hpp>
+
+namespace utsushi {
+namespace _cnx_ {
+
+//! Read from a bulk IN endpoint with several transfers in flight
+/*! Rather than waiting for the device with a single transfer of the
+ *  size asked for, a read() is spread over up to \a count transfers
+ *  of at most \a size octets that are queued at the same time.  The
+ *  device can then send the next chunk while the previous one is
+ *  being completed.
+ *
+ *  Every transfer receives into a buffer of its own and the data is
+ *  copied out in the order the transfers were queued.  All chunks but
+ *  the last are a multiple of the endpoint's maximum packet size and
+ *  the chunks add up to exactly the size asked for, so transfers
+ *  complete on a full buffer, whether or not the device ends its
+ *  reply with a zero-length packet.
+ *
+ *  A short packet ends a read() early, just like it ends a blocking
+ *  transfer.  Transfers queued behind it are cancelled but whatever
+ *  they received is kept and handed out by the next read().  A lone
+ *  zero-length packet at the start of a read() ends the reply before
+ *  it and is skipped.
+ *
+ *  Transfers are only queued for as much as a read() asks for, never
+ *  in between read() calls.  A transfer sized ahead of time may never
+ *  complete when a reply ends on a full packet without a zero-length
+ *  packet.  After a time-out or an error, all transfers are cancelled
+ *  and anything received but not yet read is dropped.
+ */
+class bulk_in_ring
+{
+public:
+  bulk_in_ring (libusb_context *ctx, libusb_device_handle *handle,
+                unsigned char endpoint, std::size_t count, int size,
+                int max_packet_size);
+  ~bulk_in_ring ();
+
+  //! Tells whether transfers could be set up at all
+  bool empty () const;
+
+  //! Reads \a size octets into \a buf within \a timeout seconds
+  void read (unsigned char *buf, streamsize size, double timeout);
+
+private:
+  struct in_transfer
+  {
+    libusb_transfer *xfer;
+    std::vector< unsigned char > buf;
+    bool is_pending;
+  };
+
+  //! Data received ahead of the read() that asks for it
+  struct segment
+  {
+    std::vector< unsigned char > data;
+    std::size_t pos;
+    bool ends_reply;            //!< received up to a short packet
+  };
+
+  void submit_(in_transfer& t, int size);
+  void wait_(in_transfer& t, uint64_t deadline);
+  void cancel_();
+  void keep_(std::size_t head, std::size_t busy);
+
+  static void LIBUSB_CALL on_completion_(libusb_transfer *xfer);
+
+  libusb_context       *ctx_;
+  libusb_device_handle *handle_;
+  unsigned char         endpoint_;
+  int                   packet_size_;
+  int                   chunk_size_;
+
+  std::vector< in_transfer > ring_;
+  std::deque< segment > spill_;
+};
+
+}       // namespace _cnx_
+}       // namespace utsushi
+
+#endif  /* HAVE_LIBUSB */
+
+#endif  /* connexions_usb_ring_hpp_ */
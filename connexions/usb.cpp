@@ -25,6 +25,7 @@
 #include <config.h>
 #endif
 
+#include <cstdlib>
 #include <iostream>
 #include <stdexcept>
 
@@ -81,6 +82,8 @@ using std::runtime_error;
 
   bool usb::is_initialised_  = false;
   int  usb::default_timeout_ = 5 * minutes;
+  std::size_t usb::default_transfer_count_ = 4;
+  int  usb::transfer_size_   = 128 * 1024;
   libusb_context *usb::ctx_  = 0;
   int usb::connexion_count_  = 0;
 
@@ -117,10 +120,31 @@ using std::runtime_error;
         (runtime_error ("no usable, matching device"));
 
     ++connexion_count_;
+
+    std::size_t count = default_transfer_count_;
+    const char *env = getenv (PACKAGE_ENV_VAR_PREFIX "USB_TRANSFERS");
+    if (env && *env)
+      count = strtoul (env, NULL, 10);
+
+    if (0 < count)
+      {
+        int max_packet_size = libusb_get_max_packet_size
+          (libusb_get_device (handle_), ep_bulk_i_);
+
+        ring_ = make_shared< bulk_in_ring > (ctx_, handle_, ep_bulk_i_,
+                                             count, transfer_size_,
+                                             max_packet_size);
+        if (ring_->empty ())
+          {
+            log::error ("falling back to blocking USB reads");
+            ring_.reset ();
+          }
+      }
   }
 
   usb::~usb (void)
   {
+    ring_.reset ();
     libusb_release_interface (handle_, if_);
     libusb_close (handle_);
 
@@ -170,6 +194,9 @@ using std::runtime_error;
   {
     unsigned char *buf = reinterpret_cast<unsigned char *> (message);
 
+    if (ring_)
+      return ring_->read (buf, size, timeout);
+
     int transferred;
     int err = libusb_bulk_transfer (handle_, ep_bulk_i_, buf, size,
                                     &transferred, 1000 * timeout);
@@ -28,10 +28,14 @@
 #include <libusb.h>
 #endif
 
+#include <cstddef>
 #include <string>
 
 #include <utsushi/connexion.hpp>
 #include <utsushi/device-info.hpp>
+#include <utsushi/memory.hpp>
+
+#include "usb-ring.hpp"
 
 namespace utsushi {
 
@@ -62,6 +66,14 @@ namespace _cnx_ {
                                          libusb_device *dev);
     bool set_bulk_endpoints_(libusb_device *dev);
 
+    //! Bulk IN transfers queued ahead of the device
+    /*! Reads are cut into several transfers that are kept in flight
+     *  at the same time.  Their number can be set with the \c UTSUSHI_\
+     *  USB_TRANSFERS environment variable.  A value of zero reverts to
+     *  a single blocking transfer of the requested size.
+     */
+    shared_ptr< bulk_in_ring > ring_;
+
     libusb_device_handle *handle_;
     int cfg_;
     int if_;
@@ -70,6 +82,8 @@ namespace _cnx_ {
 
     static bool is_initialised_;
     static int  default_timeout_;
+    static std::size_t default_transfer_count_;
+    static int  transfer_size_;
 
     static libusb_context *ctx_;
     static int connexion_count_;
@@ -177,6 +177,12 @@ scanner::read (octet *data, streamsize n)
   return active_scanner->read (data, n);
 }
 
+streamsize
+scanner::read (block& blk, streamsize n)
+{
+  return active_scanner->read (blk, n);
+}
+
 streamsize
 scanner::marker ()
 {
@@ -189,6 +195,12 @@ scanner::cancel ()
   active_scanner->cancel ();
 }
 
+bool
+scanner::is_zero_copy () const
+{
+  return active_scanner->is_zero_copy ();
+}
+
 context
 scanner::get_context () const
 {
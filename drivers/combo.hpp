@@ -52,10 +52,13 @@ public:
   connection connect_update (const update_signal_type::slot_type& slot) const;
 
   streamsize read (octet *data, streamsize n);
+  streamsize read (block& blk, streamsize n);
   streamsize marker ();
 
   void cancel ();
 
+  bool is_zero_copy () const;
+
   context get_context () const;
   option::map::ptr options ();
   streamsize buffer_size () const;
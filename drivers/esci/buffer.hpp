@@ -93,6 +93,12 @@ public:
   {
     return !base::empty ();
   }
+
+  //! Exchanges contents with \a that without copying any data
+  void swap (basic_buffer& that)
+  {
+    base::swap (that);
+  }
 };
 
 template< typename T >
@@ -23,9 +23,10 @@
 
 #include <stdexcept>
 
-#include <boost/shared_array.hpp>
 #include <boost/throw_exception.hpp>
 
+#include <utsushi/memory.hpp>
+
 #include "code-point.hpp"
 
 namespace utsushi {
@@ -36,7 +37,7 @@ namespace _drv_ {
 
     class chunk
     {
-      boost::shared_array<byte> buffer_;
+      shared_ptr<byte> buffer_;
       streamsize buffer_size_;
       bool error_code_;
 
@@ -49,8 +50,9 @@ namespace _drv_ {
         if (0 < buffer_size_
             || error_code_)
           {
-            buffer_ = boost::shared_array<byte>
-              (new byte[ buffer_size_ + (error_code_ ? 1 : 0) ]);
+            buffer_ = shared_ptr<byte>
+              (new byte[ buffer_size_ + (error_code_ ? 1 : 0) ],
+               array_deleter<byte> ());
           }
       }
 
@@ -63,7 +65,7 @@ namespace _drv_ {
       {
         if (error_code_)
           {
-            return buffer_[size (true) - 1];
+            return buffer_.get ()[size (true) - 1];
           }
 
         BOOST_THROW_EXCEPTION (logic_error (""));
@@ -74,6 +76,12 @@ namespace _drv_ {
         return buffer_.get ();
       }
 
+      //! Shares ownership of the data with the caller
+      shared_ptr<const byte> share () const
+      {
+        return buffer_;
+      }
+
       operator byte * ()
       {
         return buffer_.get ();
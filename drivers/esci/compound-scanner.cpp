@@ -23,14 +23,21 @@
 #endif
 
 #include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <iterator>
 #include <limits>
+#include <set>
 #include <stdexcept>
 #include <string>
 
+#include <unistd.h>
+
 #include <boost/assert.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/fstream.hpp>
 #include <boost/foreach.hpp>
+#include <boost/lexical_cast.hpp>
 #include <boost/static_assert.hpp>
 #include <boost/throw_exception.hpp>
 
@@ -45,6 +52,7 @@
 
 #include "compound-scanner.hpp"
 #include "scanner-inquiry.hpp"
+#include "status-poller.hpp"
 
 #define for_each BOOST_FOREACH
 
@@ -60,6 +68,10 @@ using std::ios_base;
 
 namespace fs = boost::filesystem;
 
+static fs::path cache_file_(const information& info);
+static void record_(byte_buffer& blocks, const compound_base& cmd,
+                    const quad& code);
+
 static system_error::error_code token_to_error_code (const quad& what);
 static std::string create_message (const quad& part, const quad& what);
 static system_error::error_code
@@ -368,11 +380,12 @@ do_mechanics (connexion::ptr cnx, scanner_control& ctrl,
                 *cnx << ctrl.mechanics (part, action);
                 if (!ctrl.fatal_error())
                   {
+                    status_poller poller;
                     do
                       {
                         *cnx << ctrl.get (stat);
                       }
-                    while (ctrl.is_busy () && ctrl.delay_elapsed ());
+                    while (ctrl.is_busy () && poller.wait ());
 
                     if (!ctrl.fatal_error())
                       {
@@ -432,12 +445,22 @@ erase (std::vector< quad >& v, const quad& token)
 
 compound_scanner::compound_scanner (const connexion::ptr& cnx)
   : scanner (cnx)
+  , keep_session_(false)
+  , prefetch_depth_(4)
+  , prefetch_armed_(false)
+  , prefetch_thread_(nullptr)
+  , prefetch_done_(true)
+  , prefetch_stop_(false)
+  , prefetch_media_out_(false)
+  , prefetch_duplexing_(false)
   , info_()                     // initialize reference data
   , caps_() , caps_flip_()
   , defs_() , defs_flip_()
   , min_area_width_(0.05)
   , min_area_height_(0.05)
   , read_back_(true)
+  , buffer_(make_shared< data_buffer > ())
+  , offset_(0)
   , streaming_flip_side_image_(false)
   , image_count_(0)
   , cancelled_(false)
@@ -447,29 +470,63 @@ compound_scanner::compound_scanner (const connexion::ptr& cnx)
   , adf_duplex_max_doc_width_(0.)
   , adf_duplex_max_doc_height_(0.)
 {
+  namespace reply = code_token::reply;
+
+  std::string cache;            // device replies, if any, go here
+  bool is_cached = false;
+  bool has_cached_defs = false;
+  byte_buffer blocks;
+
   {
     log::trace ("getting basic device information");
 
     scanner_inquiry cmd;
 
     *cnx_ << cmd.get (const_cast< information&  > (info_));
-    *cnx_ << cmd.get (const_cast< capabilities& > (caps_));
-    *cnx_ << cmd.get (const_cast< capabilities& > (caps_flip_), true);
+
+    cache = cache_file_(info_).string ();
+    is_cached = get_cached_defs_(cache, has_cached_defs);
+
+    if (!is_cached)
+      {
+        record_(blocks, cmd, reply::INFO);
+        *cnx_ << cmd.get (const_cast< capabilities& > (caps_));
+        record_(blocks, cmd, reply::CAPA);
+        *cnx_ << cmd.get (const_cast< capabilities& > (caps_flip_), true);
+        record_(blocks, cmd, reply::CAPB);
+      }
   }
 
-  if (!get_file_defs_(info_.product_name ()))
+  if (!get_file_defs_(info_.product_name ()) && !has_cached_defs)
     {
       log::error ("falling back to device defaults");
 
       scanner_control cmd;      // resets device state
 
+      blocks.clear ();
       *cnx_ << cmd.get (const_cast< information&  > (info_));
+      record_(blocks, cmd, reply::INFO);
       *cnx_ << cmd.get (const_cast< capabilities& > (caps_));
+      record_(blocks, cmd, reply::CAPA);
       *cnx_ << cmd.get (const_cast< capabilities& > (caps_flip_), true);
+      record_(blocks, cmd, reply::CAPB);
       *cnx_ << cmd.get (const_cast< parameters&   > (defs_));
+      record_(blocks, cmd, reply::RESA);
       *cnx_ << cmd.get (const_cast< parameters&   > (defs_flip_), true);
+      record_(blocks, cmd, reply::RESB);
+
+      is_cached = false;
     }
 
+  if (!is_cached) put_cached_defs_(cache, blocks);
+
+  const char *env = getenv (PACKAGE_ENV_VAR_PREFIX "KEEP_SESSION");
+  keep_session_ = (env && 0 != strtoul (env, NULL, 10));
+
+  env = getenv (PACKAGE_ENV_VAR_PREFIX "PREFETCH_DEPTH");
+  if (env && *env)
+    prefetch_depth_ = strtoul (env, NULL, 10);
+
   // Initialize private protocol extension bits
   // These capabilities don't make sense for the flip-side only so
   // there's no need to set them for caps_flip_.
@@ -525,6 +582,11 @@ compound_scanner::compound_scanner (const connexion::ptr& cnx)
     }
 }
 
+compound_scanner::~compound_scanner ()
+{
+  stop_prefetch_();
+}
+
 void
 compound_scanner::configure ()
 {
@@ -777,11 +839,21 @@ compound_scanner::is_single_image () const
           || value (1) == *values_["image-count"]);
 }
 
+bool
+compound_scanner::is_zero_copy () const
+{
+  return true;
+}
+
 bool
 compound_scanner::is_consecutive () const
 {
   bool rv (parm_.adf || parm_flip_.adf);
-  if (!rv) *cnx_ << acquire_.finish ();
+  if (!rv)
+    {
+      const_cast< compound_scanner * > (this)->stop_prefetch_();
+      end_session_();
+    }
   return rv;
 }
 
@@ -795,10 +867,10 @@ at_image_start (const std::deque< data_buffer >& q)
 bool
 compound_scanner::obtain_media ()
 {
-  buffer_.clear ();
+  buffer_ = make_shared< data_buffer > ();
   offset_ = 0;
 
-  if (acquire_.is_duplexing ())
+  if (is_duplexing_())
     streaming_flip_side_image_ = (1 == image_count_ % 2);
 
   deque< data_buffer >& q (streaming_flip_side_image_ ? rear_ : face_);
@@ -809,7 +881,11 @@ compound_scanner::obtain_media ()
     }
 
   bool rv (!cancelled_ && !media_out () && at_image_start (q));
-  if (!rv) *cnx_ << acquire_.finish ();
+  if (!rv)
+    {
+      stop_prefetch_();
+      end_session_();
+    }
   return rv;
 }
 
@@ -820,6 +896,7 @@ compound_scanner::set_up_image ()
 
   if (cancelled_)
     {
+      stop_prefetch_();
       *cnx_ << acquire_.finish ();
       return false;
     }
@@ -833,19 +910,19 @@ compound_scanner::set_up_image ()
 
   ctx_.content_type (transfer_content_type_(parm_));
 
-  if (buffer_.pst
-      && 0 != buffer_.pst->padding
+  if (buffer_->pst
+      && 0 != buffer_->pst->padding
       && compressed_transfer_(parm_))
     {
       log::alert ("ignoring %1% byte padding")
-        % buffer_.pst->padding;
-      buffer_.pst->padding = 0;
+        % buffer_->pst->padding;
+      buffer_->pst->padding = 0;
     }
 
-  if (buffer_.pst)
+  if (buffer_->pst)
     {
-      ctx_.width (buffer_.pst->width, buffer_.pst->padding);
-      ctx_.height (buffer_.pst->height);
+      ctx_.width (buffer_->pst->width, buffer_->pst->padding);
+      ctx_.height (buffer_->pst->height);
     }
   else
     {
@@ -864,23 +941,35 @@ compound_scanner::finish_image ()
 
 streamsize
 compound_scanner::sgetn (octet *data, streamsize n)
+{
+  block blk;
+  streamsize rv = sgetn (blk, n);
+
+  if (0 < rv) traits::copy (data, blk.data (), rv);
+
+  return rv;
+}
+
+streamsize
+compound_scanner::sgetn (block& blk, streamsize n)
 {
   data_buffer::size_type sz (n);
 
-  if (offset_ == buffer_.size ())
+  if (offset_ == buffer_->size ())
     {
       fill_data_queue_();
       if (cancelled_)
         {
+          stop_prefetch_();
           *cnx_ << acquire_.finish ();
           return traits::eof ();
         }
     }
 
-  streamsize rv = std::min (buffer_.size () - offset_, sz);
+  streamsize rv = std::min (buffer_->size () - offset_, sz);
 
-  traits::copy (data, reinterpret_cast< const octet * >
-                (buffer_.data () + offset_), rv);
+  blk = block (buffer_, reinterpret_cast< const octet * >
+               (buffer_->data () + offset_), rv);
   offset_ += rv;
 
   return rv;
@@ -915,6 +1004,7 @@ compound_scanner::set_up_initialize ()
   parm_      = defs_;
   parm_flip_ = defs_flip_;
 
+  clear_prefetch_();
   streaming_flip_side_image_ = false;
   face_.clear ();
   rear_.clear ();
@@ -977,25 +1067,17 @@ compound_scanner::set_up_initialize ()
 bool
 compound_scanner::set_up_hardware ()
 {
-  *cnx_ << acquire_.set (parm_);
-  if (read_back_)
+  if (!acquire_.is_in_session ())
     {
-      parameters requested (parm_);
-      *cnx_ << acquire_.get (parm_);
-      if (requested != parm_)
-        log::alert ("scan parameters not set as requested");
+      acked_      = boost::none;
+      acked_flip_ = boost::none;
     }
 
+  send_parameters_(parm_, false);
+
   if (caps_flip_)
     {
-      *cnx_ << acquire_.set (parm_flip_, true);
-      if (read_back_)
-        {
-          parameters requested (parm_flip_);
-          *cnx_ << acquire_.get (parm_flip_, true);
-          if (requested != parm_flip_)
-            log::alert ("flip side scan parameters not set as requested");
-        }
+      send_parameters_(parm_flip_, true);
     }
   else
     {
@@ -1041,9 +1123,88 @@ compound_scanner::set_up_hardware ()
   if (parm_.bsz)
     buffer_size_ = *parm_.bsz;
 
+  prefetch_armed_ = true;
+
   return true;
 }
 
+/*! Only the changes with respect to the last acknowledged values are
+ *  sent if there are any such values and the changes say it all.  A
+ *  page count is always sent because the device counts it down while
+ *  scanning.
+ *
+ *  Sending a full set of values for the face side is assumed to set
+ *  the same values for the flip side.  Sending only changes for the
+ *  face side is assumed to merge them into the flip side's values.
+ */
+void
+compound_scanner::send_parameters_(parameters& parm, bool flip_side_only)
+{
+  boost::optional< parameters >& acked (flip_side_only
+                                        ? acked_flip_
+                                        : acked_);
+  parameters delta;
+
+  if (keep_session_ && acked && parm.changes (*acked, delta))
+    {
+      if (parm.pag) delta.pag = parm.pag;
+
+      if (delta == parameters ())
+        {
+          log::trace ("%1%scan parameters unchanged")
+            % (flip_side_only ? "flip side " : "");
+          return;
+        }
+
+      *cnx_ << acquire_.set (parm, delta, flip_side_only);
+      if (acquire_.is_parameter_set_ok ())
+        {
+          if (!flip_side_only && acked_flip_)
+            acked_flip_->merge (delta);
+          acked = parm;
+          return;
+        }
+      log::alert ("%1%scan parameter changes not accepted"
+                  ", sending all of them")
+        % (flip_side_only ? "flip side " : "");
+    }
+
+  *cnx_ << acquire_.set (parm, flip_side_only);
+
+  bool ok = acquire_.is_parameter_set_ok ();
+
+  if (read_back_ && !(keep_session_ && ok))
+    {
+      parameters requested (parm);
+      *cnx_ << acquire_.get (parm, flip_side_only);
+      if (requested != parm)
+        log::alert ("%1%scan parameters not set as requested")
+          % (flip_side_only ? "flip side " : "");
+    }
+
+  if (ok) acked = parm;
+  else    acked = boost::none;
+
+  if (!flip_side_only) acked_flip_ = boost::none;
+}
+
+//! Ends a scan sequence's compound session if not worth keeping
+/*! Sessions are only kept when so requested and the scan sequence
+ *  ended without the device acquiring or being cancelled.
+ */
+void
+compound_scanner::end_session_() const
+{
+  if (keep_session_ && !cancelled_ && !acquire_.is_acquiring ()
+      && acquire_.is_in_session ())
+    {
+      log::trace ("keeping compound session for the next scan sequence");
+      return;
+    }
+
+  *cnx_ << acquire_.finish ();
+}
+
 void
 compound_scanner::set_up_color_matrices ()
 {
@@ -1468,6 +1629,48 @@ compound_scanner::transfer_content_type_(const parameters& p) const
 void
 compound_scanner::queue_image_data_()
 {
+  if (prefetch_armed_) start_prefetch_();
+
+  if (is_prefetching_())
+    {
+      prefetch_item item;
+
+      if (next_prefetch_item_(item))
+        {
+          if (item.error)
+            {
+              stop_prefetch_();
+              rethrow_exception (item.error);
+            }
+
+          cancelled_ = (item.buf.empty ()
+                        && (item.do_cancel || item.buf.is_cancel_requested ()));
+          if (cancelled_) cancel ();
+
+          prefetch_media_out_ = item.media_out;
+          prefetch_duplexing_ = item.duplexing;
+
+          deque< data_buffer >& q (item.buf.is_flip_side () ? rear_ : face_);
+
+          q.push_back (data_buffer ());
+          q.back ().swap (item.buf);
+
+          if (item.fatal_error)
+            {
+              std::vector < status::error > error (*item.fatal_error);
+
+              stop_prefetch_();
+              *cnx_ << acquire_.finish ();
+
+              BOOST_THROW_EXCEPTION
+                (system_error
+                 (token_to_error_code (error), create_message (error)));
+            }
+          return;
+        }
+      stop_prefetch_();         // all caught up, carry on without
+    }
+
   bool do_cancel = cancel_requested ();
 
   if (do_cancel) acquire_.cancel ();
@@ -1482,10 +1685,10 @@ compound_scanner::queue_image_data_()
       //*cnx_ << acquire_.finish ();
     }
 
-  if (buf.is_flip_side ())
-    rear_.push_back (buf);
-  else
-    face_.push_back (buf);
+  deque< data_buffer >& q (buf.is_flip_side () ? rear_ : face_);
+
+  q.push_back (data_buffer ());
+  q.back ().swap (buf);
 
   if (acquire_.fatal_error ())
     {
@@ -1515,17 +1718,166 @@ compound_scanner::fill_data_queue_()
       patch_image_size_(q, transfer_format_(p));
     }
 
-  buffer_ = q.front ();
+  buffer_ = make_shared< data_buffer > ();
+  buffer_->swap (q.front ());
   q.pop_front ();
 
   offset_    = 0;
-  media_out_ = buffer_.media_out ();
+  media_out_ = buffer_->media_out ();
 }
 
 bool
 compound_scanner::media_out () const
 {
-  return (media_out_ || acquire_.media_out ());
+  return (media_out_
+          || (is_prefetching_()
+              ? prefetch_media_out_
+              : acquire_.media_out ()));
+}
+
+bool
+compound_scanner::is_duplexing_() const
+{
+  return (is_prefetching_()
+          ? prefetch_duplexing_
+          : acquire_.is_duplexing ());
+}
+
+void
+compound_scanner::start_prefetch_()
+{
+  prefetch_armed_ = false;
+
+  if (0 == prefetch_depth_ || !acquire_.is_acquiring ()) return;
+
+  prefetch_media_out_ = acquire_.media_out ();
+  prefetch_duplexing_ = acquire_.is_duplexing ();
+
+  prefetch_done_ = false;
+  prefetch_stop_ = false;
+  prefetch_thread_ = new thread (&compound_scanner::prefetch_, this);
+}
+
+/*! Image data that was prefetched but not yet handed out stays in
+ *  the queue.  Later queue_image_data_() calls hand it out before they
+ *  request anything from the device so that nothing gets lost.  It is
+ *  safe to call this when no thread is running.
+ */
+void
+compound_scanner::stop_prefetch_()
+{
+  prefetch_armed_ = false;
+
+  if (!prefetch_thread_) return;
+
+  {
+    lock_guard< mutex > lock (prefetch_mutex_);
+    prefetch_stop_ = true;
+  }
+  prefetch_not_full_.notify_one ();
+
+  prefetch_thread_->join ();
+  delete prefetch_thread_;
+  prefetch_thread_ = nullptr;
+}
+
+//! Tells whether image data is to be taken from the prefetch queue
+bool
+compound_scanner::is_prefetching_() const
+{
+  return prefetch_thread_ || !prefetch_queue_.empty ();
+}
+
+//! Throws away whatever image data was prefetched
+void
+compound_scanner::clear_prefetch_()
+{
+  stop_prefetch_();
+  prefetch_queue_.clear ();
+}
+
+void
+compound_scanner::prefetch_()
+{
+  unique_lock< mutex > lock (prefetch_mutex_);
+
+  bool done = false;
+  while (!done)
+    {
+      // Cancellation needs to reach the device even if the queue is
+      // full
+
+      while (!prefetch_stop_
+             && prefetch_depth_ <= prefetch_queue_.size ()
+             && !cancel_requested ())
+        prefetch_not_full_.wait (lock);
+
+      if (prefetch_stop_) break;
+
+      lock.unlock ();
+
+      shared_ptr< prefetch_item > ip (make_shared< prefetch_item > ());
+      try
+        {
+          ip->do_cancel = cancel_requested ();
+          if (ip->do_cancel) acquire_.cancel ();
+
+          data_buffer buf = ++acquire_;
+          ip->buf.swap (buf);
+
+          ip->media_out   = acquire_.media_out ();
+          ip->duplexing   = acquire_.is_duplexing ();
+          ip->fatal_error = acquire_.fatal_error ();
+
+          done = (ip->fatal_error
+                  || !acquire_.is_acquiring ()
+                  || (ip->buf.empty ()
+                      && (ip->do_cancel || ip->buf.is_cancel_requested ())));
+        }
+      catch (...)
+        {
+          ip->error = current_exception ();
+          done = true;
+        }
+
+      lock.lock ();
+      prefetch_queue_.push_back (ip);
+      prefetch_not_empty_.notify_one ();
+    }
+
+  prefetch_done_ = true;
+  prefetch_not_empty_.notify_one ();
+}
+
+/*! Blocks until the prefetch thread has queued an \a item or is done.
+ *
+ *  \returns A \c false value if there are no more items.
+ */
+bool
+compound_scanner::next_prefetch_item_(prefetch_item& item)
+{
+  unique_lock< mutex > lock (prefetch_mutex_);
+
+  if (cancel_requested ()) prefetch_not_full_.notify_one ();
+
+  while (prefetch_queue_.empty () && !prefetch_done_)
+    prefetch_not_empty_.wait (lock);
+
+  if (prefetch_queue_.empty ()) return false;
+
+  shared_ptr< prefetch_item > ip (prefetch_queue_.front ());
+  prefetch_queue_.pop_front ();
+  prefetch_not_full_.notify_one ();
+  lock.unlock ();
+
+  item.buf.swap (ip->buf);
+  item.do_cancel   = ip->do_cancel;
+  item.media_out   = ip->media_out;
+  item.duplexing   = ip->duplexing;
+  item.fatal_error = ip->fatal_error;
+  item.error       = ip->error;
+
+  return true;
 }
 
 bool
@@ -1567,9 +1919,6 @@ compound_scanner::enough_image_data_(const parameters& parm,
           : !q.empty ());
 }
 
-/*! \todo Make repeat_count configurable
- *  \todo Make delay time interval configurable
- */
 media
 compound_scanner::probe_media_size_(const string& doc_source)
 {
@@ -1583,18 +1932,7 @@ compound_scanner::probe_media_size_(const string& doc_source)
 
   if (src)
     {
-      int repeat_count = 5;
-      do
-        {
-          *cnx_ << acquire_.get (stat_);
-        }
-      while (!stat_.size_detected (src)
-             && acquire_.delay_elapsed ()
-             && --repeat_count);
-
-      *cnx_ << acquire_.finish ();
-
-      if (stat_.size_detected (src))
+      if (wait_for_media_(src, media_size_budget))
         {
           size = stat_.size (src);
         }
@@ -1614,6 +1952,37 @@ compound_scanner::probe_media_size_(const string& doc_source)
   return size;
 }
 
+//! Waits for media to land on \a src and have its size detected
+/*! The device's hardware status is polled until it reports a size
+ *  for the \a src or the \a budget (in milliseconds) has been used
+ *  up.  Polling backs off while nothing happens and speeds up again
+ *  on a status change or push button event.
+ *
+ *  \returns A \c true value if a media size was detected.
+ */
+bool
+compound_scanner::wait_for_media_(const quad& src, long budget)
+{
+  bool do_finish = !acquire_.is_in_session ();
+  status_poller poller (10, 100, budget);
+  hardware_status last;
+
+  *cnx_ << acquire_.get (stat_);
+  while (!stat_.size_detected (src))
+    {
+      if (stat_ != last) poller.activity ();
+      poller.push_button (stat_.event ());
+      last = stat_;
+
+      if (!poller.wait ()) break;
+      *cnx_ << acquire_.get (stat_);
+    }
+
+  if (do_finish) *cnx_ << acquire_.finish ();
+
+  return stat_.size_detected (src);
+}
+
 void
 compound_scanner::update_scan_area_(const media& size, value::map& vm) const
 {
@@ -2994,41 +3363,28 @@ map_(std::string product)
   return rt.data_file (run_time::pkg, product + ".dat");
 }
 
-bool
-compound_scanner::get_file_defs_(const std::string& product)
+//! Decodes a \a file with reply blocks as sent by a device
+/*! Each reply block consists of a 12 byte header and its payload.
+ *  Information, capabilities and scan parameter replies are decoded
+ *  into the corresponding arguments.  The \a codes of all replies
+ *  seen are collected as well.
+ */
+static bool
+read_reply_blocks_(const fs::path& file, information& info,
+                   capabilities& caps, capabilities& caps_flip,
+                   parameters& parm, parameters& parm_flip,
+                   std::set< quad >& codes)
 {
-  log::trace ("trying to get device information from file");
-
-  if (product.empty ())
-    {
-      log::error ("product name unknown");
-      return false;
-    }
-
-  fs::path refspec (map_(product));
-
-  if (!fs::exists (refspec))
-    {
-      log::trace ("file not found: %1%") % refspec;
-      return false;
-    }
-
-  fs::basic_ifstream< byte > fs (refspec, ios_base::binary | ios_base::in);
+  fs::basic_ifstream< byte > fs (file, ios_base::binary | ios_base::in);
 
   if (!fs.is_open ())
     {
-      log::error ("cannot read %1%") % refspec;
+      log::error ("cannot read %1%") % file;
       return false;
     }
 
   // Based on code from verify.cpp
 
-  information  info;
-  capabilities caps;
-  capabilities caps_flip;
-  parameters   parm;
-  parameters   parm_flip;
-
   byte_buffer blk;
   header      hdr;
 
@@ -3060,6 +3416,8 @@ compound_scanner::get_file_defs_(const std::string& product)
             % hdr.size
             ;
 
+          codes.insert (hdr.code);
+
           if (0 == hdr.size) continue;
 
           blk.resize (hdr.size);
@@ -3112,6 +3470,40 @@ compound_scanner::get_file_defs_(const std::string& product)
       return false;
     }
 
+  return true;
+}
+
+bool
+compound_scanner::get_file_defs_(const std::string& product)
+{
+  log::trace ("trying to get device information from file");
+
+  if (product.empty ())
+    {
+      log::error ("product name unknown");
+      return false;
+    }
+
+  fs::path refspec (map_(product));
+
+  if (!fs::exists (refspec))
+    {
+      log::trace ("file not found: %1%") % refspec;
+      return false;
+    }
+
+  information  info;
+  capabilities caps;
+  capabilities caps_flip;
+  parameters   parm;
+  parameters   parm_flip;
+
+  std::set< quad > codes;
+
+  if (!read_reply_blocks_(refspec, info, caps, caps_flip, parm, parm_flip,
+                          codes))
+    return false;
+
   // Data files may modify product and version information for other
   // purposes.  Make sure to keep values obtained from the device.
   info.product = info_.product;
@@ -3138,11 +3530,147 @@ compound_scanner::get_file_defs_(const std::string& product)
   return true;
 }
 
+//! Determines where device replies for \a info are cached
+/*! Cached replies are keyed by product name and firmware version.
+ *  An empty path is returned if replies should not be cached.  This
+ *  is the case when the cache directory's environment variable is set
+ *  but empty.
+ */
+static fs::path
+cache_file_(const information& info)
+{
+  fs::path dir;
+
+  const char *env = getenv (PACKAGE_ENV_VAR_PREFIX "CACHE_DIR");
+  if (env)
+    {
+      if (!*env) return fs::path ();
+      dir = env;
+    }
+  else if ((env = getenv ("XDG_CACHE_HOME")) && *env)
+    dir = fs::path (env) / PACKAGE_TARNAME;
+  else if ((env = getenv ("HOME")) && *env)
+    dir = fs::path (env) / ".cache" / PACKAGE_TARNAME;
+  else
+    return fs::path ();
+
+  std::string name (info.product_name ());
+  if (name.empty ()) return fs::path ();
+
+  name += "-" + std::string (info.version.begin (), info.version.end ());
+  for (std::string::iterator it = name.begin (); name.end () != it; ++it)
+    {
+      if (!isalnum (*it) && '-' != *it && '.' != *it) *it = '_';
+    }
+
+  return dir / "esci" / (name + ".dat");
+}
+
+//! Appends the reply to a \a cmd's last request to a set of \a blocks
+/*! Only replies with the expected \a code are kept.
+ */
+static void
+record_(byte_buffer& blocks, const compound_base& cmd, const quad& code)
+{
+  if (code != cmd.reply_code ()) return;
+
+  const streamsize hdr_len = 12;
+  const byte_buffer& hdr (cmd.reply_header_block ());
+  const byte_buffer& dat (cmd.reply_data_block ());
+
+  std::copy (hdr.begin (), hdr.begin () + hdr_len,
+             std::back_inserter (blocks));
+  std::copy (dat.begin (), dat.end (), std::back_inserter (blocks));
+}
+
+bool
+compound_scanner::get_cached_defs_(const std::string& file, bool& has_defs)
+{
+  has_defs = false;
+
+  if (file.empty () || !fs::exists (file)) return false;
+
+  log::trace ("trying to get device information from %1%") % file;
+
+  information  info;
+  capabilities caps;
+  capabilities caps_flip;
+  parameters   parm;
+  parameters   parm_flip;
+
+  std::set< quad > codes;
+
+  namespace reply = code_token::reply;
+
+  if (!read_reply_blocks_(file, info, caps, caps_flip, parm, parm_flip,
+                          codes)
+      || !codes.count (reply::CAPA))
+    {
+      log::error ("ignoring unusable cache file: %1%") % file;
+      return false;
+    }
+  if (info_ != info)
+    {
+      log::brief ("device information changed, ignoring %1%") % file;
+      return false;
+    }
+
+  const_cast< capabilities& > (caps_     ) = caps;
+  const_cast< capabilities& > (caps_flip_) = caps_flip;
+
+  has_defs = codes.count (reply::RESA);
+  if (has_defs)
+    {
+      const_cast< parameters& > (defs_     ) = parm;
+      const_cast< parameters& > (defs_flip_) = parm_flip;
+    }
+
+  log::brief ("using cached device replies from %1%") % file;
+  return true;
+}
+
+void
+compound_scanner::put_cached_defs_(const std::string& file,
+                                   const byte_buffer& blocks) const
+{
+  if (file.empty () || blocks.empty ()) return;
+
+  // Write to a process specific file first, then move it into place
+  // so that concurrent readers never see a partially written file.
+
+  fs::path tmp (file + "."
+                + boost::lexical_cast< std::string > (getpid ()));
+
+  try
+    {
+      fs::create_directories (fs::path (file).parent_path ());
+
+      fs::basic_ofstream< byte > os (tmp, (ios_base::binary
+                                           | ios_base::out
+                                           | ios_base::trunc));
+      os.write (blocks.data (), blocks.size ());
+      os.close ();
+
+      if (!os)
+        {
+          log::error ("cannot write %1%") % tmp;
+          fs::remove (tmp);
+          return;
+        }
+      fs::rename (tmp, file);
+      log::brief ("cached device replies in %1%") % file;
+    }
+  catch (const fs::filesystem_error& e)
+    {
+      log::error ("%1%") % e.what ();
+    }
+}
+
 context::size_type
 compound_scanner::pixel_width () const
 {
-  if (buffer_.pen) return buffer_.pen->width;
-  if (buffer_.pst) return buffer_.pst->width;
+  if (buffer_->pen) return buffer_->pen->width;
+  if (buffer_->pst) return buffer_->pst->width;
 
   const parameters& p (streaming_flip_side_image_ ? parm_flip_ : parm_);
 
@@ -3154,8 +3682,8 @@ compound_scanner::pixel_width () const
 context::size_type
 compound_scanner::pixel_height () const
 {
-  if (buffer_.pen) return buffer_.pen->height;
-  if (buffer_.pst) return buffer_.pst->height;
+  if (buffer_->pen) return buffer_->pen->height;
+  if (buffer_->pst) return buffer_->pst->height;
 
   const parameters& p (streaming_flip_side_image_ ? parm_flip_ : parm_);
 
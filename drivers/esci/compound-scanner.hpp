@@ -24,9 +24,13 @@
 #include <deque>
 #include <string>
 
+#include <utsushi/condition-variable.hpp>
 #include <utsushi/connexion.hpp>
 #include <utsushi/constraint.hpp>
 #include <utsushi/context.hpp>
+#include <utsushi/exception.hpp>
+#include <utsushi/mutex.hpp>
+#include <utsushi/thread.hpp>
 
 #include "buffer.hpp"
 #include "scanner.hpp"
@@ -41,10 +45,12 @@ class compound_scanner : public scanner
 {
 public:
   compound_scanner (const connexion::ptr& cnx);
+  ~compound_scanner ();
 
   void configure ();
 
   bool is_single_image () const;
+  bool is_zero_copy () const;
 
 protected:
   bool is_consecutive () const;
@@ -52,6 +58,7 @@ protected:
   bool set_up_image ();
   void finish_image ();
   streamsize sgetn (octet *data, streamsize n);
+  streamsize sgetn (block& blk, streamsize n);
 
   void set_up_initialize ();
   bool set_up_hardware ();
@@ -74,9 +81,89 @@ protected:
   bool compressed_transfer_(const parameters& p) const;
   std::string transfer_content_type_(const parameters& p) const;
 
+  //! Compound session reuse across scan sequences
+  /*! Normally, every scan sequence ends by finishing the compound
+   *  session and the next one sends a full set of scan parameters,
+   *  reading them back afterwards if read_back_ is set.  When the
+   *  \c keep_session_ flag is set, a session that ended its scan
+   *  sequence without trouble is kept open.  The next sequence then
+   *  only sends the scan parameters that differ from the last set
+   *  the device accepted and skips reading them back if the device
+   *  accepted them as is.
+   *
+   *  The flag is set when the \c KEEP_SESSION environment variable
+   *  (with the package's prefix) is set to a non-zero number.  Keep
+   *  in mind that other users cannot get at a device while we have
+   *  a session open.
+   */
+  //! @{
+  void send_parameters_(parameters& parm, bool flip_side_only);
+  void end_session_() const;
+
+  bool keep_session_;
+  boost::optional< parameters > acked_;
+  boost::optional< parameters > acked_flip_;
+  //! @}
+
   void queue_image_data_();
   void fill_data_queue_();
   bool media_out () const;
+  bool is_duplexing_() const;
+
+  //! Image data acquisition on a thread of its own
+  /*! Requesting image data from the device and decoding it into an
+   *  image are interleaved when done on a single thread.  With a \c
+   *  prefetch_depth_ other than zero, a thread is started on the
+   *  first queue_image_data_() call of a scan sequence that keeps on
+   *  requesting image data until it is \c prefetch_depth_ transfers
+   *  ahead of the queue_image_data_() calls.  Device I/O then takes
+   *  place while earlier transfers are being decoded.
+   *
+   *  The thread stops once the device is done acquiring, has run into
+   *  a fatal error or the acquisition has been cancelled.  Any state
+   *  of acquire_ that is needed afterwards is taken along with every
+   *  transfer so that it can be inspected in the order that transfers
+   *  are handed out.  stop_prefetch_() has to be called before any
+   *  other use of acquire_.  Transfers that were already queued when
+   *  the thread is stopped are still handed out, ahead of anything
+   *  requested afterwards.  Only clear_prefetch_() drops them.
+   *
+   *  Four transfers ahead keeps the device going through the odd slow
+   *  decode without holding on to much memory.  The \c PREFETCH_DEPTH
+   *  environment variable (with the package's prefix) overrides this.
+   *  A value of zero turns prefetching off.
+   */
+  //! @{
+  struct prefetch_item
+  {
+    data_buffer buf;
+    bool do_cancel;
+    bool media_out;
+    bool duplexing;
+    boost::optional< std::vector< status::error > > fatal_error;
+    exception_ptr error;
+  };
+
+  void start_prefetch_();
+  void stop_prefetch_();
+  void clear_prefetch_();
+  bool is_prefetching_() const;
+  void prefetch_();
+  bool next_prefetch_item_(prefetch_item& item);
+
+  std::size_t prefetch_depth_;
+  bool        prefetch_armed_;  //!< thread not yet started this scan
+  thread     *prefetch_thread_;
+  mutex       prefetch_mutex_;
+  condition_variable prefetch_not_empty_;
+  condition_variable prefetch_not_full_;
+  std::deque< shared_ptr< prefetch_item > > prefetch_queue_;
+  bool        prefetch_done_;   //!< no more items will be queued
+  bool        prefetch_stop_;
+
+  bool prefetch_media_out_;     //!< as of the last item handed out
+  bool prefetch_duplexing_;     //!< as of the last item handed out
+  //! @}
 
   //! Image size information policy query
   /*! The image size reported at the start of image data acquisition
@@ -90,6 +177,7 @@ protected:
                           const std::deque< data_buffer >& q) const;
 
   media probe_media_size_(const string& doc_source);
+  bool  wait_for_media_(const quad& src, long budget);
   void  update_scan_area_(const media& size, value::map& vm) const;
   void  update_scan_area_range_(value::map& vm);
 
@@ -173,6 +261,20 @@ protected:
    */
   bool get_file_defs_(const std::string& product);
 
+  //! Tries to get capabilities from replies cached in a \a file
+  /*! Cached replies are only used if the device information they
+   *  include matches what the device just told us.  Default scan
+   *  parameters are used as well if available, as indicated by \a
+   *  has_defs.
+   *
+   *  \returns A \c true value if successful, \c false otherwise.
+   */
+  bool get_cached_defs_(const std::string& file, bool& has_defs);
+
+  //! Saves raw device reply \a blocks for get_cached_defs_()
+  void put_cached_defs_(const std::string& file,
+                        const byte_buffer& blocks) const;
+
   const information  info_;
   const capabilities caps_;
   const capabilities caps_flip_;
@@ -199,7 +301,12 @@ protected:
   parameters parm_flip_;
   bool read_back_;
 
-  data_buffer buffer_;
+  //! Image data currently being handed out by sgetn()
+  /*! This is shared with any block that sgetn() produced so the data
+   *  stays around until the last user is done with it.  A new buffer
+   *  is allocated for every transfer.
+   */
+  shared_ptr< data_buffer > buffer_;
   data_buffer::size_type offset_;
 
   bool streaming_flip_side_image_;
@@ -22,12 +22,12 @@
 #include <config.h>
 #endif
 
-#include <time.h>
-
 #include <boost/throw_exception.hpp>
 
 #include "compound.hpp"
 #include "exception.hpp"
+#include "fast-decoder.hpp"
+#include "status-poller.hpp"
 
 #if __cplusplus >= 201103L
 #define NS std
@@ -69,6 +69,7 @@ compound_base::operator>> (connexion& cnx)
   if (!request_.code)
     return;
 
+  status_poller poller;
   do
     {
       cnx_->send (req_blk_.data (), req_len_);
@@ -81,6 +82,8 @@ compound_base::operator>> (connexion& cnx)
 
       if (0 < reply_.size)
         recv_data_block_();
+      else                      // don't leave an earlier reply's data
+        dat_ref_.get ().clear ();
 
       if (request_.code != reply_.code)
         {
@@ -106,7 +109,7 @@ compound_base::operator>> (connexion& cnx)
         }
       hook_[reply_.code] ();
     }
-  while (!is_ready_() && delay_elapsed ());
+  while (!is_ready_() && poller.wait ());
 
   request_.code = quad ();
 }
@@ -131,12 +134,22 @@ compound_base::is_warming_up () const
   return status_.is_warming_up ();
 }
 
-bool
-compound_base::delay_elapsed () const
+const quad&
+compound_base::reply_code () const
+{
+  return reply_.code;
+}
+
+const byte_buffer&
+compound_base::reply_header_block () const
 {
-  struct timespec t = { 0, 100000000 /* ns */ };
+  return hdr_blk_;
+}
 
-  return 0 == nanosleep (&t, 0);
+const byte_buffer&
+compound_base::reply_data_block () const
+{
+  return dat_blk_;
 }
 
 const streamsize compound_base::req_len_ = 12;
@@ -221,14 +234,19 @@ compound_base::decode_reply_block_()
   grammar::iterator info = head + req_len_;
   grammar::iterator tail = head + hdr_len_;
 
-  if (!decode_.header_(head, info, reply_))
+  // Well-formed replies are common enough to warrant a shortcut.
+  // Anything the shortcut is not sure about goes to the grammar.
+
+  if (!fast_decode (head, info, reply_)
+      && !decode_.header_(head, info, reply_))
     {
       log::error ("%1%") % decode_.trace ();
     }
 
   status_.clear ();             // so we don't merge status info
 
-  if (!decode_.status_(info, tail, status_))
+  if (!fast_decode (info, tail, status_)
+      && !decode_.status_(info, tail, status_))
     {
       log::error ("%1%") % decode_.trace ();
     }
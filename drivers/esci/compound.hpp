@@ -100,8 +100,12 @@ public:
   bool is_busy () const;
   bool is_warming_up () const;
 
-  //! \todo Change to independent utility function taking an interval
-  bool delay_elapsed () const;
+  //! Returns the code of the most recent reply
+  const quad& reply_code () const;
+  //! Returns the most recent reply header block, exactly as received
+  const byte_buffer& reply_header_block () const;
+  //! Returns the most recent reply's payload, exactly as received
+  const byte_buffer& reply_data_block () const;
 
 protected:
   bool pedantic_;               //!< Checking of replies or not
@@ -23,8 +23,6 @@
 #include <config.h>
 #endif
 
-#include <time.h>
-
 #include <boost/assign/list_inserter.hpp>
 #include <boost/assign/list_of.hpp>
 #include <boost/bimap.hpp>
@@ -49,6 +47,7 @@
 #include "set-gamma-table.hpp"
 #include "capture-scanner.hpp"
 #include "release-scanner.hpp"
+#include "status-poller.hpp"
 
 #define for_each BOOST_FOREACH
 
@@ -154,14 +153,6 @@ namespace {
     return store_from (dither_pattern);
   }
 
-  //! \todo Make delay time interval configurable
-  bool delay_elapsed ()
-  {
-    struct timespec t = { 0, 100000000 /* ns */ };
-
-    return 0 == nanosleep (&t, 0);
-  }
-
   inline
   quantity::integer_type
   int_cast (const uint32_t& i)
@@ -482,6 +473,12 @@ extended_scanner::is_single_image () const
   return result;
 }
 
+bool
+extended_scanner::is_zero_copy () const
+{
+  return true;
+}
+
 bool
 extended_scanner::is_consecutive () const
 {
@@ -555,26 +552,14 @@ extended_scanner::set_up_image ()
   ctx_ = context (pixel_width (), pixel_height (), pixel_type ());
   ctx_.resolution (parm_.resolution ().x (), parm_.resolution ().y ());
 
-  do
-    {
-      // \todo Allow cancellation if supported by device
-      *cnx_ << stat_;
-    }
-  while (stat_.is_warming_up ()
-         && delay_elapsed ());
+  wait_for_warm_up_();
 
   *cnx_ << acquire_;
   if (acquire_.detected_fatal_error ())
     {
       // "lazy" devices may only start warming up *after* they get a
       // request to start scanning
-      do
-        {
-          // \todo Allow cancellation if supported by device
-          *cnx_ << stat_;
-        }
-      while (stat_.is_warming_up ()
-             && delay_elapsed ());
+      wait_for_warm_up_();
 
       *cnx_ << acquire_;
     }
@@ -624,6 +609,17 @@ extended_scanner::finish_image ()
 
 streamsize
 extended_scanner::sgetn (octet *data, streamsize n)
+{
+  block blk;
+  streamsize rv = sgetn (blk, n);
+
+  if (0 < rv) traits::copy (data, blk.data (), rv);
+
+  return rv;
+}
+
+streamsize
+extended_scanner::sgetn (block& blk, streamsize n)
 {
   bool do_cancel = cancel_requested ();
 
@@ -645,8 +641,8 @@ extended_scanner::sgetn (octet *data, streamsize n)
 
   streamsize rv = std::min (chunk_.size () - offset_, n);
 
-  traits::copy (data, reinterpret_cast<const octet *>
-                (chunk_.get () + offset_), rv);
+  blk = block (chunk_.share (), reinterpret_cast<const octet *>
+               (chunk_.get () + offset_), rv);
   offset_ += rv;
 
   return rv;
@@ -1357,7 +1353,25 @@ extended_scanner::add_scan_area_options (option::map& opts,
      );
 }
 
-//! \todo Make repeat_count configurable
+//! Polls the device's status for as long as it is warming up
+/*! Polling backs off while the status stays the same and speeds up
+ *  again when it changes.
+ */
+void
+extended_scanner::wait_for_warm_up_()
+{
+  status_poller poller;
+
+  // \todo Allow cancellation if supported by device
+  *cnx_ << stat_;
+  while (stat_.is_warming_up ())
+    {
+      if (stat_.changed ()) poller.activity ();
+      if (!poller.wait ()) break;
+      *cnx_ << stat_;
+    }
+}
+
 media
 extended_scanner::probe_media_size_(const string& doc_source)
 {
@@ -1374,14 +1388,15 @@ extended_scanner::probe_media_size_(const string& doc_source)
       return size;
     }
 
-  int repeat_count = 5;
-  do
+  status_poller poller (10, 100, media_size_budget);
+
+  *cnx_ << stat_;
+  while (!stat_.media_size_detected (src))
     {
+      if (stat_.changed ()) poller.activity ();
+      if (!poller.wait ()) break;
       *cnx_ << stat_;
     }
-  while (!stat_.media_size_detected (src)
-         && delay_elapsed ()
-         && --repeat_count);
 
   if (stat_.media_size_detected (src))
     {
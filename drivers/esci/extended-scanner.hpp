@@ -47,6 +47,7 @@ public:
   void configure ();
 
   bool is_single_image () const;
+  bool is_zero_copy () const;
 
 protected:
   bool is_consecutive () const;
@@ -54,6 +55,7 @@ protected:
   bool set_up_image ();
   void finish_image ();
   streamsize sgetn (octet *data, streamsize n);
+  streamsize sgetn (block& blk, streamsize n);
 
   void set_up_initialize ();
   bool set_up_hardware ();
@@ -85,6 +87,7 @@ protected:
   void add_scan_area_options (option::map& opts, const source_value& src);
 
   media probe_media_size_(const string& doc_source);
+  void  wait_for_warm_up_();
   void  update_scan_area_(const media& size, value::map& vm) const;
   void  align_document (const string& doc_source,
                         quantity& tl_x, quantity& tl_y,
@@ -0,0 +1,266 @@
+//  fast-decoder.cpp -- reply header and status shortcuts
+//  Copyright (C) 2026  SEIKO EPSON CORPORATION
+//
+//  License: GPL-3.0+
+//  Author : EPSON AVASYS CORPORATION
+//
+//  This file is part of the 'Utsushi' package.
+//  This package is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License or, at
+//  your option, any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//  You ought to have received a copy of the GNU General Public License
+//  along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "code-point.hpp"
+#include "code-token.hpp"
+#include "fast-decoder.hpp"
+
+namespace utsushi {
+namespace _drv_ {
+namespace esci {
+
+namespace decoding {
+
+typedef default_iterator_type iterator;
+
+namespace {
+
+bool
+is_digit (byte b)
+{
+  return (DIGIT_0 <= b && b <= DIGIT_9);
+}
+
+//! Consumes a four byte token, if there is one
+bool
+get_token (iterator& head, const iterator& tail, quad& q)
+{
+  if (tail - head < 4) return false;
+
+  q = CODE_TOKEN (head[0], head[1], head[2], head[3]);
+  head += 4;
+  return true;
+}
+
+//! Consumes \a n digits in base 10 or 16, whichever \a hex says
+bool
+get_digits (iterator& head, const iterator& tail, int n, bool hex,
+            integer& i)
+{
+  if (tail - head < n) return false;
+
+  integer rv = 0;
+  for (; 0 < n; --n, ++head)
+    {
+      byte b = *head;
+
+      /**/ if (is_digit (b))
+        rv = (hex ? 16 : 10) * rv + (b - DIGIT_0);
+      else if (hex && UPPER_A <= b && b <= UPPER_F)
+        rv = 16 * rv + (b - UPPER_A + 10);
+      else
+        return false;
+    }
+  i = rv;
+  return true;
+}
+
+//! Mirrors basic_grammar_formats::decimal_
+bool
+get_decimal (iterator& head, const iterator& tail, integer& i)
+{
+  if (head == tail || LOWER_D != *head) return false;
+  ++head;
+  return get_digits (head, tail, 3, false, i);
+}
+
+//! Mirrors basic_grammar_formats::positive_
+bool
+get_positive (iterator& head, const iterator& tail, integer& i)
+{
+  if (head == tail) return false;
+
+  byte b = *head;
+  /**/ if (LOWER_D == b) return get_decimal (head, tail, i);
+  else if (LOWER_I == b) return get_digits (++head, tail, 7, false, i);
+  else if (LOWER_X == b) return get_digits (++head, tail, 7, true, i);
+  return false;
+}
+
+bool
+get_image (iterator& head, const iterator& tail, status::image& img,
+           bool with_padding)
+{
+  if (!get_positive (head, tail, img.width)) return false;
+  if (with_padding && !get_positive (head, tail, img.padding)) return false;
+  return get_positive (head, tail, img.height);
+}
+
+//! Consumes a token if it is one of the \a n \a valid ones
+bool
+get_token (iterator& head, const iterator& tail, quad& q,
+           const quad *valid, int n)
+{
+  if (!get_token (head, tail, q)) return false;
+
+  for (int i = 0; i < n; ++i)
+    if (q == valid[i]) return true;
+
+  return false;
+}
+
+#define TOKENS(table) table, sizeof (table) / sizeof (*table)
+
+using namespace code_token::reply::info;
+
+const quad err_part[] = { err::ADF, err::TPU, err::FB };
+const quad err_what[] = { err::OPN, err::PJ, err::PE, err::ERR, err::LTF,
+                          err::LOCK, err::DFED, err::DTCL, err::AUTH,
+                          err::PERM, err::BTLO };
+const quad nrd_what[] = { nrd::RSVD, nrd::BUSY, nrd::WUP, nrd::NONE };
+const quad typ_what[] = { typ::IMGA, typ::IMGB };
+const quad atn_what[] = { atn::CAN, atn::NONE };
+const quad par_what[] = { par::OK, par::FAIL, par::LOST };
+const quad doc_what[] = { doc::CRST };
+
+}       // namespace
+
+bool
+fast_decode (iterator head, const iterator& tail, header& hdr)
+{
+  namespace reply = code_token::reply;
+
+  quad code;
+  if (!get_token (head, tail, code)) return false;
+
+  switch (code)
+    {
+    case reply::FIN : case reply::CAN : case reply::UNKN: case reply::INVD:
+    case reply::INFO: case reply::CAPA: case reply::CAPB: case reply::PARA:
+    case reply::PARB: case reply::RESA: case reply::RESB: case reply::STAT:
+    case reply::MECH: case reply::TRDT: case reply::IMG : case reply::EXT0:
+    case reply::EXT1: case reply::EXT2:
+      break;
+    default:
+      return false;
+    }
+
+  integer size;
+  if (head == tail || LOWER_X != *head) return false;
+  if (!get_digits (++head, tail, 7, true, size)) return false;
+
+  hdr = header (code, size);
+  return true;
+}
+
+/*! The grammar allows for the status information to come in any order
+ *  but insists on each kind appearing at most once, except for error
+ *  information.  Error information is only handled here if it comes
+ *  before anything else.  Tokens that do not introduce any kind of
+ *  status information are skipped, just like the grammar does.
+ */
+bool
+fast_decode (iterator head, const iterator& tail, status& stat)
+{
+  status rv;
+  bool seen_other = false;
+
+  while (head != tail)
+    {
+      quad q;
+      if (!get_token (head, tail, q)) return false;
+
+      if (END == q) break;      // ignore whatever follows
+
+      if (ERR == q)
+        {
+          status::error e;
+
+          if (seen_other
+              || !get_token (head, tail, e.part, TOKENS (err_part))
+              || !get_token (head, tail, e.what, TOKENS (err_what)))
+            return false;
+
+          rv.err.push_back (e);
+          continue;
+        }
+
+      bool ok = false;
+      quad t;
+      integer i;
+      status::image img;
+
+      /**/ if (NRD == q && !rv.nrd)
+        {
+          ok = get_token (head, tail, t, TOKENS (nrd_what));
+          if (ok) rv.nrd = t;
+        }
+      else if (PST == q && !rv.pst)
+        {
+          ok = get_image (head, tail, img, true);
+          if (ok) rv.pst = img;
+        }
+      else if (PEN == q && !rv.pen)
+        {
+          ok = get_image (head, tail, img, false);
+          if (ok) rv.pen = img;
+        }
+      else if (LFT == q && !rv.lft)
+        {
+          ok = get_decimal (head, tail, i);
+          if (ok) rv.lft = i;
+        }
+      else if (TYP == q && !rv.typ)
+        {
+          ok = get_token (head, tail, t, TOKENS (typ_what));
+          if (ok) rv.typ = t;
+        }
+      else if (ATN == q && !rv.atn)
+        {
+          ok = get_token (head, tail, t, TOKENS (atn_what));
+          if (ok) rv.atn = t;
+        }
+      else if (PAR == q && !rv.par)
+        {
+          ok = get_token (head, tail, t, TOKENS (par_what));
+          if (ok) rv.par = t;
+        }
+      else if (DOC == q && !rv.doc)
+        {
+          ok = get_token (head, tail, t, TOKENS (doc_what));
+          if (ok) rv.doc = t;
+        }
+      else if (NRD == q || PST == q || PEN == q || LFT == q
+               || TYP == q || ATN == q || PAR == q || DOC == q)
+        {
+          return false;         // repeated, let the grammar complain
+        }
+      else
+        {
+          continue;             // not status information, skip it
+        }
+
+      if (!ok) return false;
+      seen_other = true;
+    }
+
+  stat = rv;
+  return true;
+}
+
+}       // namespace decoding
+
+}       // namespace esci
+}       // namespace _drv_
+}       // namespace utsushi
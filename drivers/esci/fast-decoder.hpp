@@ -0,0 +1,65 @@
+//  fast-decoder.hpp -- reply header and status shortcuts
+//  Copyright (C) 2026  SEIKO EPSON CORPORATION
+//
+//  License: GPL-3.0+
+//  Author : EPSON AVASYS CORPORATION
+//
+//  This file is part of the 'Utsushi' package.
+//  This package is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License or, at
+//  your option, any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//  You ought to have received a copy of the GNU General Public License
+//  along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef drivers_esci_fast_decoder_hpp_
+#define drivers_esci_fast_decoder_hpp_
+
+#include "buffer.hpp"
+#include "grammar.hpp"
+
+namespace utsushi {
+namespace _drv_ {
+namespace esci {
+
+namespace decoding {
+
+//! Decode run-of-the-mill reply headers without the grammar's help
+/*! Every reply starts with a header that is decoded, including those
+ *  for the many image data requests an acquisition takes.  Running
+ *  the parser grammar for each of these is relatively expensive.
+ *  These functions handle the inputs that are common in practice
+ *  with a few table lookups.
+ *
+ *  Only input that is well-formed and unambiguous is decoded.  For
+ *  such input, the result is identical to what the grammar produces.
+ *  Anything else is left to basic_grammar::header_() and
+ *  basic_grammar::status_() so that unusual replies keep getting the
+ *  same treatment, error reporting included.
+ *
+ *  \returns A \c true value if the input was decoded, \c false if
+ *           the grammar needs to have a go at it.
+ */
+bool fast_decode (default_iterator_type head,
+                  const default_iterator_type& tail, header& hdr);
+
+//! Decode run-of-the-mill reply status without the grammar's help
+/*! \copydetails fast_decode(default_iterator_type,
+ *               const default_iterator_type&, header&)
+ */
+bool fast_decode (default_iterator_type head,
+                  const default_iterator_type& tail, status& stat);
+
+}       // namespace decoding
+
+}       // namespace esci
+}       // namespace _drv_
+}       // namespace utsushi
+
+#endif  /* drivers_esci_fast_decoder_hpp_ */
@@ -24,6 +24,7 @@
 #ifndef drivers_esci_getter_hpp_
 #define drivers_esci_getter_hpp_
 
+#include <algorithm>
 #include <cstring>
 
 #include <locale>
@@ -76,6 +77,7 @@ namespace _drv_ {
        */
       getter (bool pedantic = false)
         : pedantic_(pedantic)
+        , changed_(false)
       {
         traits::assign (blk_, sizeof (blk_) / sizeof (*blk_), 0);
       }
@@ -83,17 +85,32 @@ namespace _drv_ {
       void
       operator>> (connexion& cnx)
       {
+        byte prev[size];
+        traits::copy (prev, blk_, size);
+
         cnx.send (cmd_, sizeof (cmd_) / sizeof (*cmd_));
         cnx.recv (blk_, sizeof (blk_) / sizeof (*blk_));
 
+        changed_ = !std::equal (blk_, blk_ + size, prev);
+
         if (this->pedantic_)
           this->check_blk_reply ();
       }
 
+      //!  Tells whether the latest reply differs from the one before.
+      /*!  The first reply is compared to an all zero block.
+       */
+      bool
+      changed (void) const
+      {
+        return changed_;
+      }
+
     protected:
       bool pedantic_;            //!<  checking of replies or not
       static const byte cmd_[2]; //!<  command bytes
       byte blk_[size];           //!<  information or data block
+      bool changed_;             //!<  reply differs from the previous
 
       //!  Pedantically checks an information or data block.
       /*!  The implementation may log information about bits and bytes
@@ -70,6 +70,92 @@ parameters::clear ()
   *this = parameters ();
 }
 
+namespace {
+
+template< typename T >
+bool
+change (const boost::optional< T >& curr, const boost::optional< T >& prev,
+        boost::optional< T >& delta)
+{
+  if (curr != prev) delta = curr;
+  return (curr || !prev);
+}
+
+template< typename T >
+void
+merge_value (boost::optional< T >& value, const boost::optional< T >& delta)
+{
+  if (delta) value = delta;
+}
+
+}       // namespace
+
+bool
+parameters::changes (const parameters& prev, parameters& delta) const
+{
+  bool rv = true;
+
+  delta.clear ();
+
+  rv &= change (adf, prev.adf, delta.adf);
+  rv &= change (tpu, prev.tpu, delta.tpu);
+  rv &= change (fb , prev.fb , delta.fb);
+  rv &= change (col, prev.col, delta.col);
+  rv &= change (fmt, prev.fmt, delta.fmt);
+  rv &= change (jpg, prev.jpg, delta.jpg);
+  rv &= change (thr, prev.thr, delta.thr);
+  rv &= change (dth, prev.dth, delta.dth);
+  rv &= change (gmm, prev.gmm, delta.gmm);
+  rv &= change (gmt, prev.gmt, delta.gmt);
+  rv &= change (cmx, prev.cmx, delta.cmx);
+  rv &= change (sfl, prev.sfl, delta.sfl);
+  rv &= change (mrr, prev.mrr, delta.mrr);
+  rv &= change (bsz, prev.bsz, delta.bsz);
+  rv &= change (pag, prev.pag, delta.pag);
+  rv &= change (rsm, prev.rsm, delta.rsm);
+  rv &= change (rss, prev.rss, delta.rss);
+  rv &= change (crp, prev.crp, delta.crp);
+  rv &= change (acq, prev.acq, delta.acq);
+  rv &= change (flc, prev.flc, delta.flc);
+  rv &= change (fla, prev.fla, delta.fla);
+  rv &= change (qit, prev.qit, delta.qit);
+  rv &= change (ldf, prev.ldf, delta.ldf);
+  rv &= change (dfa, prev.dfa, delta.dfa);
+  rv &= change (lam, prev.lam, delta.lam);
+
+  return rv;
+}
+
+void
+parameters::merge (const parameters& delta)
+{
+  merge_value (adf, delta.adf);
+  merge_value (tpu, delta.tpu);
+  merge_value (fb , delta.fb);
+  merge_value (col, delta.col);
+  merge_value (fmt, delta.fmt);
+  merge_value (jpg, delta.jpg);
+  merge_value (thr, delta.thr);
+  merge_value (dth, delta.dth);
+  merge_value (gmm, delta.gmm);
+  merge_value (gmt, delta.gmt);
+  merge_value (cmx, delta.cmx);
+  merge_value (sfl, delta.sfl);
+  merge_value (mrr, delta.mrr);
+  merge_value (bsz, delta.bsz);
+  merge_value (pag, delta.pag);
+  merge_value (rsm, delta.rsm);
+  merge_value (rss, delta.rss);
+  merge_value (crp, delta.crp);
+  merge_value (acq, delta.acq);
+  merge_value (flc, delta.flc);
+  merge_value (fla, delta.fla);
+  merge_value (qit, delta.qit);
+  merge_value (ldf, delta.ldf);
+  merge_value (dfa, delta.dfa);
+  merge_value (lam, delta.lam);
+}
+
 bool
 parameters::is_bilevel () const
 {
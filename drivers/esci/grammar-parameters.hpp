@@ -51,6 +51,19 @@ struct parameters
 
   void clear ();
 
+  //! Collects the values that differ from those in \a prev
+  /*! Values that are set in \c *this and differ from the ones in \a
+   *  prev are copied to \a delta.  A value that is set in \a prev but
+   *  not in \c *this cannot be expressed as a change.
+   *
+   *  \returns A \c false value if there are such values, \c true if
+   *           \a delta holds everything that needs changing.
+   */
+  bool changes (const parameters& prev, parameters& delta) const;
+
+  //! Overrides values with those that are set in \a delta
+  void merge (const parameters& delta);
+
   bool is_bilevel () const;
   bool is_color () const;
   quad source () const;
@@ -25,6 +25,7 @@
 #include <utsushi/functional.hpp>
 
 #include "scanner-control.hpp"
+#include "status-poller.hpp"
 
 namespace utsushi {
 namespace _drv_ {
@@ -143,7 +144,13 @@ scanner_control::operator++ ()
       return data_buffer ();
     }
 
+  // Hand over the image data by swapping rather than copying it out
+  // of img_dat_.  The caller's copy is the only one that is needed.
+
+  data_buffer rv;
+
   img_dat_ = data_buffer ();
+  status_poller poller;
   do
     {
       if (do_cancel_)      // status_.atn triggers cancel requests too
@@ -151,7 +158,8 @@ scanner_control::operator++ ()
           cancel_();
           if (cancelled_)
             img_dat_.atn = reply::info::atn::CAN;
-          return img_dat_;
+          rv.swap (img_dat_);
+          return rv;
         }
 
       encode_request_block_(request::IMG);
@@ -160,9 +168,10 @@ scanner_control::operator++ ()
     }
   while (acquiring_
          && (0 == reply_.size && !status_.pen && !status_.pst)
-         && delay_elapsed ());
+         && poller.wait ());
 
-  return img_dat_;
+  rv.swap (img_dat_);
+  return rv;
 }
 
 void
@@ -209,6 +218,8 @@ scanner_control::set (const parameters& parm, bool flip_side_only)
     {
       using namespace encoding;
 
+      update_ = boost::none;
+
       /*! \todo Use info_.device_buffer_size instead (minimally 1536)?
        *        That appears to be the maximum we should be sending in
        *        any one set request to begin with.  How would we split
@@ -237,12 +248,37 @@ scanner_control::set (const parameters& parm, bool flip_side_only)
   return *this;
 }
 
+//! Sends only the \a delta between \a parm and the device's values
+/*! The device merges the values it is sent with the ones it already
+ *  has.  If the \a delta covers all values in \a parm that differ
+ *  from the device's, it ends up with \a parm but the request only
+ *  carries what changed.
+ */
+scanner_control&
+scanner_control::set (const parameters& parm, const parameters& delta,
+                      bool flip_side_only)
+{
+  set (delta, flip_side_only);
+  if (!acquiring_) update_ = parm;
+  return *this;
+}
+
 scanner_control&
 scanner_control::set_parameters (const parameters& parm, bool flip_side_only)
 {
   return set (parm, flip_side_only);
 }
 
+bool
+scanner_control::is_parameter_set_ok () const
+{
+  namespace reply = code_token::reply;
+  namespace par = reply::info::par;
+
+  return ((reply::PARA == reply_.code || reply::PARB == reply_.code)
+          && (!status_.par || par::OK == *status_.par));
+}
+
 //! Cache parameters set on the device side for later reference
 /*! This member function updates the instance's parameter cache based
  *  on the parameters that were just successfully sent to the device.
@@ -266,13 +302,12 @@ scanner_control::set_parameters_hook_()
     }
 
   parameters& parm (reply::PARA == reply_.code ? resa_ : resb_);
-
-  parm.clear ();                // FIXME kludge for #811
+  parameters  sent;
 
   grammar::iterator head = par_blk_.begin ();
   grammar::iterator tail = par_blk_.end ();
 
-  if (!decode_.scan_parameters_(head, tail, parm))
+  if (!decode_.scan_parameters_(head, tail, sent))
     {
       log::error ("%1%") % decode_.trace ();
     }
@@ -281,14 +316,17 @@ scanner_control::set_parameters_hook_()
   // kind of fashion for the flip side values as well.  If this isn't
   // the case, the alternative is a full sync with resa_.
 
-  if (reply::PARA == reply_.code)
+  if (update_)                  // only changes were sent
     {
-      resb_.clear ();           // FIXME kludge for #811
-
-      grammar::iterator head = par_blk_.begin ();
-      grammar::iterator tail = par_blk_.end ();
-
-      decode_.scan_parameters_(head, tail, resb_);
+      parm = *update_;
+      if (reply::PARA == reply_.code)
+        resb_.merge (sent);
+    }
+  else                          // FIXME kludge for #811
+    {
+      parm = sent;
+      if (reply::PARA == reply_.code)
+        resb_ = sent;
     }
 }
 
@@ -419,6 +457,12 @@ scanner_control::is_duplexing () const
                                             adf::DPLX));
 }
 
+bool
+scanner_control::is_acquiring () const
+{
+  return acquiring_;
+}
+
 void
 scanner_control::decode_reply_block_hook_() throw ()
 {
@@ -34,6 +34,14 @@ class data_buffer
 {
 public:
   using byte_buffer::clear;
+
+  //! Exchanges contents with \a that without copying image data
+  void swap (data_buffer& that)
+  {
+    byte_buffer::swap (that);
+    std::swap (static_cast< status& > (*this),
+               static_cast< status& > (that));
+  }
 };
 
 //! Make the device do your bidding
@@ -81,8 +89,13 @@ public:
   scanner_control& get (parameters& parm, const std::set< quad >& ts,
                         bool flip_side_only = false);
   scanner_control& set (const parameters& parm, bool flip_side_only = false);
+  scanner_control& set (const parameters& parm, const parameters& delta,
+                        bool flip_side_only = false);
   scanner_control& set_parameters (const parameters& parm,
                                    bool flip_side_only = false);
+
+  //! Tells whether the device accepted the most recent set() request
+  bool is_parameter_set_ok () const;
   //! @}
 
   //! \name Mechanical Controls
@@ -101,6 +114,9 @@ public:
   bool media_out (const quad& where) const;
   bool is_duplexing () const;
 
+  //! Tells whether operator++() may still produce image data
+  bool is_acquiring () const;
+
 protected:
   bool acquiring_;              //!< Has acquisition been initiated
   bool do_cancel_;              //!< Should acquisition be aborted
@@ -112,6 +128,9 @@ protected:
 
   data_buffer img_dat_;
 
+  //! Parameters the device ends up with when only changes are sent
+  boost::optional< parameters > update_;
+
   /*! Extends reply block decoding to add state switching logic.
    */
   void decode_reply_block_hook_() throw ();
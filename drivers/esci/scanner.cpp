@@ -46,7 +46,7 @@ extern "C" {
 bool
 is_interpreter (const std::string& cnx)
 {
-  return !(cnx == "usb" || cnx == "networkscan");
+  return !(cnx == "usb" || cnx == "networkscan" || cnx == "replay");
 }
 
 void
@@ -0,0 +1,86 @@
+//  status-poller.cpp -- adaptive status request scheduling
+//  Copyright (C) 2026  SEIKO EPSON CORPORATION
+//
+//  License: GPL-3.0+
+//  Author : EPSON AVASYS CORPORATION
+//
+//  This file is part of the 'Utsushi' package.
+//  This package is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License or, at
+//  your option, any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//  You ought to have received a copy of the GNU General Public License
+//  along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <time.h>
+
+#include <algorithm>
+
+#include <utsushi/clock.hpp>
+
+#include "status-poller.hpp"
+
+namespace utsushi {
+namespace _drv_ {
+namespace esci {
+
+status_poller::status_poller (long min_interval, long max_interval,
+                              long budget)
+  : min_interval_(std::max (1L, min_interval))
+  , max_interval_(std::max (min_interval_, max_interval))
+  , budget_(budget)
+  , interval_(min_interval_)
+  , start_(microseconds ())
+{}
+
+bool
+status_poller::wait ()
+{
+  long ms = interval_;
+
+  if (0 < budget_)
+    {
+      long left = budget_ - elapsed ();
+
+      if (0 >= left) return false;
+      ms = std::min (ms, left);
+    }
+
+  interval_ = std::min (2 * interval_, max_interval_);
+
+  struct timespec t = { ms / 1000, (ms % 1000) * 1000000 /* ns */ };
+
+  return 0 == nanosleep (&t, 0);
+}
+
+void
+status_poller::activity ()
+{
+  interval_ = min_interval_;
+}
+
+void
+status_poller::push_button (long event)
+{
+  if (event) activity ();
+}
+
+long
+status_poller::elapsed () const
+{
+  return (microseconds () - start_) / 1000;
+}
+
+}       // namespace esci
+}       // namespace _drv_
+}       // namespace utsushi
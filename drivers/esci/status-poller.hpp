@@ -0,0 +1,93 @@
+//  status-poller.hpp -- adaptive status request scheduling
+//  Copyright (C) 2026  SEIKO EPSON CORPORATION
+//
+//  License: GPL-3.0+
+//  Author : EPSON AVASYS CORPORATION
+//
+//  This file is part of the 'Utsushi' package.
+//  This package is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License or, at
+//  your option, any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//  You ought to have received a copy of the GNU General Public License
+//  along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef drivers_esci_status_poller_hpp_
+#define drivers_esci_status_poller_hpp_
+
+#include <utsushi/cstdint.hpp>
+
+namespace utsushi {
+namespace _drv_ {
+namespace esci {
+
+//! Decide when to send the next status request
+/*! The ESC/I protocols have no means for a device to tell us that
+ *  something happened.  All we can do is keep asking.  Asking at a
+ *  fixed, long interval means that we notice changes late.  Asking
+ *  at a short interval keeps the bus busy for nothing most of the
+ *  time.
+ *
+ *  A status_poller starts out with a short interval and doubles it
+ *  after every request that did not turn up anything new, up to a
+ *  maximum.  Callers report anything new, such as a changed status
+ *  or a push button event, via activity().  That gets the poller
+ *  back to the short interval because more changes are likely to
+ *  follow soon.  Someone who just pushed a button, for example, is
+ *  about to put paper in the ADF.
+ *
+ *  An optional latency budget limits the total time spent waiting.
+ */
+class status_poller
+{
+public:
+  //! Creates a poller that sleeps for \a min_interval (in ms) first
+  /*! Sleep intervals grow to at most \a max_interval.  If \a budget
+   *  is positive, wait() will not sleep past that many milliseconds
+   *  from the poller's creation.
+   */
+  status_poller (long min_interval = 10, long max_interval = 100,
+                 long budget = 0);
+
+  //! Sleeps until the next status request is due
+  /*! \returns A \c false value if the budget has been used up or the
+   *           sleep was interrupted, \c true otherwise.
+   */
+  bool wait ();
+
+  //! Returns to polling at the shortest interval
+  void activity ();
+
+  //! Notes a push button \a event, if any
+  void push_button (long event);
+
+  //! Yields the time (in ms) since the poller was created
+  long elapsed () const;
+
+private:
+  long min_interval_;
+  long max_interval_;
+  long budget_;
+
+  long interval_;
+  uint64_t start_;              //!< in microseconds
+};
+
+//! Time (in ms) that devices get to detect the size of a document
+/*! Media size probing gives up after this budget has been used up.
+ *  It is about the same time the drivers allowed for this before the
+ *  introduction of the status_poller.
+ */
+const long media_size_budget = 500;
+
+}       // namespace esci
+}       // namespace _drv_
+}       // namespace utsushi
+
+#endif  /* drivers_esci_status_poller_hpp_ */
@@ -36,6 +36,7 @@
 #include <utsushi/functional.hpp>
 #include <utsushi/test/tools.hpp>
 
+#include "../fast-decoder.hpp"
 #include "../grammar.hpp"
 
 #if __cplusplus >= 201103L
@@ -123,6 +124,68 @@ test_grammar (const grammar_tc& tc)
     }
 }
 
+void
+test_fast_decoder (const grammar_tc& tc)
+{
+  utsushi::test::change_test_case_name (tc.name);
+
+  header h (quad (), esci_non_int);
+  bool r = fast_decode (tc.payload.begin (), tc.payload.end (), h);
+
+  BOOST_CHECK_EQUAL (pass == tc.expect, r);
+
+  if (pass == tc.expect)
+    {
+      BOOST_CHECK_EQUAL (tc.hdr.code, h.code);
+      BOOST_CHECK_EQUAL (tc.hdr.size, h.size);
+    }
+}
+
+//! Checks the fast decoder against the grammar for status  info
+/*! The  info is padded with spaces to the size of a reply block's
+ *  status information.
+ */
+void
+check_status (std::string info, bool expect_fast)
+{
+  info.resize (64 - header_length, ' ');
+
+  byte_buffer payload (info.c_str ());
+  grammar::iterator head = payload.begin ();
+  grammar::iterator tail = payload.end ();
+
+  status fast;
+  bool r = fast_decode (head, tail, fast);
+
+  BOOST_CHECK_MESSAGE (expect_fast == r, info);
+  if (!r) return;
+
+  grammar parse;
+  status stat;
+
+  BOOST_REQUIRE_MESSAGE (parse.status_(head, tail, stat), parse.trace ());
+  BOOST_CHECK_MESSAGE (stat == fast, info);
+}
+
+BOOST_AUTO_TEST_CASE (fast_status_decoding)
+{
+  check_status ("", true);
+  check_status ("#---", true);
+  check_status ("#nrdBUSY#---", true);
+  check_status ("#nrdNONE#---#nrdNONE", true);
+  check_status ("FOO #nrdWUD ", true);
+  check_status ("#errADF PE  #errFB  LOCK#pstd100i0000000x00003E8", true);
+  check_status ("#pend100d200#lftd003#typIMGA#atnCAN #parOK  #docCRST",
+                true);
+
+  check_status ("#nrdBUSY#nrdNONE", false);     // repeated
+  check_status ("#nrdBUSY#errADF PE  ", false); // err not up front
+  check_status ("#nrdJUNK", false);
+  check_status ("#lfti0000003", false);
+  check_status ("#pstx00003e8d000d100", false); // lower case hex
+  check_status ("#typ", false);
+}
+
 }       // namespace decoding
 
 namespace encoding {
@@ -161,6 +224,35 @@ test_grammar (const grammar_tc& tc)
 
 }       // namespace encoding
 
+BOOST_AUTO_TEST_CASE (parameter_changes)
+{
+  using esci::parameters;
+  namespace parm = esci::code_token::parameter;
+
+  parameters prev, curr, delta;
+
+  prev.col = parm::col::C024;
+  prev.rsm = 300;
+  prev.rss = 300;
+
+  curr = prev;
+  BOOST_CHECK (curr.changes (prev, delta));
+  BOOST_CHECK (parameters () == delta);
+
+  curr.rsm = 600;
+  curr.fmt = parm::fmt::JPG;
+  BOOST_CHECK (curr.changes (prev, delta));
+  BOOST_CHECK (!delta.col && !delta.rss);
+  BOOST_CHECK (delta.rsm && 600 == *delta.rsm);
+  BOOST_CHECK (delta.fmt && parm::fmt::JPG == *delta.fmt);
+
+  prev.merge (delta);
+  BOOST_CHECK (curr == prev);
+
+  curr.col = boost::none;
+  BOOST_CHECK (!curr.changes (prev, delta));
+}
+
 bool
 init_test_runner ()
 {
@@ -307,6 +399,9 @@ init_test_runner ()
       decoding_ts->add (BOOST_PARAM_TEST_CASE (decoding::test_grammar,
                                                decoding_tcs.begin (),
                                                decoding_tcs.end ()));
+      decoding_ts->add (BOOST_PARAM_TEST_CASE (decoding::test_fast_decoder,
+                                               decoding_tcs.begin (),
+                                               decoding_tcs.end ()));
       but::framework::master_test_suite ().add (decoding_ts);
     }
   if (!encoding_tcs.empty ())
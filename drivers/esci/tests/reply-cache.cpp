@@ -0,0 +1,371 @@
+//  reply-cache.cpp -- unit tests for the compound_scanner reply cache
+//  Copyright (C) 2026  SEIKO EPSON CORPORATION
+//
+//  License: GPL-3.0+
+//  Author : EPSON AVASYS CORPORATION
+//
+//  This file is part of the 'Utsushi' package.
+//  This package is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License or, at
+//  your option, any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//  You ought to have received a copy of the GNU General Public License
+//  along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <arpa/inet.h>
+
+#include <cstdlib>
+#include <exception>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <utsushi/cstdint.hpp>
+#include <utsushi/memory.hpp>
+#include <utsushi/run-time.hpp>
+
+#include "../../../connexions/capture.hpp"
+#include "../code-point.hpp"
+#include "../compound-scanner.hpp"
+
+namespace fs = boost::filesystem;
+namespace esci = utsushi::_drv_::esci;
+
+using utsushi::_cnx_::replay;
+using utsushi::make_shared;
+using utsushi::run_time;
+using utsushi::shared_ptr;
+
+namespace {
+
+//! Replays a conversation and tells whether all of it was used up
+/*! Once the driver strays from the conversation, the divergence is
+ *  noted and every request gets a \c FIN reply.  Nothing is thrown,
+ *  as that would terminate the program when a command's destructor
+ *  finishes its session.
+ */
+struct script
+  : replay
+{
+  std::string divergence_;
+
+  script (const std::string& file)
+    : replay (file)
+  {}
+
+  using replay::send;
+  using replay::recv;
+
+  void
+  send (const utsushi::octet *message, utsushi::streamsize size)
+  {
+    if (!divergence_.empty ()) return;
+
+    try
+      {
+        replay::send (message, size);
+      }
+    catch (const std::exception& e)
+      {
+        divergence_ = e.what ();
+      }
+  }
+
+  void
+  recv (utsushi::octet *message, utsushi::streamsize size)
+  {
+    if (divergence_.empty ())
+      {
+        try
+          {
+            return replay::recv (message, size);
+          }
+        catch (const std::exception& e)
+          {
+            divergence_ = e.what ();
+          }
+      }
+
+    std::string fin ("FIN x0000000#---");
+    fin.resize (size, ' ');
+    utsushi::traits::copy (message, fin.data (), size);
+  }
+
+  bool
+  finished ()
+  {
+    return (divergence_.empty ()
+            && fs::ifstream::traits_type::eof () == file_.peek ());
+  }
+};
+
+//! Writes the conversation a driver is expected to have with a device
+/*! The device's replies come from the DS-40 data file.  Its product
+ *  name is changed so that the driver cannot find a data file of its
+ *  own and has to ask the device for its scan parameter defaults.
+ *  The firmware \a version replaces the one in the data file.
+ */
+class conversation
+{
+public:
+  conversation (const fs::path& file, const std::string& version)
+    : file_(file, std::ios_base::binary | std::ios_base::trunc)
+    , status_("#---" + std::string (48, ' '))
+  {
+    fs::path data (getenv ("srcdir"));
+    data /= "../data/DS-40.dat";
+
+    fs::ifstream is (data, std::ios_base::binary);
+    std::string blk (12, '\0');
+
+    while (is.read (&blk[0], 12))
+      {
+        std::string dat (strtol (blk.substr (5).c_str (), NULL, 16), '\0');
+        if (!dat.empty ()) is.read (&dat[0], dat.size ());
+
+        replies_[blk.substr (0, 4)] = blk + dat;
+      }
+    BOOST_REQUIRE (replies_.count ("INFO"));
+
+    std::string& info (replies_["INFO"]);
+    replace_(info, "#PRDh005DS-40", "#PRDh005ZZ-40");
+    replace_(info, "SPECD", version);
+
+    file_ << "UTSUSHI-CNX1";
+  }
+
+  //! Adds a session with the requests in \a codes
+  /*! The session is started with \a cmd and ended with a \c FIN
+   *  request.  Requests are separated by white space.
+   */
+  void
+  session (esci::byte cmd, const std::string& codes)
+  {
+    const char sig[] = { esci::FS, char (cmd) };
+
+    send_(std::string (sig, sizeof (sig)));
+    recv_(std::string (1, esci::ACK));
+
+    std::istringstream iss (codes);
+    std::string code;
+    while (iss >> code)
+      {
+        const std::string& blk (replies_[code]);
+
+        send_(code + "x0000000");
+        recv_(blk.substr (0, 12) + status_);
+        if (12 < blk.size ()) recv_(blk.substr (12));
+      }
+
+    send_("FIN x0000000");
+    recv_("FIN x0000000" + status_);
+  }
+
+  //! Adds the sessions needed when nothing has been cached
+  void
+  uncached ()
+  {
+    session (esci::UPPER_Y, "INFO CAPA CAPB");
+    session (esci::UPPER_X, "INFO CAPA CAPB RESA RESB");
+  }
+
+  //! Adds the sessions needed when everything has been cached
+  void
+  cached ()
+  {
+    session (esci::UPPER_Y, "INFO");
+  }
+
+private:
+  static void
+  replace_(std::string& s, const std::string& from, const std::string& to)
+  {
+    std::string::size_type pos = s.find (from);
+
+    BOOST_REQUIRE (std::string::npos != pos);
+    s.replace (pos, from.size (), to);
+  }
+
+  void
+  record_(char direction, const std::string& payload)
+  {
+    uint32_t hdr[2];
+
+    hdr[0] = 0;
+    hdr[1] = htonl (payload.size ());
+
+    file_.put (direction);
+    file_.write (reinterpret_cast< const char * > (hdr), sizeof (hdr));
+    file_.write (payload.data (), payload.size ());
+  }
+
+  void send_(const std::string& payload) { record_('>', payload); }
+  void recv_(const std::string& payload) { record_('<', payload); }
+
+  fs::ofstream file_;
+  std::string  status_;
+  std::map< std::string, std::string > replies_;
+};
+
+struct run_time_fixture
+{
+  run_time_fixture ()
+  {
+    const char *argv[] = { "reply-cache-unit-test-runner" };
+
+    run_time (1, argv);
+  }
+};
+
+BOOST_GLOBAL_FIXTURE (run_time_fixture);
+
+struct cache_fixture
+{
+  fs::path dir_;
+  fs::path cap_;
+
+  cache_fixture ()
+    : dir_(fs::absolute ("reply-cache.dir"))
+    , cap_(fs::absolute ("reply-cache.cap"))
+  {
+    fs::remove_all (dir_);
+    setenv (PACKAGE_ENV_VAR_PREFIX "CACHE_DIR", dir_.c_str (), 1);
+  }
+
+  ~cache_fixture ()
+  {
+    unsetenv (PACKAGE_ENV_VAR_PREFIX "CACHE_DIR");
+    unsetenv ("XDG_CACHE_HOME");
+    fs::remove_all (dir_);
+    fs::remove (cap_);
+  }
+
+  //! Creates a driver for a device with firmware \a version
+  /*! The driver needs to talk to the device as \a expected and use up
+   *  all of the conversation.  Anything else is a failure.
+   */
+  bool
+  create_driver (const std::string& version,
+                 void (conversation::*expected) ())
+  {
+    {
+      conversation cnv (cap_, version);
+      (cnv.*expected) ();
+    }
+
+    try
+      {
+        shared_ptr< script > cnx (make_shared< script > (cap_.string ()));
+        esci::compound_scanner driver (cnx);
+
+        if (!cnx->divergence_.empty ()) BOOST_ERROR (cnx->divergence_);
+        return cnx->finished ();
+      }
+    catch (const std::exception& e)
+      {
+        BOOST_ERROR (e.what ());
+      }
+    return false;
+  }
+
+  //! Lists the cache files, if any
+  std::vector< fs::path >
+  cache_files () const
+  {
+    std::vector< fs::path > rv;
+    fs::path dir (dir_ / "esci");
+
+    if (fs::exists (dir))
+      {
+        fs::directory_iterator it (dir);
+        for (; fs::directory_iterator () != it; ++it)
+          rv.push_back (it->path ());
+      }
+    return rv;
+  }
+};
+
+}       // namespace
+
+BOOST_FIXTURE_TEST_SUITE (reply_cache, cache_fixture)
+
+BOOST_AUTO_TEST_CASE (miss_writes_file)
+{
+  BOOST_CHECK (create_driver ("SPECD", &conversation::uncached));
+  BOOST_REQUIRE_EQUAL (1u, cache_files ().size ());
+  BOOST_CHECK_LT (0, fs::file_size (cache_files ().front ()));
+}
+
+BOOST_AUTO_TEST_CASE (hit_skips_requests)
+{
+  BOOST_REQUIRE (create_driver ("SPECD", &conversation::uncached));
+  BOOST_CHECK (create_driver ("SPECD", &conversation::cached));
+  BOOST_CHECK (create_driver ("SPECD", &conversation::cached));
+  BOOST_CHECK_EQUAL (1u, cache_files ().size ());
+}
+
+BOOST_AUTO_TEST_CASE (firmware_update)
+{
+  BOOST_REQUIRE (create_driver ("SPECD", &conversation::uncached));
+  BOOST_CHECK (create_driver ("SPECE", &conversation::uncached));
+  BOOST_CHECK_EQUAL (2u, cache_files ().size ());
+  BOOST_CHECK (create_driver ("SPECE", &conversation::cached));
+}
+
+BOOST_AUTO_TEST_CASE (information_mismatch)
+{
+  BOOST_REQUIRE (create_driver ("SPECD", &conversation::uncached));
+  BOOST_REQUIRE_EQUAL (1u, cache_files ().size ());
+
+  // Put the replies under the name used for another firmware version
+  // as if they had been cached before the device information changed.
+
+  fs::path file (cache_files ().front ());
+  std::string name (file.filename ().string ());
+  name.replace (name.find ("SPECD"), 5, "SPECE");
+  fs::rename (file, file.parent_path () / name);
+
+  BOOST_CHECK (create_driver ("SPECE", &conversation::uncached));
+  BOOST_CHECK (create_driver ("SPECE", &conversation::cached));
+}
+
+BOOST_AUTO_TEST_CASE (corrupted_file)
+{
+  BOOST_REQUIRE (create_driver ("SPECD", &conversation::uncached));
+  BOOST_REQUIRE_EQUAL (1u, cache_files ().size ());
+  {
+    fs::ofstream os (cache_files ().front (), std::ios_base::trunc);
+    os << "CAPAxgarbage";
+  }
+  BOOST_CHECK (create_driver ("SPECD", &conversation::uncached));
+  BOOST_CHECK (create_driver ("SPECD", &conversation::cached));
+}
+
+BOOST_AUTO_TEST_CASE (empty_dir_disables_cache)
+{
+  setenv (PACKAGE_ENV_VAR_PREFIX "CACHE_DIR", "", 1);
+  setenv ("XDG_CACHE_HOME", dir_.c_str (), 1);
+
+  BOOST_CHECK (create_driver ("SPECD", &conversation::uncached));
+  BOOST_CHECK (create_driver ("SPECD", &conversation::uncached));
+  BOOST_CHECK (!fs::exists (dir_));
+}
+
+BOOST_AUTO_TEST_SUITE_END ()
+
+#include "utsushi/test/runner.ipp"
@@ -0,0 +1,99 @@
+//  status-poller.cpp -- unit tests for the status_poller class
+//  Copyright (C) 2026  SEIKO EPSON CORPORATION
+//
+//  License: GPL-3.0+
+//  Author : EPSON AVASYS CORPORATION
+//
+//  This file is part of the 'Utsushi' package.
+//  This package is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License or, at
+//  your option, any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//  You ought to have received a copy of the GNU General Public License
+//  along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <boost/test/unit_test.hpp>
+
+#include "../status-poller.hpp"
+
+namespace esci = utsushi::_drv_::esci;
+
+using esci::status_poller;
+
+//! Stands in for a device that detects media after a number of polls
+struct device
+{
+  int polls_to_go;
+
+  device (int polls) : polls_to_go (polls) {}
+
+  bool media_detected () { return 0 >= --polls_to_go; }
+};
+
+BOOST_AUTO_TEST_CASE (budget_runs_out)
+{
+  device dev (1000);
+  status_poller poller (10, 100, 200);
+  int polls = 0;
+
+  do
+    {
+      ++polls;
+    }
+  while (!dev.media_detected ()
+         && poller.wait ());
+
+  BOOST_CHECK_LE (200, poller.elapsed ());
+  BOOST_CHECK_GT (1000, poller.elapsed ());
+  BOOST_CHECK_LT (1, polls);
+  BOOST_CHECK_GT (20, polls);   // the interval backs off
+  BOOST_CHECK (!poller.wait ());
+}
+
+BOOST_AUTO_TEST_CASE (media_shows_up)
+{
+  device dev (3);
+  status_poller poller (10, 100, 10000);
+  int polls = 0;
+
+  do
+    {
+      ++polls;
+    }
+  while (!dev.media_detected ()
+         && poller.wait ());
+
+  BOOST_CHECK_EQUAL (3, polls);
+  BOOST_CHECK_GT (1000, poller.elapsed ());
+}
+
+BOOST_AUTO_TEST_CASE (activity_resets_interval)
+{
+  status_poller poller (10, 400);
+
+  for (int i = 0; i < 5; ++i)   // 10 + 20 + 40 + 80 + 160 ms
+    poller.wait ();
+
+  long t = poller.elapsed ();
+  poller.push_button (0);       // no event, interval stays at 320 ms
+  poller.wait ();
+  BOOST_CHECK_LE (320, poller.elapsed () - t);
+
+  t = poller.elapsed ();
+  poller.push_button (1);
+  poller.wait ();
+  BOOST_CHECK_GT (200, poller.elapsed () - t);
+}
+
+#include "utsushi/test/runner.ipp"
@@ -0,0 +1,754 @@
+//  synthetic.cpp -- virtual scanner producing test images at speed
+//  Copyright (C) 2026  SEIKO EPSON CORPORATION
+//
+//  License: GPL-3.0+
+//  Author : EPSON AVASYS CORPORATION
+//
+//  This file is part of the 'Utsushi' package.
+//  This package is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License or, at
+//  your option, any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//  You ought to have received a copy of the GNU General Public License
+//  along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <list>
+#include <stdexcept>
+
+#include <boost/throw_exception.hpp>
+
+#if HAVE_LIBJPEG
+#include <jpeglib.h>
+#endif
+
+#include "utsushi/clock.hpp"
+#include "utsushi/format.hpp"
+#include "utsushi/i18n.hpp"
+#include "utsushi/log.hpp"
+#include "utsushi/media.hpp"
+#include "utsushi/range.hpp"
+#include "utsushi/regex.hpp"
+#include "utsushi/store.hpp"
+#include "utsushi/toggle.hpp"
+
+#include "synthetic.hpp"
+
+namespace utsushi {
+
+extern "C" {
+void
+libdrv_synthetic_LTX_scanner_factory (const scanner::info& info,
+                                      scanner::ptr& rv)
+{
+  const std::string kv ("([^&=]+)=([^&]+)");
+  const std::string query (info.query ());
+  regex re (kv);
+  sregex_iterator pos (query.begin (), query.end (), re);
+  sregex_iterator end;
+
+  unsigned pages = 10;
+  double   rate  = 0;
+  std::string pattern ("Mixed");
+
+  for (; pos != end; ++pos)
+    {
+      /**/ if ("pages"   == pos->str (1))
+        pages = std::strtoul (pos->str (2).c_str (), NULL, 10);
+      else if ("rate"    == pos->str (1))
+        rate = std::strtod (pos->str (2).c_str (), NULL);
+      else if ("pattern" == pos->str (1))
+        pattern = pos->str (2);
+      else
+        log::alert ("ignoring unknown UDI query parameter: '%1%'")
+          % pos->str (1);
+    }
+
+  rv = make_shared< _drv_::synthetic::scanner > (pages, rate, pattern);
+}
+}       // extern "C"
+
+namespace _drv_ {
+namespace synthetic {
+
+using std::logic_error;
+using std::runtime_error;
+
+namespace {
+
+const string adf (SEC_N_("ADF"));
+const string flatbed (SEC_N_("Document Table"));
+
+const double   max_width  =  8.5;       // inches, US Legal size
+const double   max_height = 14.0;
+const unsigned max_pages  = 9999;
+const double   max_rate   = 1000;       // MB/s
+
+//! Light based RGB values for the colour bars, from left to right
+const uint8_t bars[8][3] = {
+  { 0xff, 0xff, 0xff },         // white
+  { 0xff, 0xff, 0x00 },         // yellow
+  { 0x00, 0xff, 0xff },         // cyan
+  { 0x00, 0xff, 0x00 },         // green
+  { 0xff, 0x00, 0xff },         // magenta
+  { 0xff, 0x00, 0x00 },         // red
+  { 0x00, 0x00, 0xff },         // blue
+  { 0x00, 0x00, 0x00 },         // black
+};
+
+const uint8_t backing = 0xd0;   // what is visible around skewed pages
+const uint8_t ink     = 0x20;
+
+inline uint8_t
+luminance (const uint8_t *rgb)
+{
+  return (299 * rgb[0] + 587 * rgb[1] + 114 * rgb[2]) / 1000;
+}
+
+#if HAVE_LIBJPEG
+
+//! Grow the compressed image as the JPEG library fills it up
+/*! The vector holding the image is handed around via \c client_data.
+ */
+struct destination
+{
+  static const std::size_t chunk_size = 64 * 1024;
+
+  static std::vector< octet >&
+  image (j_compress_ptr cinfo)
+  {
+    return *static_cast< std::vector< octet > * > (cinfo->client_data);
+  }
+
+  static void
+  init (j_compress_ptr cinfo)
+  {
+    std::vector< octet >& v (image (cinfo));
+
+    v.resize (chunk_size);
+    cinfo->dest->next_output_byte = reinterpret_cast< JOCTET * > (&v[0]);
+    cinfo->dest->free_in_buffer   = v.size ();
+  }
+
+  static boolean
+  empty (j_compress_ptr cinfo)
+  {
+    std::vector< octet >& v (image (cinfo));
+    std::size_t used = v.size ();
+
+    v.resize (2 * used);
+    cinfo->dest->next_output_byte = reinterpret_cast< JOCTET * > (&v[used]);
+    cinfo->dest->free_in_buffer   = v.size () - used;
+    return TRUE;
+  }
+
+  static void
+  term (j_compress_ptr cinfo)
+  {
+    std::vector< octet >& v (image (cinfo));
+
+    v.resize (v.size () - cinfo->dest->free_in_buffer);
+  }
+
+  static void
+  error_exit (j_common_ptr cinfo)
+  {
+    char msg[JMSG_LENGTH_MAX];
+
+    cinfo->err->format_message (cinfo, msg);
+    jpeg_destroy (cinfo);
+
+    log::fatal (msg);
+
+    BOOST_THROW_EXCEPTION (runtime_error (msg));
+  }
+};
+
+#endif  /* HAVE_LIBJPEG */
+
+}       // namespace
+
+scanner::scanner (const unsigned& pages, const double& rate,
+                  const std::string& pattern)
+  : utsushi::scanner::scanner (connexion::ptr ())
+  , images_(0)
+  , image_count_(0)
+  , is_adf_(false)
+  , is_duplex_(false)
+  , is_compressed_(false)
+  , quality_(75)
+  , type_(context::RGB8)
+  , test_pattern_(MIXED)
+  , rate_(0)
+  , pattern_type_(BARS)
+  , is_rear_(false)
+  , skew_(0)
+  , line_no_(0)
+  , offset_(0)
+  , start_(0)
+  , octets_(0)
+{
+  if (!(0 < pages && pages <= max_pages))
+    BOOST_THROW_EXCEPTION
+      (runtime_error ((format ("page count out of range: %1%")
+                       % pages).str ()));
+
+  if (!(0 <= rate && rate <= max_rate))
+    BOOST_THROW_EXCEPTION
+      (runtime_error ((format ("data rate out of range: %1% MB/s")
+                       % rate).str ()));
+
+  if (!(   "Bars"   == pattern || "Blank" == pattern
+        || "Skewed" == pattern || "Mixed" == pattern))
+    BOOST_THROW_EXCEPTION
+      (runtime_error ((format ("unknown test pattern: '%1%'")
+                       % pattern).str ()));
+
+  std::list< std::string > areas = media::within (1.0, 1.0,
+                                                  max_width, max_height);
+  areas.push_back (SEC_N_("Manual"));
+  areas.push_back (SEC_N_("Maximum"));
+
+  add_options ()
+    ("doc-source", (from< store > ()
+                    -> alternative (flatbed)
+                    -> alternative (adf)
+                    -> default_value (adf)
+                    ),
+     attributes (tag::general)(level::standard),
+     SEC_N_("Document Source")
+     )
+    ("duplex", toggle (),
+     attributes (tag::general)(level::standard),
+     SEC_N_("Duplex")
+     )
+    ("image-count", (from< range > ()
+                     -> lower (1)
+                     -> upper (int (max_pages))
+                     -> default_value (int (pages))
+                     ),
+     attributes (),
+     CCB_N_("Image Count")
+     )
+    ("image-type", (from< store > ()
+                    -> alternative (SEC_N_("Monochrome"))
+                    -> alternative (SEC_N_("Grayscale"))
+                    -> alternative ("Gray (16 bit)")
+                    -> alternative ("Color (16 bit)")
+                    -> default_value (SEC_N_("Color"))
+                    ),
+     attributes (tag::general)(level::standard),
+     SEC_N_("Image Type")
+     )
+    ("resolution", (from< range > ()
+                    -> lower (50)
+                    -> upper (1200)
+                    -> default_value (300)
+                    ),
+     attributes (tag::general)(level::standard),
+     SEC_N_("Resolution")
+     )
+    ("transfer-format", (from< store > ()
+                         -> alternative ("RAW")
+#if HAVE_LIBJPEG
+                         -> alternative ("JPEG")
+#endif
+                         -> default_value ("RAW")
+                         ),
+     attributes (level::standard),
+     SEC_N_("Transfer Format")
+     )
+#if HAVE_LIBJPEG
+    ("jpeg-quality", (from< range > ()
+                      -> lower (1)
+                      -> upper (100)
+                      -> default_value (quality_)
+                      ),
+     attributes (),
+     CCB_N_("JPEG Quality")
+     )
+#endif
+    ("scan-area", (from< store > ()
+                   -> alternatives (areas.begin (), areas.end ())
+                   -> default_value ("Manual")
+                   ),
+     attributes (tag::general)(level::standard),
+     SEC_N_("Scan Area")
+     )
+    ("tl-x", (from< range > ()
+              -> lower (0.)
+              -> upper (max_width)
+              -> default_value (0.)
+              ),
+     attributes (tag::geometry)(level::standard),
+     SEC_N_("Top Left X")
+     )
+    ("tl-y", (from< range > ()
+              -> lower (0.)
+              -> upper (max_height)
+              -> default_value (0.)
+              ),
+     attributes (tag::geometry)(level::standard),
+     SEC_N_("Top Left Y")
+     )
+    ("br-x", (from< range > ()
+              -> lower (0.)
+              -> upper (max_width)
+              -> default_value (max_width)
+              ),
+     attributes (tag::geometry)(level::standard),
+     SEC_N_("Bottom Right X")
+     )
+    ("br-y", (from< range > ()
+              -> lower (0.)
+              -> upper (max_height)
+              -> default_value (max_height)
+              ),
+     attributes (tag::geometry)(level::standard),
+     SEC_N_("Bottom Right Y")
+     )
+    ("test-pattern", (from< store > ()
+                      -> alternative ("Bars")
+                      -> alternative ("Blank")
+                      -> alternative ("Skewed")
+                      -> alternative ("Mixed")
+                      -> default_value (pattern)
+                      ),
+     attributes (level::standard),
+     CCB_N_("Test Pattern"),
+     CCB_N_("The Mixed pattern turns every fourth image into a blank"
+            " page and the one following it into a skewed page.")
+     )
+    ("data-rate", (from< range > ()
+                   -> lower (0.)
+                   -> upper (max_rate)
+                   -> default_value (rate)
+                   ),
+     attributes (level::standard),
+     CCB_N_("Data Rate"),
+     CCB_N_("Image data is produced no faster than this many MB/s."
+            "  Use zero to produce image data as fast as possible.")
+     )
+    ;
+
+  if (!validate (values ()))
+    {
+      BOOST_THROW_EXCEPTION
+        (logic_error
+         ("synthetic::scanner(): internal inconsistency"));
+    }
+  finalize (values ());
+}
+
+bool
+scanner::is_single_image () const
+{
+  if (value (adf) != *values_["doc-source"]) return true;
+
+  return (value (1) == *values_["image-count"]
+          && value (toggle (false)) == *values_["duplex"]);
+}
+
+bool
+scanner::validate (const value::map& vm) const
+{
+  if (!option::map::validate (vm)) return false;
+
+  if (value ("JPEG") == vm.at ("transfer-format"))
+    {
+      string type = vm.at ("image-type");
+      return (type == "Color" || type == "Grayscale");
+    }
+  return true;
+}
+
+void
+scanner::finalize (const value::map& vm)
+{
+  value::map final_vm (vm);
+
+  string scan_area = final_vm["scan-area"];
+
+  /**/ if (scan_area == "Maximum")
+    {
+      final_vm["tl-x"] = quantity (0.);
+      final_vm["tl-y"] = quantity (0.);
+      final_vm["br-x"] = quantity (max_width);
+      final_vm["br-y"] = quantity (max_height);
+    }
+  else if (scan_area != "Manual")
+    {
+      media size = media::lookup (scan_area);
+
+      final_vm["tl-x"] = quantity (0.);
+      final_vm["tl-y"] = quantity (0.);
+      final_vm["br-x"] = size.width ();
+      final_vm["br-y"] = size.height ();
+    }
+
+  option::map::finalize (final_vm);
+}
+
+bool
+scanner::set_up_sequence ()
+{
+  val_ = values ();
+
+  is_adf_ = (value (adf) == val_["doc-source"]);
+  is_duplex_ = is_adf_ && (value (toggle (true)) == val_["duplex"]);
+
+  images_ = 1;
+  if (is_adf_)
+    {
+      quantity q = val_["image-count"];
+      images_ = q.amount< int > ();
+      if (is_duplex_)
+        images_ = 2 * ((images_ + 1) / 2);     // next even integer
+    }
+  image_count_ = 0;
+
+  string type = val_["image-type"];
+  /**/ if (type == "Monochrome"    ) type_ = context::MONO;
+  else if (type == "Grayscale"     ) type_ = context::GRAY8;
+  else if (type == "Gray (16 bit)" ) type_ = context::GRAY16;
+  else if (type == "Color (16 bit)") type_ = context::RGB16;
+  else                               type_ = context::RGB8;
+
+  is_compressed_ = (value ("JPEG") == val_["transfer-format"]);
+  if (val_.count ("jpeg-quality"))
+    {
+      quantity q = val_["jpeg-quality"];
+      quality_ = q.amount< int > ();
+    }
+
+  string pattern = val_["test-pattern"];
+  /**/ if (pattern == "Bars"  ) test_pattern_ = BARS;
+  else if (pattern == "Blank" ) test_pattern_ = BLANK;
+  else if (pattern == "Skewed") test_pattern_ = SKEWED;
+  else                          test_pattern_ = MIXED;
+
+  // One MB/s happens to be exactly one octet per microsecond
+
+  quantity rate = val_["data-rate"];
+  rate_ = rate.amount< double > ();
+
+  return true;
+}
+
+bool
+scanner::is_consecutive () const
+{
+  return is_adf_;
+}
+
+bool
+scanner::obtain_media ()
+{
+  return !cancel_requested () && image_count_ < images_;
+}
+
+bool
+scanner::set_up_image ()
+{
+  quantity q_tl_x = val_["tl-x"];
+  quantity q_tl_y = val_["tl-y"];
+  quantity q_br_x = val_["br-x"];
+  quantity q_br_y = val_["br-y"];
+  quantity q_res  = val_["resolution"];
+
+  double tl_x = q_tl_x.amount< double > ();
+  double tl_y = q_tl_y.amount< double > ();
+  double br_x = q_br_x.amount< double > ();
+  double br_y = q_br_y.amount< double > ();
+  int    res  = q_res.amount< int > ();
+
+  if (br_x < tl_x) std::swap (tl_x, br_x);
+  if (br_y < tl_y) std::swap (tl_y, br_y);
+
+  context::size_type width  = std::max (1.0, (br_x - tl_x) * res + 0.5);
+  context::size_type height = std::max (1.0, (br_y - tl_y) * res + 0.5);
+
+  ctx_ = context (width, height, type_);
+  ctx_.resolution (res);
+  if (is_compressed_) ctx_.content_type ("image/jpeg");
+
+  pattern_type_ = pattern_(image_count_);
+  is_rear_ = is_duplex_ && (1 == image_count_ % 2);
+  skew_ = (1.5 + 1.5 * (image_count_ / 4 % 3)) * M_PI / 180;
+
+  rgb_.resize (3 * width);
+  line_.resize (is_compressed_
+                ? (context::GRAY8 == type_ ? 1 : 3) * width
+                : ctx_.octets_per_line ());
+  line_no_ = 0;
+  offset_  = 0;
+
+  image_.clear ();
+  if (is_compressed_)
+    encode_();
+  else
+    render_(line_no_);
+
+  start_  = microseconds ();
+  octets_ = 0;
+
+  return true;
+}
+
+void
+scanner::finish_image ()
+{
+  ++image_count_;
+}
+
+streamsize
+scanner::sgetn (octet *data, streamsize n)
+{
+  if (cancel_requested ()) return traits::eof ();
+
+  streamsize rv = 0;
+
+  if (is_compressed_)
+    {
+      rv = std::min (n, streamsize (image_.size ()) - offset_);
+      traits::copy (data, &image_[offset_], rv);
+      offset_ += rv;
+    }
+  else
+    {
+      const streamsize size = line_.size ();
+
+      while (rv < n && line_no_ < ctx_.height ())
+        {
+          if (size == offset_)
+            {
+              if (ctx_.height () == ++line_no_) break;
+              render_(line_no_);
+              offset_ = 0;
+            }
+
+          streamsize count = std::min (n - rv, size - offset_);
+          traits::copy (data + rv, &line_[offset_], count);
+          offset_ += count;
+          rv      += count;
+        }
+    }
+
+  throttle_(rv);
+
+  return rv;
+}
+
+scanner::pattern_type
+scanner::pattern_(unsigned image) const
+{
+  if (MIXED != test_pattern_) return test_pattern_;
+
+  switch (image % 4)
+    {
+    case 2:  return BLANK;
+    case 3:  return SKEWED;
+    default: return BARS;
+    }
+}
+
+//! Prepare the image data for a scan \a line in line_
+/*! Colour bars fill the top two thirds of regular pages, with a grey
+ *  ramp underneath.  Rear sides are mirrored so they can be told from
+ *  the face side.  Skewed pages show a sheet of paper with lines of
+ *  text on it, rotated by a few degrees on top of the ADF backing.
+ *
+ *  Only skewed pages need to be computed for every scan line.  Other
+ *  patterns reuse the previous line whenever possible.
+ */
+void
+scanner::render_(context::size_type line)
+{
+  const context::size_type w = ctx_.width ();
+  const context::size_type h = ctx_.height ();
+
+  if (0 != line)
+    {
+      if (BLANK == pattern_type_) return;
+      if (BARS  == pattern_type_ && 2 * h / 3 != line) return;
+    }
+
+  uint8_t *p = &rgb_[0];
+
+  if (BLANK == pattern_type_)
+    {
+      std::fill (rgb_.begin (), rgb_.end (), 0xff);
+    }
+  else if (BARS == pattern_type_ && line < 2 * h / 3)
+    {
+      for (context::size_type x = 0; x < w; ++x, p += 3)
+        {
+          context::size_type i = 8 * x / w;
+          if (is_rear_) i = 7 - i;
+          std::copy (bars[i], bars[i] + 3, p);
+        }
+    }
+  else if (BARS == pattern_type_)
+    {
+      for (context::size_type x = 0; x < w; ++x, p += 3)
+        {
+          uint8_t v = 0xff * x / std::max< context::size_type > (1, w - 1);
+          if (is_rear_) v = 0xff - v;
+          std::fill (p, p + 3, v);
+        }
+    }
+  else                          // SKEWED
+    {
+      std::fill (rgb_.begin (), rgb_.end (), backing);
+
+      const double c  = std::cos (skew_);
+      const double s  = std::sin (skew_);
+      const double cx = w / 2.0;
+      const double hw = 0.4 * w;
+      const double hh = 0.4 * h;
+      const double dy = line + 0.5 - h / 2.0;
+
+      // Work out where this line crosses the rotated sheet edges
+
+      double lo = std::max ((-hw - dy * s) / c, (dy * c - hh) / s);
+      double hi = std::min (( hw - dy * s) / c, (dy * c + hh) / s);
+
+      const double period = hh / 12;
+      const double height = period / 3;
+
+      double first = std::max (0.0, std::ceil (cx + lo - 0.5));
+      double last  = std::min (double (w), cx + hi + 0.5);
+
+      for (double x = first; x < last; ++x)
+        {
+          const double dx = x + 0.5 - cx;
+          const double u  =  dx * c + dy * s;
+          const double v  = -dx * s + dy * c + hh;
+
+          bool is_text = (std::fabs (u) < 0.8 * hw
+                          && period < v && v < 2 * hh - period
+                          && std::fmod (v, period) < height);
+
+          std::fill_n (p + 3 * context::size_type (x), 3,
+                       is_text ? ink : 0xff);
+        }
+    }
+
+  pack_();
+}
+
+//! Convert the RGB values in rgb_ to the image's pixel type
+void
+scanner::pack_()
+{
+  const context::size_type w = ctx_.width ();
+  const uint8_t *src = &rgb_[0];
+  octet *dst = &line_[0];
+
+  switch (type_)
+    {
+    case context::MONO:
+      std::fill (line_.begin (), line_.end (), 0x00);
+      for (context::size_type x = 0; x < w; ++x, src += 3)
+        {
+          if (0x80 <= luminance (src)) dst[x / 8] |= 0x80 >> (x % 8);
+        }
+      break;
+    case context::GRAY8:
+      for (context::size_type x = 0; x < w; ++x, src += 3)
+        {
+          *dst++ = luminance (src);
+        }
+      break;
+    case context::GRAY16:
+      for (context::size_type x = 0; x < w; ++x, src += 3)
+        {
+          *dst++ = luminance (src);
+          *dst++ = luminance (src);
+        }
+      break;
+    case context::RGB16:
+      for (context::size_type i = 0; i < 3 * w; ++i)
+        {
+          *dst++ = src[i];
+          *dst++ = src[i];
+        }
+      break;
+    default:
+      std::copy (rgb_.begin (), rgb_.end (), line_.begin ());
+    }
+}
+
+//! Compress the complete image into image_
+void
+scanner::encode_()
+{
+#if HAVE_LIBJPEG
+  struct jpeg_compress_struct cinfo;
+  struct jpeg_error_mgr       jerr;
+  struct jpeg_destination_mgr dmgr;
+
+  cinfo.err = jpeg_std_error (&jerr);
+  jerr.error_exit = &destination::error_exit;
+
+  jpeg_create_compress (&cinfo);
+
+  dmgr.init_destination    = &destination::init;
+  dmgr.empty_output_buffer = &destination::empty;
+  dmgr.term_destination    = &destination::term;
+
+  cinfo.client_data = &image_;
+  cinfo.dest        = &dmgr;
+
+  cinfo.image_width      = ctx_.width ();
+  cinfo.image_height     = ctx_.height ();
+  cinfo.input_components = (context::GRAY8 == type_ ? 1 : 3);
+  cinfo.in_color_space   = (context::GRAY8 == type_ ? JCS_GRAYSCALE : JCS_RGB);
+
+  jpeg_set_defaults (&cinfo);
+  jpeg_set_quality (&cinfo, quality_, true);
+  jpeg_start_compress (&cinfo, true);
+
+  for (context::size_type y = 0; y < ctx_.height (); ++y)
+    {
+      render_(y);
+
+      JSAMPROW row = reinterpret_cast< JSAMPROW > (&line_[0]);
+      jpeg_write_scanlines (&cinfo, &row, 1);
+    }
+
+  jpeg_finish_compress (&cinfo);
+  jpeg_destroy_compress (&cinfo);
+#endif  /* HAVE_LIBJPEG */
+}
+
+//! Hold back until \a n more octets are due at the requested rate
+void
+scanner::throttle_(streamsize n)
+{
+  if (0 >= n || 0 == rate_) return;
+
+  octets_ += n;
+
+  uint64_t due = start_ + octets_ / rate_;
+  uint64_t now = microseconds ();
+
+  if (now < due) delay (due - now);
+}
+
+}       // namespace synthetic
+}       // namespace _drv_
+}       // namespace utsushi
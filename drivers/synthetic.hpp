@@ -0,0 +1,128 @@
+//  synthetic.hpp -- virtual scanner producing test images at speed
+//  Copyright (C) 2026  SEIKO EPSON CORPORATION
+//
+//  License: GPL-3.0+
+//  Author : EPSON AVASYS CORPORATION
+//
+//  This file is part of the 'Utsushi' package.
+//  This package is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License or, at
+//  your option, any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//  You ought to have received a copy of the GNU General Public License
+//  along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef drivers_synthetic_hpp_
+#define drivers_synthetic_hpp_
+
+#include <string>
+#include <vector>
+
+#include "utsushi/cstdint.hpp"
+#include "utsushi/option.hpp"
+#include "utsushi/scanner.hpp"
+
+namespace utsushi {
+
+extern "C" {
+  /*! Creates a scanner that needs no hardware at all.  The UDI query
+   *  may set the defaults for the number of images, the data rate in
+   *  MB/s and the test pattern, as in
+   *  \verbatim
+  synthetic::?pages=500&rate=40&pattern=Mixed
+  \endverbatim
+   *  Add such a UDI to the \c [devices] section of a configuration
+   *  file to make the scanner available to the applications.
+   */
+  void libdrv_synthetic_LTX_scanner_factory (const scanner::info& info,
+                                             scanner::ptr& rv);
+}
+
+namespace _drv_ {
+namespace synthetic {
+
+//! A virtual scanner for load testing the image processing pipeline
+/*! Image data is generated on the fly from a handful of deterministic
+ *  test patterns.  Colour bars and a grey ramp make up a regular page
+ *  while blank and skewed pages give the blank page detection and the
+ *  deskew support something to chew on.  The \c Mixed pattern cycles
+ *  through all of these.
+ *
+ *  Images come either as raw scan lines or as JPEG, at the requested
+ *  resolution and pixel type and, optionally, no faster than a given
+ *  data rate.  A duplex scan produces the face and rear side of every
+ *  sheet back to back, just like the real thing.
+ */
+class scanner
+  : public utsushi::scanner
+{
+public:
+  scanner (const unsigned& pages, const double& rate,
+           const std::string& pattern);
+
+  bool is_single_image () const;
+
+protected:
+  bool validate (const value::map& vm) const;
+  void finalize (const value::map& vm);
+
+  bool set_up_sequence ();
+  bool is_consecutive () const;
+  bool obtain_media ();
+  bool set_up_image ();
+  void finish_image ();
+
+  streamsize sgetn (octet *data, streamsize n);
+
+private:
+  enum pattern_type { BARS, BLANK, SKEWED, MIXED };
+
+  pattern_type pattern_(unsigned image) const;
+
+  void render_(context::size_type line);
+  void pack_();
+  void encode_();
+  void throttle_(streamsize n);
+
+  value::map val_;
+
+  unsigned images_;             //!< to produce in this sequence
+  unsigned image_count_;        //!< produced so far in this sequence
+
+  bool is_adf_;
+  bool is_duplex_;
+  bool is_compressed_;
+  int  quality_;
+  context::_pxl_type_ type_;
+  pattern_type test_pattern_;
+  double       rate_;           //!< octets per microsecond, 0 for max
+
+  pattern_type pattern_type_;   //!< for the current image
+  bool         is_rear_;
+  double       skew_;
+
+  //! Light based RGB values for a single scan line
+  std::vector< uint8_t > rgb_;
+  //! A scan line of image data in the final pixel type
+  std::vector< octet > line_;
+  //! Image data for the whole image if compressed
+  std::vector< octet > image_;
+
+  context::size_type line_no_;
+  streamsize offset_;
+
+  uint64_t   start_;
+  uint64_t   octets_;
+};
+
+}       // namespace synthetic
+}       // namespace _drv_
+}       // namespace utsushi
+
+#endif  /* drivers_synthetic_hpp_ */
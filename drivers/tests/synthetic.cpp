@@ -0,0 +1,121 @@
+//  synthetic.cpp -- unit tests for the synthetic scanner driver
+//  Copyright (C) 2026  SEIKO EPSON CORPORATION
+//
+//  License: GPL-3.0+
+//  Author : EPSON AVASYS CORPORATION
+//
+//  This file is part of the 'Utsushi' package.
+//  This package is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License or, at
+//  your option, any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//  You ought to have received a copy of the GNU General Public License
+//  along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string>
+
+#include <boost/crc.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "utsushi/quantity.hpp"
+#include "utsushi/scanner.hpp"
+#include "utsushi/test/memory.hpp"
+
+#include "../synthetic.hpp"
+
+using namespace utsushi;
+
+//! Scans four 2 x 2 inch images at 50 dpi in the given \a pattern
+/*! The images are collected in \a odev and their CRC-32 is returned.
+ */
+static
+unsigned
+scan (const std::string& pattern, capture_odevice& odev, context& ctx)
+{
+  scanner::ptr idev;
+  libdrv_synthetic_LTX_scanner_factory
+    (scanner::info ("synthetic::?pages=4&pattern=" + pattern), idev);
+  BOOST_REQUIRE (idev);
+
+  value::map vm (idev->options ()->values ());
+  vm["scan-area"]  = value ("Manual");
+  vm["br-x"]       = quantity (2.);
+  vm["br-y"]       = quantity (2.);
+  vm["resolution"] = quantity (50);
+  idev->options ()->assign (vm);
+
+  *idev | odev;
+  ctx = idev->get_context ();
+
+  boost::crc_32_type crc;
+  crc.process_bytes (&odev.data[0], odev.data.size ());
+  return crc.checksum ();
+}
+
+static
+void
+check_context (const context& ctx)
+{
+  BOOST_CHECK_EQUAL (100, ctx.width ());
+  BOOST_CHECK_EQUAL (100, ctx.height ());
+  BOOST_CHECK_EQUAL (8, ctx.depth ());
+  BOOST_CHECK_EQUAL (3, ctx.comps ());
+  BOOST_CHECK_EQUAL (300, ctx.octets_per_line ());
+}
+
+BOOST_AUTO_TEST_CASE (bars)
+{
+  capture_odevice odev;
+  context ctx;
+
+  BOOST_CHECK_EQUAL (0x18cc8766u, scan ("Bars", odev, ctx));
+  check_context (ctx);
+  BOOST_CHECK_EQUAL (4, odev.images);
+  BOOST_CHECK_EQUAL (4 * 300 * 100, odev.data.size ());
+}
+
+BOOST_AUTO_TEST_CASE (blank)
+{
+  capture_odevice odev;
+  context ctx;
+
+  BOOST_CHECK_EQUAL (0xb068f1fbu, scan ("Blank", odev, ctx));
+  check_context (ctx);
+  BOOST_CHECK_EQUAL (4, odev.images);
+  BOOST_CHECK_EQUAL (4 * 300 * 100, odev.data.size ());
+}
+
+BOOST_AUTO_TEST_CASE (skewed)
+{
+  capture_odevice odev;
+  context ctx;
+
+  BOOST_CHECK_EQUAL (0x4aacbfe8u, scan ("Skewed", odev, ctx));
+  check_context (ctx);
+  BOOST_CHECK_EQUAL (4, odev.images);
+  BOOST_CHECK_EQUAL (4 * 300 * 100, odev.data.size ());
+}
+
+BOOST_AUTO_TEST_CASE (mixed)
+{
+  capture_odevice odev;
+  context ctx;
+
+  BOOST_CHECK_EQUAL (0x78369e85u, scan ("Mixed", odev, ctx));
+  check_context (ctx);
+  BOOST_CHECK_EQUAL (4, odev.images);
+  BOOST_CHECK_EQUAL (4 * 300 * 100, odev.data.size ());
+}
+
+#include "utsushi/test/runner.ipp"
@@ -24,8 +24,7 @@
 
 #include "autocrop.hpp"
 
-#include <utsushi/range.hpp>
-#include <utsushi/run-time.hpp>
+#include <utsushi/toggle.hpp>
 
 #include <boost/lexical_cast.hpp>
 
@@ -37,26 +36,23 @@ using boost::lexical_cast;
 const streamsize PNM_HEADER_SIZE = 50;
 
 autocrop::autocrop ()
-  : shell_pipe (run_time ().exec_file (run_time::pkg, "doc-locate"))
 {
   option_->add_options ()
-    ("lo-threshold", (from< range > ()  // percentage
-                      -> lower (  0.0)
-                      -> upper (100.0)
-                      -> default_value (45.0)))
-    ("hi-threshold", (from< range > ()  // percentage
-                      -> lower (  0.0)
-                      -> upper (100.0)
-                      -> default_value (55.0)))
     ("trim", toggle (false))
     ;
   freeze_options ();   // initializes option tracking member variables
 }
 
+filter::ptr
+autocrop::clone () const
+{
+  return clone_< autocrop > ();
+}
+
 void
 autocrop::mark (traits::int_type c, const context& ctx)
 {
-  if (traits::boi () == c)
+  if (traits::boi () == c && !is_native_(ctx))
     {
       traits::assign (header_buf_, header_buf_size_, 0x00);
       header_buf_used_ = 0;
@@ -66,19 +62,14 @@ autocrop::mark (traits::int_type c, const context& ctx)
     }
   else
     {
-      shell_pipe::mark (c, ctx);
+      locating_pipe::mark (c, ctx);
     }
 }
 
 void
 autocrop::freeze_options ()
 {
-  quantity threshold;
-
-  threshold = value ((*option_)["lo-threshold"]);
-  lo_threshold_ = threshold.amount< double > ();
-  threshold = value ((*option_)["hi-threshold"]);
-  hi_threshold_ = threshold.amount< double > ();
+  locating_pipe::freeze_options ();
 
   toggle t = value ((*option_)["trim"]);
   trim_ = t;
@@ -118,6 +109,8 @@ autocrop::arguments (const context& ctx)
 
   string argv;
 
+  if (is_persistent ()) argv += " --framed";
+
   // Set up input data characteristics
 
   argv += " " + lexical_cast< string > (lo_threshold_ / 100);
@@ -131,6 +124,12 @@ autocrop::arguments (const context& ctx)
   return argv;
 }
 
+doc_locator::action
+autocrop::action_() const
+{
+  return (trim_ ? doc_locator::TRIM : doc_locator::CROP);
+}
+
 static inline
 bool
 is_white_space (char c)
@@ -21,17 +21,20 @@
 #ifndef filters_autocrop_hpp_
 #define filters_autocrop_hpp_
 
-#include "shell-pipe.hpp"
+#include "locating-pipe.hpp"
 
 namespace utsushi {
 namespace _flt_ {
 
+//!  Crop images to the (straightened) documents they contain
 class autocrop
-  : public shell_pipe
+  : public locating_pipe
 {
 public:
   autocrop ();
 
+  filter::ptr clone () const;
+
   void mark (traits::int_type c, const context& ctx);
 
 protected:
@@ -44,7 +47,10 @@ protected:
 
   void checked_write (octet *data, streamsize n);
 
+  doc_locator::action action_() const;
+
 private:
+
   static const streamsize header_buf_size_ = 64;
 
   bool       header_seen_;
@@ -54,9 +60,7 @@ private:
   context::size_type width_;
   context::size_type height_;
 
-  double lo_threshold_;
-  double hi_threshold_;
-  bool   trim_;
+  bool trim_;
 };
 
 }       // namespace _flt_
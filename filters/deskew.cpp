@@ -24,9 +24,6 @@
 
 #include "deskew.hpp"
 
-#include <utsushi/range.hpp>
-#include <utsushi/run-time.hpp>
-
 #include <boost/lexical_cast.hpp>
 
 namespace utsushi {
@@ -37,30 +34,12 @@ using boost::lexical_cast;
 const streamsize PNM_HEADER_SIZE = 50;
 
 deskew::deskew ()
-  : shell_pipe (run_time ().exec_file (run_time::pkg, "doc-locate"))
-{
-  option_->add_options ()
-    ("lo-threshold", (from< range > ()  // percentage
-                      -> lower (  0.0)
-                      -> upper (100.0)
-                      -> default_value (45.0)))
-    ("hi-threshold", (from< range > ()  // percentage
-                      -> lower (  0.0)
-                      -> upper (100.0)
-                      -> default_value (55.0)))
-    ;
-  freeze_options ();   // initializes option tracking member variables
-}
+{}
 
-void
-deskew::freeze_options ()
+filter::ptr
+deskew::clone () const
 {
-  quantity threshold;
-
-  threshold = value ((*option_)["lo-threshold"]);
-  lo_threshold_ = threshold.amount< double > ();
-  threshold = value ((*option_)["hi-threshold"]);
-  hi_threshold_ = threshold.amount< double > ();
+  return clone_< deskew > ();
 }
 
 std::string
@@ -70,6 +49,8 @@ deskew::arguments (const context& ctx)
 
   string argv;
 
+  if (is_persistent ()) argv += " --framed";
+
   // Set up input data characteristics
 
   argv += " " + lexical_cast< string > (lo_threshold_ / 100);
@@ -81,5 +62,11 @@ deskew::arguments (const context& ctx)
   return argv;
 }
 
+doc_locator::action
+deskew::action_() const
+{
+  return doc_locator::DESKEW;
+}
+
 }       // namespace _flt_
 }       // namespace utsushi
@@ -21,27 +21,26 @@
 #ifndef filters_deskew_hpp_
 #define filters_deskew_hpp_
 
-#include "shell-pipe.hpp"
+#include "locating-pipe.hpp"
 
 #include <string>
 
 namespace utsushi {
 namespace _flt_ {
 
+//!  Straighten skewed documents
 class deskew
-  : public shell_pipe
+  : public locating_pipe
 {
 public:
   deskew ();
 
-protected:
-  void freeze_options ();
+  filter::ptr clone () const;
 
+protected:
   std::string arguments (const context& ctx);
 
-private:
-  double lo_threshold_;
-  double hi_threshold_;
+  doc_locator::action action_() const;
 };
 
 }       // namespace _flt_
@@ -42,6 +42,7 @@
 
 #include <Magick++.h>
 
+#include <algorithm>
 #include <cerrno>
 #include <cmath>
 #include <cstdlib>
@@ -50,7 +51,9 @@
 #include <iostream>
 #include <limits>
 #include <sstream>
+#include <string>
 
+#include <stdint.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -685,22 +688,168 @@ trim (Magick::Image& image, const locator& loc)
   image.colorFuzz (0);
   image.trim ();
 }
+
+//! Size of the chunk size prefix used by the shell-pipe filter framing
+const size_t frame_head_size = 4;
+
+//! Chunk size that tells the shell-pipe filter an image failed
+const uint32_t frame_failure = 0xffffffff;
+
+bool
+read_fully (int fd, char *data, size_t n)
+{
+  while (0 < n)
+    {
+      ssize_t rv = read (fd, data, n);
+
+      if (0 > rv && EINTR == errno) continue;
+      if (0 >= rv) return false;
+
+      data += rv;
+      n    -= rv;
+    }
+  return true;
+}
+
+bool
+write_fully (int fd, const char *data, size_t n)
+{
+  while (0 < n)
+    {
+      ssize_t rv = write (fd, data, n);
+
+      if (0 > rv && EINTR == errno) continue;
+      if (0 >= rv) return false;
+
+      data += rv;
+      n    -= rv;
+    }
+  return true;
+}
+
+bool
+write_size (uint32_t size)
+{
+  char head[frame_head_size];
+
+  for (size_t i = frame_head_size; 0 < i; --i, size >>= 8)
+    head[i - 1] = size & 0xff;
+
+  return write_fully (STDOUT_FILENO, head, frame_head_size);
+}
+
+//! Collects the chunks of the next image on standard input
+/*! Returns \c false when input ends before a complete image is seen.
+ */
+bool
+read_frames (std::string& image)
+{
+  image.clear ();
+
+  for (;;)
+    {
+      unsigned char head[frame_head_size];
+
+      if (!read_fully (STDIN_FILENO, reinterpret_cast< char * > (head),
+                       frame_head_size))
+        return false;
+
+      uint32_t size = 0;
+      for (size_t i = 0; i < frame_head_size; ++i)
+        size = (size << 8) | head[i];
+
+      if (0 == size) return true;
+
+      size_t used = image.size ();
+      image.resize (used + size);
+      if (!read_fully (STDIN_FILENO, &image[used], size))
+        return false;
+    }
+}
+
+//! Processes framed images until standard input is closed
+/*! This lets the shell-pipe filter use a single process for a whole
+ *  sequence of images rather than start one for each image.
+ */
+int
+serve (void (*process)(Magick::Image&, const locator&),
+       double lo_threshold, double hi_threshold, double fuzz,
+       const std::string& output)
+{
+  const size_t max_chunk_size = 1 << 30;
+
+  std::string image;
+
+  while (read_frames (image))
+    {
+      bool ok = true;
+      try
+        {
+          Magick::Blob blob (image.data (), image.size ());
+          Magick::Image original (blob);
+
+          locator loc (original, lo_threshold, hi_threshold, fuzz);
+
+          process (original, loc);
+
+          std::string::size_type colon = output.find (':');
+          if (std::string::npos != colon)
+            original.magick (output.substr (0, colon));
+
+          original.write (&blob);
+
+          const char *data = static_cast< const char * > (blob.data ());
+          size_t n = blob.length ();
+
+          while (ok && 0 < n)
+            {
+              size_t k = std::min (n, max_chunk_size);
+
+              ok = (write_size (k) && write_fully (STDOUT_FILENO, data, k));
+              data += k;
+              n    -= k;
+            }
+          if (ok) ok = write_size (0);
+        }
+      catch (std::exception &oops)
+        {
+          std::cerr << oops.what () << std::endl;
+          ok = write_size (frame_failure);
+        }
+      if (!ok) return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
 }       // namespace
 
 int
 main (int argc, char *argv[])
 {
+  const bool framed = (1 < argc && !strcmp (argv[1], "--framed"));
+
+  if (framed)
+    {
+      argv[1] = argv[0];
+      --argc;
+      ++argv;
+    }
+
   if (3 > argc)
     {
       std::cerr
         << "Usage: " << argv[0]
-        << " lo hi [action [size [source [destination]]]]\n"
+        << " [--framed] lo hi [action [size [source [destination]]]]\n"
         << "\n"
         << "The program expects two threshold values bracketing the image's\n"
         << "background intensity.  Values should be in [0,1].\n"
         << "Supported actions are crop, trim and deskew.\n"
         << "Source and destination image specifications are optional.  They\n"
         << "default to standard input and standard output.\n"
+        << "\n"
+        << "With --framed, a sequence of images is read from standard input\n"
+        << "using the shell-pipe filter's framing and results are written to\n"
+        << "standard output the same way.  The size and source are ignored.\n"
         ;
       exit (1);
     }
@@ -764,6 +913,10 @@ main (int argc, char *argv[])
   const char *output = (argc > 6 ? argv[6] : "-");
 
   Magick::InitializeMagick (*argv);
+
+  if (framed)
+    return serve (process, lo_threshold, hi_threshold, fuzz, output);
+
   Magick::Image original;
 
   try
@@ -0,0 +1,521 @@
+//  doc-locator.cpp -- in-process document location and deskewing
+//  Copyright (C) 2026  SEIKO EPSON CORPORATION
+//
+//  License: GPL-3.0+
+//  Author : EPSON AVASYS CORPORATION
+//
+//  This file is part of the 'Utsushi' package.
+//  This package is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License or, at
+//  your option, any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//  You ought to have received a copy of the GNU General Public License
+//  along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "doc-locator.hpp"
+
+#include <utsushi/format.hpp>
+#include <utsushi/log.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <string>
+
+namespace utsushi {
+namespace _flt_ {
+
+namespace {
+
+const std::string pnm_content_type ("image/x-portable-anymap");
+
+//! Longest thumbnail side to aim for
+const streamsize thumbnail_size = 640;
+
+//! Intensity below which pixels are taken to be text (as doc-locate)
+const unsigned char dark_threshold = 102;
+
+//! Color used for areas that lie outside of the raster
+const octet fill_color = octet (0xff);
+
+//! Scores how well features line up along lines with slope tan (\a a)
+/*! Features are projected onto a line perpendicular to that slope and
+ *  counted per thumbnail pixel.  The sum of the squared counts peaks
+ *  when many features end up in few bins, i.e. at the skew angle.
+ */
+double
+projection_score (const std::vector< int >& x, const std::vector< int >& y,
+                  double a, streamsize width, streamsize height)
+{
+  const double c = std::cos (a);
+  const double s = std::sin (a);
+  const double offset = width + 1;
+
+  std::vector< unsigned > bins (height + 2 * width + 3, 0);
+
+  for (std::size_t i = 0; i < x.size (); ++i)
+    ++bins[streamsize (y[i] * c - x[i] * s + offset)];
+
+  double rv = 0;
+  for (std::size_t i = 0; i < bins.size (); ++i)
+    rv += double (bins[i]) * bins[i];
+
+  return rv;
+}
+
+}       // namespace
+
+doc_locator::doc_locator (const context& ctx,
+                          double lo_threshold, double hi_threshold)
+  : ctx_(ctx)
+  , result_(ctx)
+  , lo_threshold_(std::max (0.0, std::min (lo_threshold, 1.0)) * 255)
+  , hi_threshold_(std::max (0.0, std::min (hi_threshold, 1.0)) * 255)
+  , header_seen_(pnm_content_type != ctx.content_type ())
+  , stride_(ctx.octets_per_line ())
+  , rows_(0)
+  , sum_rows_(0)
+  , angle_(0)
+  , center_x_(0), center_y_(0)
+  , origin_x_(0), origin_y_(0)
+{
+  streamsize size = ctx.width ();
+  if (ctx.height () != context::unknown_size)
+    {
+      size = std::max (size, streamsize (ctx.height ()));
+      raster_.reserve (ctx.octets_per_image ());
+    }
+
+  scale_ = std::max< streamsize > (1, (size + thumbnail_size - 1)
+                                   / thumbnail_size);
+  thumb_width_ = (ctx.width () + scale_ - 1) / scale_;
+  sum_.assign (thumb_width_, 0);
+}
+
+bool
+doc_locator::supports (const context& ctx)
+{
+  return (8 == ctx.depth ()
+          && (1 == ctx.comps () || 3 == ctx.comps ())
+          && context::unknown_size != ctx.width ()
+          && 0 < ctx.width ());
+}
+
+streamsize
+doc_locator::write (const octet *data, streamsize n)
+{
+  const streamsize rv = n;
+
+  if (!header_seen_)            // skip the pnm filter's one-line header
+    {
+      const octet *eol = std::find (data, data + n, '\n');
+
+      if (data + n == eol) return rv;
+
+      header_seen_ = true;
+      n   -= eol + 1 - data;
+      data = eol + 1;
+    }
+
+  raster_.insert (raster_.end (), data, data + n);
+
+  while ((rows_ + 1) * stride_ <= streamsize (raster_.size ()))
+    {
+      thumbnail_scanline_(&raster_[rows_ * stride_]);
+      ++rows_;
+    }
+
+  return rv;
+}
+
+context
+doc_locator::locate (action a)
+{
+  if (0 < sum_rows_) add_thumbnail_row_();
+
+  const streamsize width = ctx_.width ();
+
+  result_ = ctx_;
+  result_.width (width);
+  result_.height (rows_);
+
+  angle_ = 0;
+  center_x_ = center_y_ = 0;
+  origin_x_ = origin_y_ = 0;
+
+  if (TRIM == a)
+    {
+      trim_();
+      return result_;
+    }
+
+  const streamsize tw = thumb_width_;
+  const streamsize th = (tw ? thumb_.size () / tw : 0);
+
+  if (!tw || !th) return result_;
+
+  // Mark everything outside the background intensity range as part
+  // of the document and weed out specks by majority vote.
+
+  std::vector< char > doc (tw * th);
+  for (std::size_t i = 0; i < doc.size (); ++i)
+    doc[i] = (thumb_[i] < lo_threshold_ || hi_threshold_ < thumb_[i]);
+
+  std::vector< char > mask (tw * th, 0);
+  for (streamsize ty = 0; ty < th; ++ty)
+    for (streamsize tx = 0; tx < tw; ++tx)
+      {
+        int count = 0;
+        for (streamsize y = std::max< streamsize > (0, ty - 1);
+             y < std::min (th, ty + 2); ++y)
+          for (streamsize x = std::max< streamsize > (0, tx - 1);
+               x < std::min (tw, tx + 2); ++x)
+            count += doc[y * tw + x];
+        mask[ty * tw + tx] = (5 <= count);
+      }
+
+  // Text and the document's outline are what the skew angle is based
+  // on.  Outline parts on the edges of the image are of no use.
+
+  std::vector< int > fx, fy;
+  for (streamsize ty = 1; ty < th - 1; ++ty)
+    for (streamsize tx = 1; tx < tw - 1; ++tx)
+      {
+        const streamsize i = ty * tw + tx;
+
+        if (!mask[i]) continue;
+
+        if (dark_threshold > thumb_[i]
+            || !mask[i - 1] || !mask[i + 1]
+            || !mask[i - tw] || !mask[i + tw])
+          {
+            fx.push_back (tx);
+            fy.push_back (ty);
+          }
+      }
+
+  if (fx.empty ())
+    {
+      log::brief ("doc-locator: no document found");
+      return result_;
+    }
+
+  angle_ = estimate_skew_(fx, fy);
+  center_x_ = width / 2;
+  center_y_ = rows_ / 2;
+
+  if (DESKEW == a)
+    {
+      origin_x_ = -center_x_;
+      origin_y_ = -center_y_;
+      return result_;
+    }
+
+  // Find the document's bounding box once straightened
+
+  const double c = std::cos (angle_);
+  const double s = std::sin (angle_);
+
+  double x_min =  std::numeric_limits< double >::max ();
+  double y_min =  std::numeric_limits< double >::max ();
+  double x_max = -std::numeric_limits< double >::max ();
+  double y_max = -std::numeric_limits< double >::max ();
+
+  for (streamsize ty = 0; ty < th; ++ty)
+    for (streamsize tx = 0; tx < tw; ++tx)
+      {
+        if (!mask[ty * tw + tx]) continue;
+
+        double px = (tx + 0.5) * scale_ - center_x_;
+        double py = (ty + 0.5) * scale_ - center_y_;
+        double qx =  c * px + s * py;
+        double qy = -s * px + c * py;
+
+        x_min = std::min (x_min, qx);
+        x_max = std::max (x_max, qx);
+        y_min = std::min (y_min, qy);
+        y_max = std::max (y_max, qy);
+      }
+
+  if (x_min > x_max)
+    {
+      log::brief ("doc-locator: no document found");
+      angle_ = 0;
+      center_x_ = center_y_ = 0;
+      return result_;
+    }
+
+  const double margin = scale_ / 2.0;
+
+  x_min = std::floor (x_min - margin);
+  y_min = std::floor (y_min - margin);
+  x_max = std::ceil  (x_max + margin);
+  y_max = std::ceil  (y_max + margin);
+
+  if (0 == angle_)
+    {
+      x_min = std::max (x_min, -center_x_);
+      y_min = std::max (y_min, -center_y_);
+      x_max = std::min (x_max, width - center_x_);
+      y_max = std::min (y_max, rows_ - center_y_);
+    }
+
+  origin_x_ = x_min;
+  origin_y_ = y_min;
+  result_.width  (x_max - x_min);
+  result_.height (y_max - y_min);
+
+  return result_;
+}
+
+void
+doc_locator::render (output& out) const
+{
+  if (pnm_content_type == result_.content_type ())
+    {
+      format fmt ("P%1% %2% %3% 255\n");
+      std::string header = (fmt % (3 == result_.comps () ? 6 : 5)
+                            % result_.width () % result_.height ()).str ();
+      out.write (header.c_str (), header.length ());
+    }
+
+  const streamsize octets = result_.width () * result_.comps ();
+
+  if (0 >= octets) return;
+
+  std::vector< octet > line (octets);
+  for (streamsize v = 0; v < streamsize (result_.height ()); ++v)
+    {
+      render_scanline_(&line[0], v);
+
+      const octet *p = &line[0];
+      streamsize   n = octets;
+      while (0 < n)
+        {
+          streamsize m = out.write (p, n);
+          p += m;
+          n -= m;
+        }
+    }
+}
+
+double
+doc_locator::skew_angle () const
+{
+  return angle_ * 180 / M_PI;
+}
+
+void
+doc_locator::thumbnail_scanline_(const octet *line)
+{
+  const streamsize width = ctx_.width ();
+  const streamsize comps = ctx_.comps ();
+  const unsigned char *p = reinterpret_cast< const unsigned char * > (line);
+
+  for (streamsize tx = 0, x = 0; tx < thumb_width_; ++tx)
+    {
+      unsigned sum = 0;
+      streamsize end = std::min (width, x + scale_);
+
+      if (1 == comps)
+        for (; x < end; ++x, ++p)
+          sum += p[0];
+      else
+        for (; x < end; ++x, p += comps)
+          sum += (77 * p[0] + 150 * p[1] + 29 * p[2]) >> 8;
+
+      sum_[tx] += sum;
+    }
+
+  if (++sum_rows_ == scale_) add_thumbnail_row_();
+}
+
+void
+doc_locator::add_thumbnail_row_()
+{
+  const streamsize width = ctx_.width ();
+
+  for (streamsize tx = 0; tx < thumb_width_; ++tx)
+    {
+      streamsize cols = std::min (scale_, width - tx * scale_);
+      thumb_.push_back (sum_[tx] / (cols * sum_rows_));
+      sum_[tx] = 0;
+    }
+  sum_rows_ = 0;
+}
+
+//! Searches for the angle at which features line up best
+/*! A coarse search over the range that doc-locate covers is followed
+ *  by a finer one around the best candidate.  Level documents are
+ *  left alone unless some other angle is a definite improvement.
+ */
+double
+doc_locator::estimate_skew_(const std::vector< int >& x,
+                            const std::vector< int >& y) const
+{
+  const streamsize tw = thumb_width_;
+  const streamsize th = thumb_.size () / tw;
+
+  const double max_angle   = std::atan (1.0 / 8);
+  const double coarse_step = 0.5  * M_PI / 180;
+  const double fine_step   = 0.05 * M_PI / 180;
+
+  const double level = projection_score (x, y, 0, tw, th);
+
+  double best = 0;
+  double best_score = level;
+
+  for (double a = -max_angle; a <= max_angle; a += coarse_step)
+    {
+      double score = projection_score (x, y, a, tw, th);
+      if (score > best_score)
+        {
+          best = a;
+          best_score = score;
+        }
+    }
+
+  const double center = best;
+  for (double a = center - coarse_step; a <= center + coarse_step;
+       a += fine_step)
+    {
+      double score = projection_score (x, y, a, tw, th);
+      if (score > best_score)
+        {
+          best = a;
+          best_score = score;
+        }
+    }
+
+  if (std::fabs (best) < fine_step) best = 0;
+
+  log::debug ("doc-locator: skew angle %1% degrees") % (best * 180 / M_PI);
+
+  return best;
+}
+
+//! Removes borders that have the same color as the top-left pixel
+void
+doc_locator::trim_()
+{
+  const streamsize width = ctx_.width ();
+
+  if (!rows_ || !width) return;
+
+  streamsize y0 = 0;
+  while (y0 < rows_ && is_plain_(0, width, y0, y0 + 1)) ++y0;
+
+  if (y0 == rows_) return;      // nothing but border
+
+  streamsize y1 = rows_;
+  while (y1 > y0 && is_plain_(0, width, y1 - 1, y1)) --y1;
+
+  streamsize x0 = 0;
+  while (x0 < width && is_plain_(x0, x0 + 1, y0, y1)) ++x0;
+
+  streamsize x1 = width;
+  while (x1 > x0 && is_plain_(x1 - 1, x1, y0, y1)) --x1;
+
+  origin_x_ = x0;
+  origin_y_ = y0;
+  result_.width  (x1 - x0);
+  result_.height (y1 - y0);
+}
+
+//! Tells whether all pixels in a rectangle match the top-left pixel
+bool
+doc_locator::is_plain_(streamsize x0, streamsize x1,
+                       streamsize y0, streamsize y1) const
+{
+  const streamsize comps = ctx_.comps ();
+  const octet *corner = &raster_[0];
+
+  for (streamsize y = y0; y < y1; ++y)
+    for (streamsize x = x0; x < x1; ++x)
+      if (0 != std::memcmp (&raster_[y * stride_ + x * comps], corner, comps))
+        return false;
+
+  return true;
+}
+
+void
+doc_locator::render_scanline_(octet *line, streamsize v) const
+{
+  const streamsize width = result_.width ();
+  const streamsize comps = result_.comps ();
+  const streamsize src_width = ctx_.width ();
+
+  const double c = std::cos (angle_);
+  const double s = std::sin (angle_);
+
+  const double qx = origin_x_ + 0.5;
+  const double qy = origin_y_ + v + 0.5;
+
+  double sx = center_x_ + c * qx - s * qy - 0.5;
+  double sy = center_y_ + s * qx + c * qy - 0.5;
+
+  if (0 == angle_)              // a mere shift by whole pixels
+    {
+      const streamsize x = std::floor (sx + 0.5);
+      const streamsize y = std::floor (sy + 0.5);
+
+      std::fill (line, line + width * comps, fill_color);
+      if (0 > y || rows_ <= y) return;
+
+      streamsize u0 = std::max< streamsize > (0, -x);
+      streamsize u1 = std::min (width, src_width - x);
+      if (u0 < u1)
+        traits::copy (line + u0 * comps,
+                      &raster_[y * stride_ + (x + u0) * comps],
+                      (u1 - u0) * comps);
+      return;
+    }
+
+  const unsigned char *src
+    = reinterpret_cast< const unsigned char * > (&raster_[0]);
+  const unsigned fill = static_cast< unsigned char > (fill_color);
+
+  for (streamsize u = 0; u < width; ++u, sx += c, sy += s)
+    {
+      const double fx = std::floor (sx);
+      const double fy = std::floor (sy);
+      const streamsize x = fx;
+      const streamsize y = fy;
+      const unsigned wx = (sx - fx) * 256;
+      const unsigned wy = (sy - fy) * 256;
+
+      const bool x_ok[2] = { 0 <= x && x < src_width,
+                             0 <= x + 1 && x + 1 < src_width };
+      const bool y_ok[2] = { 0 <= y && y < rows_,
+                             0 <= y + 1 && y + 1 < rows_ };
+
+      for (streamsize k = 0; k < comps; ++k)
+        {
+          unsigned p[2][2];
+          for (int j = 0; j < 2; ++j)
+            for (int i = 0; i < 2; ++i)
+              p[j][i] = (x_ok[i] && y_ok[j]
+                         ? src[(y + j) * stride_ + (x + i) * comps + k]
+                         : fill);
+
+          unsigned top = p[0][0] * (256 - wx) + p[0][1] * wx;
+          unsigned bot = p[1][0] * (256 - wx) + p[1][1] * wx;
+
+          *line++ = (top * (256 - wy) + bot * wy + (1 << 15)) >> 16;
+        }
+    }
+}
+
+}       // namespace _flt_
+}       // namespace utsushi
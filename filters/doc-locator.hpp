@@ -0,0 +1,120 @@
+//  doc-locator.hpp -- in-process document location and deskewing
+//  Copyright (C) 2026  SEIKO EPSON CORPORATION
+//
+//  License: GPL-3.0+
+//  Author : EPSON AVASYS CORPORATION
+//
+//  This file is part of the 'Utsushi' package.
+//  This package is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License or, at
+//  your option, any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//  You ought to have received a copy of the GNU General Public License
+//  along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef filters_doc_locator_hpp_
+#define filters_doc_locator_hpp_
+
+#include <utsushi/context.hpp>
+#include <utsushi/iobase.hpp>
+
+#include <vector>
+
+namespace utsushi {
+namespace _flt_ {
+
+//!  Locate and straighten documents without leaving the process
+/*!  This is a native alternative to the \c doc-locate utility that
+ *   the deskew and autocrop filters run for every image.  Rather than
+ *   having the image encoded, piped to another process and decoded by
+ *   Magick++, a %doc_locator takes the image data as it streams by.
+ *   It keeps a copy of the raster and builds a downsampled thumbnail
+ *   on the fly.  The thumbnail is used to find the document's outline
+ *   and skew angle once all image data has been seen.  The result is
+ *   then rotated and cropped in a single pass over the raster.
+ *
+ *   Only 8-bit gray and RGB images are supported.  The image data may
+ *   come with a PNM header, as produced by the pnm filter, in which
+ *   case the result comes with one as well.
+ *
+ *   Document and background are told apart by two thresholds in the
+ *   [0,1] range.  Pixels with an intensity between these thresholds
+ *   are considered to be part of the background.
+ */
+class doc_locator
+{
+public:
+  enum action {
+    DESKEW,                     //!< straighten, keeping the image size
+    CROP,                       //!< straighten and crop to the document
+    TRIM                        //!< remove borders of uniform color
+  };
+
+  doc_locator (const context& ctx,
+               double lo_threshold, double hi_threshold);
+
+  //!  Tells whether images described by \a ctx can be handled
+  static bool supports (const context& ctx);
+
+  streamsize write (const octet *data, streamsize n);
+
+  //!  Works out what an \a action results in
+  /*!  Call this after all image data has been written.  The context
+   *   returned describes the result.
+   */
+  context locate (action a);
+
+  //!  Writes the result of the last locate() call to \a out
+  void render (output& out) const;
+
+  //!  Returns the skew angle in degrees found by locate()
+  double skew_angle () const;
+
+private:
+  void add_thumbnail_row_();
+  void thumbnail_scanline_(const octet *line);
+
+  double estimate_skew_(const std::vector< int >& x,
+                        const std::vector< int >& y) const;
+  void trim_();
+  bool is_plain_(streamsize x0, streamsize x1,
+                 streamsize y0, streamsize y1) const;
+
+  void render_scanline_(octet *line, streamsize v) const;
+
+  context ctx_;
+  context result_;
+
+  unsigned char lo_threshold_;
+  unsigned char hi_threshold_;
+
+  bool header_seen_;
+  streamsize stride_;           //!< octets per input scanline
+  streamsize rows_;             //!< scanlines seen so far
+
+  std::vector< octet > raster_;
+
+  streamsize scale_;            //!< thumbnail downsampling factor
+  streamsize thumb_width_;
+  std::vector< unsigned char > thumb_;
+  std::vector< unsigned > sum_;  //!< thumbnail row being collected
+  streamsize sum_rows_;
+
+  // Maps result pixels to raster positions.  The result's pixel
+  // centers are offset by origin_ from the center_ of rotation.
+
+  double angle_;                //!< in radians
+  double center_x_, center_y_;
+  double origin_x_, origin_y_;
+};
+
+}       // namespace _flt_
+}       // namespace utsushi
+
+#endif  /* filters_doc_locator_hpp_ */
@@ -1,5 +1,5 @@
-//  g3fax.cpp -- convert scanlines to G3 facsimile format
-//  Copyright (C) 2012-2015  SEIKO EPSON CORPORATION
+//  g3fax.cpp -- convert scanlines to G3 and G4 facsimile format
+//  Copyright (C) 2012-2015, 2026  SEIKO EPSON CORPORATION
 //
 //  License: GPL-3.0+
 //  Author : EPSON AVASYS CORPORATION
@@ -22,6 +22,7 @@
 #include <config.h>
 #endif
 
+#include <algorithm>
 #include <cstddef>
 #include <string>
 #include <vector>
@@ -45,6 +46,12 @@ static string transform (const octet *scanline, streamsize n,
                          bool is_light_based);
 static string transform (vector<size_t>& runs);
 
+filter::ptr
+g3fax::clone () const
+{
+  return clone_< g3fax > ();
+}
+
 streamsize
 g3fax::write (const octet *data, streamsize n)
 {
@@ -548,5 +555,289 @@ g3fax::skip_pbm_header_(const octet *& data, streamsize n)
     return result;
   }
 
+  //! Vertical mode codes, indexed by b1 - a1 + 3
+  static const struct code g4_vertical[] =
+    {
+      { 7, 0x03 },              // VR3
+      { 6, 0x03 },              // VR2
+      { 3, 0x03 },              // VR1
+      { 1, 0x01 },              // V0
+      { 3, 0x02 },              // VL1
+      { 6, 0x02 },              // VL2
+      { 7, 0x02 },              // VL3
+    };
+
+  static const struct code g4_pass       = { 4, 0x01 };
+  static const struct code g4_horizontal = { 3, 0x01 };
+  static const struct code g4_eol        = { 12, 0x01 };
+
+  static inline
+  unsigned int
+  leading_zeros (uint32_t word)
+  {
+    BOOST_ASSERT (word);
+
+#if defined (__GNUC__)
+    return __builtin_clz (word);
+#else
+    unsigned int n = 0;
+    while (!(word & 0x80000000))
+      {
+        word <<= 1;
+        ++n;
+      }
+    return n;
+#endif
+  }
+
+  static inline
+  bool
+  is_black (const uint32_t *line, size_t pos)
+  {
+    return (line[pos / 32] >> (31 - pos % 32)) & 0x01;
+  }
+
+  //! Finds the first pixel at or after \a pos that is not \a black
+  /*! Scanlines are searched a word at a time so long runs of the same
+   *  colour only cost a handful of operations.  Returns \a end if no
+   *  such pixel can be found before it.
+   */
+  static inline
+  size_t
+  find_change (const uint32_t *line, size_t pos, size_t end, bool black)
+  {
+    if (end <= pos) return end;
+
+    const uint32_t flip = (black ? ~uint32_t (0) : 0);
+    const size_t   last = (end + 31) / 32;
+
+    size_t   i    = pos / 32;
+    uint32_t word = (line[i] ^ flip) & (~uint32_t (0) >> (pos % 32));
+
+    while (!word)
+      {
+        if (last == ++i) return end;
+        word = line[i] ^ flip;
+      }
+    return std::min (end, i * 32 + leading_zeros (word));
+  }
+
+filter::ptr
+g4fax::clone () const
+{
+  return clone_< g4fax > ();
+}
+
+streamsize
+g4fax::write (const octet *data, streamsize n)
+{
+  BOOST_ASSERT ((data && 0 < n) || 0 == n);
+
+  const octet *tail = data + n;
+  if (!pbm_header_seen_) skip_pbm_header_(data, n);
+
+  const streamsize octets_per_line = ctx_.octets_per_line ();
+
+  if (0 < partial_size_)        // continue with stashed octets
+    {
+      streamsize octets = std::min (octets_per_line - partial_size_,
+                                    streamsize (tail - data));
+
+      traits::copy (partial_line_.get () + partial_size_, data, octets);
+      partial_size_ += octets;
+      data          += octets;
+
+      if (partial_size_ < octets_per_line) return n;
+
+      encode_(partial_line_.get ());
+      partial_size_ = 0;
+    }
+
+  while (octets_per_line <= tail - data)
+    {
+      encode_(data);
+      data += octets_per_line;
+    }
+
+  partial_size_ = tail - data;
+  if (0 < partial_size_)        // stash left-over octets for next write
+    {
+      traits::copy (partial_line_.get (), data, partial_size_);
+    }
+
+  if (!encoded_.empty ())
+    {
+      output_->write (encoded_.data (), encoded_.size ());
+      encoded_.clear ();
+    }
+
+  return n;
+}
+
+void
+g4fax::boi (const context& ctx)
+{
+  BOOST_ASSERT (1 == ctx.depth ());
+  BOOST_ASSERT (1 == ctx.comps ());
+  BOOST_ASSERT (0 == ctx.padding_octets ());
+
+  BOOST_ASSERT (   "image/x-raster"          == ctx.content_type ()
+                || "image/x-portable-bitmap" == ctx.content_type ());
+
+  pbm_header_seen_ = ("image/x-raster" == ctx.content_type ());
+  is_light_based_ = ("image/x-raster" == ctx.content_type ());
+
+  ctx_ = ctx;
+  ctx_.content_type ("image/g4fax");
+  ctx_.octets_seen () = 0;
+
+  partial_line_.reset (new octet[ctx_.octets_per_line ()]);
+  partial_size_ = 0;
+
+  ref_.assign ((ctx_.width () + 31) / 32, 0);
+  cur_.assign ((ctx_.width () + 31) / 32, 0);
+
+  encoded_.clear ();
+  bit_buffer_ = 0;
+  bit_count_  = 0;
+}
+
+void
+g4fax::eoi (const context& ctx)
+{
+  BOOST_ASSERT (partial_size_ == 0);
+  BOOST_ASSERT (ctx_.octets_seen () == ctx.octets_per_image ());
+
+  put_(g4_eol.bits, g4_eol.code);       // EOFB
+  put_(g4_eol.bits, g4_eol.code);
+  if (bit_count_) put_(8 - bit_count_, 0);
+
+  output_->write (encoded_.data (), encoded_.size ());
+  encoded_.clear ();
+
+  ctx_ = ctx;
+  ctx_.content_type ("image/g4fax");
+  ctx_.octets_seen () = ctx.octets_per_image ();
+}
+
+//! Codes a \a scanline relative to the previous one
+/*! This follows the coding procedure of ITU-T T.6 section 2.2.  The
+ *  changing elements a0, a1, a2 are on the coding line, b1 and b2 on
+ *  the reference line.  All of them are found with find_change().
+ */
+void
+g4fax::encode_(const octet *scanline)
+{
+  const size_t     width  = ctx_.width ();
+  const streamsize octets = ctx_.octets_per_line ();
+  const octet      flip   = (is_light_based_ ? 0xff : 0x00);
+
+  for (size_t i = 0; i < cur_.size (); ++i)
+    {
+      uint32_t word = 0;
+      for (streamsize j = 4 * i; j < streamsize (4 * i + 4); ++j)
+        {
+          word <<= 8;
+          if (j < octets) word |= 0xff & (scanline[j] ^ flip);
+        }
+      cur_[i] = word;
+    }
+
+  const uint32_t *cur = (cur_.empty () ? NULL : &cur_[0]);
+  const uint32_t *ref = (ref_.empty () ? NULL : &ref_[0]);
+
+  size_t a0 = 0;
+  size_t a1 = (0 < width && is_black (cur, 0)
+               ? 0 : find_change (cur, 0, width, false));
+  size_t b1 = (0 < width && is_black (ref, 0)
+               ? 0 : find_change (ref, 0, width, false));
+
+  for (;;)
+    {
+      size_t b2 = find_change (ref, b1, width,
+                               b1 < width && is_black (ref, b1));
+
+      if (b2 < a1)
+        {
+          put_(g4_pass.bits, g4_pass.code);
+          a0 = b2;
+        }
+      else if (a1 + 3 < b1 || b1 + 3 < a1)
+        {
+          bool black = (0 != a0 + a1 && is_black (cur, a0));
+          size_t a2 = find_change (cur, a1, width,
+                                   a1 < width && is_black (cur, a1));
+
+          put_(g4_horizontal.bits, g4_horizontal.code);
+          put_span_(a1 - a0, (black ? BLACK : WHITE));
+          put_span_(a2 - a1, (black ? WHITE : BLACK));
+          a0 = a2;
+        }
+      else
+        {
+          const struct code& c (g4_vertical[3 + b1 - a1]);
+          put_(c.bits, c.code);
+          a0 = a1;
+        }
+
+      if (width <= a0) break;
+
+      bool black = is_black (cur, a0);
+      a1 = find_change (cur, a0, width, black);
+      b1 = find_change (ref, a0, width, !black);
+      b1 = find_change (ref, b1, width, black);
+    }
+
+  ref_.swap (cur_);
+  ctx_.octets_seen () += octets;
+}
+
+void
+g4fax::put_(unsigned int bits, unsigned int code)
+{
+  bit_buffer_ = (bit_buffer_ << bits) | code;
+  bit_count_ += bits;
+
+  while (8 <= bit_count_)
+    {
+      bit_count_ -= 8;
+      encoded_.push_back (0xff & (bit_buffer_ >> bit_count_));
+    }
+}
+
+//! Puts the G31D codes for a \a run of pixels of a given \a colour
+void
+g4fax::put_span_(size_t run, bool colour)
+{
+  const struct code *c = NULL;
+
+  while (g3_extra_make_up_max <= run)
+    {
+      c = (g3_extra_make_up
+           + (g3_extra_make_up_max - g3_extra_make_up_min) / g3_make_up_inc);
+      put_(c->bits, c->code);
+      run -= g3_extra_make_up_max;
+    }
+  if (g3_extra_make_up_min <= run)
+    {
+      size_t index = (run - g3_extra_make_up_min) / g3_make_up_inc;
+
+      c = g3_extra_make_up + index;
+      put_(c->bits, c->code);
+      run -= g3_extra_make_up_min + index * g3_make_up_inc;
+    }
+  else if (g3_make_up_min <= run)
+    {
+      size_t index = (run - g3_make_up_min) / g3_make_up_inc;
+
+      c = (WHITE == colour ? g3_white_make_up : g3_black_make_up) + index;
+      put_(c->bits, c->code);
+      run -= g3_make_up_min + index * g3_make_up_inc;
+    }
+
+  c = (WHITE == colour ? g3_white_terminal : g3_black_terminal) + run;
+  put_(c->bits, c->code);
+}
+
 }       // namespace _flt_
 }       // namespace utsushi
@@ -1,5 +1,5 @@
-//  g3fax.hpp -- convert scanlines to G3 facsimile format
-//  Copyright (C) 2012, 2014, 2015  SEIKO EPSON CORPORATION
+//  g3fax.hpp -- convert scanlines to G3 and G4 facsimile format
+//  Copyright (C) 2012, 2014, 2015, 2026  SEIKO EPSON CORPORATION
 //
 //  License: GPL-3.0+
 //  Author : EPSON AVASYS CORPORATION
@@ -21,8 +21,12 @@
 #ifndef filters_g3fax_hpp_
 #define filters_g3fax_hpp_
 
+#include <string>
+#include <vector>
+
 #include <boost/scoped_array.hpp>
 
+#include <utsushi/cstdint.hpp>
 #include <utsushi/filter.hpp>
 
 namespace utsushi {
@@ -69,6 +73,8 @@ public:
    */
   streamsize write (const octet *data, streamsize n);
 
+  filter::ptr clone () const;
+
 protected:
   void boi (const context& ctx);
   void eoi (const context& ctx);
@@ -76,12 +82,52 @@ protected:
   boost::scoped_array< octet > partial_line_;
   streamsize                   partial_size_;
 
-private:
   streamsize skip_pbm_header_(const octet *& data, streamsize n);
   bool pbm_header_seen_;
   bool is_light_based_;
 };
 
+//! Convert bi-level image data to FAX G4 (MMR) encoded data
+/*! The G4 encoding is part of the ITU-T T.6 standard.  Rather than
+ *  coding every scanline on its own, it codes the positions where the
+ *  colour changes relative to those on the preceding scanline.  Runs
+ *  are only coded, with the same codes as used for G31D, where these
+ *  positions are too far apart.  The first scanline is coded against
+ *  an imaginary all white line.
+ *
+ *  Scanlines are not terminated by EOL codes.  The encoded image is
+ *  terminated by an EOFB code (two EOL codes) and filled to an octet
+ *  boundary.  For typical documents the result is considerably more
+ *  compact than G31D encoded data.
+ *
+ *  The \a data accepted by write() is interpreted the same way as for
+ *  the g3fax filter.
+ */
+class g4fax
+  : public g3fax
+{
+public:
+  streamsize write (const octet *data, streamsize n);
+
+  filter::ptr clone () const;
+
+protected:
+  void boi (const context& ctx);
+  void eoi (const context& ctx);
+
+private:
+  void encode_(const octet *scanline);
+  void put_(unsigned int bits, unsigned int code);
+  void put_span_(size_t run, bool colour);
+
+  std::vector< uint32_t > ref_;  //!< reference line, black bits set
+  std::vector< uint32_t > cur_;  //!< coding line, black bits set
+
+  std::string  encoded_;
+  uint32_t     bit_buffer_;
+  unsigned int bit_count_;
+};
+
 }       // namespace _flt_
 }       // namespace utsushi
 
@@ -23,39 +23,114 @@
 #endif
 
 #include "image-skip.hpp"
+#include "simd.hpp"
 
-#include <utsushi/cstdint.hpp>
 #include <utsushi/i18n.hpp>
+#include <utsushi/log.hpp>
 #include <utsushi/quantity.hpp>
 #include <utsushi/range.hpp>
 #include <utsushi/store.hpp>
 
+#include <algorithm>
 #include <limits>
 
 namespace utsushi {
 namespace _flt_ {
 
-struct bucket
+namespace {
+
+uint64_t
+sum_scalar (const octet *data, streamsize n)
+{
+  const uint8_t *p = reinterpret_cast< const uint8_t * > (data);
+  uint64_t rv = 0;
+
+  for (streamsize i = 0; i < n; ++i)
+    rv += p[i];
+
+  return rv;
+}
+
+#if FILTERS_USE_X86_KERNELS
+
+__attribute__ ((target ("sse2")))
+uint64_t
+sum_sse2 (const octet *data, streamsize n)
+{
+  const __m128i zero = _mm_setzero_si128 ();
+  __m128i acc = zero;
+  streamsize i = 0;
+
+  for (; i + 16 <= n; i += 16)
+    {
+      __m128i x = _mm_loadu_si128 (reinterpret_cast< const __m128i * >
+                                   (data + i));
+      acc = _mm_add_epi64 (acc, _mm_sad_epu8 (x, zero));
+    }
+
+  uint64_t lane[2];
+  _mm_storeu_si128 (reinterpret_cast< __m128i * > (lane), acc);
+
+  return lane[0] + lane[1] + sum_scalar (data + i, n - i);
+}
+
+__attribute__ ((target ("avx2")))
+uint64_t
+sum_avx2 (const octet *data, streamsize n)
+{
+  const __m256i zero = _mm256_setzero_si256 ();
+  __m256i acc = zero;
+  streamsize i = 0;
+
+  for (; i + 32 <= n; i += 32)
+    {
+      __m256i x = _mm256_loadu_si256 (reinterpret_cast< const __m256i * >
+                                      (data + i));
+      acc = _mm256_add_epi64 (acc, _mm256_sad_epu8 (x, zero));
+    }
+
+  uint64_t lane[4];
+  _mm256_storeu_si256 (reinterpret_cast< __m256i * > (lane), acc);
+
+  return (lane[0] + lane[1] + lane[2] + lane[3]
+          + sum_sse2 (data + i, n - i));
+}
+
+#endif  /* FILTERS_USE_X86_KERNELS */
+
+#if FILTERS_USE_NEON_KERNEL
+
+uint64_t
+sum_neon (const octet *data, streamsize n)
 {
-  octet     *data_;
-  streamsize size_;
-  bool       seen_;
+  uint64x2_t acc = vdupq_n_u64 (0);
+  streamsize i = 0;
+
+  for (; i + 16 <= n; i += 16)
+    {
+      uint8x16_t x = vld1q_u8 (reinterpret_cast< const uint8_t * >
+                               (data + i));
+      acc = vpadalq_u32 (acc, vpaddlq_u16 (vpaddlq_u8 (x)));
+    }
+
+  return (vgetq_lane_u64 (acc, 0) + vgetq_lane_u64 (acc, 1)
+          + sum_scalar (data + i, n - i));
+}
 
-  bucket (const octet *data, streamsize size)
-    : data_(new octet[size])
-    , size_(size)
-    , seen_(false)
-  {
-    traits::copy (data_, data, size);
-  }
+#endif  /* FILTERS_USE_NEON_KERNEL */
 
-  ~bucket ()
-  {
-    delete [] data_;
-  }
-};
+const uint64_t max_octet_value = std::numeric_limits< uint8_t >::max ();
+
+}       // namespace
 
 image_skip::image_skip ()
+  : threshold_(0)
+  , margin_(0)
+  , tiles_(1)
+  , is_passing_on_(false)
+  , has_tiles_(false)
+  , offset_(0)
+  , sum_(sum_functions ().front ())
 {
   option_->add_options ()
     ("blank-threshold", (from< range > ()
@@ -66,9 +141,36 @@ image_skip::image_skip ()
      attributes (tag::enhancement)(level::standard),
      SEC_N_("Skip Blank Pages Settings")
      )
+    ("blank-margin", (from< range > ()
+                      -> lower ( 0.)
+                      -> upper (25.)
+                      -> default_value (0.)
+                      ),
+     attributes (tag::enhancement)(level::extended),
+     SEC_N_("Blank Page Margin"),
+     CCB_("Percentage of the image's width and height that is ignored "
+          "along each edge when checking for blank pages.")
+     )
+    ("blank-tiles", (from< range > ()
+                     -> lower ( 1)
+                     -> upper (16)
+                     -> default_value (1)
+                     ),
+     attributes (tag::enhancement)(level::extended),
+     SEC_N_("Blank Page Tiles"),
+     CCB_("Number of tiles across and down that are checked separately "
+          "for blank pages.  A page is kept if any of its tiles is not "
+          "blank.")
+     )
     ;
 }
 
+filter::ptr
+image_skip::clone () const
+{
+  return clone_< image_skip > ();
+}
+
 // Our marker handlers decide when to call output_->mark() and produce any
 // image data.  We always use the most up-to-date context information.
 // That means that the end-of context replaces the begin-of one.
@@ -82,16 +184,14 @@ image_skip::mark (traits::int_type c, const context& ctx)
 streamsize
 image_skip::write (const octet *data, streamsize n)
 {
-  pool_.push_back (make_shared< bucket > (data, n));
+  if (is_passing_on_) return output_->write (data, n);
 
-  // When area of interest is supported we need to know the width
-  // before we can do any processing.
-  if (context::unknown_size != ctx_.width ())
-    {
-      process_(pool_.back ());
+  pending_.insert (pending_.end (), data, data + n);
 
-      // for a tile based algorithm we can start writing data as soon
-      // as the first non-blank tile has been found.
+  if (has_tiles_)
+    {
+      process_(data, n);
+      if (!is_blank_()) pass_on_();
     }
   return n;
 }
@@ -99,8 +199,14 @@ image_skip::write (const octet *data, streamsize n)
 void
 image_skip::bos (const context& ctx)
 {
-  quantity q = value ((*option_)["blank-threshold"]);
+  quantity q;
+
+  q = value ((*option_)["blank-threshold"]);
   threshold_ = q.amount< double > ();
+  q = value ((*option_)["blank-margin"]);
+  margin_ = q.amount< double > ();
+  q = value ((*option_)["blank-tiles"]);
+  tiles_ = q.amount< int > ();
 
   last_marker_ = traits::eos ();
 }
@@ -117,47 +223,50 @@ image_skip::boi (const context& ctx)
   BOOST_ASSERT (0 == ctx_.padding_octets ());
   BOOST_ASSERT (0 == ctx_.padding_lines ());
 
-  BOOST_ASSERT (pool_.empty ());
+  BOOST_ASSERT (pending_.empty ());
 
-  darkness_ = 0;
+  is_passing_on_ = false;
+  set_up_tiles_(ctx_);
 }
 
 void
 image_skip::eoi (const context& ctx)
 {
-  if (!skip_())
+  if (!is_passing_on_)
     {
-      if (!pool_.empty ())
-        {
-          if (traits::eos () == last_marker_)
-            {
-              last_marker_ = traits::bos ();
-              output_->mark (last_marker_, ctx_);
-            }
-          if (   traits::bos () == last_marker_
-              || traits::eoi () == last_marker_)
-            {
-              last_marker_ = traits::boi ();
-              output_->mark (last_marker_, ctx_);
-            }
-        }
-      while (!pool_.empty ())
+      // The image size may have been unknown at the beginning of the
+      // image or turned out differently.  All image data is at hand,
+      // so we can redo the measurements as necessary.
+
+      context actual (ctx_);
+
+      if (context::unknown_size == actual.height ()
+          && context::unknown_size != actual.width ()
+          && 0 < actual.octets_per_line ())
+        actual.height (pending_.size () / actual.octets_per_line ());
+
+      if (!has_tiles_
+          || actual.width ()  != tiles_ctx_.width ()
+          || actual.height () != tiles_ctx_.height ())
         {
-          shared_ptr< bucket > p = pool_.front ();
-          pool_.pop_front ();
-          if (p)
-            output_->write (p->data_, p->size_);
+          set_up_tiles_(actual);
+          if (has_tiles_ && !pending_.empty ())
+            process_(&pending_[0], pending_.size ());
         }
-      if (last_marker_ == traits::boi ())
+
+      if (!has_tiles_)
+        log::error ("image-skip: cannot check image of unknown size");
+
+      if (has_tiles_ && is_blank_())
         {
-          last_marker_ = traits::eoi ();
-          output_->mark (last_marker_, ctx_);
+          pending_.clear ();
+          return;
         }
+      pass_on_();
     }
-  else
-    {
-      pool_.clear ();
-    }
+
+  last_marker_ = traits::eoi ();
+  output_->mark (last_marker_, ctx_);
 }
 
 void
@@ -171,37 +280,143 @@ image_skip::eos (const context& ctx)
 void
 image_skip::eof (const context& ctx)
 {
+  pending_.clear ();
   output_->mark (traits::eof (), ctx);
 }
 
+std::vector< image_skip::sum_function >
+image_skip::sum_functions ()
+{
+  simd_kernels< sum_function > k (sum_scalar);
+
+#if FILTERS_USE_X86_KERNELS
+  k.sse2 = sum_sse2;
+  k.avx2 = sum_avx2;
+#endif
+#if FILTERS_USE_NEON_KERNEL
+  k.neon = sum_neon;
+#endif
+
+  return k.supported ();
+}
+
+//! Divides the area of interest of images like \a ctx into tiles
+void
+image_skip::set_up_tiles_(const context& ctx)
+{
+  tiles_ctx_ = ctx;
+  has_tiles_ = (context::unknown_size != ctx.width ()
+                && context::unknown_size != ctx.height ());
+  offset_ = 0;
+
+  if (!has_tiles_) return;
+
+  const streamsize width  = ctx.width ();
+  const streamsize height = ctx.height ();
+  const streamsize x_margin = width  * margin_ / 100;
+  const streamsize y_margin = height * margin_ / 100;
+  const streamsize octets = ctx.octets_per_line () / width;
+
+  col_edge_.resize (tiles_ + 1);
+  row_edge_.resize (tiles_ + 1);
+  for (int i = 0; i <= tiles_; ++i)
+    {
+      col_edge_[i] = (x_margin + (width  - 2 * x_margin) * i / tiles_) * octets;
+      row_edge_[i] =  y_margin + (height - 2 * y_margin) * i / tiles_;
+    }
+  darkness_.assign (tiles_ * tiles_, 0);
+}
+
 bool
-image_skip::skip_()
+image_skip::is_blank_() const
 {
-  std::deque< shared_ptr< bucket > >::iterator it;
-  for (it = pool_.begin (); pool_.end () != it; ++it)
+  for (std::size_t t = 0; t < darkness_.size (); ++t)
     {
-      if (!(*it)->seen_) process_(*it);
+      if (!is_blank_(t)) return false;
     }
+  return true;
+}
 
-  return 100 * darkness_ <= threshold_ * ctx_.octets_per_image ();
+bool
+image_skip::is_blank_(std::size_t tile) const
+{
+  const std::size_t tx = tile % tiles_;
+  const std::size_t ty = tile / tiles_;
+  const double octets = (double (col_edge_[tx + 1] - col_edge_[tx])
+                         * (row_edge_[ty + 1] - row_edge_[ty]));
+
+  return 100 * double (darkness_[tile])
+    <= threshold_ * max_octet_value * octets;
 }
 
+//! Adds the darkness of the next \a n octets of image data
 void
-image_skip::process_(shared_ptr< bucket > bp)
+image_skip::process_(const octet *data, streamsize n)
 {
-  if (!bp) return;
+  const streamsize line = tiles_ctx_.octets_per_line ();
+
+  if (0 >= line) return;
+
+  while (0 < n)
+    {
+      const streamsize row = offset_ / line;
+      const streamsize col = offset_ % line;
+      const streamsize run = std::min (n, line - col);
+
+      if (row_edge_.front () <= row && row < row_edge_.back ())
+        {
+          const std::size_t ty
+            = (std::upper_bound (row_edge_.begin (), row_edge_.end (), row)
+               - row_edge_.begin () - 1);
+
+          for (int tx = 0; tx < tiles_; ++tx)
+            {
+              streamsize head = std::max (col, col_edge_[tx]);
+              streamsize tail = std::min (col + run, col_edge_[tx + 1]);
+
+              if (head >= tail) continue;
+
+              uint64_t octets = tail - head;
+              darkness_[ty * tiles_ + tx]
+                += (octets * max_octet_value
+                    - sum_(data + (head - col), octets));
+            }
+        }
+
+      offset_ += run;
+      data    += run;
+      n       -= run;
+    }
+}
+
+//! Passes on the image data held so far and anything that follows
+void
+image_skip::pass_on_()
+{
+  if (traits::eos () == last_marker_)
+    {
+      last_marker_ = traits::bos ();
+      output_->mark (last_marker_, ctx_);
+    }
+  if (   traits::bos () == last_marker_
+      || traits::eoi () == last_marker_)
+    {
+      last_marker_ = traits::boi ();
+      output_->mark (last_marker_, ctx_);
+    }
 
-  int scale_factor = std::numeric_limits< uint8_t >::max ();
-  int bucket_sum = bp->size_ * scale_factor;
+  const octet *p = (pending_.empty () ? nullptr : &pending_[0]);
+  streamsize   n = pending_.size ();
 
-  octet *p = bp->data_;
-  while (p < bp->data_ + bp->size_)
+  while (0 < n)
     {
-      bucket_sum -= uint8_t (*p++);
+      streamsize m = output_->write (p, n);
+      p += m;
+      n -= m;
     }
-  bp->seen_ = true;
+  pending_.clear ();
 
-  darkness_ += double (bucket_sum) / scale_factor;
+  is_passing_on_ = true;
 }
 
 }       // namespace _flt_
@@ -21,14 +21,14 @@
 #ifndef filters_image_skip_hpp_
 #define filters_image_skip_hpp_
 
+#include <utsushi/cstdint.hpp>
 #include <utsushi/filter.hpp>
-#include <deque>
+
+#include <vector>
 
 namespace utsushi {
 namespace _flt_ {
 
-struct bucket;
-
 //! Make selected images disappear
 /*! When acquiring a large number of images it is often desirable to
  *  remove the "uninteresting" ones.  The definition of uninteresting
@@ -40,15 +40,19 @@ struct bucket;
  *        image is removed from the output unless that "darkness"
  *        exceeds a configurable threshold.
  *
- *  \todo Generalize the algorithm to allow for setting of an area of
- *        interest (so you can for example ignore the shaded edges of
- *        a document) and easier detection of localized artifacts
- *        (such as page headers, footers and numbers) which tend to be
- *        smothered by the brightness of the remaining white space.
- *        The latter can be achieved by tiling the area of interest
- *        and applying the measure on each tile (rather than a single
- *        tile as done at the moment).
- *  \todo Make the algorithm configurable.
+ *  An area of interest can be set by ignoring a margin along each of
+ *  the image's edges, so that the shaded edges of a document do not
+ *  count.  That area can also be divided into tiles with the measure
+ *  applied to each tile.  This makes it easier to detect localized
+ *  artifacts (such as page headers, footers and numbers) which tend
+ *  to be smothered by the brightness of the remaining white space.
+ *  An image is kept if any one of its tiles exceeds the threshold.
+ *
+ *  Darkness only ever increases as image data comes in.  Provided
+ *  the image size is known up front, image data is only held until
+ *  the image has been proven to be non-blank.  From then on, image
+ *  data is passed on as is.  Only blank images are held in full.
+ *
  *  \todo Add an algorithm based on the variance in luminance?
  */
 class image_skip
@@ -57,6 +61,8 @@ class image_skip
 public:
   image_skip ();
 
+  filter::ptr clone () const;
+
   streamsize write (const octet *data, streamsize n);
 
   void mark (traits::int_type c, const context& ctx);
@@ -68,14 +74,37 @@ protected:
   void eos (const context& ctx);
   void eof (const context& ctx);
 
+  //! Adds up the values of \a n octets of \a data
+  typedef uint64_t (*sum_function) (const octet *data, streamsize n);
+
+  //! Lists the sum_function kernels the CPU we run on supports
+  /*! The fastest comes first, the scalar reference kernel last.
+   */
+  static std::vector< sum_function > sum_functions ();
+
 private:
-  bool skip_();
-  void process_(shared_ptr< bucket > b);
+  void set_up_tiles_(const context& ctx);
+  bool is_blank_() const;
+  bool is_blank_(std::size_t tile) const;
+  void process_(const octet *data, streamsize n);
+  void pass_on_();
 
   double threshold_;
-  double darkness_;
+  double margin_;               //!< percentage ignored along each edge
+  int    tiles_;                //!< per image dimension
+
+  bool is_passing_on_;          //!< image proven to be non-blank
+  bool has_tiles_;              //!< tile layout is known
+  context tiles_ctx_;           //!< what the tile layout is based on
+
+  std::vector< streamsize > col_edge_;  //!< tile boundaries in octets
+  std::vector< streamsize > row_edge_;  //!< tile boundaries in lines
+  std::vector< uint64_t > darkness_;   //!< per tile, in octet values
+
+  streamsize offset_;           //!< octets processed so far
+  std::vector< octet > pending_;        //!< held until a decision
 
-  std::deque< shared_ptr< bucket > > pool_;
+  sum_function sum_;
 };
 
 }       // namespace _flt_
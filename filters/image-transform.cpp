@@ -0,0 +1,512 @@
+//  image-transform.cpp -- in-process, line oriented image conversion
+//  Copyright (C) 2026  SEIKO EPSON CORPORATION
+//
+//  License: GPL-3.0+
+//  Author : EPSON AVASYS CORPORATION
+//
+//  This file is part of the 'Utsushi' package.
+//  This package is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License or, at
+//  your option, any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//  You ought to have received a copy of the GNU General Public License
+//  along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "image-transform.hpp"
+
+#include <utsushi/format.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+
+namespace utsushi {
+namespace _flt_ {
+
+namespace {
+
+const std::string raster_content_type ("image/x-raster");
+const std::string pnm_content_type ("image/x-portable-anymap");
+
+//! Color used for areas added by extent()
+const octet fill_color = octet (0xff);
+
+bool
+is_pnm (const std::string& content_type)
+{
+  return 0 == content_type.find ("image/x-portable-");
+}
+
+octet
+clamp (double v)
+{
+  return (0 > v ? 0 : 255 < v ? 255 : octet (v + 0.5));
+}
+
+void
+write_all (output& out, const octet *data, streamsize n)
+{
+  while (0 < n)
+    {
+      streamsize rv = out.write (data, n);
+      data += rv;
+      n    -= rv;
+    }
+}
+
+}       // namespace
+
+image_transform::image_transform (const context& ctx)
+  : ctx_(ctx)
+  , comps_(ctx.comps ())
+  , scale_width_(ctx.width ())
+  , scale_height_(ctx.height ())
+  , extent_width_(0)
+  , extent_height_(0)
+  , has_matrix_(false)
+  , offset_(0)
+  , is_bilevel_(false)
+  , threshold_(50)
+  , transpose_(false)
+  , flip_x_(false)
+  , flip_y_(false)
+  , content_type_(raster_content_type)
+  , is_set_up_(false)
+  , header_tokens_(pnm_content_type == ctx.content_type () ? 4 : 0)
+  , in_token_(false)
+  , in_comment_(false)
+  , in_row_(0)
+  , sum_end_(0)
+  , rows_(0)
+{
+  for (int i = 0; i < 9; ++i)
+    matrix_[i] = (0 == i % 4 ? 1 : 0);
+}
+
+bool
+image_transform::supports (const context& ctx)
+{
+  return (8 == ctx.depth ()
+          && (1 == ctx.comps () || 3 == ctx.comps ())
+          && context::unknown_size != ctx.width ()
+          && context::unknown_size != ctx.height ()
+          && 0 < ctx.width () && 0 < ctx.height ()
+          && (ctx.is_raster_image ()
+              || pnm_content_type == ctx.content_type ()));
+}
+
+void
+image_transform::scale (context::size_type width, context::size_type height)
+{
+  scale_width_  = std::max< context::size_type > (1, width);
+  scale_height_ = std::max< context::size_type > (1, height);
+}
+
+void
+image_transform::extent (context::size_type width, context::size_type height)
+{
+  extent_width_  = std::max< context::size_type > (1, width);
+  extent_height_ = std::max< context::size_type > (1, height);
+}
+
+void
+image_transform::color_matrix (const double matrix[9])
+{
+  double m[9];
+
+  for (int i = 0; i < 3; ++i)
+    for (int j = 0; j < 3; ++j)
+      {
+        m[3 * i + j] = 0;
+        for (int k = 0; k < 3; ++k)
+          m[3 * i + j] += matrix[3 * i + k] * matrix_[3 * k + j];
+      }
+  std::copy (m, m + 9, matrix_);
+  has_matrix_ = true;
+}
+
+//! Maps each component value \c v to <tt>gain * v + offset * 255</tt>
+void
+image_transform::levels (double gain, double offset)
+{
+  for (int i = 0; i < 9; ++i)
+    matrix_[i] *= gain;
+  offset_ = gain * offset_ + offset * 255;
+  has_matrix_ = true;
+}
+
+//! Undoes the image's orientation the way the magick filter emulates it
+void
+image_transform::auto_orient ()
+{
+  switch (ctx_.orientation ())
+    {
+    case context::bottom_left : flip_y_ = true; break;
+    case context::bottom_right: flip_x_ = flip_y_ = true; break;
+    case context::left_bottom : transpose_ = flip_x_ = true; break;
+    case context::left_top    : transpose_ = true; break;
+    case context::right_bottom: transpose_ = flip_x_ = flip_y_ = true; break;
+    case context::right_top   : transpose_ = flip_y_ = true; break;
+    case context::top_right   : flip_x_ = true; break;
+    default:
+      return;
+    }
+}
+
+void
+image_transform::threshold (double percentage)
+{
+  is_bilevel_ = true;
+  threshold_  = percentage;
+}
+
+void
+image_transform::content_type (const std::string& type)
+{
+  content_type_ = type;
+}
+
+context
+image_transform::get_context () const
+{
+  context::size_type w = (extent_width_  ? extent_width_  : scale_width_);
+  context::size_type h = (extent_height_ ? extent_height_ : scale_height_);
+
+  if (transpose_) std::swap (w, h);
+
+  context rv (w, h, content_type_, (3 == comps_
+                                    ? context::RGB8
+                                    : context::GRAY8));
+  if (is_bilevel_) rv.depth (1);
+
+  rv.resolution (ctx_.x_resolution (), ctx_.y_resolution ());
+  rv.orientation ((transpose_ || flip_x_ || flip_y_)
+                  ? context::top_left
+                  : ctx_.orientation ());
+  return rv;
+}
+
+streamsize
+image_transform::write (const octet *data, streamsize n, output& out)
+{
+  const streamsize rv = n;
+
+  if (!is_set_up_) set_up_(out);
+  if (!skip_header_(data, n)) return rv;
+
+  const streamsize stride = ctx_.octets_per_line ();
+
+  if (!carry_.empty ())
+    {
+      streamsize k = std::min (n, stride - streamsize (carry_.size ()));
+
+      carry_.insert (carry_.end (), data, data + k);
+      data += k;
+      n    -= k;
+
+      if (stride != streamsize (carry_.size ())) return rv;
+
+      resample_(&carry_[0], out);
+      carry_.clear ();
+    }
+
+  for (; stride <= n; data += stride, n -= stride)
+    resample_(data, out);
+
+  carry_.assign (data, data + n);
+
+  return rv;
+}
+
+void
+image_transform::finish (output& out)
+{
+  if (!is_set_up_) set_up_(out);
+
+  const context::size_type height = (extent_height_
+                                     ? extent_height_
+                                     : scale_height_);
+  std::vector< octet > blank (scale_width_ * comps_, fill_color);
+
+  while (rows_ < height)
+    crop_(&blank[0], out);
+
+  if (!transpose_ && !flip_y_) return;
+
+  const streamsize width = (extent_width_ ? extent_width_ : scale_width_);
+
+  for (streamsize y = 0; y < result_.height (); ++y)
+    {
+      for (streamsize x = 0; x < result_.width (); ++x)
+        {
+          streamsize u = (transpose_ ? y : x);
+          streamsize v = (transpose_ ? x : y);
+
+          if (flip_x_) u = width  - 1 - u;
+          if (flip_y_) v = height - 1 - v;
+
+          std::copy (&image_[(v * width + u) * comps_],
+                     &image_[(v * width + u) * comps_] + comps_,
+                     &line_[x * comps_]);
+        }
+      emit_(&line_[0], out);
+    }
+  image_.clear ();
+}
+
+void
+image_transform::set_up_(output& out)
+{
+  is_set_up_ = true;
+  result_ = get_context ();
+
+  const streamsize width  = ctx_.width ();
+  const double step = double (width) / scale_width_;
+
+  taps_.assign (1, 0);
+  tap_pixel_.clear ();
+  tap_weight_.clear ();
+  for (streamsize j = 0; j < scale_width_; ++j)
+    {
+      double a =  j      * step;
+      double b = (j + 1) * step;
+
+      for (streamsize i = streamsize (a);
+           i < std::min (width, streamsize (std::ceil (b)));
+           ++i)
+        {
+          double w = std::min (b, i + 1.0) - std::max (a, double (i));
+          if (0 < w)
+            {
+              tap_pixel_.push_back (i);
+              tap_weight_.push_back (w / step);
+            }
+        }
+      taps_.push_back (tap_pixel_.size ());
+    }
+
+  row_.assign (scale_width_ * comps_, 0);
+  sum_.assign (scale_width_ * comps_, 0);
+  scaled_.assign (scale_width_ * comps_, 0);
+  sum_end_ = double (ctx_.height ()) / scale_height_;
+
+  const streamsize ext_w = (extent_width_  ? extent_width_  : scale_width_);
+  const streamsize ext_h = (extent_height_ ? extent_height_ : scale_height_);
+
+  line_.resize (std::max (ext_w, ext_h) * comps_);
+  if (transpose_ || flip_y_)
+    image_.reserve (ext_w * ext_h * comps_);
+  if (is_bilevel_)
+    packed_.resize (result_.octets_per_line ());
+
+  if (!is_pnm (content_type_)) return;
+
+  std::string header;
+  /**/ if (is_bilevel_) header = "P4 %1% %2%\n";
+  else if (3 == comps_) header = "P6 %1% %2% 255\n";
+  else                  header = "P5 %1% %2% 255\n";
+  header = (format (header) % result_.width () % result_.height ()).str ();
+
+  write_all (out, reinterpret_cast< const octet * > (header.data ()),
+             header.size ());
+}
+
+//! Skips a PNM header, returning \c true once all of it has been seen
+/*! Headers have four whitespace separated tokens and may contain
+ *  comments.  A single whitespace character follows the last token.
+ */
+bool
+image_transform::skip_header_(const octet *& data, streamsize& n)
+{
+  while (header_tokens_ && n)
+    {
+      const char c = *data;
+      ++data;
+      --n;
+
+      if (in_comment_)
+        {
+          in_comment_ = ('\n' != c && '\r' != c);
+        }
+      else if (std::isspace (c))
+        {
+          if (in_token_) --header_tokens_;
+          in_token_ = false;
+        }
+      else if ('#' == c && !in_token_)
+        {
+          in_comment_ = true;
+        }
+      else
+        {
+          in_token_ = true;
+        }
+    }
+  return !header_tokens_;
+}
+
+//! Area averages scanlines to the requested scale()
+/*! Each input scanline covers a fraction of zero or more result lines.
+ *  Its horizontally resampled values are added to sum_ with a weight
+ *  proportional to that coverage.  Once sum_ covers a whole result
+ *  line it is passed on.
+ */
+void
+image_transform::resample_(const octet *line, output& out)
+{
+  if (scale_width_ == ctx_.width () && scale_height_ == ctx_.height ())
+    {
+      crop_(line, out);
+      return;
+    }
+
+  const double step = double (ctx_.height ()) / scale_height_;
+
+  if (rows_ >= scale_height_) return;
+
+  const unsigned char *p = reinterpret_cast< const unsigned char * > (line);
+
+  for (streamsize j = 0; j < scale_width_; ++j)
+    for (streamsize c = 0; c < comps_; ++c)
+      {
+        double v = 0;
+        for (std::size_t k = taps_[j]; k < taps_[j + 1]; ++k)
+          v += tap_weight_[k] * p[tap_pixel_[k] * comps_ + c];
+        row_[j * comps_ + c] = v;
+      }
+
+  double begin = in_row_;
+  const double end = in_row_ + 1;
+
+  while (begin < end && rows_ < scale_height_)
+    {
+      const double stop = std::min (end, sum_end_);
+
+      for (std::size_t i = 0; i < sum_.size (); ++i)
+        sum_[i] += (stop - begin) * row_[i];
+      begin = stop;
+
+      if (sum_end_ <= end)
+        {
+          for (std::size_t i = 0; i < sum_.size (); ++i)
+            scaled_[i] = clamp (sum_[i] / step);
+          std::fill (sum_.begin (), sum_.end (), 0);
+
+          crop_(&scaled_[0], out);
+          sum_end_ = double (rows_ + 1) * ctx_.height () / scale_height_;
+        }
+    }
+  in_row_ = end;
+}
+
+//! Crops or pads scanlines to the requested extent()
+void
+image_transform::crop_(const octet *line, output& out)
+{
+  const streamsize height = (extent_height_ ? extent_height_ : scale_height_);
+  const streamsize width  = (extent_width_  ? extent_width_  : scale_width_);
+
+  if (rows_++ >= height) return;
+
+  const streamsize n = std::min (width, scale_width_) * comps_;
+
+  std::copy (line, line + n, line_.begin ());
+  std::fill (line_.begin () + n, line_.begin () + width * comps_, fill_color);
+
+  if (has_matrix_)
+    {
+      const unsigned char *p
+        = reinterpret_cast< const unsigned char * > (&line_[0]);
+
+      if (3 == comps_)
+        {
+          for (streamsize i = 0; i < width * comps_; i += 3)
+            {
+              double r = p[i], g = p[i + 1], b = p[i + 2];
+
+              line_[i    ] = clamp (matrix_[0] * r + matrix_[1] * g
+                                    + matrix_[2] * b + offset_);
+              line_[i + 1] = clamp (matrix_[3] * r + matrix_[4] * g
+                                    + matrix_[5] * b + offset_);
+              line_[i + 2] = clamp (matrix_[6] * r + matrix_[7] * g
+                                    + matrix_[8] * b + offset_);
+            }
+        }
+      else
+        {
+          octet lut[256];
+          for (int v = 0; v < 256; ++v)
+            lut[v] = clamp (matrix_[0] * v + offset_);
+          for (streamsize i = 0; i < width; ++i)
+            line_[i] = lut[p[i]];
+        }
+    }
+
+  orient_(&line_[0], out);
+}
+
+//! Passes on a scanline unless the orientation needs the whole image
+void
+image_transform::orient_(octet *line, output& out)
+{
+  const streamsize width = (extent_width_ ? extent_width_ : scale_width_);
+
+  if (transpose_ || flip_y_)
+    {
+      image_.insert (image_.end (), line, line + width * comps_);
+      return;
+    }
+
+  if (flip_x_)
+    {
+      for (streamsize i = 0, j = width - 1; i < j; ++i, --j)
+        std::swap_ranges (line + i * comps_, line + (i + 1) * comps_,
+                          line + j * comps_);
+    }
+  emit_(line, out);
+}
+
+//! Writes a result scanline, thresholding it first if so requested
+/*! Bilevel raster images use 1 for white, PBM uses 1 for black.
+ */
+void
+image_transform::emit_(const octet *line, output& out)
+{
+  const streamsize width = result_.width ();
+
+  if (!is_bilevel_)
+    {
+      write_all (out, line, width * comps_);
+      return;
+    }
+
+  const unsigned limit = threshold_ * 255 / 100;
+  const octet black = (is_pnm (content_type_) ? 0xff : 0x00);
+
+  std::fill (packed_.begin (), packed_.end (), black);
+  for (streamsize x = 0; x < width; ++x)
+    {
+      const unsigned char *p
+        = reinterpret_cast< const unsigned char * > (line + x * comps_);
+      unsigned v = (3 == comps_
+                    ? (77 * p[0] + 150 * p[1] + 29 * p[2]) >> 8
+                    : p[0]);
+
+      if (v > limit)
+        packed_[x / 8] ^= (0x80 >> (x % 8));
+    }
+  write_all (out, &packed_[0], packed_.size ());
+}
+
+}       // namespace _flt_
+}       // namespace utsushi
@@ -0,0 +1,138 @@
+//  image-transform.hpp -- in-process, line oriented image conversion
+//  Copyright (C) 2026  SEIKO EPSON CORPORATION
+//
+//  License: GPL-3.0+
+//  Author : EPSON AVASYS CORPORATION
+//
+//  This file is part of the 'Utsushi' package.
+//  This package is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License or, at
+//  your option, any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//  You ought to have received a copy of the GNU General Public License
+//  along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef filters_image_transform_hpp_
+#define filters_image_transform_hpp_
+
+#include <utsushi/context.hpp>
+#include <utsushi/iobase.hpp>
+
+#include <string>
+#include <vector>
+
+namespace utsushi {
+namespace _flt_ {
+
+//!  Convert an image as it streams by
+/*!  An %image_transform applies the subset of operations that the
+ *   magick filter asks \c convert for which can be done one scanline
+ *   at a time.  In order, these are
+ *
+ *   - scale(), resampling by area averaging like \c -scale does
+ *   - extent(), cropping and padding with white like \c -extent does
+ *   - color_matrix() and levels(), like \c -color-matrix does
+ *   - auto_orient(), turning the image upright like \c -auto-orient
+ *   - threshold(), turning the image into a bilevel one
+ *
+ *   The result is encoded as a raster image or as PNM, depending on
+ *   its content_type().  Scanlines are passed on as soon as they are
+ *   complete.  Only rotations and vertical flips need to hold on to
+ *   all of an image before it can be passed on.
+ *
+ *   Input needs to be an 8-bit gray or RGB image of known size.  It
+ *   may be a raster image or PNM.
+ */
+class image_transform
+{
+public:
+  image_transform (const context& ctx);
+
+  //!  Tells whether images described by \a ctx can be transformed
+  static bool supports (const context& ctx);
+
+  void scale (context::size_type width, context::size_type height);
+  void extent (context::size_type width, context::size_type height);
+  void color_matrix (const double matrix[9]);
+  void levels (double gain, double offset);
+  void auto_orient ();
+  void threshold (double percentage);
+  void content_type (const std::string& type);
+
+  //!  Describes the result of all operations requested so far
+  context get_context () const;
+
+  streamsize write (const octet *data, streamsize n, output& out);
+
+  //!  Passes on whatever is left after all image data was written
+  void finish (output& out);
+
+private:
+  void set_up_(output& out);
+  bool skip_header_(const octet *& data, streamsize& n);
+
+  void resample_(const octet *line, output& out);
+  void crop_(const octet *line, output& out);
+  void orient_(octet *line, output& out);
+  void emit_(const octet *line, output& out);
+
+  context ctx_;
+  context result_;
+  streamsize comps_;
+
+  context::size_type scale_width_;
+  context::size_type scale_height_;
+  context::size_type extent_width_;
+  context::size_type extent_height_;
+
+  bool   has_matrix_;
+  double matrix_[9];
+  double offset_;
+
+  bool   is_bilevel_;
+  double threshold_;
+
+  bool transpose_;
+  bool flip_x_;
+  bool flip_y_;
+
+  std::string content_type_;
+
+  bool is_set_up_;
+
+  // Input parsing
+
+  int  header_tokens_;          //!< still to be skipped
+  bool in_token_;
+  bool in_comment_;
+  std::vector< octet > carry_;  //!< incomplete input scanline
+
+  // Resampling by area averaging
+
+  std::vector< std::size_t > taps_;     //!< per result pixel
+  std::vector< streamsize > tap_pixel_;
+  std::vector< double > tap_weight_;
+  std::vector< double > row_;           //!< horizontally resampled
+  std::vector< double > sum_;           //!< result scanline so far
+  std::vector< octet > scaled_;
+  double in_row_;               //!< input scanlines seen
+  double sum_end_;              //!< input position that completes sum_
+
+  // Later stages
+
+  context::size_type rows_;     //!< scaled rows seen
+  std::vector< octet > line_;
+  std::vector< octet > image_;  //!< only if the orientation needs it
+  std::vector< octet > packed_;
+};
+
+}       // namespace _flt_
+}       // namespace utsushi
+
+#endif  /* filters_image_transform_hpp_ */
@@ -277,6 +277,12 @@ compressor::~compressor ()
   jpeg_destroy_compress (&cinfo_);
 }
 
+filter::ptr
+compressor::clone () const
+{
+  return clone_< compressor > ();
+}
+
 streamsize
 compressor::write (const octet *data, streamsize n)
 {
@@ -727,6 +733,12 @@ decompressor::decompressor ()
   common::add_buffer_size_(option_);
 }
 
+filter::ptr
+decompressor::clone () const
+{
+  return clone_< decompressor > ();
+}
+
 streamsize
 decompressor::write (const octet *data, streamsize n)
 {
@@ -73,6 +73,8 @@ public:
   compressor ();
   ~compressor ();
 
+  filter::ptr clone () const;
+
   streamsize write (const octet *data, streamsize n);
 
 protected:
@@ -154,6 +156,8 @@ class decompressor
 public:
   decompressor ();
 
+  filter::ptr clone () const;
+
   streamsize write (const octet *data, streamsize n);
 
 protected:
@@ -0,0 +1,133 @@
+//  locating-pipe.cpp -- base for filters that locate documents
+//  Copyright (C) 2026  SEIKO EPSON CORPORATION
+//
+//  License: GPL-3.0+
+//  Author : EPSON AVASYS CORPORATION
+//
+//  This file is part of the 'Utsushi' package.
+//  This package is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License or, at
+//  your option, any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//  You ought to have received a copy of the GNU General Public License
+//  along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "locating-pipe.hpp"
+
+#include <utsushi/range.hpp>
+#include <utsushi/run-time.hpp>
+#include <utsushi/store.hpp>
+
+namespace utsushi {
+namespace _flt_ {
+
+locating_pipe::locating_pipe ()
+  : shell_pipe (run_time ().exec_file (run_time::pkg, "doc-locate"))
+  , use_native_engine_(true)
+{
+  option_->add_options ()
+    ("lo-threshold", (from< range > ()  // percentage
+                      -> lower (  0.0)
+                      -> upper (100.0)
+                      -> default_value (45.0)))
+    ("hi-threshold", (from< range > ()  // percentage
+                      -> lower (  0.0)
+                      -> upper (100.0)
+                      -> default_value (55.0)))
+    ("engine", (from< store > ()
+                -> alternative ("native")
+                -> alternative ("doc-locate")
+                -> default_value ("native")))
+    ;
+  locating_pipe::freeze_options ();
+}
+
+void
+locating_pipe::mark (traits::int_type c, const context& ctx)
+{
+  if (traits::boi () == c && is_native_(ctx))
+    {
+      locator_ = make_shared< doc_locator > (ctx,
+                                             lo_threshold_ / 100,
+                                             hi_threshold_ / 100);
+      return;
+    }
+
+  if (locator_ && traits::eoi () == c)
+    {
+      ctx_ = locator_->locate (action_());
+      signal_(traits::boi ());
+      locator_->render (*output_);
+      locator_.reset ();
+      signal_(traits::eoi ());
+      return;
+    }
+
+  if (locator_ && traits::eof () == c)
+    {
+      locator_.reset ();
+      ctx_ = ctx;
+      signal_(traits::eof ());
+      return;
+    }
+
+  shell_pipe::mark (c, ctx);
+}
+
+streamsize
+locating_pipe::write (const octet *data, streamsize n)
+{
+  if (locator_) return locator_->write (data, n);
+
+  return shell_pipe::write (data, n);
+}
+
+void
+locating_pipe::freeze_options ()
+{
+  quantity threshold;
+
+  threshold = value ((*option_)["lo-threshold"]);
+  lo_threshold_ = threshold.amount< double > ();
+  threshold = value ((*option_)["hi-threshold"]);
+  hi_threshold_ = threshold.amount< double > ();
+
+  string engine = value ((*option_)["engine"]);
+  use_native_engine_ = (engine == "native");
+}
+
+//! Lets a single doc-locate process handle all images in a sequence
+/*! This does not apply when images may be handled in-process.
+ */
+bool
+locating_pipe::is_persistent () const
+{
+  return !use_native_engine_;
+}
+
+bool
+locating_pipe::is_native_(const context& ctx) const
+{
+  return use_native_engine_ && doc_locator::supports (ctx);
+}
+
+void
+locating_pipe::signal_(traits::int_type c)
+{
+  last_marker_ = c;
+  output_->mark (c, ctx_);
+  signal_marker_(c);
+}
+
+}       // namespace _flt_
+}       // namespace utsushi
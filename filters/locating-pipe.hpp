@@ -0,0 +1,74 @@
+//  locating-pipe.hpp -- base for filters that locate documents
+//  Copyright (C) 2026  SEIKO EPSON CORPORATION
+//
+//  License: GPL-3.0+
+//  Author : EPSON AVASYS CORPORATION
+//
+//  This file is part of the 'Utsushi' package.
+//  This package is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License or, at
+//  your option, any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//  You ought to have received a copy of the GNU General Public License
+//  along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef filters_locating_pipe_hpp_
+#define filters_locating_pipe_hpp_
+
+#include "doc-locator.hpp"
+#include "shell-pipe.hpp"
+
+#include <string>
+
+namespace utsushi {
+namespace _flt_ {
+
+//!  Locate documents via \c doc-locate or in-process
+/*!  Images that a doc_locator supports are processed in-process by
+ *   default.  Anything else is handed to the \c doc-locate utility.
+ *   Setting the \c engine option to \c "doc-locate" uses the utility
+ *   for all images.
+ *
+ *   Subclasses say what to do with a located document via action_().
+ */
+class locating_pipe
+  : public shell_pipe
+{
+public:
+  void mark (traits::int_type c, const context& ctx);
+  streamsize write (const octet *data, streamsize n);
+
+protected:
+  locating_pipe ();
+
+  void freeze_options ();
+
+  bool is_persistent () const;
+
+  //!  Tells whether images described by \a ctx are handled in-process
+  bool is_native_(const context& ctx) const;
+
+  //!  Tells what to do with the document located in an image
+  virtual doc_locator::action action_() const = 0;
+
+  double lo_threshold_;
+  double hi_threshold_;
+
+private:
+  void signal_(traits::int_type c);
+
+  bool use_native_engine_;
+
+  shared_ptr< doc_locator > locator_;
+};
+
+}       // namespace _flt_
+}       // namespace utsushi
+
+#endif  /* filters_locating_pipe_hpp_ */
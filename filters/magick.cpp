@@ -224,6 +224,12 @@ magick::magick ()
   freeze_options ();   // initializes option tracking member variables
 }
 
+filter::ptr
+magick::clone () const
+{
+  return clone_< magick > ();
+}
+
 void
 magick::freeze_options ()
 {
@@ -280,6 +286,81 @@ magick::freeze_options ()
   }
 }
 
+void
+magick::mark (traits::int_type c, const context& ctx)
+{
+  if (traits::boi () == c && is_native_(ctx))
+    {
+      context est = estimate (ctx);
+
+      transform_ = make_shared< image_transform > (ctx);
+
+      if (   x_resolution_ != ctx.x_resolution ()
+          || y_resolution_ != ctx.y_resolution ())
+        {
+          double x_sample_factor = x_resolution_ / ctx.x_resolution ();
+          double y_sample_factor = y_resolution_ / ctx.y_resolution ();
+
+          transform_->scale (ctx.width ()  * x_sample_factor,
+                             ctx.height () * y_sample_factor);
+        }
+      if (force_extent_)
+        transform_->extent (width_  * x_resolution_,
+                            height_ * y_resolution_);
+      if (color_correction_)
+        transform_->color_matrix (cct_);
+      if (   0 != brightness_
+          || 0 != contrast_)
+        {
+          if ( 1 - contrast_ <= 0.0)
+            {
+              contrast_ = 0.999;
+            }
+
+          double a = 1 / (1 - contrast_);
+          double b = (brightness_ - contrast_) * a / 2;
+
+          transform_->levels (a, b);
+        }
+      if (bilevel_)
+        transform_->threshold (threshold_);
+      if (auto_orient_)
+        transform_->auto_orient ();
+      transform_->content_type (est.content_type ());
+
+      ctx_ = transform_->get_context ();
+      ctx_.resolution (est.x_resolution (), est.y_resolution ());
+      signal_(traits::boi ());
+      return;
+    }
+
+  if (transform_ && traits::eoi () == c)
+    {
+      transform_->finish (*output_);
+      transform_.reset ();
+      signal_(traits::eoi ());
+      return;
+    }
+
+  if (transform_ && traits::eof () == c)
+    {
+      transform_.reset ();
+      ctx_ = estimate (ctx);
+      signal_(traits::eof ());
+      return;
+    }
+
+  shell_pipe::mark (c, ctx);
+}
+
+streamsize
+magick::write (const octet *data, streamsize n)
+{
+  if (transform_) return transform_->write (data, n, *output_);
+
+  return shell_pipe::write (data, n);
+}
+
 context
 magick::estimate (const context& ctx)
 {
@@ -347,6 +428,30 @@ magick::estimate (const context& ctx)
   return rv;
 }
 
+//!  Tells whether an image_transform can do what convert would do
+/*!  Only results that are raster images or PNM qualify.  Everything
+ *   else still needs an encoder and is left to \c convert.
+ */
+bool
+magick::is_native_(const context& ctx) const
+{
+  if (!image_transform::supports (ctx)) return false;
+  if (color_correction_ && !ctx.is_rgb ()) return false;
+
+  return (!image_format_
+          || image_format_ == "PNM"
+          || image_format_ == "TIFF"
+          || (image_format_ == "PDF" && bilevel_));
+}
+
+void
+magick::signal_(traits::int_type c)
+{
+  last_marker_ = c;
+  output_->mark (c, ctx_);
+  signal_marker_(c);
+}
+
 std::string
 magick::arguments (const context& ctx)
 {
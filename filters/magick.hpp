@@ -21,6 +21,7 @@
 #ifndef filters_magick_hpp_
 #define filters_magick_hpp_
 
+#include "image-transform.hpp"
 #include "shell-pipe.hpp"
 
 #include <string>
@@ -28,12 +29,24 @@
 namespace utsushi {
 namespace _flt_ {
 
+//!  Convert images with the help of ImageMagick or GraphicsMagick
+/*!  Images are normally piped through \c convert.  When everything
+ *   that was asked for can be done one scanline at a time and the
+ *   result is a raster image or PNM, an image_transform is used
+ *   instead.  That saves encoding, decoding and copying all image
+ *   data to and from another process.
+ */
 class magick
   : public shell_pipe
 {
 public:
   magick ();
 
+  filter::ptr clone () const;
+
+  void mark (traits::int_type c, const context& ctx);
+  streamsize write (const octet *data, streamsize n);
+
 protected:
   void freeze_options ();
 
@@ -60,6 +73,12 @@ protected:
   double contrast_;
 
   bool auto_orient_;
+
+private:
+  bool is_native_(const context& ctx) const;
+  void signal_(traits::int_type c);
+
+  shared_ptr< image_transform > transform_;
 };
 
 }       // namespace _flt_
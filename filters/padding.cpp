@@ -36,6 +36,12 @@ namespace _flt_ {
 
 using std::logic_error;
 
+filter::ptr
+padding::clone () const
+{
+  return clone_< padding > ();
+}
+
 streamsize
 padding::write (const octet *data, streamsize n)
 {
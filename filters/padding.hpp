@@ -41,6 +41,8 @@ public:
    */
   streamsize write (const octet *data, streamsize n);
 
+  filter::ptr clone () const;
+
 protected:
   //! Reinitialises members based on a context \a ctx
   /*! After requirement checking, the context \a ctx is copied, its
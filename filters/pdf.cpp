@@ -59,8 +59,7 @@ pdf::write (const octet * data, streamsize n)
 {
   if (!data || 0 == n) return 0;
 
-  _doc->write (data, n);
-  _doc->write (output_);
+  _doc->write (output_, data, n);
 
   return n;
 }
@@ -85,7 +84,8 @@ void
 pdf::boi (const context& ctx)
 {
   BOOST_ASSERT (   "image/jpeg"  == ctx.content_type ()
-                || "image/g3fax" == ctx.content_type ());
+                || "image/g3fax" == ctx.content_type ()
+                || "image/g4fax" == ctx.content_type ());
 
   if (_multi_file)
     {
@@ -266,6 +266,16 @@ pdf::write_image_object (_pdf_::dictionary& image, std::string name)
       parms.insert ("K", _pdf_::primitive (0));   // CCITT3 1-D encoding
       image.insert ("DecodeParms", &parms);
     }
+  else if ("image/g4fax" == content_type_)
+    {
+      image.insert ("Filter", _pdf_::primitive ("/CCITTFaxDecode"));
+
+      parms.insert ("Columns", _pdf_::primitive (ctx_.width ()));
+      parms.insert ("Rows", _pdf_::object (_img_height_obj->obj_num ()));
+      parms.insert ("EndOfBlock", _pdf_::primitive ("true"));
+      parms.insert ("K", _pdf_::primitive (-1));  // CCITT4 2-D encoding
+      image.insert ("DecodeParms", &parms);
+    }
 
   // see PDF reference 1.7 p. 342 and p. 1107 # 53
   image.insert ("Name", _pdf_::primitive ("/" + name));
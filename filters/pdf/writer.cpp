@@ -22,6 +22,7 @@
 #include <config.h>
 #endif
 
+#include <sstream>
 #include <stdexcept>
 
 #include <boost/throw_exception.hpp>
@@ -40,7 +41,8 @@ using std::string;
 using std::stringstream;
 
 writer::writer ()
-  : _xref (xref ())
+  : stream_(&buffer_)
+  , _xref (xref ())
 {
   _xref_pos = 0;
   _last_xref_pos = 0;
@@ -56,17 +58,34 @@ writer::~writer ()
   _stream_len_obj = NULL;
 }
 
+writer::buffer::int_type
+writer::buffer::overflow (int_type c)
+{
+  if (!traits_type::eq_int_type (c, traits_type::eof ()))
+    buf_.push_back (traits_type::to_char_type (c));
+
+  return traits_type::not_eof (c);
+}
+
+std::streamsize
+writer::buffer::xsputn (const char *s, std::streamsize n)
+{
+  buf_.append (s, n);
+  return n;
+}
+
 streamsize
 writer::write (pdf::output::ptr& output)
 {
-  streamsize rv (output->write (stream_.str ().c_str (),
-                                stream_.str ().size ()));
+  if (0 == buffer_.size ()) return 0;
 
-  if (string::size_type (rv) != stream_.str ().size ())
+  streamsize rv (output->write (buffer_.data (), buffer_.size ()));
+
+  if (size_t (rv) != buffer_.size ())
     BOOST_THROW_EXCEPTION
       (ios_base::failure ("PDF filter octet count mismatch"));
 
-  stream_.str ("");
+  buffer_.clear ();
 
   return rv;
 }
@@ -82,13 +101,13 @@ writer::write (object& obj)
 
   _xref[obj.obj_num ()] = octets_seen_;
 
-  ostream::pos_type mark (stream_.tellp ());
+  size_t mark (buffer_.size ());
   stream_ << obj.obj_num ()
           << " 0 obj\n"
           << obj
           << "\n"
           << "endobj\n";
-  octets_seen_ += stream_.tellp () - mark;
+  count_octets (mark);
 }
 
 void
@@ -106,13 +125,13 @@ writer::begin_stream (dictionary& dict)
 
   _xref[dict.obj_num ()] = octets_seen_;
 
-  ostream::pos_type mark (stream_.tellp ());
+  size_t mark (buffer_.size ());
   stream_ << dict.obj_num ()
           << " 0 obj\n"
           << dict
           << "\n"
           << "stream\n";
-  octets_seen_ += stream_.tellp () - mark;
+  count_octets (mark);
   _saved_pos = octets_seen_;
 }
 
@@ -140,6 +159,25 @@ writer::write (const string& s)
   octets_seen_ += s.size ();
 }
 
+void
+writer::write (pdf::output::ptr& output, const char *data, size_t n)
+{
+  if (stream_mode != _mode)
+    {
+      BOOST_THROW_EXCEPTION
+        (runtime_error ("invalid call to _pdf_::writer::write ()"));
+    }
+  write (output);
+
+  streamsize rv (output->write (data, n));
+
+  if (size_t (rv) != n)
+    BOOST_THROW_EXCEPTION
+      (ios_base::failure ("PDF filter octet count mismatch"));
+
+  octets_seen_ += n;
+}
+
 void
 writer::end_stream ()
 {
@@ -153,11 +191,11 @@ writer::end_stream ()
   size_t pos = octets_seen_;
   size_t length = pos - _saved_pos;
 
-  ostream::pos_type mark (stream_.tellp ());
+  size_t mark (buffer_.size ());
   stream_ << "\n"
           << "endstream\n"
           << "endobj\n";
-  octets_seen_ += stream_.tellp () - mark;
+  count_octets (mark);
 
   // FIXME: overload the '=' operator in _pdf_::primitive
   *_stream_len_obj = primitive (length);
@@ -175,9 +213,9 @@ writer::header ()
       BOOST_THROW_EXCEPTION
         (runtime_error ("cannot write header in stream mode"));
     }
-  ostream::pos_type mark (stream_.tellp ());
+  size_t mark (buffer_.size ());
   stream_ << "%PDF-1.0\n";
-  octets_seen_ += stream_.tellp () - mark;
+  count_octets (mark);
 }
 
 void
@@ -192,6 +230,12 @@ writer::trailer (dictionary& trailer_dict)
   write_trailer (trailer_dict);
 }
 
+void
+writer::count_octets (size_t mark)
+{
+  octets_seen_ += buffer_.size () - mark;
+}
+
 // FIXME: clean up this kludge
 void
 writer::write_xref ()
@@ -201,7 +245,7 @@ writer::write_xref ()
   _last_xref_pos = _xref_pos;
   _xref_pos = octets_seen_;
 
-  ostream::pos_type mark (stream_.tellp ());
+  size_t mark (buffer_.size ());
   stream_ << "xref\n";
 
   stringstream ss;
@@ -242,7 +286,7 @@ writer::write_xref ()
               << "\n"
               << ss.str ();
     }
-  octets_seen_ += stream_.tellp () - mark;
+  count_octets (mark);
 }
 
 void
@@ -254,7 +298,7 @@ writer::write_trailer (dictionary& trailer_dict)
       trailer_dict.insert ("Prev", primitive (_last_xref_pos));
     }
 
-  ostream::pos_type mark (stream_.tellp ());
+  size_t mark (buffer_.size ());
   stream_ << "trailer\n"
           << trailer_dict
           << "\n"
@@ -262,7 +306,7 @@ writer::write_trailer (dictionary& trailer_dict)
           << _xref_pos
           << "\n"
           << "%%EOF\n";
-  octets_seen_ += stream_.tellp () - mark;
+  count_octets (mark);
 
   _xref.clear ();
 }
@@ -22,7 +22,9 @@
 #define filters_pdf_writer_hpp_
 
 #include <map>
-#include <sstream>
+#include <ostream>
+#include <streambuf>
+#include <string>
 
 #include "../pdf.hpp"
 #include "dictionary.hpp"
@@ -50,7 +52,28 @@ class writer
 private:
   typedef std::map<size_t, size_t> xref;
 
-  std::stringstream stream_;
+  //! Collects formatted PDF syntax until it is written out
+  /*! Unlike a std::stringbuf, this gives access to its contents
+   *  without copying them and keeps its storage around for reuse.
+   */
+  class buffer
+    : public std::streambuf
+  {
+  public:
+    const char * data () const { return buf_.data (); }
+    size_t size () const { return buf_.size (); }
+    void clear () { buf_.clear (); }
+
+  protected:
+    int_type overflow (int_type c);
+    std::streamsize xsputn (const char *s, std::streamsize n);
+
+  private:
+    std::string buf_;
+  };
+
+  buffer buffer_;
+  std::ostream stream_;
 
   xref _xref;
   size_t _xref_pos;
@@ -75,6 +98,8 @@ public:
 
   ~writer ();
 
+  /*! Writes everything formatted so far to \a output.
+   */
   streamsize write (pdf::output::ptr& output);
 
   /*! Writes a _pdf_::object to the file as an indirect object [p 63].
@@ -113,6 +138,16 @@ public:
    */
   void write (const std::string& s);
 
+  /*! Writes \a n bytes from \a buf straight to \a output as part of
+   *  a PDF stream.
+   *
+   *  Anything formatted so far is written first.  The bytes in \a buf
+   *  are not copied, which makes this the preferred way to pass large
+   *  amounts of image data.  The same restrictions as for write (const
+   *  char*, size_t) apply.
+   */
+  void write (pdf::output::ptr& output, const char *buf, size_t n);
+
   /*! Finishes writing a PDF stream and sets the current mode to object mode.
    *
    *  The "Length" property of the stream is written at this point as an
@@ -139,6 +174,9 @@ public:
   void trailer (dictionary& trailer_dict);
 
 private:
+  // Adds the octets formatted since \a mark to the octets seen.
+  void count_octets (size_t mark);
+
   // Writes the cross-reference table [p 93].
   void write_xref ();
 
@@ -34,6 +34,12 @@
 namespace utsushi {
 namespace _flt_ {
 
+filter::ptr
+pnm::clone () const
+{
+  return clone_< pnm > ();
+}
+
 streamsize
 pnm::write (const octet *data, streamsize n)
 {
@@ -58,6 +58,8 @@ class pnm
 public:
   streamsize write (const octet *data, streamsize n);
 
+  filter::ptr clone () const;
+
 protected:
   void boi (const context& ctx);
 };
@@ -297,6 +297,12 @@ reorient::reorient ()
   freeze_options ();   // initializes option tracking member variables
 }
 
+filter::ptr
+reorient::clone () const
+{
+  return clone_< reorient > ();
+}
+
 void
 reorient::mark (traits::int_type c, const context& ctx)
 {
@@ -36,6 +36,8 @@ class reorient
 public:
   reorient ();
 
+  filter::ptr clone () const;
+
   streamsize write (const octet *data, streamsize n);
 
   void mark (traits::int_type c, const context& ctx);
@@ -24,6 +24,7 @@
 
 #include "shell-pipe.hpp"
 
+#include <utsushi/cstdint.hpp>
 #include <utsushi/log.hpp>
 
 #include <algorithm>
@@ -33,7 +34,7 @@
 #include <stdexcept>
 
 #include <fcntl.h>
-#include <sys/select.h>
+#include <poll.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <unistd.h>
@@ -83,6 +84,21 @@ log_process_exit_(const std::string& cmd, const siginfo_t& info)
     }
 }
 
+//! Pipe capacity to ask for so both ends need fewer wake-ups
+/*! This matches the default limit for unprivileged processes.
+ */
+const int preferred_pipe_size = 1024 * 1024;
+
+inline
+void
+enlarge_(int pipe)
+{
+#ifdef F_SETPIPE_SZ
+  if (0 > fcntl (pipe, F_SETPIPE_SZ, preferred_pipe_size))
+    log::debug ("shell-pipe: F_SETPIPE_SZ: %1%") % strerror (errno);
+#endif
+}
+
 inline
 void
 reserve_(octet *&buffer, ssize_t& size, int pipe)
@@ -107,6 +123,30 @@ reserve_(octet *&buffer, ssize_t& size, int pipe)
   if (0 > pipe_size) log::error (strerror (errno));
 }
 
+//! Size of the chunk size prefix used when framing image data
+const streamsize frame_head_size = 4;
+
+//! Chunk size that ends a reply for an image that could not be processed
+const uint32_t frame_failure = 0xffffffff;
+
+inline
+void
+encode_size_(octet *head, uint32_t size)
+{
+  for (streamsize i = frame_head_size - 1; 0 <= i; --i, size >>= 8)
+    head[i] = size & 0xff;
+}
+
+inline
+uint32_t
+decode_size_(const octet *head)
+{
+  uint32_t rv = 0;
+  for (streamsize i = 0; i < frame_head_size; ++i)
+    rv = (rv << 8) | traits::to_int_type (head[i]);
+  return rv;
+}
+
 inline
 void
 reset_(int& pipe, int fd)
@@ -132,6 +172,12 @@ shell_pipe::shell_pipe (const std::string& command)
   , e_pipe_(-1)
   , buffer_(new octet[default_buffer_size])
   , buffer_size_(default_buffer_size)
+  , is_framed_(false)
+  , send_head_used_(0)
+  , send_left_(0)
+  , recv_head_used_(0)
+  , recv_left_(0)
+  , reply_(traits::eoi ())
 {
   freeze_options ();   // initializes option tracking member variables
 }
@@ -159,6 +205,8 @@ shell_pipe::write (const octet *data, streamsize n)
 {
   if (-1 == i_pipe_) return n;
 
+  if (is_framed_) return write_frame_(data, n);
+
   return service_pipes_(data, n);
 }
 
@@ -168,18 +216,68 @@ shell_pipe::bos (const context& ctx)
   freeze_options ();
   ctx_ = estimate (ctx);
   last_marker_ = traits::bos ();
+
+  is_framed_ = is_persistent ();
+  if (is_framed_ && traits::eof () == exec_process_(ctx))
+    last_marker_ = traits::eof ();
 }
 
 void
 shell_pipe::boi (const context& ctx)
 {
   ctx_ = estimate (ctx);
-  last_marker_ = exec_process_(ctx);
+
+  if (!is_framed_)
+    {
+      last_marker_ = exec_process_(ctx);
+      return;
+    }
+
+  send_head_used_ = 0;
+  send_left_      = 0;
+  recv_head_used_ = 0;
+  recv_left_      = 0;
+  reply_ = traits::boi ();
+
+  last_marker_ = (-1 != i_pipe_ ? traits::boi () : traits::eof ());
 }
 
 void
 shell_pipe::eoi (const context& ctx)
 {
+  if (is_framed_)
+    {
+      octet tail[frame_head_size];
+      encode_size_(tail, 0);
+
+      streamsize sent = 0;
+      while (-1 != i_pipe_ && sent < frame_head_size)
+        sent += service_pipes_(tail + sent, frame_head_size - sent);
+
+      while (-1 != o_pipe_ && traits::boi () == reply_)
+        service_pipes_(nullptr, 0);
+
+      if (!message_.empty ())
+        {
+          log::error ("%1% (pid: %2%): %3%")
+            % command_ % process_ % message_;
+          message_.clear ();
+        }
+
+      ctx_ = finalize (ctx);
+
+      last_marker_ = (traits::eoi () == reply_
+                      ? traits::eoi ()
+                      : traits::eof ());
+
+      if (-1 == o_pipe_)        // command quit on us
+        {
+          close_(i_pipe_);
+          reap_process_();
+        }
+      return;
+    }
+
   close_(i_pipe_);              // no more input for process_
 
   while (-1 != o_pipe_)
@@ -193,6 +291,17 @@ shell_pipe::eoi (const context& ctx)
 void
 shell_pipe::eos (const context& ctx)
 {
+  if (is_framed_ && 0 < process_)
+    {
+      close_(i_pipe_);          // let process_ know it is done
+
+      while (-1 != o_pipe_)
+        service_pipes_(nullptr, 0);
+
+      reap_process_();
+    }
+  is_framed_ = false;
+
   ctx_ = finalize (ctx);
   last_marker_ = traits::eos ();
 }
@@ -205,7 +314,8 @@ shell_pipe::eof (const context& ctx)
 
   ctx_ = finalize (ctx);
 
-  last_marker_ = reap_process_();
+  last_marker_ = (0 < process_ ? reap_process_() : traits::eof ());
+  is_framed_ = false;
 }
 
 void
@@ -237,6 +347,12 @@ shell_pipe::checked_write (octet *data, streamsize n)
   output_->write (data, n);
 }
 
+bool
+shell_pipe::is_persistent () const
+{
+  return false;
+}
+
 traits::int_type
 shell_pipe::exec_process_(const context& ctx)
 {
@@ -304,6 +420,8 @@ shell_pipe::exec_process_(const context& ctx)
       reset_(o_pipe_, out[0]);
       reset_(i_pipe_, in[1]);
 
+      enlarge_(o_pipe_);
+      enlarge_(i_pipe_);
       reserve_(buffer_, buffer_size_, o_pipe_);
 
       log::trace ("%1% started (pid: %2%)") % command_ % process_;
@@ -374,44 +492,48 @@ shell_pipe::service_pipes_(const octet *data, streamsize n)
 {
   BOOST_ASSERT ((data && 0 < n) || 0 == n);
 
-  int fds;
-  int fd_max = 0;
-  fd_set r_fds;
-  fd_set w_fds;
-
-  FD_ZERO (&r_fds);
-  FD_ZERO (&w_fds);
+  // Sleep until at least one of the pipes is ready.  Output and
+  // errors are always watched so the process_ cannot get stuck on
+  // a full pipe while waiting for more input.
 
-  using std::max;
+  struct pollfd fds[3];
+  nfds_t nfds = 0;
+  const struct pollfd *i_fd = nullptr;
+  const struct pollfd *o_fd = nullptr;
+  const struct pollfd *e_fd = nullptr;
 
   if (0 < i_pipe_ && 0 < n)
     {
-      FD_SET (i_pipe_, &w_fds);
-      fd_max = max (i_pipe_, fd_max);
+      fds[nfds].fd = i_pipe_;
+      fds[nfds].events = POLLOUT;
+      i_fd = &fds[nfds++];
     }
   if (0 < o_pipe_)
     {
-      FD_SET (o_pipe_, &r_fds);
-      fd_max = max (o_pipe_, fd_max);
+      fds[nfds].fd = o_pipe_;
+      fds[nfds].events = POLLIN;
+      o_fd = &fds[nfds++];
     }
   if (0 < e_pipe_)
     {
-      FD_SET (e_pipe_, &r_fds);
-      fd_max = max (e_pipe_, fd_max);
+      fds[nfds].fd = e_pipe_;
+      fds[nfds].events = POLLIN;
+      e_fd = &fds[nfds++];
     }
 
-  struct timespec nonblocking = { 0, 0 };
-  fds = pselect (fd_max + 1, &r_fds, &w_fds, nullptr,
-                 &nonblocking, nullptr);
+  if (0 == nfds) return 0;
+
+  if (-1 == poll (fds, nfds, -1))
+    {
+      if (EINTR == errno) return 0;
+      BOOST_THROW_EXCEPTION (runtime_error (strerror (errno)));
+    }
 
-  if (-1 == fds && EINTR == errno)
-    return 0;
-  if (-1 == fds)
-    BOOST_THROW_EXCEPTION (runtime_error (strerror (errno)));
+  const short ready = POLLIN | POLLOUT | POLLERR | POLLHUP;
 
   ssize_t rv;
 
-  if (0 < e_pipe_ && FD_ISSET (e_pipe_, &r_fds))
+  if (e_fd && (ready & e_fd->revents))
     {
       rv = ::read (e_pipe_, buffer_, buffer_size_);
 
@@ -429,16 +551,17 @@ shell_pipe::service_pipes_(const octet *data, streamsize n)
         }
     }
 
-  if (0 < o_pipe_ && FD_ISSET (o_pipe_, &r_fds))
+  if (o_fd && (ready & o_fd->revents) && 0 < o_pipe_)
     {
       rv = ::read (o_pipe_, buffer_, buffer_size_);
 
-      /**/ if (0 < rv) { checked_write (buffer_, rv); }
+      /**/ if (0 < rv && is_framed_) { read_frames_(buffer_, rv); }
+      else if (0 < rv) { checked_write (buffer_, rv); }
       else if (0 > rv) { handle_error_(errno, o_pipe_); }
       else  /* EOF */  { close_(o_pipe_); }
     }
 
-  if (0 < i_pipe_ && FD_ISSET (i_pipe_, &w_fds) && 0 < n)
+  if (i_fd && (ready & i_fd->revents) && 0 < i_pipe_)
     {
       rv = ::write (i_pipe_, data, n);
 
@@ -466,12 +589,85 @@ shell_pipe::handle_error_(int ec, int& fd)
       if (e_pipe_ != fd)
         last_marker_ = traits::eof ();
 
-      // The file descriptor should no longer be included in the sets
-      // passed to pselect() beyond this point.  See: select_tut(2).
+      // The file descriptor should no longer be polled beyond this
+      // point.
 
       close_(fd);
     }
 }
 
+//! Sends image data to a persistent process_ as a series of chunks
+/*! Each call starts a new chunk unless the previous one has not been
+ *  sent completely yet.  As with service_pipes_(), the caller has to
+ *  hold on to any data that has not been consumed.
+ */
+streamsize
+shell_pipe::write_frame_(const octet *data, streamsize n)
+{
+  if (0 == send_left_)
+    {
+      if (0 == n) return 0;
+
+      send_left_ = std::min< streamsize > (n, frame_failure - 1);
+      encode_size_(send_head_, send_left_);
+      send_head_used_ = 0;
+    }
+
+  if (frame_head_size > send_head_used_)
+    {
+      send_head_used_ += service_pipes_(send_head_ + send_head_used_,
+                                        frame_head_size - send_head_used_);
+      if (frame_head_size > send_head_used_) return 0;
+    }
+
+  streamsize rv = service_pipes_(data, std::min (n, send_left_));
+  send_left_ -= rv;
+
+  return rv;
+}
+
+//! Passes on the payload of the chunks that a persistent process_ sent
+void
+shell_pipe::read_frames_(octet *data, streamsize n)
+{
+  while (0 < n)
+    {
+      if (traits::boi () != reply_)
+        {
+          log::error ("%1% (pid: %2%): ignoring %3% octets of excess output")
+            % command_ % process_ % n;
+          return;
+        }
+
+      if (0 == recv_left_)
+        {
+          streamsize k = std::min (n, frame_head_size - recv_head_used_);
+
+          traits::copy (recv_head_ + recv_head_used_, data, k);
+          recv_head_used_ += k;
+          data += k;
+          n    -= k;
+
+          if (frame_head_size > recv_head_used_) return;
+
+          recv_head_used_ = 0;
+
+          uint32_t size = decode_size_(recv_head_);
+          /**/ if (0 == size)            reply_ = traits::eoi ();
+          else if (frame_failure == size) reply_ = traits::eof ();
+          else                            recv_left_ = size;
+
+          continue;
+        }
+
+      streamsize k = std::min (n, recv_left_);
+
+      checked_write (data, k);
+      recv_left_ -= k;
+      data += k;
+      n    -= k;
+    }
+}
+
 }       // namespace _flt_
 }       // namespace utsushi
@@ -55,6 +55,23 @@ protected:
 
   virtual void checked_write (octet *data, streamsize n);
 
+  //!  Tells whether the command can process a whole image sequence
+  /*!  Commands normally handle a single image and are started anew
+   *   for every image.  Commands that understand the framing used
+   *   by a shell_pipe are started only once per sequence instead.
+   *   The arguments() passed are based on the context at the start
+   *   of the sequence.
+   *
+   *   Image data is framed as a series of chunks.  Each chunk starts
+   *   with its size in octets as a four octet, big-endian unsigned
+   *   integer.  A chunk of size zero marks the end of an image.  The
+   *   command replies with its result, framed the same way.  It ends
+   *   the reply with a 0xffffffff size instead if the image could
+   *   not be processed.  The command should exit when its standard
+   *   input is closed in between images.
+   */
+  virtual bool is_persistent () const;
+
 private:
   traits::int_type exec_process_(const context& ctx);
   traits::int_type reap_process_();
@@ -62,6 +79,9 @@ private:
   streamsize service_pipes_(const octet *data, streamsize n);
   void handle_error_(int ec, int& fd);
 
+  streamsize write_frame_(const octet *data, streamsize n);
+  void read_frames_(octet *data, streamsize n);
+
   std::string command_;
   std::string message_;
   pid_t       process_;
@@ -72,6 +92,20 @@ private:
 
   octet  *buffer_;
   ssize_t buffer_size_;
+
+  // Framing state when running a command for a whole sequence
+
+  bool is_framed_;
+
+  octet      send_head_[4];
+  streamsize send_head_used_;
+  streamsize send_left_;        //!< of the chunk being sent
+
+  octet      recv_head_[4];
+  streamsize recv_head_used_;
+  streamsize recv_left_;        //!< of the chunk being received
+
+  traits::int_type reply_;      //!< how the command's reply ended
 };
 
 }       // namespace _flt_
@@ -0,0 +1,86 @@
+//  simd.hpp -- run-time selection of SIMD filter kernels
+//  Copyright (C) 2026  SEIKO EPSON CORPORATION
+//
+//  License: GPL-3.0+
+//  Author : EPSON AVASYS CORPORATION
+//
+//  This file is part of the 'Utsushi' package.
+//  This package is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License or, at
+//  your option, any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//  You ought to have received a copy of the GNU General Public License
+//  along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef filters_simd_hpp_
+#define filters_simd_hpp_
+
+#include <vector>
+
+#if defined (__GNUC__) && (defined (__x86_64__) || defined (__i386__))
+#define FILTERS_USE_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+#if defined (__ARM_NEON) || defined (__ARM_NEON__)
+#define FILTERS_USE_NEON_KERNEL 1
+#include <arm_neon.h>
+#endif
+
+namespace utsushi {
+namespace _flt_ {
+
+//! Implementations of a filter kernel for several instruction sets
+/*! Only the scalar implementation is required.  It is the reference
+ *  the others have to agree with.  Implementations for instruction
+ *  sets that are not compiled in are left null.
+ *
+ *  x86 kernels are compiled with a \c target attribute so that they
+ *  can be built without changing the compiler flags for the rest of
+ *  the code.  Whether they can be used is decided at run-time.
+ */
+template< typename function >
+struct simd_kernels
+{
+  function scalar;
+  function sse2;
+  function avx2;
+  function neon;
+
+  simd_kernels (function reference)
+    : scalar (reference)
+    , sse2 (0)
+    , avx2 (0)
+    , neon (0)
+  {}
+
+  //! Lists the implementations the CPU we run on supports
+  /*! The fastest comes first, the scalar implementation last.
+   */
+  std::vector< function >
+  supported () const
+  {
+    std::vector< function > rv;
+
+#if FILTERS_USE_X86_KERNELS
+    __builtin_cpu_init ();
+    if (avx2 && __builtin_cpu_supports ("avx2")) rv.push_back (avx2);
+    if (sse2 && __builtin_cpu_supports ("sse2")) rv.push_back (sse2);
+#endif
+    if (neon) rv.push_back (neon);
+    rv.push_back (scalar);
+
+    return rv;
+  }
+};
+
+}       // namespace _flt_
+}       // namespace utsushi
+
+#endif  /* filters_simd_hpp_ */
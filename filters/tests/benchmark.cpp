@@ -0,0 +1,595 @@
+//  benchmark.cpp -- filter throughput measurements
+//  Copyright (C) 2026  SEIKO EPSON CORPORATION
+//
+//  License: GPL-3.0+
+//  Author : EPSON AVASYS CORPORATION
+//
+//  This file is part of the 'Utsushi' package.
+//  This package is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License or, at
+//  your option, any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//  You ought to have received a copy of the GNU General Public License
+//  along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+//  Runs filters, on their own and in the chains that utsushi-scan sets
+//  up, on reproducible synthetic pages and on the JPEG sample images.
+//  Every run happens in a process of its own so that the peak RSS is
+//  that of the run.  Results are written to standard output, one JSON
+//  object per line.
+//
+//  Usage: benchmark [-p pages] [-r res[,res...]] [-s dir] [chain...]
+//
+//  where a chain is a list of filter names separated by '|', such as
+//  "threshold|g4fax|pdf".  Without chains, all known ones are run.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <utsushi/atomic.hpp>
+#include <utsushi/device.hpp>
+#include <utsushi/stream.hpp>
+#include <utsushi/test/memory.hpp>
+
+#include "../g3fax.hpp"
+#include "../image-skip.hpp"
+#if HAVE_LIBJPEG
+#include "../jpeg.hpp"
+#endif
+#include "../padding.hpp"
+#include "../pdf.hpp"
+#include "../pnm.hpp"
+#include "../threshold.hpp"
+
+using namespace utsushi;
+
+//  Count every allocation made through operator new, including those
+//  made by the filters in the shared libraries.
+
+static atomic< std::size_t > allocations (0);
+static atomic< std::size_t > allocated_octets (0);
+
+void *
+operator new (std::size_t size)
+{
+  ++allocations;
+  allocated_octets += size;
+
+  void *p = std::malloc (size ? size : 1);
+  if (!p) throw std::bad_alloc ();
+  return p;
+}
+
+void *
+operator new[] (std::size_t size)
+{
+  return operator new (size);
+}
+
+void *
+operator new (std::size_t size, const std::nothrow_t&) throw ()
+{
+  ++allocations;
+  allocated_octets += size;
+
+  return std::malloc (size ? size : 1);
+}
+
+void *
+operator new[] (std::size_t size, const std::nothrow_t& nt) throw ()
+{
+  return operator new (size, nt);
+}
+
+void operator delete   (void *p) throw () { std::free (p); }
+void operator delete[] (void *p) throw () { std::free (p); }
+
+enum input_type { RAW_RGB, RAW_GRAY, RAW_MONO, PBM, JPEG };
+
+struct bench_case
+{
+  const char *chain;
+  input_type  input;
+};
+
+//! Filters on their own, then the chains used by utsushi-scan
+/*! The "thru" filter only forwards its input and shows the overhead
+ *  of the stream and the device.  The g3fax filter only accepts PBM,
+ *  which utsushi-scan gets from the magick filter.  That filter needs
+ *  an external program and would swamp the numbers, so the g3fax runs
+ *  start from ready-made PBM images instead.
+ */
+static const bench_case cases[] = {
+  { "thru",                            RAW_RGB  },
+  { "padding",                         RAW_RGB  },
+  { "pnm",                             RAW_RGB  },
+  { "image-skip",                      RAW_RGB  },
+  { "threshold",                       RAW_GRAY },
+  { "g3fax",                           PBM      },
+  { "g4fax",                           RAW_MONO },
+#if HAVE_LIBJPEG
+  { "jpeg-compressor",                 RAW_RGB  },
+  { "jpeg-decompressor",               JPEG     },
+  { "pdf",                             JPEG     },
+#endif
+  { "padding|image-skip|pnm",          RAW_RGB  },
+#if HAVE_LIBJPEG
+  { "jpeg-decompressor|image-skip|pnm", JPEG    },
+  { "jpeg-compressor|pdf",             RAW_RGB  },
+#endif
+  { "g3fax|pdf",                       PBM      },
+  { "threshold|g4fax|pdf",             RAW_GRAY },
+};
+
+//! JPEG sample images in the test data directory
+static const struct {
+  const char *name;
+  context::size_type width;
+  context::size_type height;
+} samples[] = {
+  { "A4-max-x-max.jpg", 2550, 3513 },
+};
+
+static filter::ptr
+make_filter (const std::string& name)
+{
+  using namespace _flt_;
+
+  if ("thru"       == name) return make_shared< thru_filter > ();
+  if ("padding"    == name) return make_shared< padding > ();
+  if ("pnm"        == name) return make_shared< pnm > ();
+  if ("image-skip" == name) return make_shared< image_skip > ();
+  if ("threshold"  == name) return make_shared< threshold > ();
+  if ("g3fax"      == name) return make_shared< g3fax > ();
+  if ("g4fax"      == name) return make_shared< g4fax > ();
+  if ("pdf"        == name) return make_shared< pdf > ();
+#if HAVE_LIBJPEG
+  if ("jpeg-compressor"   == name)
+    return make_shared< jpeg::compressor > ();
+  if ("jpeg-decompressor" == name)
+    return make_shared< jpeg::decompressor > ();
+#endif
+
+  throw std::invalid_argument ("unknown filter: " + name);
+}
+
+//!  Discards all image data, only keeping count
+class counting_odevice : public odevice
+{
+public:
+  counting_odevice () : octets (0) {}
+
+  uintmax_t octets;
+
+  streamsize write (const octet *p, streamsize n)
+  {
+    octets += n;
+    return n;
+  }
+};
+
+//!  Hands out the same in-memory image for a number of pages
+/*!  Data is provided zero-copy so that the measurements are not
+ *   skewed by the cost of producing it.
+ */
+class memory_idevice : public idevice
+{
+  shared_ptr< const std::vector< octet > > image_;
+  unsigned pages_;
+  unsigned count_;
+  streamsize offset_;
+
+public:
+  memory_idevice (const context& ctx,
+                  shared_ptr< const std::vector< octet > > image,
+                  unsigned pages)
+    : idevice (ctx), image_(image), pages_(pages), count_(0), offset_(0)
+  {}
+
+  bool is_zero_copy () const { return true; }
+
+protected:
+  bool is_consecutive () const { return true; }
+  bool obtain_media () { return count_ < pages_; }
+  bool set_up_image ()
+  {
+    offset_ = 0;
+    ctx_.octets_seen () = 0;
+    return true;
+  }
+  void finish_image () { ++count_; }
+
+  streamsize sgetn (octet *data, streamsize n)
+  {
+    block blk;
+    streamsize rv = sgetn (blk, n);
+    if (0 < rv) traits::copy (data, blk.data (), rv);
+    return rv;
+  }
+  streamsize sgetn (block& blk, streamsize n)
+  {
+    streamsize rv = std::min (n, streamsize (image_->size ()) - offset_);
+    blk = block (image_, &(*image_)[0] + offset_, rv);
+    offset_ += rv;
+    return rv;
+  }
+};
+
+static inline octet
+luminance (uint8_t r, uint8_t g, uint8_t b)
+{
+  return (299 * r + 587 * g + 114 * b) / 1000;
+}
+
+//! Render a page of an A4 document at a given \a res
+/*! The page has a colour photograph-like gradient in the top right
+ *  corner and is filled with lines of "words" otherwise.  The word
+ *  lengths come from a fixed pseudo-random sequence so every run gets
+ *  exactly the same page.  Image data is light based, like what the
+ *  devices produce.
+ */
+static shared_ptr< std::vector< octet > >
+render_page (context& ctx, input_type type, context::size_type res)
+{
+  const context::size_type w = 8.27  * res;
+  const context::size_type h = 11.69 * res;
+
+  ctx = context (w, h, (RAW_GRAY == type ? context::GRAY8
+                        : RAW_MONO == type ? context::MONO
+                        : PBM == type ? context::MONO
+                        : context::RGB8));
+  ctx.resolution (res);
+
+  shared_ptr< std::vector< octet > >
+    rv = make_shared< std::vector< octet > > ();
+  rv->reserve (ctx.octets_per_image ());
+
+  const context::size_type margin  = res;
+  const context::size_type leading = res / 6;
+  const context::size_type x_height = res / 12;
+  const context::size_type glyph   = res / 20;
+
+  const context::size_type photo_l = w / 2;
+  const context::size_type photo_r = w - margin;
+  const context::size_type photo_t = margin;
+  const context::size_type photo_b = margin + w / 3;
+
+  std::vector< uint8_t > rgb (3 * w);
+  std::vector< octet > line (ctx.octets_per_line ());
+  uint32_t seed = 0x2545f491;
+
+  for (context::size_type y = 0; y < h; ++y)
+    {
+      std::fill (rgb.begin (), rgb.end (), 0xfa);
+
+      bool is_text = (margin <= y && y < h - margin
+                      && (y - margin) % leading < x_height);
+      if (is_text && 0 == (y - margin) % leading)
+        seed = 0x2545f491 + y;  // new line of text, new words
+      uint32_t state = seed;
+
+      for (context::size_type x = margin; is_text && x < w - margin;)
+        {
+          state = state * 1103515245 + 12345;
+          context::size_type word = (2 + (state >> 16) % 9) * glyph;
+
+          for (context::size_type i = x; i < std::min (x + word, w - margin); ++i)
+            {
+              if (photo_t <= y && y < photo_b
+                  && photo_l <= i && i < photo_r) continue;
+              std::fill_n (&rgb[3 * i], 3, 0x20);
+            }
+          x += word + glyph;
+        }
+
+      if (photo_t <= y && y < photo_b)
+        {
+          for (context::size_type x = photo_l; x < photo_r; ++x)
+            {
+              uint8_t v = (255 * (x - photo_l) / (photo_r - photo_l)
+                           + 255 * (y - photo_t) / (photo_b - photo_t)) / 2;
+              rgb[3 * x    ] = v;
+              rgb[3 * x + 1] = 255 - v;
+              rgb[3 * x + 2] = 128 + v / 2;
+            }
+        }
+
+      if (RAW_GRAY == type)
+        {
+          for (context::size_type x = 0; x < w; ++x)
+            line[x] = luminance (rgb[3 * x], rgb[3 * x + 1], rgb[3 * x + 2]);
+        }
+      else if (RAW_MONO == type || PBM == type)
+        {
+          std::fill (line.begin (), line.end (), 0x00);
+          for (context::size_type x = 0; x < w; ++x)
+            if ((0x80 <= uint8_t (luminance (rgb[3 * x], rgb[3 * x + 1],
+                                             rgb[3 * x + 2])))
+                == (RAW_MONO == type))  // PBM uses 1 for black
+              line[x / 8] |= 0x80 >> (x % 8);
+        }
+      else
+        {
+          std::copy (rgb.begin (), rgb.end (), line.begin ());
+        }
+      rv->insert (rv->end (), line.begin (), line.end ());
+    }
+
+  if (PBM == type)
+    {
+      char header[32];
+      int n = snprintf (header, sizeof (header), "P4\n%u %u\n",
+                        unsigned (w), unsigned (h));
+      rv->insert (rv->begin (), header, header + n);
+      ctx.content_type ("image/x-portable-bitmap");
+    }
+
+  return rv;
+}
+
+#if HAVE_LIBJPEG
+static shared_ptr< std::vector< octet > >
+compress (context& ctx, shared_ptr< std::vector< octet > > raw)
+{
+  memory_idevice dev (ctx, raw, 1);
+  idevice& idev (dev);
+  shared_ptr< capture_odevice > out = make_shared< capture_odevice > ();
+
+  stream str;
+  str.push (make_shared< _flt_::jpeg::compressor > ());
+  str.push (out);
+
+  idev | str;
+
+  ctx.content_type ("image/jpeg");
+  return make_shared< std::vector< octet > > (out->data);
+}
+#endif
+
+static double
+seconds (clockid_t clock)
+{
+  struct timespec t;
+  clock_gettime (clock, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static const char *
+type_name (input_type type)
+{
+  switch (type)
+    {
+    case RAW_GRAY: return "gray8";
+    case RAW_MONO: return "mono";
+    case PBM:      return "pbm";
+    case JPEG:     return "jpeg";
+    default:       return "rgb8";
+    }
+}
+
+//! Measure a single \a chain, in the process that calls it
+static void
+run (const std::string& chain, input_type type, context::size_type res,
+     unsigned pages, const std::string& sample,
+     context::size_type sample_w, context::size_type sample_h)
+{
+  context ctx;
+  shared_ptr< std::vector< octet > > image;
+
+  if (sample.empty ())
+    {
+      image = render_page (ctx, (JPEG == type ? RAW_RGB : type), res);
+#if HAVE_LIBJPEG
+      if (JPEG == type) image = compress (ctx, image);
+#endif
+    }
+  else
+    {
+      std::ifstream file (sample.c_str (), std::ios::binary);
+      image = make_shared< std::vector< octet > >
+        ((std::istreambuf_iterator< char > (file)),
+         std::istreambuf_iterator< char > ());
+      if (!file || image->empty ())
+        throw std::runtime_error ("cannot read sample: " + sample);
+
+      ctx = context (sample_w, sample_h, context::RGB8);
+      ctx.resolution (res);
+      ctx.content_type ("image/jpeg");
+    }
+
+  memory_idevice dev (ctx, image, pages);
+  idevice& idev (dev);
+  shared_ptr< counting_odevice > out = make_shared< counting_odevice > ();
+
+  stream str;
+  std::string::size_type pos = 0;
+  do
+    {
+      std::string::size_type end = chain.find ('|', pos);
+      str.push (make_filter (chain.substr (pos, end - pos)));
+      pos = (std::string::npos == end ? end : end + 1);
+    }
+  while (std::string::npos != pos);
+  str.push (out);
+
+  std::size_t allocs = allocations;
+  std::size_t octets = allocated_octets;
+  double cpu  = seconds (CLOCK_PROCESS_CPUTIME_ID);
+  double wall = seconds (CLOCK_MONOTONIC);
+
+  idev | str;
+
+  wall = seconds (CLOCK_MONOTONIC) - wall;
+  cpu  = seconds (CLOCK_PROCESS_CPUTIME_ID) - cpu;
+  allocs = allocations - allocs;
+  octets = allocated_octets - octets;
+
+  struct rusage usage;
+  getrusage (RUSAGE_SELF, &usage);
+
+  double in = double (image->size ()) * pages;
+
+  printf ("{\"chain\":\"%s\",\"input\":\"%s\",\"type\":\"%s\""
+          ",\"resolution\":%u,\"width\":%u,\"height\":%u,\"pages\":%u"
+          ",\"octets_in\":%.0f,\"octets_out\":%ju"
+          ",\"seconds\":%.6f,\"cpu_seconds\":%.6f"
+          ",\"mb_per_s\":%.3f,\"pages_per_s\":%.3f"
+          ",\"allocations\":%zu,\"allocated_octets\":%zu"
+          ",\"peak_rss_kb\":%ld}\n",
+          chain.c_str (),
+          (sample.empty () ? "synthetic"
+           : sample.substr (sample.rfind ('/') + 1).c_str ()),
+          type_name (type),
+          unsigned (res), unsigned (ctx.width ()), unsigned (ctx.height ()),
+          pages, in, out->octets, wall, cpu,
+          in / 1e6 / wall, pages / wall,
+          allocs, octets, usage.ru_maxrss);
+  fflush (stdout);
+}
+
+//! Measure a single \a chain in a child process
+static bool
+spawn (const std::string& chain, input_type type, context::size_type res,
+       unsigned pages, const std::string& sample = std::string (),
+       context::size_type sample_w = 0, context::size_type sample_h = 0)
+{
+  pid_t pid = fork ();
+
+  if (0 > pid)
+    {
+      perror ("fork");
+      return false;
+    }
+  if (0 == pid)
+    {
+      try
+        {
+          run (chain, type, res, pages, sample, sample_w, sample_h);
+        }
+      catch (const std::exception& e)
+        {
+          fprintf (stderr, "%s: %s\n", chain.c_str (), e.what ());
+          _exit (EXIT_FAILURE);
+        }
+      _exit (EXIT_SUCCESS);
+    }
+
+  int status = 0;
+  waitpid (pid, &status, 0);
+
+  bool rv = (WIFEXITED (status) && EXIT_SUCCESS == WEXITSTATUS (status));
+  if (!rv)
+    printf ("{\"chain\":\"%s\",\"type\":\"%s\",\"resolution\":%u"
+            ",\"error\":true}\n",
+            chain.c_str (), type_name (type), unsigned (res));
+  fflush (stdout);
+
+  return rv;
+}
+
+int
+main (int argc, char *argv[])
+{
+  unsigned pages = 3;
+  std::vector< context::size_type > resolutions;
+  std::string srcdir (getenv ("srcdir") ? getenv ("srcdir") : "");
+
+  int opt;
+  while (-1 != (opt = getopt (argc, argv, "p:r:s:")))
+    {
+      switch (opt)
+        {
+        case 'p':
+          pages = strtoul (optarg, NULL, 10);
+          break;
+        case 'r':
+          for (char *p = optarg, *end; *p; p = end + (',' == *end))
+            {
+              resolutions.push_back (strtoul (p, &end, 10));
+              if (end == p) break;
+            }
+          break;
+        case 's':
+          srcdir = optarg;
+          break;
+        default:
+          fprintf (stderr, "Usage: %s [-p pages] [-r res[,res...]]"
+                   " [-s dir] [chain...]\n", argv[0]);
+          return EXIT_FAILURE;
+        }
+    }
+  if (resolutions.empty ())
+    {
+      resolutions.push_back (150);
+      resolutions.push_back (300);
+      resolutions.push_back (600);
+    }
+
+  std::vector< bench_case > selected;
+  for (std::size_t i = 0; i < sizeof (cases) / sizeof (*cases); ++i)
+    {
+      bool match = (optind == argc);
+      for (int j = optind; !match && j < argc; ++j)
+        match = (cases[i].chain == std::string (argv[j]));
+      if (match) selected.push_back (cases[i]);
+    }
+  for (int j = optind; j < argc; ++j)   // chains not in the table
+    {
+      bool known = false;
+      for (std::size_t i = 0; !known && i < selected.size (); ++i)
+        known = (selected[i].chain == std::string (argv[j]));
+      if (!known)
+        {
+          std::string first (argv[j]);
+          first = first.substr (0, first.find ('|'));
+          bench_case c = { argv[j], ("threshold" == first ? RAW_GRAY
+                                     : "g4fax" == first ? RAW_MONO
+                                     : "g3fax" == first ? PBM
+                                     : "jpeg-decompressor" == first ? JPEG
+                                     : "pdf" == first ? JPEG
+                                     : RAW_RGB) };
+          selected.push_back (c);
+        }
+    }
+
+  bool success = true;
+  for (std::size_t i = 0; i < selected.size (); ++i)
+    {
+      for (std::size_t j = 0; j < resolutions.size (); ++j)
+        {
+          success &= spawn (selected[i].chain, selected[i].input,
+                            resolutions[j], pages);
+        }
+      if (JPEG != selected[i].input || srcdir.empty ()) continue;
+
+      for (std::size_t j = 0; j < sizeof (samples) / sizeof (*samples); ++j)
+        {
+          success &= spawn (selected[i].chain, JPEG, 300, pages,
+                            srcdir + "/data/" + samples[j].name,
+                            samples[j].width, samples[j].height);
+        }
+    }
+
+  return (success ? EXIT_SUCCESS : EXIT_FAILURE);
+}
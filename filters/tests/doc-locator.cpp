@@ -0,0 +1,182 @@
+//  doc-locator.cpp -- unit tests for the doc_locator implementation
+//  Copyright (C) 2026  SEIKO EPSON CORPORATION
+//
+//  License: GPL-3.0+
+//  Author : EPSON AVASYS CORPORATION
+//
+//  This file is part of the 'Utsushi' package.
+//  This package is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License or, at
+//  your option, any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//  You ought to have received a copy of the GNU General Public License
+//  along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <boost/test/unit_test.hpp>
+
+#include <utsushi/device.hpp>
+#include <utsushi/format.hpp>
+#include <utsushi/test/memory.hpp>
+
+#include "../doc-locator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+using namespace utsushi;
+using _flt_::doc_locator;
+
+//!  Renders a page with lines of "text" on a mid-gray background
+/*!  The page is \a w by \a h pixels and rotated clockwise by \a angle
+ *   degrees about the image's center.
+ */
+std::vector< octet >
+scan (const context& ctx, double w, double h, double angle)
+{
+  const double c = std::cos (angle * M_PI / 180);
+  const double s = std::sin (angle * M_PI / 180);
+
+  std::vector< octet > rv;
+  for (streamsize y = 0; y < streamsize (ctx.height ()); ++y)
+    for (streamsize x = 0; x < streamsize (ctx.width ()); ++x)
+      {
+        double px = x - ctx.width ()  / 2.0;
+        double py = y - ctx.height () / 2.0;
+        double qx =  c * px + s * py;
+        double qy = -s * px + c * py;
+
+        octet o = 0x80;
+        if (std::fabs (qx) < w / 2 && std::fabs (qy) < h / 2)
+          {
+            o = octet (0xff);
+            if (std::fabs (qx) < w / 2 - 30 && std::fabs (qy) < h / 2 - 30
+                && 8 > int (qy + h) % 40)
+              o = 0x00;
+          }
+        rv.push_back (o);
+      }
+  return rv;
+}
+
+//!  Feeds \a raster to a \a locator in chunks of various sizes
+void
+feed (doc_locator& locator, const context& ctx,
+      const std::vector< octet >& raster)
+{
+  std::string header = (format ("P5 %1% %2% 255\n")
+                        % ctx.width () % ctx.height ()).str ();
+  locator.write (header.data (), header.size ());
+
+  for (std::size_t i = 0, n = 1; i < raster.size (); i += n, n = 2 * n + 1)
+    {
+      n = std::min (n, raster.size () - i);
+      locator.write (&raster[i], n);
+    }
+}
+
+struct fixture
+{
+  context ctx;
+
+  fixture ()
+    : ctx (800, 1000, context::GRAY8)
+  {
+    ctx.content_type ("image/x-portable-anymap");
+  }
+};
+
+BOOST_FIXTURE_TEST_SUITE (native_engine, fixture);
+
+BOOST_AUTO_TEST_CASE (supported_formats)
+{
+  BOOST_CHECK ( doc_locator::supports (context (8, 8, context::GRAY8)));
+  BOOST_CHECK ( doc_locator::supports (context (8, 8, context::RGB8)));
+  BOOST_CHECK (!doc_locator::supports (context (8, 8, context::MONO)));
+}
+
+BOOST_AUTO_TEST_CASE (level_document)
+{
+  doc_locator locator (ctx, 0.45, 0.55);
+  feed (locator, ctx, scan (ctx, 500, 700, 0));
+
+  context rv = locator.locate (doc_locator::CROP);
+
+  BOOST_CHECK_EQUAL (0, locator.skew_angle ());
+  BOOST_CHECK_CLOSE (500.0, double (rv.width ()) , 2.0);
+  BOOST_CHECK_CLOSE (700.0, double (rv.height ()), 2.0);
+}
+
+BOOST_AUTO_TEST_CASE (skewed_document)
+{
+  doc_locator locator (ctx, 0.45, 0.55);
+  feed (locator, ctx, scan (ctx, 500, 700, 3));
+
+  context rv = locator.locate (doc_locator::CROP);
+
+  BOOST_CHECK_CLOSE (3.0, locator.skew_angle (), 10.0);
+  BOOST_CHECK_CLOSE (500.0, double (rv.width ()) , 2.0);
+  BOOST_CHECK_CLOSE (700.0, double (rv.height ()), 2.0);
+
+  capture_odevice out;
+  locator.render (out);
+
+  std::string header = (format ("P5 %1% %2% 255\n")
+                        % rv.width () % rv.height ()).str ();
+  BOOST_REQUIRE_EQUAL (header.size () + rv.octets_per_image (),
+                       out.data.size ());
+  BOOST_CHECK (std::equal (header.begin (), header.end (),
+                           out.data.begin ()));
+}
+
+BOOST_AUTO_TEST_CASE (deskew_keeps_size)
+{
+  doc_locator locator (ctx, 0.45, 0.55);
+  feed (locator, ctx, scan (ctx, 500, 700, -2));
+
+  context rv = locator.locate (doc_locator::DESKEW);
+
+  BOOST_CHECK_CLOSE (-2.0, locator.skew_angle (), 10.0);
+  BOOST_CHECK_EQUAL (ctx.width (), rv.width ());
+  BOOST_CHECK_EQUAL (ctx.height (), rv.height ());
+}
+
+BOOST_AUTO_TEST_CASE (trim_borders)
+{
+  context ctx (60, 40, context::RGB8);
+  std::vector< octet > raster (ctx.octets_per_image (), octet (0xc8));
+
+  for (streamsize y = 5; y < 30; ++y)
+    for (streamsize x = 10; x < 50; ++x)
+      raster[y * ctx.octets_per_line () + x * 3 + 1] = x + y;
+
+  doc_locator locator (ctx, 0.45, 0.55);
+  locator.write (&raster[0], raster.size ());
+
+  context rv = locator.locate (doc_locator::TRIM);
+
+  BOOST_CHECK_EQUAL (40, rv.width ());
+  BOOST_CHECK_EQUAL (25, rv.height ());
+
+  capture_odevice out;
+  locator.render (out);
+
+  BOOST_REQUIRE_EQUAL (rv.octets_per_image (), out.data.size ());
+  BOOST_CHECK_EQUAL (10 + 5, out.data[1]);
+  BOOST_CHECK_EQUAL (49 + 29, out.data[out.data.size () - 2]);
+}
+
+BOOST_AUTO_TEST_SUITE_END ();
+
+#include "utsushi/test/runner.ipp"
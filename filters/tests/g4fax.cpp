@@ -0,0 +1,114 @@
+//  g4fax.cpp -- unit tests for the G4 facsimile filter implementation
+//  Copyright (C) 2026  SEIKO EPSON CORPORATION
+//
+//  License: GPL-3.0+
+//  Author : EPSON AVASYS CORPORATION
+//
+//  This file is part of the 'Utsushi' package.
+//  This package is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License or, at
+//  your option, any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//  You ought to have received a copy of the GNU General Public License
+//  along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <boost/test/unit_test.hpp>
+
+#include <utsushi/stream.hpp>
+#include <utsushi/test/memory.hpp>
+
+#include "../g3fax.hpp"
+
+#include <cstdlib>
+#include <vector>
+
+using namespace utsushi;
+using _flt_::g4fax;
+
+static std::vector< octet >
+encode (const context& ctx, const std::vector< octet >& in,
+        streamsize chunk)
+{
+  shared_ptr< capture_odevice > dev = make_shared< capture_odevice > ();
+
+  stream str;
+  str.push (make_shared< g4fax > ());
+  str.push (dev);
+
+  str.mark (traits::bos (), ctx);
+  str.mark (traits::boi (), ctx);
+  for (streamsize i = 0; i < streamsize (in.size ()); i += chunk)
+    {
+      str.write (&in[i], std::min (chunk, streamsize (in.size ()) - i));
+    }
+  str.mark (traits::eoi (), ctx);
+  str.mark (traits::eos (), ctx);
+
+  return dev->data;
+}
+
+BOOST_AUTO_TEST_CASE (all_white)
+{
+  octet i[] = {'P', '4', ' ', '8', ' ', '2', '\n',
+               octet(0x00), octet(0x00)};
+  octet o[] = {octet(0xc0), octet(0x04), octet(0x00), octet(0x40)};
+
+  context ctx (8, 2, context::MONO);
+  ctx.content_type ("image/x-portable-bitmap");
+
+  std::vector< octet > in (i, i + sizeof (i));
+  std::vector< octet > out (encode (ctx, in, in.size ()));
+
+  BOOST_CHECK_EQUAL_COLLECTIONS (o, o + sizeof (o),
+                                 out.begin (), out.end ());
+}
+
+//  Exercises vertical, pass and horizontal modes.  The expected data
+//  has been checked against libtiff's G4 decoder.
+BOOST_AUTO_TEST_CASE (all_modes)
+{
+  octet i[] = {octet(0xf0), octet(0xff),
+               octet(0xf8), octet(0x0f),
+               octet(0x0f), octet(0xf0)};
+  octet o[] = {octet(0x36), octet(0xec), octet(0x8e), octet(0xc9),
+               octet(0xab), octet(0x33), octet(0x60), octet(0x02),
+               octet(0x00), octet(0x20)};
+
+  context ctx (16, 3, context::MONO);
+  ctx.content_type ("image/x-raster");
+
+  std::vector< octet > in (i, i + sizeof (i));
+  std::vector< octet > out (encode (ctx, in, in.size ()));
+
+  BOOST_CHECK_EQUAL_COLLECTIONS (o, o + sizeof (o),
+                                 out.begin (), out.end ());
+}
+
+BOOST_AUTO_TEST_CASE (odd_width_in_odd_chunks)
+{
+  context ctx (1235, 17, context::MONO);
+  ctx.content_type ("image/x-raster");
+
+  std::vector< octet > in (ctx.octets_per_image ());
+  std::srand (42);
+  for (std::size_t i = 0; i < in.size (); ++i)
+    in[i] = (std::rand () % 4 ? octet (0xff) : octet (std::rand ()));
+
+  std::vector< octet > whole (encode (ctx, in, in.size ()));
+  std::vector< octet > parts (encode (ctx, in, 7));
+
+  BOOST_CHECK_EQUAL_COLLECTIONS (whole.begin (), whole.end (),
+                                 parts.begin (), parts.end ());
+}
+
+#include "utsushi/test/runner.ipp"
@@ -33,6 +33,9 @@
 
 #include <boost/filesystem.hpp>
 
+#include <cstdlib>
+#include <vector>
+
 namespace fs = boost::filesystem;
 
 using namespace utsushi;
@@ -85,4 +88,132 @@ BOOST_AUTO_TEST_CASE (keep_all_black)
   if (fs::exists ("skip001.pnm")) remove ("skip001.pnm");
 }
 
+struct page_fixture
+{
+  context ctx;
+  std::vector< octet > page;
+  shared_ptr< image_skip > flt;
+  shared_ptr< capture_odevice > dev;
+  stream str;
+
+  page_fixture ()
+    : ctx (100, 100, context::GRAY8)
+    , page (ctx.octets_per_image (), octet (0xff))
+    , flt (make_shared< image_skip > ())
+    , dev (make_shared< capture_odevice > ())
+  {
+    str.push (flt);
+    str.push (dev);
+  }
+
+  //! Darkens a \a w by \a h area at \a x, \a y
+  void smudge (streamsize x, streamsize y, streamsize w, streamsize h)
+  {
+    for (streamsize i = y; i < y + h; ++i)
+      for (streamsize j = x; j < x + w; ++j)
+        page[i * ctx.octets_per_line () + j] = 0x00;
+  }
+
+  void scan ()
+  {
+    str.mark (traits::bos (), ctx);
+    str.mark (traits::boi (), ctx);
+    str.write (&page[0], page.size ());
+    str.mark (traits::eoi (), ctx);
+    str.mark (traits::eos (), ctx);
+  }
+};
+
+BOOST_FIXTURE_TEST_SUITE (area_of_interest, page_fixture);
+
+BOOST_AUTO_TEST_CASE (ignore_margin)
+{
+  smudge (0, 0, 3, 100);        // shaded left edge, 3% of the page
+  (*flt->options ())["blank-threshold"] = quantity (1.);
+
+  scan ();
+  BOOST_CHECK_EQUAL (1, dev->images);
+
+  (*flt->options ())["blank-margin"] = quantity (5.);
+  dev->images = 0;
+
+  scan ();
+  BOOST_CHECK_EQUAL (0, dev->images);
+}
+
+BOOST_AUTO_TEST_CASE (find_page_number)
+{
+  smudge (48, 92, 4, 4);        // 0.16% of the page
+  (*flt->options ())["blank-threshold"] = quantity (1.);
+
+  scan ();
+  BOOST_CHECK_EQUAL (0, dev->images);
+
+  (*flt->options ())["blank-tiles"] = quantity (4);
+
+  scan ();
+  BOOST_CHECK_EQUAL (1, dev->images);
+  BOOST_CHECK_EQUAL (page.size (), dev->data.size ());
+}
+
+BOOST_AUTO_TEST_CASE (pass_on_early)
+{
+  smudge (0, 0, 100, 10);
+  (*flt->options ())["blank-threshold"] = quantity (5.);
+
+  flt->open (dev);              // no buffering in between
+  flt->mark (traits::bos (), ctx);
+  flt->mark (traits::boi (), ctx);
+
+  streamsize half = page.size () / 2;
+  flt->write (&page[0], half);
+  BOOST_CHECK_EQUAL (half, dev->data.size ());
+
+  flt->write (&page[half], page.size () - half);
+  BOOST_CHECK_EQUAL (page.size (), dev->data.size ());
+
+  flt->mark (traits::eoi (), ctx);
+  flt->mark (traits::eos (), ctx);
+  BOOST_CHECK_EQUAL (1, dev->images);
+  BOOST_CHECK (page == dev->data);
+}
+
+BOOST_AUTO_TEST_SUITE_END ();
+
+//! Exposes the sum_function kernels
+struct kernels
+  : public image_skip
+{
+  using image_skip::sum_function;
+  using image_skip::sum_functions;
+};
+
+BOOST_AUTO_TEST_CASE (kernels_match_scalar)
+{
+  const std::vector< kernels::sum_function > sum
+    (kernels::sum_functions ());
+  const kernels::sum_function scalar = sum.back ();
+
+  BOOST_TEST_MESSAGE ("checking " << sum.size () - 1 << " SIMD kernels");
+
+  const streamsize max_n = 3 * 32 + 31;
+  std::vector< octet > in (max_n);
+  std::srand (42);
+  for (std::size_t i = 0; i < in.size (); ++i)
+    in[i] = std::rand () % 256;
+
+  // All white is the most common input and gives the largest sums.
+
+  std::vector< octet > white (1 << 20, octet (0xff));
+
+  for (std::size_t k = 0; k + 1 < sum.size (); ++k)
+    {
+      for (streamsize n = 0; n <= max_n; ++n)
+        BOOST_REQUIRE_EQUAL (scalar (&in[0], n), sum[k] (&in[0], n));
+
+      BOOST_CHECK_EQUAL (scalar (&white[0], white.size ()),
+                         sum[k] (&white[0], white.size ()));
+    }
+}
+
 #include "utsushi/test/runner.ipp"
@@ -0,0 +1,180 @@
+//  image-transform.cpp -- unit tests for the image_transform implementation
+//  Copyright (C) 2026  SEIKO EPSON CORPORATION
+//
+//  License: GPL-3.0+
+//  Author : EPSON AVASYS CORPORATION
+//
+//  This file is part of the 'Utsushi' package.
+//  This package is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License or, at
+//  your option, any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//  You ought to have received a copy of the GNU General Public License
+//  along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <boost/test/unit_test.hpp>
+
+#include <utsushi/device.hpp>
+#include <utsushi/test/memory.hpp>
+
+#include "../image-transform.hpp"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace utsushi;
+using _flt_::image_transform;
+
+//!  Writes \a raster to a \a transform one octet at a time
+void
+feed (image_transform& transform, const std::vector< octet >& raster,
+      output& out)
+{
+  for (std::size_t i = 0; i < raster.size (); ++i)
+    transform.write (&raster[i], 1, out);
+  transform.finish (out);
+}
+
+BOOST_AUTO_TEST_CASE (supported_formats)
+{
+  context pnm (8, 8, context::GRAY8);
+  pnm.content_type ("image/x-portable-anymap");
+
+  BOOST_CHECK ( image_transform::supports (context (8, 8, context::GRAY8)));
+  BOOST_CHECK ( image_transform::supports (context (8, 8, context::RGB8)));
+  BOOST_CHECK ( image_transform::supports (pnm));
+  BOOST_CHECK (!image_transform::supports (context (8, 8, context::MONO)));
+  BOOST_CHECK (!image_transform::supports (context (8, context::unknown_size,
+                                                    context::GRAY8)));
+}
+
+BOOST_AUTO_TEST_CASE (area_average)
+{
+  context ctx (4, 2, context::GRAY8);
+  const char raster[] = { 0, 20, 40, 60, 100, 120, 10, 30 };
+
+  image_transform transform (ctx);
+  transform.scale (2, 1);
+
+  capture_odevice out;
+  feed (transform, std::vector< octet > (raster, raster + 8), out);
+
+  BOOST_CHECK_EQUAL (2, transform.get_context ().width ());
+  BOOST_CHECK_EQUAL (1, transform.get_context ().height ());
+  BOOST_REQUIRE_EQUAL (2, out.data.size ());
+  BOOST_CHECK_EQUAL (60, out.at (0));
+  BOOST_CHECK_EQUAL (35, out.at (1));
+}
+
+BOOST_AUTO_TEST_CASE (extent_pads_with_white)
+{
+  context ctx (2, 2, context::GRAY8);
+
+  image_transform transform (ctx);
+  transform.extent (3, 3);
+
+  capture_odevice out;
+  feed (transform, std::vector< octet > (4, 0), out);
+
+  BOOST_REQUIRE_EQUAL (9, out.data.size ());
+  BOOST_CHECK_EQUAL (  0, out.at (0));
+  BOOST_CHECK_EQUAL (255, out.at (2));
+  BOOST_CHECK_EQUAL (  0, out.at (4));
+  BOOST_CHECK_EQUAL (255, out.at (6));
+  BOOST_CHECK_EQUAL (255, out.at (8));
+}
+
+BOOST_AUTO_TEST_CASE (levels)
+{
+  context ctx (2, 1, context::RGB8);
+  const char raster[] = { 10, 20, 30, 100, 110, 120 };
+
+  image_transform transform (ctx);
+  transform.levels (2, 0.1);
+
+  capture_odevice out;
+  feed (transform, std::vector< octet > (raster, raster + 6), out);
+
+  BOOST_REQUIRE_EQUAL (6, out.data.size ());
+  BOOST_CHECK_EQUAL ( 46, out.at (0));
+  BOOST_CHECK_EQUAL ( 86, out.at (2));
+  BOOST_CHECK_EQUAL (226, out.at (3));
+  BOOST_CHECK_EQUAL (255, out.at (5));
+}
+
+BOOST_AUTO_TEST_CASE (threshold)
+{
+  context ctx (10, 1, context::GRAY8);
+  const unsigned char raster[] = { 0, 255, 200, 50, 127, 128,
+                                   255, 0, 255, 0 };
+
+  image_transform transform (ctx);
+  transform.threshold (50);
+
+  capture_odevice out;
+  feed (transform, std::vector< octet > (raster, raster + 10), out);
+
+  BOOST_CHECK_EQUAL (1, transform.get_context ().depth ());
+  BOOST_REQUIRE_EQUAL (2, out.data.size ());
+  BOOST_CHECK_EQUAL (0x66, out.at (0));
+  BOOST_CHECK_EQUAL (0x80, out.at (1));
+}
+
+BOOST_AUTO_TEST_CASE (rotate_clockwise)
+{
+  context ctx (3, 2, context::GRAY8);
+  ctx.orientation (context::right_top);
+  const char raster[] = { 1, 2, 3, 4, 5, 6 };
+
+  image_transform transform (ctx);
+  transform.auto_orient ();
+
+  context rv = transform.get_context ();
+  BOOST_CHECK_EQUAL (2, rv.width ());
+  BOOST_CHECK_EQUAL (3, rv.height ());
+  BOOST_CHECK_EQUAL (context::top_left, rv.orientation ());
+
+  capture_odevice out;
+  feed (transform, std::vector< octet > (raster, raster + 6), out);
+
+  const char expected[] = { 4, 1, 5, 2, 6, 3 };
+  BOOST_CHECK_EQUAL_COLLECTIONS (expected, expected + 6,
+                                 out.data.begin (), out.data.end ());
+}
+
+BOOST_AUTO_TEST_CASE (pnm_in_pbm_out)
+{
+  context ctx (3, 1, context::GRAY8);
+  ctx.content_type ("image/x-portable-anymap");
+
+  std::string pnm ("P5\n# comment\n3 1\n255\n");
+  pnm += char (0x00);
+  pnm += char (0xff);
+  pnm += char (0x00);
+
+  image_transform transform (ctx);
+  transform.threshold (50);
+  transform.content_type ("image/x-portable-bitmap");
+
+  capture_odevice out;
+  feed (transform, std::vector< octet > (pnm.begin (), pnm.end ()), out);
+
+  const std::string header ("P4 3 1\n");
+  BOOST_REQUIRE_EQUAL (header.size () + 1, out.data.size ());
+  BOOST_CHECK (std::equal (header.begin (), header.end (),
+                           out.data.begin ()));
+  BOOST_CHECK_EQUAL (0xbf, out.at (header.size ()));
+}
+
+#include "utsushi/test/runner.ipp"
@@ -40,6 +40,12 @@
 
 #include <boost/filesystem.hpp>
 
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <string>
+
 namespace fs = boost::filesystem;
 
 using namespace utsushi;
@@ -89,4 +95,100 @@ BOOST_FIXTURE_TEST_CASE (test_magic, fixture)
 #endif  /* HAVE_LIBMAGIC */
 }
 
+//! Returns the number that follows \a key in \a s, starting at \a pos
+static std::size_t
+number_after (const std::string& s, const std::string& key,
+              std::string::size_type pos = 0)
+{
+  pos = s.find (key, pos);
+  BOOST_REQUIRE (std::string::npos != pos);
+
+  std::istringstream is (s.substr (pos + key.size (), 32));
+  std::size_t rv;
+  is >> rv;
+  BOOST_REQUIRE (!is.fail ());
+  return rv;
+}
+
+BOOST_FIXTURE_TEST_CASE (test_structure, fixture)
+{
+  context ctx (32, 48);
+  shared_ptr<setmem_idevice::generator> gen
+    = make_shared< const_generator > (0x50);
+
+  setmem_idevice dev (gen, ctx, 3);
+  idevice& idev (dev);
+
+  stream str;
+  str.push (make_shared< jpeg::compressor > ());
+  str.push (make_shared< pdf > ());
+  str.push (make_shared< file_odevice > (name_));
+
+  idev | str;
+
+  std::ifstream ifs (name_.c_str (), std::ios_base::binary);
+  std::string doc ((std::istreambuf_iterator< char > (ifs)),
+                   std::istreambuf_iterator< char > ());
+
+  BOOST_REQUIRE_EQUAL (0, doc.find ("%PDF-"));
+
+  // Collect the object offsets from every cross-reference section.
+  // Each trailer's startxref has to point at its section.
+
+  std::map< std::size_t, std::size_t > offsets;
+  std::string::size_type pos = 0;
+  while (std::string::npos != (pos = doc.find ("startxref\n", pos)))
+    {
+      std::size_t xref = number_after (doc, "startxref\n", pos);
+      BOOST_REQUIRE_EQUAL (0, doc.compare (xref, 5, "xref\n"));
+
+      std::istringstream is (doc.substr (xref + 5));
+      std::size_t first, count;
+      while (is >> first >> count)
+        {
+          for (std::size_t i = 0; i < count; ++i)
+            {
+              std::size_t offset, generation;
+              char type;
+              BOOST_REQUIRE (is >> offset >> generation >> type);
+              if ('n' == type) offsets[first + i] = offset;
+            }
+        }
+      pos += 10;
+    }
+  BOOST_REQUIRE (!offsets.empty ());
+
+  std::size_t streams = 0;
+  std::map< std::size_t, std::size_t >::const_iterator it;
+  for (it = offsets.begin (); offsets.end () != it; ++it)
+    {
+      std::ostringstream header;
+      header << it->first << " 0 obj\n";
+      BOOST_CHECK_MESSAGE
+        (0 == doc.compare (it->second, header.str ().size (), header.str ()),
+         "xref entry for object " << it->first << " is off");
+
+      // Only look at the object's dictionary, never at stream data
+
+      std::string::size_type end = doc.find ("endobj\n", it->second);
+      std::string::size_type beg = doc.find (">>\nstream\n", it->second);
+      if (std::string::npos == beg || end < beg) continue;
+
+      std::size_t length_obj = number_after (doc, "/Length ", it->second);
+      BOOST_REQUIRE (offsets.count (length_obj));
+
+      std::ostringstream length_header;
+      length_header << length_obj << " 0 obj\n";
+      std::size_t length = number_after (doc, length_header.str (),
+                                         offsets[length_obj]);
+
+      beg += 10;
+      BOOST_CHECK_MESSAGE
+        (0 == doc.compare (beg + length, 11, "\nendstream\n"),
+         "/Length of object " << it->first << " is off");
+      ++streams;
+    }
+  BOOST_CHECK_LE (3, streams);
+}
+
 #include "utsushi/test/runner.ipp"
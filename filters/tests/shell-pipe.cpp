@@ -38,6 +38,7 @@
 #include <boost/test/unit_test.hpp>
 
 #include <csignal>
+#include <fstream>
 #include <list>
 #include <string>
 #include <utility>
@@ -60,6 +61,30 @@ public:
   {}
 };
 
+//!  Echoes framed image data using a single process per sequence
+/*!  The process records its PID so tests can count the processes.
+ */
+class framed_pipe
+  : public _flt_::shell_pipe
+{
+public:
+  framed_pipe ()
+    : _flt_::shell_pipe
+      ("echo $$ >> framed.pid;"
+       " while h=$(dd bs=1 count=4 2>/dev/null | od -An -tu1);"
+       " test -n \"$h\"; do"
+       " set -- $h;"
+       " printf \"\\\\$(printf %o $1)\\\\$(printf %o $2)"
+       "\\\\$(printf %o $3)\\\\$(printf %o $4)\";"
+       " dd bs=1 count=$(( ($1 << 24) + ($2 << 16) + ($3 << 8) + $4 ))"
+       " 2>/dev/null;"
+       " done")
+  {}
+
+protected:
+  bool is_persistent () const { return true; }
+};
+
 void
 test_throughput (const std::pair< streamsize, unsigned >& args)
 {
@@ -113,6 +138,40 @@ test_chaining (int length)
   fs::remove (file);
 }
 
+BOOST_AUTO_TEST_CASE (persistent_process)
+{
+  const streamsize octet_count (3000);
+  const unsigned   image_count (3);
+
+  rawmem_idevice dev (octet_count, image_count);
+  idevice& idev (dev);
+
+  stream str;
+  str.push (make_shared< framed_pipe > ());
+  str.push (make_shared< file_odevice >
+             (path_generator ("persistent-%3i.out")));
+
+  BOOST_CHECK_EQUAL (traits::eos (), idev | str);
+
+  for (unsigned i = 0; i < image_count; ++i)
+    {
+      format fmt ("persistent-%|03|.out");
+      std::string file ((fmt % i).str ());
+
+      BOOST_CHECK (fs::exists (file));
+      BOOST_CHECK_EQUAL (fs::file_size (file), octet_count);
+      fs::remove (file);
+    }
+
+  std::ifstream pids ("framed.pid");
+  std::string line;
+  unsigned process_count = 0;
+  while (std::getline (pids, line)) ++process_count;
+
+  BOOST_CHECK_EQUAL (1, process_count);
+  fs::remove ("framed.pid");
+}
+
 bool
 init_test_runner ()
 {
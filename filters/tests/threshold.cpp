@@ -33,6 +33,10 @@
 
 #include <boost/filesystem.hpp>
 
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
 namespace fs = boost::filesystem;
 
 using namespace utsushi;
@@ -76,4 +80,100 @@ BOOST_FIXTURE_TEST_CASE (gray_to_binary, fixture)
   delete [] buf;
 }
 
+BOOST_AUTO_TEST_CASE (clone_keeps_options)
+{
+  threshold prototype;
+  (*prototype.options ())["threshold"] = quantity (64);
+
+  filter::ptr copy = prototype.clone ();
+  BOOST_REQUIRE (copy);
+  BOOST_CHECK (value (quantity (64)) == (*copy->options ())["threshold"]);
+}
+
+BOOST_AUTO_TEST_CASE (odd_width_in_odd_chunks)
+{
+  const streamsize width = 93;
+  const streamsize height = 23;
+  const unsigned char t = 100;
+
+  context ctx (width, height, context::GRAY8);
+  std::vector< octet > in (ctx.octets_per_image ());
+  std::srand (42);
+  for (std::size_t i = 0; i < in.size (); ++i)
+    in[i] = std::rand () % 256;
+
+  const streamsize out_line = (width + 7) / 8;
+  std::vector< octet > expected (out_line * height, 0);
+  for (streamsize y = 0; y < height; ++y)
+    for (streamsize x = 0; x < width; ++x)
+      if (t <= static_cast< unsigned char > (in[y * width + x]))
+        expected[y * out_line + x / 8] |= 0x80 >> (x % 8);
+
+  shared_ptr< threshold > flt = make_shared< threshold > ();
+  (*flt->options ())["threshold"] = quantity (t);
+  shared_ptr< capture_odevice > dev = make_shared< capture_odevice > ();
+
+  stream str;
+  str.push (flt);
+  str.push (dev);
+
+  str.mark (traits::bos (), ctx);
+  str.mark (traits::boi (), ctx);
+  for (streamsize i = 0, n = 1; i < streamsize (in.size ()); i += n, n += 6)
+    {
+      n = std::min (n, streamsize (in.size ()) - i);
+      str.write (&in[i], n);
+    }
+  str.mark (traits::eoi (), ctx);
+  str.mark (traits::eos (), ctx);
+
+  BOOST_CHECK_EQUAL_COLLECTIONS (expected.begin (), expected.end (),
+                                 dev->data.begin (), dev->data.end ());
+}
+
+//! Exposes the pack_function kernels
+struct kernels
+  : public threshold
+{
+  using threshold::pack_function;
+  using threshold::pack_functions;
+};
+
+BOOST_AUTO_TEST_CASE (kernels_match_scalar)
+{
+  const std::vector< kernels::pack_function > pack
+    (kernels::pack_functions ());
+  const kernels::pack_function scalar = pack.back ();
+
+  BOOST_TEST_MESSAGE ("checking " << pack.size () - 1 << " SIMD kernels");
+
+  // Cover a few full vectors of pixels followed by every possible
+  // remainder, including none at all.
+
+  const streamsize max_n = 3 * 32 + 31;
+  std::vector< octet > in (max_n);
+  std::srand (42);
+  for (std::size_t i = 0; i < in.size (); ++i)
+    in[i] = std::rand () % 256;
+
+  const unsigned char thresholds[] = { 0, 1, 127, 128, 254, 255 };
+  const std::size_t guard = 8;
+
+  for (std::size_t k = 0; k + 1 < pack.size (); ++k)
+    for (std::size_t t = 0; t < sizeof (thresholds); ++t)
+      for (streamsize n = 0; n <= max_n; ++n)
+        {
+          std::vector< octet > expected ((n + 7) / 8 + guard, 0x5a);
+          std::vector< octet > actual (expected);
+
+          scalar  (&in[0], &expected[0], n, thresholds[t]);
+          pack[k] (&in[0], &actual[0], n, thresholds[t]);
+
+          BOOST_REQUIRE_MESSAGE (expected == actual,
+                                 "kernel " << k << " differs for "
+                                 << n << " pixels at threshold "
+                                 << int (thresholds[t]));
+        }
+}
+
 #include "utsushi/test/runner.ipp"
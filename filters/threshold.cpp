@@ -22,22 +22,157 @@
 #include <config.h>
 #endif
 
+#include <algorithm>
+#include <cstring>
 #include <stdexcept>
 
 #include <boost/throw_exception.hpp>
 
 #include <utsushi/i18n.hpp>
+#include <utsushi/log.hpp>
 #include <utsushi/range.hpp>
 
+#include "simd.hpp"
 #include "threshold.hpp"
 
 namespace utsushi {
 namespace _flt_ {
 
 using std::invalid_argument;
-using std::logic_error;
+
+namespace {
+
+//! Amount of packed image data to collect before passing it on
+const streamsize batch_size = 64 * 1024;
+
+void
+pack_scalar (const octet *in, octet *out, streamsize n,
+             unsigned char threshold)
+{
+  const uint8_t *p = reinterpret_cast< const uint8_t * > (in);
+  streamsize i = 0;
+
+  for (; i + 8 <= n; i += 8)
+    {
+      uint8_t o = 0;
+      for (int b = 0; b < 8; ++b)
+        o = (o << 1) | (p[i + b] >= threshold);
+      *out++ = o;
+    }
+
+  if (i < n)
+    {
+      uint8_t o = 0;
+      for (int b = 7; i < n; ++i, --b)
+        o |= (p[i] >= threshold) << b;
+      *out = o;
+    }
+}
+
+#if FILTERS_USE_X86_KERNELS
+
+__attribute__ ((target ("sse2")))
+void
+pack_sse2 (const octet *in, octet *out, streamsize n,
+           unsigned char threshold)
+{
+  const __m128i t = _mm_set1_epi8 (threshold);
+  streamsize i = 0;
+
+  for (; i + 16 <= n; i += 16)
+    {
+      __m128i x = _mm_loadu_si128 (reinterpret_cast< const __m128i * >
+                                   (in + i));
+      __m128i ge = _mm_cmpeq_epi8 (_mm_max_epu8 (x, t), x);
+      unsigned m = _mm_movemask_epi8 (ge);
+
+      // The mask has the leftmost pixel in the least significant bit
+      // of each octet.  Reverse the bits in both octets in one go.
+
+      m = ((m & 0xf0f0) >> 4) | ((m & 0x0f0f) << 4);
+      m = ((m & 0xcccc) >> 2) | ((m & 0x3333) << 2);
+      m = ((m & 0xaaaa) >> 1) | ((m & 0x5555) << 1);
+
+      *out++ = m & 0xff;
+      *out++ = m >> 8;
+    }
+  pack_scalar (in + i, out, n - i, threshold);
+}
+
+__attribute__ ((target ("avx2")))
+void
+pack_avx2 (const octet *in, octet *out, streamsize n,
+           unsigned char threshold)
+{
+  const __m256i t = _mm256_set1_epi8 (threshold);
+  const __m256i reverse = _mm256_setr_epi8 ( 7,  6,  5,  4,  3,  2,  1,  0,
+                                            15, 14, 13, 12, 11, 10,  9,  8,
+                                             7,  6,  5,  4,  3,  2,  1,  0,
+                                            15, 14, 13, 12, 11, 10,  9,  8);
+  streamsize i = 0;
+
+  for (; i + 32 <= n; i += 32)
+    {
+      __m256i x = _mm256_loadu_si256 (reinterpret_cast< const __m256i * >
+                                      (in + i));
+      __m256i ge = _mm256_cmpeq_epi8 (_mm256_max_epu8 (x, t), x);
+
+      // Put the leftmost pixel of every eight in the most significant
+      // bit of the corresponding mask octet.
+
+      ge = _mm256_shuffle_epi8 (ge, reverse);
+      uint32_t m = _mm256_movemask_epi8 (ge);
+
+      std::memcpy (out, &m, sizeof (m)); // x86 is little endian
+      out += sizeof (m);
+    }
+  pack_sse2 (in + i, out, n - i, threshold);
+}
+
+#endif  /* FILTERS_USE_X86_KERNELS */
+
+#if FILTERS_USE_NEON_KERNEL
+
+void
+pack_neon (const octet *in, octet *out, streamsize n,
+           unsigned char threshold)
+{
+  static const uint8_t weight[16] = {
+    128, 64, 32, 16, 8, 4, 2, 1,
+    128, 64, 32, 16, 8, 4, 2, 1,
+  };
+  const uint8x16_t t = vdupq_n_u8 (threshold);
+  const uint8x16_t w = vld1q_u8 (weight);
+  streamsize i = 0;
+
+  for (; i + 16 <= n; i += 16)
+    {
+      uint8x16_t x = vld1q_u8 (reinterpret_cast< const uint8_t * >
+                               (in + i));
+      uint8x16_t b = vandq_u8 (vcgeq_u8 (x, t), w);
+
+      // Add up the weighted bits of each group of eight pixels
+
+      uint8x8_t s = vpadd_u8 (vget_low_u8 (b), vget_high_u8 (b));
+      s = vpadd_u8 (s, s);
+      s = vpadd_u8 (s, s);
+
+      *out++ = vget_lane_u8 (s, 0);
+      *out++ = vget_lane_u8 (s, 1);
+    }
+  pack_scalar (in + i, out, n - i, threshold);
+}
+
+#endif  /* FILTERS_USE_NEON_KERNEL */
+
+}       // namespace
 
 threshold::threshold ()
+  : threshold_(128)
+  , in_line_(0)
+  , out_line_(0)
+  , out_fill_(0)
+  , pack_(pack_functions ().front ())
 {
   option_->add_options ()
     ("threshold", (from< range > ()
@@ -50,25 +185,42 @@ threshold::threshold ()
      );
 }
 
+filter::ptr
+threshold::clone () const
+{
+  return clone_< threshold > ();
+}
+
 streamsize
 threshold::write (const octet *data, streamsize n)
 {
-  octet *out = new octet[n];
-  streamsize gray_count = 0;
-  streamsize mono_count = 0;
-  streamsize rv = 0;
-  quantity v = value ((*option_)["threshold"]);
-  gray_count = filter (data, out, n, ctx_.width (),
-                       v.amount< unsigned char > ());
-
-  // assumption: scanlines = 1
-  mono_count = gray_count / 8 + (gray_count % 8 ? 1 : 0);       // ceil()
-  rv = output_->write (out, mono_count);
-
-  delete [] out;
-
-  if (rv < mono_count) return rv * 8; // assumption: scanlines = 1
-  return gray_count;
+  const streamsize rv = n;
+
+  if (0 >= in_line_) return rv;
+
+  if (!carry_.empty ())
+    {
+      streamsize m = std::min (n, in_line_ - streamsize (carry_.size ()));
+
+      carry_.insert (carry_.end (), data, data + m);
+      data += m;
+      n    -= m;
+
+      if (streamsize (carry_.size ()) < in_line_) return rv;
+
+      pack_lines_(&carry_[0], 1);
+      carry_.clear ();
+    }
+
+  streamsize lines = n / in_line_;
+
+  pack_lines_(data, lines);
+  data += lines * in_line_;
+  n    -= lines * in_line_;
+
+  carry_.assign (data, data + n);
+
+  return rv;
 }
 
 void
@@ -86,47 +238,78 @@ threshold::boi (const context& ctx)
 
   ctx_ = ctx;
   ctx_.depth (1);
+
+  quantity q = value ((*option_)["threshold"]);
+  threshold_ = q.amount< unsigned char > ();
+
+  in_line_  = ctx.octets_per_line ();
+  out_line_ = ctx_.octets_per_line ();
+
+  carry_.clear ();
+  carry_.reserve (in_line_);
+  out_.resize (std::max< streamsize > (1, batch_size / std::max< streamsize >
+                                       (1, out_line_)) * out_line_);
+  out_fill_ = 0;
 }
 
 void
-threshold::set_bit (octet *data, streamsize bit_index, bool is_below)
+threshold::eoi (const context& ctx)
 {
-  streamsize toctet = bit_index / 8;         // target octet
-  streamsize tbit   = 7 - (bit_index % 8);   // target bit
+  if (!carry_.empty ())
+    {
+      log::error ("threshold: dropping incomplete scanline (%1% octets)")
+        % carry_.size ();
+      carry_.clear ();
+    }
+  flush_();
+}
 
-  if (is_below) {
-    data[toctet] &= ~(1 << tbit);
-  } else {
-    data[toctet] |=  (1 << tbit);
-  }
+std::vector< threshold::pack_function >
+threshold::pack_functions ()
+{
+  simd_kernels< pack_function > k (pack_scalar);
+
+#if FILTERS_USE_X86_KERNELS
+  k.sse2 = pack_sse2;
+  k.avx2 = pack_avx2;
+#endif
+#if FILTERS_USE_NEON_KERNEL
+  k.neon = pack_neon;
+#endif
+
+  return k.supported ();
 }
 
-//! Returns the number of pixels consumed from the input
-streamsize
-threshold::filter (const octet *in_data,
-                   octet *out_data,
-                   streamsize n,            // size of data buffers
-                   streamsize ppl,          // pixels per line
-                   unsigned char threshold)
+//! Packs complete scanlines into the output buffer
+/*! The output buffer is passed on whenever it cannot hold another
+ *  scanline.
+ */
+void
+threshold::pack_lines_(const octet *data, streamsize lines)
 {
-  if (0 == n) return 0;
-  if (0 == ppl) return 0;
-  if (ppl > n)
-    BOOST_THROW_EXCEPTION
-      (logic_error ("not enough data to generate a line of output"));
+  const streamsize pixels = ctx_.width ();
 
-  //! \todo fix processing more than a single scanline at a time
-  streamsize lines = 1;
-  streamsize pad = 8 - ppl%8;
+  for (streamsize i = 0; i < lines; ++i)
+    {
+      if (streamsize (out_.size ()) < out_fill_ + out_line_) flush_();
 
-  for (streamsize v=0; v<lines; ++v) {
-    for (streamsize h=0; h<ppl; ++h) {
-      set_bit (out_data, v*(ppl+pad) + h,
-               (unsigned char)in_data[v*ppl + h] < threshold);
+      pack_(data, &out_[out_fill_], pixels, threshold_);
+      out_fill_ += out_line_;
+      data += in_line_;
     }
-  }
+}
 
-  return lines*ppl;
+void
+threshold::flush_()
+{
+  const octet *p = &out_[0];
+
+  while (0 < out_fill_)
+    {
+      streamsize m = output_->write (p, out_fill_);
+      p         += m;
+      out_fill_ -= m;
+    }
 }
 
 }       // namespace _flt_
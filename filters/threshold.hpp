@@ -21,6 +21,8 @@
 #ifndef filters_threshold_hpp_
 #define filters_threshold_hpp_
 
+#include <vector>
+
 #include <utsushi/cstdint.hpp>
 #include <utsushi/filter.hpp>
 
@@ -30,6 +32,11 @@ namespace _flt_ {
 /*! Set all pixel component samples below a certain value to their
  *  minimum value and all other samples to their maximum.
  *
+ *  Image data may arrive in chunks of any size.  Incomplete scanlines
+ *  are carried over to the next write().  Complete scanlines are
+ *  packed eight pixels to an octet, using SIMD instructions where the
+ *  CPU supports them, and passed on as large a batch as possible.
+ *
  *  \todo  Generalize to support an arbitrary number of components
  *  \todo  Generalize to support component depths other than eight
  */
@@ -39,19 +46,41 @@ class threshold
 public:
   threshold ();
 
+  filter::ptr clone () const;
+
   streamsize write (const octet *data, streamsize n);
 
 protected:
   void boi (const context& ctx);
+  void eoi (const context& ctx);
+
+  //! Converts a scanline of \a n pixels to one bit per pixel
+  /*! Pixels at or above the \a threshold become ones, anything below
+   *  becomes a zero.  The most significant bit of each output octet
+   *  corresponds to the leftmost pixel.  Unused bits in the last \a
+   *  out octet are cleared.
+   */
+  typedef void (*pack_function) (const octet *in, octet *out,
+                                 streamsize n, unsigned char threshold);
+
+  //! Lists the pack_function kernels the CPU we run on supports
+  /*! The fastest comes first, the scalar reference kernel last.
+   */
+  static std::vector< pack_function > pack_functions ();
+
+  void pack_lines_(const octet *data, streamsize lines);
+  void flush_();
 
   unsigned char threshold_;
 
-  static streamsize
-  filter (const octet *in_data, octet *out_data, streamsize n,
-          streamsize ppl, unsigned char threshold);
+  streamsize in_line_;          //!< octets per input scanline
+  streamsize out_line_;         //!< octets per output scanline
+
+  std::vector< octet > carry_;  //!< incomplete input scanline
+  std::vector< octet > out_;    //!< packed scanlines to be passed on
+  streamsize out_fill_;
 
-  static void
-  set_bit (octet *data, streamsize bit_index, bool is_below);
+  pack_function pack_;
 };
 
 }       // namespace _flt_
@@ -0,0 +1,51 @@
+//  clock.cpp -- monotonic time keeping and sleeping
+//  Copyright (C) 2026  SEIKO EPSON CORPORATION
+//
+//  License: GPL-3.0+
+//  Author : EPSON AVASYS CORPORATION
+//
+//  This file is part of the 'Utsushi' package.
+//  This package is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License or, at
+//  your option, any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//  You ought to have received a copy of the GNU General Public License
+//  along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <time.h>
+
+#include <cerrno>
+
+#include "utsushi/clock.hpp"
+
+namespace utsushi {
+
+uint64_t
+microseconds ()
+{
+  struct timespec t;
+  clock_gettime (CLOCK_MONOTONIC, &t);
+  return uint64_t (t.tv_sec) * 1000000 + t.tv_nsec / 1000;
+}
+
+void
+delay (uint64_t usec)
+{
+  struct timespec t;
+  t.tv_sec  = usec / 1000000;
+  t.tv_nsec = (usec % 1000000) * 1000;
+  while (0 != nanosleep (&t, &t) && EINTR == errno)
+    ;
+}
+
+}       // namespace utsushi
@@ -26,8 +26,10 @@
 #endif
 
 #include <arpa/inet.h>
+#include <fcntl.h>
 #include <netinet/in.h>
 #include <signal.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <sys/wait.h>
@@ -36,6 +38,7 @@
 #include <cerrno>
 #include <cstdio>
 #include <iostream>
+#include <vector>
 
 #include <boost/filesystem.hpp>
 
@@ -44,8 +47,9 @@
 #include "utsushi/log.hpp"
 #include "utsushi/run-time.hpp"
 #include "utsushi/thread.hpp"
-#include "connexions/usb.hpp"
+#include "connexions/capture.hpp"
 #include "connexions/hexdump.hpp"
+#include "connexions/usb.hpp"
 
 namespace fs = boost::filesystem;
 
@@ -69,11 +73,24 @@ namespace utsushi
 
         libcnx_usb_LTX_factory (cnx, type, path);
       }
+    else if ("replay" == type)
+      {
+        // Same as usb, see comment above.
+
+        libcnx_capture_LTX_replay_factory (cnx, type, path);
+      }
     else if (!type.empty ())
       {
         cnx = make_shared< ipc::connexion > (type, path);
       }
 
+    const char *capture = getenv (PACKAGE_ENV_VAR_PREFIX "CNX_RECORD");
+    if (cnx && capture && "replay" != type)
+      {
+        // same as usb. see comment above.
+        libcnx_capture_LTX_record_factory (cnx, capture);
+      }
+
     if (debug)
       {
         // same as usb. see comment above.
@@ -187,10 +204,12 @@ namespace {
 
 streamsize write (int fd, const void *buf, streamsize count);
 streamsize read  (int fd,       void *buf, streamsize count);
+streamsize write (int fd, const void *buf, streamsize count, int attachment);
 
 }       // namespace
 
 int connexion::default_timeout_ = 30 * seconds;
+streamsize connexion::default_shm_size_ = 4 * 1024 * 1024;
 
 /*! \todo Make retry_count and delay_time configurable
  *  \todo Allow for searching in multiple locations
@@ -199,6 +218,11 @@ connexion::connexion (const std::string& type, const std::string& path)
   : pid_(-1)
   , port_(-1)
   , socket_(-1)
+  , unix_socket_(-1)
+  , shm_fd_(-1)
+  , shm_(nullptr)
+  , shm_size_(0)
+  , timeout_(-1)
   , id_(0)
 {
   run_time rt;
@@ -280,7 +304,7 @@ connexion::connexion (const std::string& type, const std::string& path)
       hdr.type (header::OPEN);
       hdr.size (path.length ());
 
-      streamsize n = send_message_(hdr, path.c_str ());
+      streamsize n = send_message_(hdr, path.c_str (), shm_fd_);
 
       if (n == hdr.size ())
         {
@@ -293,7 +317,7 @@ connexion::connexion (const std::string& type, const std::string& path)
             {
               id_ = hdr.token ();
               log::brief ("opened ipc::connexion to: %1%") % path;
-              set_timeout (socket_, default_timeout_);
+              set_timeout_(default_timeout_);
               return;
             }
           msg = "error receiving";
@@ -304,6 +328,10 @@ connexion::connexion (const std::string& type, const std::string& path)
         }
     }
 
+  if (0 <= unix_socket_) close (unix_socket_);
+  if (shm_) munmap (shm_, shm_size_);
+  if (0 <= shm_fd_) close (shm_fd_);
+
   thread (kill_, pid_, port_, socket_, name_).detach ();
 
   BOOST_THROW_EXCEPTION
@@ -321,6 +349,9 @@ connexion::~connexion ()
     {
       log::brief ("%1%: failure closing connexion") % name_;
     }
+  if (shm_) munmap (shm_, shm_size_);
+  if (0 <= shm_fd_) close (shm_fd_);
+
   thread (kill_, pid_, port_, socket_, name_).detach ();
 }
 
@@ -336,7 +367,7 @@ connexion::send (const octet *message, streamsize size, double timeout)
   header hdr;
   hdr.token (id_);
   hdr.size (size);
-  set_timeout (socket_, timeout);
+  set_timeout_(timeout);
   send_message_(hdr, message);
 }
 
@@ -346,22 +377,48 @@ connexion::recv (octet *message, streamsize size)
   return recv (message, size, default_timeout_);
 }
 
+/*! Payloads of the expected \a size are read straight into \a message
+ *  or copied there from shared memory.  Anything else is discarded.
+ */
 void
 connexion::recv (octet *message, streamsize size, double timeout)
 {
   header hdr;
   hdr.token (id_);
-  octet *reply = nullptr;
 
-  set_timeout (socket_, timeout);
-  recv_message_(hdr, reply);
+  set_timeout_(timeout);
+  if (0 > recv_message_(&hdr, sizeof (hdr))) return;
+
+  bool wanted = (!hdr.error () && size == hdr.size ());
+
+  if (header::SHARED == hdr.type ())
+    {
+      uint32_t offset = 0;
+      if (0 > recv_message_(&offset, sizeof (offset))) return;
+      offset = ntohl (offset);
+
+      if (!shm_ || 0 > hdr.size ()
+          || shm_size_ < streamsize (offset) + hdr.size ())
+        {
+          log::error ("%1%: payload outside of shared memory") % name_;
+          return;
+        }
+      if (wanted && 0 < size)
+        traits::copy (message, shm_ + offset, size);
+      return;
+    }
 
-  if (!hdr.error () && size == hdr.size ())
+  if (0 >= hdr.size ()) return;
+
+  if (wanted)
+    {
+      recv_message_(message, size);
+    }
+  else
     {
-      if (0 < hdr.size () && reply)
-        traits::copy (message, reply, hdr.size ());
+      std::vector< octet > discard (hdr.size ());
+      recv_message_(&discard[0], hdr.size ());
     }
-  delete [] reply;
 }
 
 /*! \todo Make send and receive timeouts configurable
@@ -371,6 +428,20 @@ connexion::recv (octet *message, streamsize size, double timeout)
 bool
 connexion::connect_()
 {
+  if (0 <= unix_socket_)
+    {
+      if (0 == port_)           // helper took the Unix domain socket
+        {
+          socket_ = unix_socket_;
+          unix_socket_ = -1;
+          set_timeout (socket_, 3 * seconds);
+          map_shared_memory_();
+          return true;
+        }
+      close (unix_socket_);
+      unix_socket_ = -1;
+    }
+
   errno = 0;
   socket_ = socket (AF_INET, SOCK_STREAM, 0);
   if (0 > socket_)
@@ -407,6 +478,15 @@ connexion::fork_()
       return false;
     }
 
+  int unix_fd[2];
+
+  if (-1 == socketpair (AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, unix_fd))
+    {
+      log::alert ("socketpair: %1%") % strerror (errno);
+      unix_fd[0] = -1;
+      unix_fd[1] = -1;
+    }
+
   pid_ = fork ();
   if (0 == pid_)
     {
@@ -415,6 +495,13 @@ connexion::fork_()
       signal (SIGTERM, SIG_IGN);         // dealt with by parent
       signal (SIGINT , SIG_IGN);
 
+      if (0 <= unix_fd[1]
+          && 0 == fcntl (unix_fd[1], F_SETFD, 0)) // keep across exec
+        {
+          setenv (PACKAGE_ENV_VAR_PREFIX "IPC_SOCKET",
+                  (format ("%1%") % unix_fd[1]).str ().c_str (), 1);
+        }
+
       close (pipe_fd[0]);               // unused read end
       if (0 <= dup2 (pipe_fd[1], STDOUT_FILENO))
         {
@@ -479,12 +566,57 @@ connexion::fork_()
   close (pipe_fd[0]);
   close (pipe_fd[1]);
 
+  if (0 <= unix_fd[1]) close (unix_fd[1]);
+  unix_socket_ = unix_fd[0];
+
   if (0 > port_)
     s = false;
 
   return s;
 }
 
+/*! Failure to set up shared memory is not fatal.  Replies will then
+ *  all be sent via the socket.
+ */
+void
+connexion::map_shared_memory_()
+{
+#if HAVE_MEMFD_CREATE
+  shm_fd_ = memfd_create ("utsushi-ipc", MFD_CLOEXEC);
+  if (0 > shm_fd_)
+    {
+      log::alert ("memfd_create: %1%") % strerror (errno);
+      return;
+    }
+
+  if (0 == ftruncate (shm_fd_, default_shm_size_))
+    {
+      void *p = mmap (nullptr, default_shm_size_, PROT_READ, MAP_SHARED,
+                      shm_fd_, 0);
+      if (MAP_FAILED != p)
+        {
+          shm_ = static_cast< octet * > (p);
+          shm_size_ = default_shm_size_;
+          return;
+        }
+    }
+
+  log::alert ("shared memory: %1%") % strerror (errno);
+  close (shm_fd_);
+  shm_fd_ = -1;
+#endif  /* HAVE_MEMFD_CREATE */
+}
+
+//! Only touches the socket options if the \a timeout changes
+void
+connexion::set_timeout_(double timeout)
+{
+  if (timeout == timeout_) return;
+
+  set_timeout (socket_, timeout);
+  timeout_ = timeout;
+}
+
 void
 kill_(pid_t pid_, int port_, int socket_, std::string name_)
 {
@@ -554,12 +686,29 @@ kill_(pid_t pid_, int port_, int socket_, std::string name_)
     }
 }
 
+/*! A file descriptor \a fd, if not negative, is sent along with the
+ *  header.  This only works for Unix domain sockets.
+ */
 streamsize
-connexion::send_message_(const header& hdr, const octet *payload)
+connexion::send_message_(const header& hdr, const octet *payload, int fd)
 {
   streamsize n = 0;
 
-  n = send_message_(&hdr, sizeof (hdr));
+  if (0 > fd)
+    {
+      n = send_message_(&hdr, sizeof (hdr));
+    }
+  else
+    {
+      const octet *p = reinterpret_cast< const octet * > (&hdr);
+
+      n = write (socket_, p, sizeof (hdr), fd);
+      if (0 < n && n < streamsize (sizeof (hdr)))
+        {
+          streamsize t = send_message_(p + n, sizeof (hdr) - n);
+          n = (0 > t ? t : n + t);
+        }
+    }
   if (0 >= n) return -1;
 
   if (!hdr.size ()) return 0;
@@ -659,6 +808,46 @@ write (int fd, const void *buf, streamsize count)
   return rv;
 }
 
+//! Writes like the above but with an \a attachment file descriptor
+streamsize
+write (int fd, const void *buf, streamsize count, int attachment)
+{
+  struct iovec iov;
+  iov.iov_base = const_cast< void * > (buf);
+  iov.iov_len  = count;
+
+  char control[CMSG_SPACE (sizeof (attachment))];
+  memset (control, 0, sizeof (control));
+
+  struct msghdr msg;
+  memset (&msg, 0, sizeof (msg));
+  msg.msg_iov        = &iov;
+  msg.msg_iovlen     = 1;
+  msg.msg_control    = control;
+  msg.msg_controllen = sizeof (control);
+
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR (&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type  = SCM_RIGHTS;
+  cmsg->cmsg_len   = CMSG_LEN (sizeof (attachment));
+  memcpy (CMSG_DATA (cmsg), &attachment, sizeof (attachment));
+
+  sigset_t current, blocked;
+  sigemptyset (&blocked);
+  sigaddset (&blocked, SIGTERM);
+  sigaddset (&blocked, SIGINT );
+  sigprocmask (SIG_BLOCK, &blocked, &current);
+
+  errno = 0;
+  streamsize rv = ::sendmsg (fd, &msg, 0);
+  if (0 > rv)
+    log::error ("sendmsg failed: %1%") % strerror (errno);
+
+  sigprocmask (SIG_SETMASK, &current, NULL);
+
+  return rv;
+}
+
 streamsize
 read (int fd, void *buf, streamsize count)
 {
@@ -44,10 +44,26 @@ idevice::idevice (const context& ctx)
 
 streamsize
 idevice::read (octet *data, streamsize n)
+{
+  return guarded_read_(data, n, nullptr);
+}
+
+streamsize
+idevice::read (block& blk, streamsize n)
+{
+  if (!is_zero_copy ())
+    return input::read (blk, n);
+
+  blk = block ();
+  return guarded_read_(nullptr, n, &blk);
+}
+
+streamsize
+idevice::guarded_read_(octet *data, streamsize n, block *blk)
 {
   try
     {
-      return read_(data, n);
+      return read_(data, n, blk);
     }
   catch (const exception& e)
     {
@@ -61,7 +77,7 @@ idevice::read (octet *data, streamsize n)
 }
 
 streamsize
-idevice::read_(octet *data, streamsize n)
+idevice::read_(octet *data, streamsize n, block *blk)
 {
   const streamsize prev_marker = last_marker_;
 
@@ -69,9 +85,12 @@ idevice::read_(octet *data, streamsize n)
     {
       if (0 < n)
         {
-          streamsize rv = sgetn (data, n);
+          streamsize rv = (blk
+                           ? sgetn (*blk, n)
+                           : sgetn (data, n));
           if (0 >= rv)
             {
+              if (blk) *blk = block ();
               finish_image ();
               last_marker_ = (0 == rv
                               ? traits::eoi ()
@@ -193,6 +212,20 @@ idevice::sgetn (octet *data, streamsize n)
   return 0;
 }
 
+streamsize
+idevice::sgetn (block& blk, streamsize n)
+{
+  shared_ptr< octet > data;
+
+  if (0 < n) data = shared_ptr< octet > (new octet[n],
+                                         array_deleter< octet > ());
+
+  streamsize rv = sgetn (data.get (), n);
+
+  if (0 < rv) blk = block (data, data.get (), rv);
+  return rv;
+}
+
 bool
 idevice::cancel_requested () const
 {
@@ -228,6 +261,12 @@ decorator<idevice>::read (octet *data, streamsize n)
   return instance_->read (data, n);
 }
 
+streamsize
+decorator<idevice>::read (block& blk, streamsize n)
+{
+  return instance_->read (blk, n);
+}
+
 streamsize
 decorator<idevice>::marker ()
 {
@@ -240,6 +279,12 @@ decorator<idevice>::cancel ()
   return instance_->cancel ();
 }
 
+bool
+decorator<idevice>::is_zero_copy () const
+{
+  return instance_->is_zero_copy ();
+}
+
 streamsize
 decorator<idevice>::buffer_size () const
 {
@@ -32,12 +32,14 @@
 #include <boost/scoped_array.hpp>
 #include <boost/throw_exception.hpp>
 
+#include <algorithm>
 #include <cerrno>
 #include <cstdio>
 #include <cstring>
 #include <ios>
 
 #include <unistd.h>
+#include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -48,6 +50,23 @@ using std::ios_base;
 
 namespace utsushi {
 
+namespace {
+
+struct unmapper
+{
+  unmapper (size_t size) : size_(size) {}
+
+  void operator() (void *addr) const
+  {
+    if (0 != munmap (addr, size_))
+      log::error ("munmap: %1%") % strerror (errno);
+  }
+
+  size_t size_;
+};
+
+}       // namespace
+
 path_generator::path_generator ()
 {}
 
@@ -99,11 +118,15 @@ path_generator::operator() ()
 file_idevice::file_idevice (const std::string& filename)
   : filename_(filename)
   , used_(true)
+  , map_size_(0)
+  , map_offset_(0)
 {}
 
 file_idevice::file_idevice (const path_generator& generator)
   : generator_(generator)
   , used_(true)
+  , map_size_(0)
+  , map_offset_(0)
 {}
 
 file_idevice::~file_idevice ()
@@ -111,6 +134,12 @@ file_idevice::~file_idevice ()
   file_.close ();
 }
 
+bool
+file_idevice::is_zero_copy () const
+{
+  return bool (mapping_);
+}
+
 bool
 file_idevice::is_consecutive () const
 {
@@ -130,6 +159,8 @@ file_idevice::obtain_media ()
 bool
 file_idevice::set_up_image ()
 {
+  if (map_image_()) return true;
+
   return file_.open (filename_.c_str (),
                      std::ios_base::binary | std::ios_base::in);
 }
@@ -137,13 +168,68 @@ file_idevice::set_up_image ()
 void
 file_idevice::finish_image ()
 {
+  mapping_.reset ();
   file_.close ();
 }
 
 streamsize
 file_idevice::sgetn (octet *data, streamsize n)
 {
-  return file_.sgetn (data, n);
+  if (!mapping_) return file_.sgetn (data, n);
+
+  block blk;
+  streamsize rv = sgetn (blk, n);
+
+  if (0 < rv) traits::copy (data, blk.data (), rv);
+
+  return rv;
+}
+
+streamsize
+file_idevice::sgetn (block& blk, streamsize n)
+{
+  if (!mapping_) return idevice::sgetn (blk, n);
+
+  streamsize rv = std::min (map_size_ - map_offset_, n);
+
+  blk = block (mapping_, (static_cast< const octet * > (mapping_.get ())
+                          + map_offset_), rv);
+  map_offset_ += rv;
+
+  return rv;
+}
+
+//! Maps the image file into memory if it is a non-empty regular file
+/*! Anything that cannot be mapped, such as named pipes, is read via
+ *  the file_ instead.
+ */
+bool
+file_idevice::map_image_()
+{
+  int fd = ::open (filename_.c_str (), O_RDONLY | O_CLOEXEC);
+
+  if (-1 == fd) return false;
+
+  struct stat buf;
+  void *addr = MAP_FAILED;
+
+  if (0 == fstat (fd, &buf)
+      && S_ISREG (buf.st_mode)
+      && 0 < buf.st_size)
+    {
+      addr = mmap (NULL, buf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+  ::close (fd);
+
+  if (MAP_FAILED == addr) return false;
+
+  madvise (addr, buf.st_size, MADV_SEQUENTIAL);
+
+  mapping_ = shared_ptr< const void > (addr, unmapper (buf.st_size));
+  map_size_ = buf.st_size;
+  map_offset_ = 0;
+
+  return true;
 }
 
 file_odevice::file_odevice (const std::string& filename)
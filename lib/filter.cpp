@@ -47,6 +47,12 @@ filter::buffer_size (streamsize size)
   buffer_size_ = size;
 }
 
+filter::ptr
+filter::clone () const
+{
+  return filter::ptr ();
+}
+
 decorator<filter>::decorator (ptr instance)
   : instance_(instance)
 {}
@@ -26,6 +26,36 @@
 
 namespace utsushi {
 
+block::block ()
+  : data_(nullptr)
+  , size_(0)
+{}
+
+block::block (shared_ptr< const void > owner, const octet *data,
+              streamsize n)
+  : owner_(owner)
+  , data_(data)
+  , size_(n)
+{}
+
+const octet *
+block::data () const
+{
+  return data_;
+}
+
+streamsize
+block::size () const
+{
+  return size_;
+}
+
+bool
+block::empty () const
+{
+  return 0 == size_;
+}
+
 input::input (const context& ctx)
   : buffer_size_(default_buffer_size), ctx_(ctx)
 {}
@@ -33,6 +63,28 @@ input::input (const context& ctx)
 input::~input ()
 {}
 
+streamsize
+input::read (block& blk, streamsize n)
+{
+  shared_ptr< octet > data;
+
+  if (0 < n) data = shared_ptr< octet > (new octet[n],
+                                         array_deleter< octet > ());
+
+  streamsize rv = read (data.get (), n);
+
+  blk = (0 < rv
+         ? block (data, data.get (), rv)
+         : block ());
+  return rv;
+}
+
+bool
+input::is_zero_copy () const
+{
+  return false;
+}
+
 streamsize
 input::buffer_size () const
 {
@@ -120,6 +172,29 @@ operator>> (input& iref, output& oref)
   streamsize buffer_size = std::max (iref.buffer_size (),
                                      oref.buffer_size ());
 
+  if (iref.is_zero_copy ())
+    {
+      block blk;
+
+      oref.mark (traits::boi (), iref.get_context ());
+      n = iref.read (blk, buffer_size);
+      while (   traits::eoi () != n
+             && traits::eof () != n)
+        {
+          const octet *p = blk.data ();
+          streamsize m;
+
+          while (0 < n) {
+            m = oref.write (p, n);
+            p += m;
+            n -= m;
+          }
+          n = iref.read (blk, buffer_size);
+        }
+      oref.mark (n, iref.get_context ());
+      return n;
+    }
+
   octet *data = new octet[buffer_size];
 
   oref.mark (traits::boi (), iref.get_context ());
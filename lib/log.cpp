@@ -1,5 +1,5 @@
 //  log.cpp -- formatted messages based on priority and category
-//  Copyright (C) 2012, 2015  SEIKO EPSON CORPORATION
+//  Copyright (C) 2012, 2015, 2026  SEIKO EPSON CORPORATION
 //
 //  License: GPL-3.0+
 //  Author : EPSON AVASYS CORPORATION
@@ -22,13 +22,43 @@
 #include <config.h>
 #endif
 
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include <time.h>
+
+#include "utsushi/atomic.hpp"
 #include "utsushi/log.hpp"
+#include "utsushi/memory.hpp"
+#include "utsushi/mutex.hpp"
+#include "utsushi/thread.hpp"
+
+#include "ring-buffer.hpp"
+
+#if !(__cplusplus >= 201103L && !WITH_INCLUDED_BOOST)
+#include <boost/thread/tss.hpp>
+#endif
 
 namespace utsushi {
 
 log::priority log::threshold = log::FATAL;
 log::category log::matching  = log::NOTHING;
 
+namespace {
+
+bool
+enabled_by_env (const char *name)
+{
+  const char *env = getenv (name);
+  return (env && 0 != strtoul (env, NULL, 10));
+}
+
+}       // namespace
+
+bool log::asynchronous_ = enabled_by_env (PACKAGE_ENV_VAR_PREFIX "LOG_ASYNC");
+
 template<>
 std::basic_ostream< char >&
 log::basic_logger< char >::os_(std::clog);
@@ -37,4 +67,215 @@ template<>
 std::basic_ostream< wchar_t >&
 log::basic_logger< wchar_t >::os_(std::wclog);
 
+namespace {
+
+typedef ring_buffer< log::record * > channel;
+
+//! Collects queued log records and outputs them in the background
+/*! Every thread that logs gets a channel of its own.  Channels are
+ *  only registered, under a lock, the first time a thread queues a
+ *  record.  A single consumer, either the background thread or a
+ *  caller of flush(), drains all channels at a time.
+ */
+class backend
+{
+public:
+  static backend& instance ()
+  {
+    static backend instance_;
+    return instance_;
+  }
+
+  void push (log::record *r)
+  {
+    if (stopped_.load (memory_order_acquire))
+      {
+        r->dump ();
+        delete r;
+        return;
+      }
+
+    channel& ch (local_channel ());
+    while (!ch.push (r))
+      {
+        this_thread::yield ();
+      }
+  }
+
+  void flush ()
+  {
+    {
+      lock_guard< mutex > lock (drain_mutex_);
+      drain ();
+    }
+    log::basic_logger< char >::os_.flush ();
+    log::basic_logger< wchar_t >::os_.flush ();
+  }
+
+  static void shutdown ()
+  {
+    backend& b (instance ());
+
+    b.stopped_.store (true, memory_order_release);
+    if (b.worker_)
+      {
+        b.worker_->join ();
+        delete b.worker_;
+        b.worker_ = nullptr;
+      }
+    b.flush ();
+  }
+
+private:
+  backend ()
+    : stopped_(false)
+    , worker_(nullptr)
+  {}
+
+  channel& local_channel ()
+  {
+#if __cplusplus >= 201103L && !WITH_INCLUDED_BOOST
+    static thread_local shared_ptr< channel > local_;
+    shared_ptr< channel > *p = &local_;
+#else
+    static boost::thread_specific_ptr< shared_ptr< channel > > local_;
+    if (!local_.get ()) local_.reset (new shared_ptr< channel >);
+    shared_ptr< channel > *p = local_.get ();
+#endif
+
+    if (!*p)
+      {
+        *p = make_shared< channel > (size_t (capacity));
+
+        lock_guard< mutex > lock (registry_mutex_);
+        channels_.push_back (*p);
+        if (!worker_ && !stopped_.load (memory_order_acquire))
+          {
+            worker_ = new thread (&backend::run, this);
+            std::atexit (&backend::shutdown);
+          }
+      }
+    return **p;
+  }
+
+  void run ()
+  {
+    while (!stopped_.load (memory_order_acquire))
+      {
+        size_t n;
+        {
+          lock_guard< mutex > lock (drain_mutex_);
+          n = drain ();
+        }
+        if (!n)
+          {
+            struct timespec t = { 0, idle_interval };
+            nanosleep (&t, NULL);
+          }
+      }
+  }
+
+  //! Outputs all queued records, oldest first
+  /*! Channels whose thread has gone and which have been drained are
+   *  dropped.  Caller needs to hold the drain_mutex_.
+   *
+   *  A thread may register, log and exit while channels are popped.
+   *  Its records may well be older than ones already popped from the
+   *  other channels, so the registry is looked at again after every
+   *  pass until no new channel turns up.
+   */
+  size_t drain ()
+  {
+    std::vector< shared_ptr< channel > > channels;
+    {
+      lock_guard< mutex > lock (registry_mutex_);
+      channels = channels_;
+    }
+
+    size_t seen;
+    log::record *r;
+    do
+      {
+        for (size_t i = 0; i < channels.size (); ++i)
+          {
+            while (channels[i]->pop (r))
+              pending_.push_back (r);
+          }
+
+        seen = channels.size ();
+        lock_guard< mutex > lock (registry_mutex_);
+        channels = channels_;
+      }
+    while (seen < channels.size ());
+
+    std::stable_sort (pending_.begin (), pending_.end (), is_older);
+
+    size_t rv = pending_.size ();
+    for (size_t i = 0; i < pending_.size (); ++i)
+      {
+        pending_[i]->dump ();
+        delete pending_[i];
+      }
+    pending_.clear ();
+
+    {
+      lock_guard< mutex > lock (registry_mutex_);
+      std::vector< shared_ptr< channel > >::iterator it = channels_.begin ();
+      while (it != channels_.end ())
+        {
+          // Our local copy and the registry are the only owners left
+          if (2 == it->use_count () && (*it)->empty ())
+            it = channels_.erase (it);
+          else
+            ++it;
+        }
+    }
+    return rv;
+  }
+
+  static bool is_older (const log::record *a, const log::record *b)
+  {
+    return a->timestamp () < b->timestamp ();
+  }
+
+  static const size_t capacity = 1024;
+  static const long   idle_interval = 10 * 1000 * 1000; // nanoseconds
+
+  atomic< bool > stopped_;
+  thread        *worker_;
+
+  mutex registry_mutex_;
+  std::vector< shared_ptr< channel > > channels_;
+
+  mutex drain_mutex_;
+  std::vector< log::record * > pending_;
+};
+
+}       // namespace
+
+void
+log::enqueue (record *r)
+{
+  backend::instance ().push (r);
+}
+
+void
+log::asynchronous (bool enable)
+{
+  if (!enable) flush ();
+  asynchronous_ = enable;
+}
+
+bool
+log::asynchronous ()
+{
+  return asynchronous_;
+}
+
+void
+log::flush ()
+{
+  backend::instance ().flush ();
+}
+
 }       // namespace utsushi
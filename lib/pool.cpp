@@ -0,0 +1,429 @@
+//  pool.cpp -- process several images of a sequence at once
+//  Copyright (C) 2026  SEIKO EPSON CORPORATION
+//
+//  License: GPL-3.0+
+//  Author : EPSON AVASYS CORPORATION
+//
+//  This file is part of the 'Utsushi' package.
+//  This package is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License or, at
+//  your option, any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//  You ought to have received a copy of the GNU General Public License
+//  along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <algorithm>
+
+#include "utsushi/exception.hpp"
+#include "utsushi/log.hpp"
+#include "utsushi/pool.hpp"
+#include "utsushi/stream.hpp"
+#include "utsushi/thread.hpp"
+
+namespace utsushi {
+
+//! An image on its way through the pool
+struct pool::page
+{
+  //! Image data or a marker as produced by a worker's filters
+  struct record
+  {
+    bool is_marker_;
+    traits::int_type mark_;
+    context ctx_;
+    std::vector< octet > data_;
+  };
+
+  context boi_ctx_;
+  context eoi_ctx_;
+  std::vector< octet > input_;
+
+  std::deque< record > output_;
+  bool is_done_;
+  exception_ptr error_;
+
+  page (const context& ctx)
+    : boi_ctx_(ctx)
+    , is_done_(false)
+  {}
+};
+
+//! Keeps what a worker's filters produce for later replay
+/*! Image data and image markers are stored with the page being worked
+ *  on.  The contexts that come with the sequence markers are kept so
+ *  the pool can pass them on.
+ */
+class pool::recorder
+  : public odevice
+{
+public:
+  page *page_;
+  context bos_ctx_;
+  context end_ctx_;
+
+  recorder ()
+    : page_(nullptr)
+  {}
+
+  streamsize write (const octet *data, streamsize n)
+  {
+    if (!page_ || 0 >= n) return n;
+
+    std::deque< page::record >& out (page_->output_);
+
+    if (out.empty () || out.back ().is_marker_)
+      {
+        out.push_back (page::record ());
+        out.back ().is_marker_ = false;
+      }
+    out.back ().data_.insert (out.back ().data_.end (), data, data + n);
+
+    return n;
+  }
+
+  void mark (traits::int_type c, const context& ctx)
+  {
+    if (!traits::is_marker (c)) return;
+
+    if (traits::bos () == c)
+      {
+        bos_ctx_ = ctx;
+      }
+    else if (traits::eos () == c || traits::eof () == c)
+      {
+        end_ctx_ = ctx;
+      }
+    else if (page_)
+      {
+        page::record r;
+        r.is_marker_ = true;
+        r.mark_ = c;
+        r.ctx_ = ctx;
+        page_->output_.push_back (r);
+      }
+  }
+};
+
+//! A worker with its own chain of filters
+struct pool::lane
+{
+  stream str_;
+  shared_ptr< recorder > rec_;
+  thread *thread_;
+
+  lane ()
+    : rec_(make_shared< recorder > ())
+    , thread_(nullptr)
+  {}
+
+  ~lane ()
+  {
+    delete thread_;
+  }
+};
+
+pool::pool (unsigned workers)
+  : workers_(workers)
+  , is_stopping_(false)
+{}
+
+pool::~pool ()
+{
+  stop_();
+
+  std::vector< lane * >::iterator it;
+  for (it = lane_.begin (); lane_.end () != it; ++it)
+    delete *it;
+}
+
+void
+pool::push (filter::ptr filter)
+{
+  prototype_.push_back (filter);
+}
+
+streamsize
+pool::write (const octet *data, streamsize n)
+{
+  if (page_) page_->input_.insert (page_->input_.end (), data, data + n);
+
+  return n;
+}
+
+void
+pool::mark (traits::int_type c, const context& ctx)
+{
+  if (!traits::is_marker (c)) return;
+
+  /**/ if (traits::bos () == c)
+    {
+      set_up_sequence_(ctx);
+    }
+  else if (traits::boi () == c)
+    {
+      page_ = make_shared< page > (ctx);
+    }
+  else if (traits::eoi () == c)
+    {
+      if (!page_) return;
+
+      page_->eoi_ctx_ = ctx;
+      dispatch_(page_);
+      page_.reset ();
+    }
+  else
+    {
+      page_.reset ();
+      finish_sequence_(c, ctx);
+    }
+}
+
+//! Clones a chain of filters for each worker and starts them
+void
+pool::set_up_sequence_(const context& ctx)
+{
+  stop_();
+
+  std::vector< lane * >::iterator it;
+  for (it = lane_.begin (); lane_.end () != it; ++it)
+    delete *it;
+  lane_.clear ();
+
+  unsigned n = workers_;
+  if (!n) n = thread::hardware_concurrency ();
+  if (!n) n = 1;
+
+  std::vector< std::vector< filter::ptr > > chain (n);
+  bool is_cloneable = true;
+
+  for (unsigned i = 0; is_cloneable && i < n; ++i)
+    {
+      std::vector< filter::ptr >::const_iterator pt;
+      for (pt = prototype_.begin (); prototype_.end () != pt; ++pt)
+        {
+          filter::ptr fp = (*pt)->clone ();
+          if (!fp)
+            {
+              is_cloneable = false;
+              break;
+            }
+          chain[i].push_back (fp);
+        }
+    }
+
+  if (!is_cloneable)
+    {
+      log::brief ("pool: cannot clone filters, using a single worker");
+      chain.assign (1, prototype_);
+    }
+
+  for (std::size_t i = 0; i < chain.size (); ++i)
+    {
+      lane *lp = new lane;
+      lane_.push_back (lp);
+
+      std::vector< filter::ptr >::iterator ft;
+      for (ft = chain[i].begin (); chain[i].end () != ft; ++ft)
+        lp->str_.push (*ft);
+      lp->str_.push (lp->rec_);
+
+      lp->str_.mark (traits::bos (), ctx);
+    }
+
+  is_stopping_ = false;
+  for (it = lane_.begin (); lane_.end () != it; ++it)
+    (*it)->thread_ = new thread (&pool::work_, this, *it);
+
+  ctx_ = lane_.front ()->rec_->bos_ctx_;
+  output_->mark (traits::bos (), ctx_);
+}
+
+//! Passes on all remaining images and ends the sequence for everyone
+/*! Images that were not passed on yet are dropped if the sequence is
+ *  cancelled.
+ */
+void
+pool::finish_sequence_(traits::int_type c, const context& ctx)
+{
+  if (traits::eos () == c) replay_(0);
+
+  stop_();
+  {
+    lock_guard< mutex > lock (mutex_);
+    todo_.clear ();
+    pages_.clear ();
+  }
+
+  ctx_ = ctx;
+
+  std::vector< lane * >::iterator it;
+  for (it = lane_.begin (); lane_.end () != it; ++it)
+    {
+      if (traits::eos () == c)
+        {
+          (*it)->str_.mark (c, ctx);
+        }
+      else
+        {
+          try
+            {
+              (*it)->str_.mark (c, ctx);
+            }
+          catch (...)
+            {}
+        }
+      if (lane_.begin () == it) ctx_ = (*it)->rec_->end_ctx_;
+    }
+
+  output_->mark (c, ctx_);
+}
+
+//! Queues an image for the workers
+/*! Any images that are done in the meantime are passed on.  This may
+ *  wait for the oldest image if too many images are being held.
+ */
+void
+pool::dispatch_(shared_ptr< page > pp)
+{
+  {
+    lock_guard< mutex > lock (mutex_);
+    pages_.push_back (pp);
+    todo_.push_back (pp);
+  }
+  has_work_.notify_one ();
+
+  replay_(2 * lane_.size () - 1);
+}
+
+//! Passes finished images on in the order in which they came in
+/*! This waits for images to finish until no more than \a limit images
+ *  are left.  Any other images that are finished are passed on too.
+ *  Exceptions that occurred while working on an image are rethrown
+ *  when that image's turn comes.
+ */
+void
+pool::replay_(std::size_t limit)
+{
+  for (;;)
+    {
+      shared_ptr< page > pp;
+      {
+        unique_lock< mutex > lock (mutex_);
+
+        if (pages_.empty ()) return;
+
+        pp = pages_.front ();
+        if (!pp->is_done_ && pages_.size () <= limit) return;
+
+        while (!pp->is_done_)
+          is_done_.wait (lock);
+        pages_.pop_front ();
+      }
+
+      if (pp->error_) rethrow_exception (pp->error_);
+
+      std::deque< page::record >::const_iterator it;
+      for (it = pp->output_.begin (); pp->output_.end () != it; ++it)
+        {
+          if (it->is_marker_)
+            {
+              ctx_ = it->ctx_;
+              output_->mark (it->mark_, it->ctx_);
+              continue;
+            }
+
+          const octet *p = &it->data_[0];
+          streamsize   n = it->data_.size ();
+
+          while (0 < n)
+            {
+              streamsize m = output_->write (p, n);
+              p += m;
+              n -= m;
+            }
+        }
+    }
+}
+
+//! Makes the workers finish what they are doing and waits for them
+void
+pool::stop_()
+{
+  {
+    lock_guard< mutex > lock (mutex_);
+    is_stopping_ = true;
+    todo_.clear ();
+  }
+  has_work_.notify_all ();
+
+  std::vector< lane * >::iterator it;
+  for (it = lane_.begin (); lane_.end () != it; ++it)
+    {
+      if (!(*it)->thread_) continue;
+
+      (*it)->thread_->join ();
+      delete (*it)->thread_;
+      (*it)->thread_ = nullptr;
+    }
+}
+
+void
+pool::work_(lane *lp)
+{
+  for (;;)
+    {
+      shared_ptr< page > pp;
+      {
+        unique_lock< mutex > lock (mutex_);
+
+        while (todo_.empty () && !is_stopping_)
+          has_work_.wait (lock);
+
+        if (todo_.empty ()) return;
+
+        pp = todo_.front ();
+        todo_.pop_front ();
+      }
+
+      lp->rec_->page_ = pp.get ();
+      try
+        {
+          lp->str_.mark (traits::boi (), pp->boi_ctx_);
+
+          const octet *p = (pp->input_.empty () ? nullptr : &pp->input_[0]);
+          streamsize   n = pp->input_.size ();
+
+          while (0 < n)
+            {
+              streamsize m = lp->str_.write (p, n);
+              p += m;
+              n -= m;
+            }
+          lp->str_.mark (traits::eoi (), pp->eoi_ctx_);
+        }
+      catch (...)
+        {
+          pp->error_ = current_exception ();
+        }
+      lp->rec_->page_ = nullptr;
+      std::vector< octet > ().swap (pp->input_);
+
+      {
+        lock_guard< mutex > lock (mutex_);
+        pp->is_done_ = true;
+      }
+      is_done_.notify_all ();
+    }
+}
+
+}       // namespace utsushi
@@ -0,0 +1,451 @@
+//  profiler.cpp -- per stage timing and throughput of a stream
+//  Copyright (C) 2026  SEIKO EPSON CORPORATION
+//
+//  License: GPL-3.0+
+//  Author : EPSON AVASYS CORPORATION
+//
+//  This file is part of the 'Utsushi' package.
+//  This package is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License or, at
+//  your option, any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//  You ought to have received a copy of the GNU General Public License
+//  along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <typeinfo>
+
+#include <unistd.h>
+
+#if __GNUC__
+#include <cxxabi.h>
+#endif
+
+#if !(__cplusplus >= 201103L && !WITH_INCLUDED_BOOST)
+#include <boost/thread/tss.hpp>
+#endif
+
+#include "utsushi/clock.hpp"
+#include "utsushi/format.hpp"
+#include "utsushi/log.hpp"
+#include "utsushi/mutex.hpp"
+
+#include "profiler.hpp"
+
+namespace utsushi {
+
+namespace {
+
+std::string
+name_of (const output& out)
+{
+  std::string rv (typeid (out).name ());
+
+#if __GNUC__
+  int status = 0;
+  char *name = abi::__cxa_demangle (rv.c_str (), nullptr, nullptr, &status);
+  if (name)
+    {
+      rv = name;
+      std::free (name);
+    }
+#endif
+
+  const std::string ns ("utsushi::");
+  if (0 == rv.compare (0, ns.size (), ns))
+    rv.erase (0, ns.size ());
+
+  return rv;
+}
+
+std::string
+ms (uint64_t us)
+{
+  return (format ("%.3f") % (us / 1e3)).str ();
+}
+
+std::string
+json_escape (const std::string& s)
+{
+  std::string rv;
+  for (std::string::size_type i = 0; i < s.size (); ++i)
+    {
+      if ('"' == s[i] || '\\' == s[i]) rv += '\\';
+      rv += s[i];
+    }
+  return rv;
+}
+
+}       // namespace
+
+//!  Times a single call into a stage
+/*!  Scopes on the same thread nest when one stage calls the next one
+ *   down the stream.  The time spent in the nested scope is charged
+ *   to its own stage only.
+ */
+class profiler::scope
+{
+public:
+  scope (stage& s);
+  ~scope ();
+
+private:
+  static scope * current ()
+  {
+#if __cplusplus >= 201103L && !WITH_INCLUDED_BOOST
+    return current_;
+#else
+    return current_.get ();
+#endif
+  }
+
+  static void current (scope *s)
+  {
+#if __cplusplus >= 201103L && !WITH_INCLUDED_BOOST
+    current_ = s;
+#else
+    current_.reset (s);
+#endif
+  }
+
+#if __cplusplus >= 201103L && !WITH_INCLUDED_BOOST
+  static thread_local scope *current_;
+#else
+  static void keep (scope *) {}
+  static boost::thread_specific_ptr< scope > current_;
+#endif
+
+  stage& stage_;
+  scope *parent_;
+  uint64_t nested_;
+  uint64_t start_;
+};
+
+//!  Instrumented %output aspect of a single %filter or %device
+/*!  A stage is called by whichever thread feeds it, which need not be
+ *   the thread that asks for a report.  All that it keeps track of is
+ *   therefore guarded by a mutex and only read via a snapshot().
+ */
+class profiler::stage
+  : public output
+{
+public:
+  //!  Start and end of an image or a sequence
+  struct span
+  {
+    bool     is_image;
+    unsigned index;
+    uint64_t begin;
+    uint64_t end;
+    uint64_t octets;
+    uint64_t self;
+  };
+
+  struct counts
+  {
+    uint64_t writes;
+    uint64_t marks;
+    uint64_t octets;
+    uint64_t self;              //!< excluding downstream stages
+    uint64_t total;             //!< including downstream stages
+    unsigned images;
+    uint64_t latency;           //!< summed over all images
+    uint64_t max_latency;
+
+    uint64_t bos;
+    uint64_t eos;
+    unsigned sequences;
+
+    std::vector< span > spans;
+  };
+
+  stage (output::ptr out)
+    : name_(name_of (*out))
+    , out_(out)
+  {
+    counts_.sequences = 0;
+    reset_(0);
+  }
+
+  streamsize write (const octet *data, streamsize n)
+  {
+    streamsize rv;
+    {
+      scope s (*this);
+      rv = out_->write (data, n);
+    }
+    lock_guard< mutex > lock (mutex_);
+    ++counts_.writes;
+    counts_.octets += rv;
+    return rv;
+  }
+
+  void mark (traits::int_type c, const context& ctx)
+  {
+    uint64_t t = microseconds ();
+    {
+      lock_guard< mutex > lock (mutex_);
+
+      if (traits::bos () == c)
+        {
+          reset_(t);
+          ++counts_.sequences;
+        }
+      if (traits::boi () == c)
+        {
+          boi_        = t;
+          boi_octets_ = counts_.octets;
+          boi_self_   = counts_.self;
+        }
+    }
+
+    {
+      scope s (*this);
+      out_->mark (c, ctx);
+    }
+
+    t = microseconds ();
+
+    lock_guard< mutex > lock (mutex_);
+    ++counts_.marks;
+
+    if (traits::eoi () == c)
+      {
+        uint64_t latency = t - boi_;
+
+        ++counts_.images;
+        counts_.latency += latency;
+        if (counts_.max_latency < latency) counts_.max_latency = latency;
+
+        span s = { true, counts_.images, boi_, t,
+                   counts_.octets - boi_octets_, counts_.self - boi_self_ };
+        counts_.spans.push_back (s);
+      }
+    if (traits::eos () == c || traits::eof () == c)
+      {
+        counts_.eos = t;
+
+        span s = { false, counts_.sequences, counts_.bos, counts_.eos,
+                   counts_.octets, counts_.self };
+        counts_.spans.push_back (s);
+      }
+  }
+
+  streamsize buffer_size () const
+  {
+    return out_->buffer_size ();
+  }
+
+  context get_context () const
+  {
+    return out_->get_context ();
+  }
+
+  //!  Adds the time taken by a call, with and without nested calls
+  void charge (uint64_t total, uint64_t self)
+  {
+    lock_guard< mutex > lock (mutex_);
+    counts_.total += total;
+    counts_.self  += self;
+  }
+
+  //!  Returns a consistent copy of everything counted so far
+  counts snapshot () const
+  {
+    lock_guard< mutex > lock (mutex_);
+    return counts_;
+  }
+
+  const std::string name_;
+
+private:
+  void reset_(uint64_t t)
+  {
+    counts_.writes = counts_.marks = counts_.octets = 0;
+    counts_.self = counts_.total = 0;
+    counts_.images = 0;
+    counts_.latency = counts_.max_latency = 0;
+    counts_.bos = t;
+    counts_.eos = 0;
+    boi_ = boi_octets_ = boi_self_ = 0;
+  }
+
+  counts counts_;
+
+  uint64_t boi_;
+  uint64_t boi_octets_;
+  uint64_t boi_self_;
+
+  mutable mutex mutex_;
+
+  output::ptr out_;
+};
+
+profiler::scope::scope (stage& s)
+  : stage_(s)
+  , parent_(current ())
+  , nested_(0)
+  , start_(microseconds ())
+{
+  current (this);
+}
+
+profiler::scope::~scope ()
+{
+  uint64_t elapsed = microseconds () - start_;
+
+  stage_.charge (elapsed, elapsed - nested_);
+  if (parent_) parent_->nested_ += elapsed;
+
+  current (parent_);
+}
+
+#if __cplusplus >= 201103L && !WITH_INCLUDED_BOOST
+thread_local profiler::scope *profiler::scope::current_ = nullptr;
+#else
+boost::thread_specific_ptr< profiler::scope >
+profiler::scope::current_(profiler::scope::keep);
+#endif
+
+profiler::ptr
+profiler::create ()
+{
+  const char *summary = getenv (PACKAGE_ENV_VAR_PREFIX "PROFILE");
+  const char *trace = getenv (PACKAGE_ENV_VAR_PREFIX "PROFILE_TRACE");
+
+  if (!summary && !trace) return ptr ();
+
+  return make_shared< profiler > (summary, (trace ? trace : ""));
+}
+
+profiler::profiler (bool summary, const std::string& trace_file)
+  : summary_(summary)
+  , trace_file_(trace_file)
+  , origin_(microseconds ())
+{}
+
+output::ptr
+profiler::instrument (output::ptr out)
+{
+  shared_ptr< stage > rv = make_shared< stage > (out);
+
+  stages_.push_back (rv);
+  return rv;
+}
+
+void
+profiler::report () const
+{
+  if (summary_) summary (std::clog);
+
+  if (trace_file_.empty ()) return;
+
+  std::ofstream os (trace_file_.c_str ());
+  trace (os);
+  if (!os)
+    log::error ("cannot write profile trace to %1%") % trace_file_;
+}
+
+/*!  Stages are only looked at via their snapshot() so this is safe
+ *   to call while other threads are still feeding them.
+ */
+void
+profiler::summary (std::ostream& os) const
+{
+  if (stages_.empty ()) return;
+
+  std::vector< stage::counts > counts;
+  for (std::size_t i = 0; i < stages_.size (); ++i)
+    counts.push_back (stages_[i]->snapshot ());
+
+  const stage::counts& first (counts.front ());
+  uint64_t elapsed = (first.eos > first.bos
+                      ? first.eos - first.bos : 0);
+  uint64_t source  = (elapsed > first.total
+                      ? elapsed - first.total : 0);
+
+  uint64_t self = source;
+  for (std::size_t i = 0; i < counts.size (); ++i)
+    self += counts[i].self;
+  if (!self) self = 1;
+
+  const char *row = "profile: %-32s %12s %12s %8s %6s %10s %6s %10s %10s\n";
+
+  os << format ("profile: sequence %1%, %2% images in %3% ms\n")
+    % first.sequences % first.images % ms (elapsed);
+  os << format (row)
+    % "stage" % "octets in" % "octets out" % "writes" % "marks"
+    % "self ms" % "share" % "image ms" % "max ms";
+  os << format (row)
+    % "(source)" % "-" % first.octets % "-" % "-"
+    % ms (source) % (format ("%.1f%%") % (100.0 * source / self)).str ()
+    % "-" % "-";
+
+  for (std::size_t i = 0; i < counts.size (); ++i)
+    {
+      const stage::counts& s (counts[i]);
+      std::string out = (i + 1 < counts.size ()
+                         ? (format ("%1%") % counts[i + 1].octets).str ()
+                         : "-");
+
+      os << format (row)
+        % stages_[i]->name_ % s.octets % out % s.writes % s.marks
+        % ms (s.self)
+        % (format ("%.1f%%") % (100.0 * s.self / self)).str ()
+        % (s.images ? ms (s.latency / s.images) : "-")
+        % (s.images ? ms (s.max_latency) : "-");
+    }
+  os.flush ();
+}
+
+void
+profiler::trace (std::ostream& os) const
+{
+  const pid_t pid = getpid ();
+  const char *sep = "\n";
+
+  os << "{\"traceEvents\":[";
+  for (std::size_t i = 0; i < stages_.size (); ++i)
+    {
+      const stage::counts s (stages_[i]->snapshot ());
+
+      os << sep << format ("{\"name\":\"thread_name\",\"ph\":\"M\""
+                           ",\"pid\":%1%,\"tid\":%2%"
+                           ",\"args\":{\"name\":\"%3%\"}}")
+        % pid % (i + 1) % json_escape (stages_[i]->name_);
+      sep = ",\n";
+      os << sep << format ("{\"name\":\"thread_sort_index\",\"ph\":\"M\""
+                           ",\"pid\":%1%,\"tid\":%2%"
+                           ",\"args\":{\"sort_index\":%2%}}")
+        % pid % (i + 1);
+
+      for (std::size_t j = 0; j < s.spans.size (); ++j)
+        {
+          const stage::span& t (s.spans[j]);
+
+          os << sep << format ("{\"name\":\"%1% %2%\",\"cat\":\"%1%\""
+                               ",\"ph\":\"X\",\"ts\":%3%,\"dur\":%4%"
+                               ",\"pid\":%5%,\"tid\":%6%"
+                               ",\"args\":{\"octets\":%7%,\"self_us\":%8%}}")
+            % (t.is_image ? "image" : "sequence") % t.index
+            % (t.begin - origin_) % (t.end - t.begin)
+            % pid % (i + 1)
+            % t.octets % t.self;
+        }
+    }
+  os << "\n]}\n";
+}
+
+}       // namespace utsushi
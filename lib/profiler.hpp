@@ -0,0 +1,90 @@
+//  profiler.hpp -- per stage timing and throughput of a stream
+//  Copyright (C) 2026  SEIKO EPSON CORPORATION
+//
+//  License: GPL-3.0+
+//  Author : EPSON AVASYS CORPORATION
+//
+//  This file is part of the 'Utsushi' package.
+//  This package is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License or, at
+//  your option, any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//  You ought to have received a copy of the GNU General Public License
+//  along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef _profiler_hpp_
+#define _profiler_hpp_
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "utsushi/cstdint.hpp"
+#include "utsushi/iobase.hpp"
+
+namespace utsushi {
+
+//!  Find out where a %stream spends its time
+/*!  A %profiler instruments the %output aspect of every %filter and
+ *   %device pushed onto a %stream.  Each of these stages keeps track
+ *   of the number of write() and mark() calls, the image data octets
+ *   it is given and the time it spends on these calls.  That time is
+ *   \e exclusive of the time spent by the stages further down the
+ *   %stream, even when these are called from within a stage, so it
+ *   tells which stage is the bottleneck.  The time from the start to
+ *   the end of each image is recorded as well.
+ *
+ *   Whatever happens between write() and mark() calls on the thread
+ *   that feeds the %stream, typically acquiring image data from the
+ *   %input, is attributed to a pseudo-stage called "(source)".  The
+ *   relays that hand image data to another thread are instrumented
+ *   as well, so that waiting for a slower thread shows up as such.
+ *
+ *   A summary of the sequence is written to \c std::clog when it is
+ *   marked as complete or cancelled.  All images and sequences seen
+ *   so far can also be written to a file in the Chrome trace event
+ *   format, for a look at them with a trace viewer.
+ */
+class profiler
+{
+public:
+  typedef shared_ptr< profiler > ptr;
+
+  //!  Returns a %profiler configured via the environment, if any
+  /*!  Setting \c UTSUSHI_PROFILE enables summaries, setting
+   *   \c UTSUSHI_PROFILE_TRACE to a file name enables trace output
+   *   to that file.  If neither is set, an empty pointer is returned.
+   */
+  static ptr create ();
+
+  profiler (bool summary, const std::string& trace_file = std::string ());
+
+  //!  Wraps \a out so that calls of its API get profiled
+  output::ptr instrument (output::ptr out);
+
+  //!  Writes summary and/or trace, as configured
+  void report () const;
+
+  void summary (std::ostream& os) const;
+  void trace (std::ostream& os) const;
+
+private:
+  class stage;
+  class scope;
+
+  bool summary_;
+  std::string trace_file_;
+
+  uint64_t origin_;             //!< in microseconds
+  std::vector< shared_ptr< stage > > stages_;
+};
+
+}       // namespace utsushi
+
+#endif  /* _profiler_hpp_ */
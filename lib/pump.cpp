@@ -22,45 +22,66 @@
 #include <config.h>
 #endif
 
+#include <algorithm>
 #include <csignal>
-#include <deque>
+#include <cstddef>
+#include <limits>
 #include <new>
 #include <stdexcept>
 
 #include <boost/throw_exception.hpp>
 
+#include "utsushi/atomic.hpp"
 #include "utsushi/condition-variable.hpp"
 #include "utsushi/i18n.hpp"
 #include "utsushi/log.hpp"
 #include "utsushi/memory.hpp"
 #include "utsushi/mutex.hpp"
 #include "utsushi/pump.hpp"
+#include "utsushi/range.hpp"
 #include "utsushi/thread.hpp"
 
+#include "ring-buffer.hpp"
+
 namespace utsushi {
 
 using std::invalid_argument;
 
+//! A run of image data octets or a marker on its way through a pump
+/*! Image data is either read into storage owned by the bucket itself
+ *  or, for inputs that support it, handed over as a block referring
+ *  to the input's own storage.  The latter saves copying everything
+ *  once more on the way to the first filter.
+ */
 class bucket
 {
 public:
-  typedef shared_ptr< bucket > ptr;
-
   octet *data_;
+  block block_;
+  streamsize capacity_;
   union {
     streamsize size_;
     streamsize mark_;
   };
+  bool is_marker_;
   context ctx_;
 
+  //! Creates a bucket for image data
+  /*! A \a size of zero creates a bucket without storage of its own.
+   *  Such buckets can only be filled with a block.
+   */
   bucket (streamsize size)
-    : data_(new octet[size])
+    : data_(0 < size ? new octet[size] : nullptr)
+    , capacity_(size)
     , size_(size)
+    , is_marker_(false)
   {}
 
   bucket (const context& ctx, streamsize marker)
     : data_(nullptr)
+    , capacity_(0)
     , mark_(marker)
+    , is_marker_(true)
     , ctx_(ctx)
   {}
 
@@ -68,11 +89,49 @@ public:
   {
     delete [] data_;
   }
+
+  //! Reads up to \a n octets of image data from \a iptr
+  streamsize fill (input::ptr iptr, streamsize n)
+  {
+    return (data_
+            ? iptr->read (data_, capacity_)
+            : iptr->read (block_, n));
+  }
+
+  const octet * begin () const
+  {
+    return (data_ ? data_ : block_.data ());
+  }
 };
 
 namespace {
 
 const key ASYNC ("acquire-async");
+const key HIGH_OCTETS ("acquire-high-water");
+const key LOW_OCTETS ("acquire-low-water");
+const key HIGH_BUCKETS ("acquire-high-water-buckets");
+const key LOW_BUCKETS ("acquire-low-water-buckets");
+
+//! Default limits on the amount of image data held by a pump
+/*! Large enough to hold a couple of A4 size, 600 dpi colour images so
+ *  consumers that occasionally fall behind do not throttle the image
+ *  acquisition process.
+ */
+const quantity::integer_type default_high_water = 256 * 1024 * 1024;
+const quantity::integer_type default_low_water  = 128 * 1024 * 1024;
+
+//! Number of buckets a pump may hold on to for reuse
+/*! Buckets of image data that have been processed are handed back to
+ *  the acquiring side so it can reuse them instead of allocating new
+ *  ones.  As long as the consumer keeps up, a handful of buckets is
+ *  all that is ever needed.
+ */
+const std::size_t bucket_pool_size = 32;
+
+//! Brigade capacity when not limited by any high water mark
+const std::size_t default_brigade_size = 64 * 1024;
+//! Upper bound on the brigade capacity
+const std::size_t max_brigade_size = 1024 * 1024;
 
 void
 init_(option::map::ptr& option_)
@@ -89,6 +148,48 @@ init_(option::map::ptr& option_)
             " more predictable program flow.\n"
             "Note, you may no longer be able to cancel image acquisition"
             " via the normal means when this option is set to false.")
+     )
+    (HIGH_OCTETS, (from< range > ()
+                   -> lower (0)
+                   -> upper (std::numeric_limits< quantity::integer_type >::max ())
+                   -> default_value (default_high_water)
+                   ),
+     attributes (level::complete),
+     CCB_N_("Acquisition High Water Mark"),
+     CCB_N_("When acquiring image data asynchronously, image acquisition"
+            " is suspended as soon as this many octets are waiting to be"
+            " processed.  It resumes when the amount of waiting data has"
+            " dropped to the low water mark.  Use zero for no limit.")
+     )
+    (LOW_OCTETS, (from< range > ()
+                  -> lower (0)
+                  -> upper (std::numeric_limits< quantity::integer_type >::max ())
+                  -> default_value (default_low_water)
+                  ),
+     attributes (level::complete),
+     CCB_N_("Acquisition Low Water Mark"),
+     CCB_N_("Amount of image data, in octets, that still waits to be"
+            " processed when suspended image acquisition resumes.")
+     )
+    (HIGH_BUCKETS, (from< range > ()
+                    -> lower (0)
+                    -> upper (std::numeric_limits< quantity::integer_type >::max ())
+                    -> default_value (0)
+                    ),
+     attributes (level::complete),
+     CCB_N_("Acquisition High Water Mark (Chunks)"),
+     CCB_N_("Suspends image acquisition when this many chunks of image"
+            " data are waiting to be processed.  Use zero for no limit.")
+     )
+    (LOW_BUCKETS, (from< range > ()
+                   -> lower (0)
+                   -> upper (std::numeric_limits< quantity::integer_type >::max ())
+                   -> default_value (0)
+                   ),
+     attributes (level::complete),
+     CCB_N_("Acquisition Low Water Mark (Chunks)"),
+     CCB_N_("Number of chunks of image data that still wait to be"
+            " processed when suspended image acquisition resumes.")
      );
 }
 
@@ -108,6 +209,29 @@ require_(output::ptr optr)
   BOOST_THROW_EXCEPTION (invalid_argument ("no output destination"));
 }
 
+//! Limits on the amount of image data held in a bucket brigade
+/*! A zero value for either member means that aspect is not limited.
+ */
+struct watermark
+{
+  streamsize octets;
+  streamsize buckets;
+
+  watermark (streamsize octets = 0, streamsize buckets = 0)
+    : octets (octets)
+    , buckets (buckets)
+  {}
+};
+
+watermark
+watermark_(option::map::ptr om, const key& octets, const key& buckets)
+{
+  quantity o = value ((*om)[octets]);
+  quantity b = value ((*om)[buckets]);
+
+  return watermark (o.amount< streamsize > (), b.amount< streamsize > ());
+}
+
 }       // namespace
 
 class pump::impl
@@ -119,6 +243,8 @@ public:
   void start (input::ptr iptr, output::ptr optr, toggle);
   void start (output::ptr optr, toggle);
 
+  void limit (const watermark& high, const watermark& low);
+
   void cancel ();
 
   streamsize acquire_and_process (input::ptr iptr, output::ptr optr);
@@ -127,15 +253,20 @@ public:
   streamsize process_data (output::ptr optr);
 
   streamsize acquire_image (input::ptr iptr);
-  bucket::ptr process_image (output::ptr optr);
+  streamsize process_image (output::ptr optr, context& ctx);
 
-  bucket::ptr make_bucket (streamsize size);
+  bucket * make_bucket (streamsize size);
+  void recycle (bucket *bp);
+  void clear ();
 
-  bucket::ptr pop ();
-  void push (bucket::ptr bp);
+  bucket * pop ();
+  void push (bucket *bp);
 
   void mark (traits::int_type c, const context& ctx);
 
+  bool is_above_high_water_() const;
+  bool is_below_low_water_() const;
+
   input::ptr  iptr_;
 
   //! \todo Replace with query on iptr_?
@@ -145,11 +276,34 @@ public:
   thread *acquire_;
   thread *process_;
 
-  std::deque< bucket::ptr >::size_type have_bucket_;
+  //! Buckets on their way from the acquiring to the processing side
+  ring_buffer< bucket * > brigade_;
+  //! Processed buckets on their way back to the acquiring side
+  ring_buffer< bucket * > free_list_;
+  //! Bucket the acquiring side did not get to use
+  bucket *spare_;
+
+  atomic< streamsize > have_octets_;
+
+  //! Tells whether anyone is still taking buckets off the brigade_
+  /*! Pushing onto the brigade_ should never block when nobody is
+   *  going to pop() any buckets again.
+   */
+  bool is_processing_;
 
-  std::deque< bucket::ptr > brigade_;
-  mutex brigade_mutex_;
+  watermark high_;
+  watermark low_;
+
+  // Buckets are handed off without any locking.  Only when one side
+  // has to wait for the other will it take the mutex and go to sleep
+  // on a condition variable.  The flags tell the other side that it
+  // needs to wake up the sleeper.
+
+  mutex waiting_mutex_;
   condition_variable not_empty_;
+  condition_variable not_full_;
+  atomic< bool > is_acquire_waiting_;
+  atomic< bool > is_process_waiting_;
 
   notify_signal_type signal_notify_;
   cancel_signal_type signal_cancel_;
@@ -165,7 +319,12 @@ pump::impl::impl (input::ptr iptr)
   , is_pumping_(false)
   , acquire_(nullptr)
   , process_(nullptr)
-  , have_bucket_(0)
+  , free_list_(bucket_pool_size)
+  , spare_(nullptr)
+  , have_octets_(0)
+  , is_processing_(false)
+  , is_acquire_waiting_(false)
+  , is_process_waiting_(false)
 {
   require_(iptr);
 }
@@ -183,6 +342,13 @@ pump::impl::~impl ()
       process_->join ();
     }
   delete process_;
+
+  clear ();
+
+  bucket *bp;
+  while (free_list_.pop (bp))
+    delete bp;
+  delete spare_;
 }
 
 void
@@ -213,8 +379,7 @@ pump::impl::start (input::ptr iptr, output::ptr optr,
 
   delete acquire_; acquire_ = nullptr;
   delete process_; process_ = nullptr;
-  brigade_.clear ();
-  have_bucket_ = 0;
+  clear ();
 
   iptr_ = iptr;
 
@@ -225,8 +390,23 @@ pump::impl::start (input::ptr iptr, output::ptr optr,
       return;
     }
 
+  // Size the brigade so that it can hold everything up to the high
+  // water mark.  A few extra slots make room for sequence markers.
+
+  std::size_t size = default_brigade_size;
+  if (high_.buckets)
+    {
+      size = high_.buckets;
+    }
+  else if (high_.octets)
+    {
+      size = high_.octets / std::max (iptr->buffer_size (), streamsize (1));
+    }
+  brigade_.reserve (std::min (size + 8, max_brigade_size));
+
   // Note that starting order of threads is undefined.
 
+  is_processing_ = true;
   acquire_ = new thread (&impl::acquire_data, this, iptr);
   process_ = new thread (&impl::process_data, this, optr);
 }
@@ -237,13 +417,28 @@ pump::impl::start (output::ptr optr, toggle acquire_asynchronously)
   start (iptr_, optr, acquire_asynchronously);
 }
 
+void
+pump::impl::limit (const watermark& high, const watermark& low)
+{
+  high_ = high;
+
+  // Resuming above the high water mark makes no sense
+
+  low_.octets  = std::min (low.octets , high_.octets );
+  low_.buckets = std::min (low.buckets, high_.buckets);
+}
+
 void
 pump::impl::cancel ()
 {
   if (!iptr_) return;
 
   iptr_->cancel ();
-  is_cancelling_ = true;
+  {
+    lock_guard< mutex > lock (waiting_mutex_);
+    is_cancelling_ = true;
+  }
+  not_full_.notify_all ();
 }
 
 streamsize
@@ -315,23 +510,30 @@ pump::impl::acquire_data (input::ptr iptr)
 streamsize                      // write part of operator|
 pump::impl::process_data (output::ptr optr)
 {
+  streamsize rv = traits::eof ();
   try
     {
-      bucket::ptr bp = pop ();
-      if (traits::bos () != bp->mark_)
+      bucket *bp = pop ();
+      streamsize marker = bp->mark_;
+      context ctx = bp->ctx_;
+      recycle (bp);
+
+      if (traits::bos () != marker)
         {
           optr->mark (traits::eof (), context ());
-          return bp->mark_;
+          rv = marker;
         }
-
-      optr->mark (traits::bos (), bp->ctx_);
-      while (   traits::eos () != bp->mark_
-             && traits::eof () != bp->mark_)
+      else
         {
-          bp = process_image (optr);
+          optr->mark (traits::bos (), ctx);
+          while (   traits::eos () != marker
+                 && traits::eof () != marker)
+            {
+              marker = process_image (optr, ctx);
+            }
+          optr->mark (marker, ctx);
+          rv = marker;
         }
-      optr->mark (bp->mark_, bp->ctx_);
-      return bp->mark_;
     }
   catch (const std::exception& e)
     {
@@ -343,7 +545,16 @@ pump::impl::process_data (output::ptr optr)
       optr->mark (traits::eof (), context ());
       signal_notify_(log::ALERT, "unknown exception during processing");
     }
-  return traits::eof ();
+
+  // Make sure the acquiring side does not wait for us forever
+
+  {
+    lock_guard< mutex > lock (waiting_mutex_);
+    is_processing_ = false;
+  }
+  not_full_.notify_all ();
+
+  return rv;
 }
 
 streamsize                      // read part of operator>>
@@ -353,70 +564,119 @@ pump::impl::acquire_image (input::ptr iptr)
   if (traits::boi () != n) return n;
 
   const streamsize buffer_size = iptr->buffer_size ();
-  bucket::ptr bp;
+  const streamsize capacity = (iptr->is_zero_copy () ? 0 : buffer_size);
+  bucket *bp;
 
   mark (traits::boi (), iptr->get_context ());
 
-  bp = make_bucket (buffer_size);
-  n = iptr->read (bp->data_, bp->size_);
-  while (   traits::eoi () != n
-         && traits::eof () != n)
+  bp = make_bucket (capacity);
+  try
+    {
+      n = bp->fill (iptr, buffer_size);
+      while (   traits::eoi () != n
+             && traits::eof () != n)
+        {
+          bp->size_ = n;
+          push (bp);
+          bp = make_bucket (capacity);
+          n = bp->fill (iptr, buffer_size);
+        }
+    }
+  catch (...)
     {
-      bp->size_ = n;
-      push (bp);
-      bp = make_bucket (buffer_size);
-      n = iptr->read (bp->data_, bp->size_);
+      spare_ = bp;
+      throw;
     }
+  spare_ = bp;
+
   mark (n, iptr->get_context ());
   if (traits::eof () == n) signal_cancel_();
   return n;
 }
 
-bucket::ptr            // write part of operator>>
-pump::impl::process_image (output::ptr optr)
+//! Writes one image's worth of buckets to \a optr
+/*! \return the marker that ended the image.  The marker's context
+ *          is stored in \a ctx.
+ */
+streamsize                      // write part of operator>>
+pump::impl::process_image (output::ptr optr, context& ctx)
 {
-  bucket::ptr bp = pop ();
-  if (traits::boi () != bp->mark_) return bp;
+  bucket *bp = pop ();
+  streamsize marker = bp->mark_;
+  ctx = bp->ctx_;
+  recycle (bp);
 
-  optr->mark (traits::boi (), bp->ctx_);
+  if (traits::boi () != marker) return marker;
+
+  optr->mark (traits::boi (), ctx);
   bp = pop ();
   while (   traits::eoi () != bp->mark_
          && traits::eof () != bp->mark_)
     {
-      const octet *p = bp->data_;
+      const octet *p = bp->begin ();
       streamsize m;
 
-      while (0 < bp->size_) {
-        m          = optr->write (p, bp->size_);
-        p         += m;
-        bp->size_ -= m;
-      }
+      try
+        {
+          while (0 < bp->size_) {
+            m          = optr->write (p, bp->size_);
+            p         += m;
+            bp->size_ -= m;
+          }
+        }
+      catch (...)
+        {
+          recycle (bp);
+          throw;
+        }
+      recycle (bp);
       bp = pop ();
     }
-  optr->mark (bp->mark_, bp->ctx_);
-  return bp;
+  marker = bp->mark_;
+  ctx = bp->ctx_;
+  recycle (bp);
+
+  optr->mark (marker, ctx);
+  return marker;
 }
 
-bucket::ptr
+//! Gets a bucket for up to \a size octets of image data
+/*! Buckets handed back by the processing side are reused whenever
+ *  possible.  Only if none is available will a new one be allocated.
+ *  A \a size of zero gets a bucket that can only hold a block.
+ *
+ *  \note  Only to be called from the acquiring side.
+ */
+bucket *
 pump::impl::make_bucket (streamsize size)
 {
-  bucket::ptr rv;
+  bucket *rv = spare_;
+  spare_ = nullptr;
+
+  if (!rv) free_list_.pop (rv);
+  if (rv && size != rv->capacity_)
+    {
+      delete rv;
+      rv = nullptr;
+    }
 
   while (!rv)
     {
       try
         {
-          rv = make_shared< bucket > (size);
+          rv = new bucket (size);
         }
       catch (const std::bad_alloc&)
         {
-          bool retry_alloc;
-          {
-            lock_guard< mutex > lock (brigade_mutex_);
-
-            retry_alloc = have_bucket_;
-          }
-          if (retry_alloc)
+          if (free_list_.pop (rv))
+            {
+              if (size != rv->capacity_)
+                {
+                  delete rv;    // make room for one of the right size
+                  rv = nullptr;
+                }
+            }
+          else if (!brigade_.empty ())
             {
               this_thread::yield ();
             }
@@ -429,40 +689,152 @@ pump::impl::make_bucket (streamsize size)
   return rv;
 }
 
-bucket::ptr
+//! Hands a processed bucket back to the acquiring side
+/*! Markers and anything the free list has no room for are deleted.
+ *  Any block held is released first so the input can get its storage
+ *  back as soon as possible.
+ *
+ *  \note  Only to be called from the processing side.
+ */
+void
+pump::impl::recycle (bucket *bp)
+{
+  if (!bp->is_marker_)
+    {
+      bp->block_ = block ();
+      if (free_list_.push (bp)) return;
+    }
+
+  delete bp;
+}
+
+//! Deletes all buckets left on the brigade
+/*! \note  Only to be called when neither side is active.
+ */
+void
+pump::impl::clear ()
+{
+  bucket *bp;
+  while (brigade_.pop (bp))
+    delete bp;
+  have_octets_ = 0;
+}
+
+bucket *
 pump::impl::pop ()
 {
-  bucket::ptr bp;
+  bucket *bp;
 
-  {
-    unique_lock< mutex > lock (brigade_mutex_);
+  if (!brigade_.pop (bp))
+    {
+      unique_lock< mutex > lock (waiting_mutex_);
 
-    while (!have_bucket_)
-      not_empty_.wait (lock);
+      is_process_waiting_.store (true, memory_order_relaxed);
+      atomic_thread_fence (memory_order_seq_cst);
+      while (!brigade_.pop (bp))
+        not_empty_.wait (lock);
+      is_process_waiting_.store (false, memory_order_relaxed);
+    }
+  if (!bp->is_marker_) have_octets_ -= bp->size_;
 
-    bp = brigade_.front ();
-    brigade_.pop_front ();
-    --have_bucket_;
-  }
+  atomic_thread_fence (memory_order_seq_cst);
+  if (is_acquire_waiting_.load (memory_order_relaxed))
+    {
+      lock_guard< mutex > lock (waiting_mutex_);
+      not_full_.notify_one ();
+    }
 
   return bp;
 }
 
+//! Puts a bucket at the end of the brigade
+/*! Buckets with image data are held back while the brigade is above
+ *  its high water mark.  This blocks the caller until enough buckets
+ *  have been processed to get the brigade below its low water mark.
+ *  Markers are never held back as they are needed to make progress.
+ *  Cancellation and the end of processing also release the caller.
+ *
+ *  Independent of any water marks, the caller blocks when there is
+ *  no room left in the brigade.  Once processing has ended, buckets
+ *  are silently dropped as nobody would ever take them off again.
+ */
 void
-pump::impl::push (bucket::ptr bp)
+pump::impl::push (bucket *bp)
 {
-  {
-    lock_guard< mutex > lock (brigade_mutex_);
-    brigade_.push_back (bp);
-    ++have_bucket_;
-  }
-  not_empty_.notify_one ();
+  if (!bp->is_marker_ && is_above_high_water_())
+    {
+      unique_lock< mutex > lock (waiting_mutex_);
+
+      log::trace ("acquisition suspended (%1% octets in %2% buckets)")
+        % have_octets_
+        % brigade_.size ();
+
+      is_acquire_waiting_.store (true, memory_order_relaxed);
+      atomic_thread_fence (memory_order_seq_cst);
+      while (   !is_below_low_water_()
+             && !is_cancelling_
+             && is_processing_)
+        not_full_.wait (lock);
+      is_acquire_waiting_.store (false, memory_order_relaxed);
+
+      log::trace ("acquisition resumed (%1% octets in %2% buckets)")
+        % have_octets_
+        % brigade_.size ();
+    }
+
+  if (!bp->is_marker_) have_octets_ += bp->size_;
+
+  if (!brigade_.push (bp))
+    {
+      unique_lock< mutex > lock (waiting_mutex_);
+
+      is_acquire_waiting_.store (true, memory_order_relaxed);
+      atomic_thread_fence (memory_order_seq_cst);
+      while (   !brigade_.push (bp)
+             && is_processing_)
+        not_full_.wait (lock);
+      is_acquire_waiting_.store (false, memory_order_relaxed);
+
+      if (!is_processing_)
+        {
+          if (!bp->is_marker_) have_octets_ -= bp->size_;
+          delete bp;
+          return;
+        }
+    }
+
+  atomic_thread_fence (memory_order_seq_cst);
+  if (is_process_waiting_.load (memory_order_relaxed))
+    {
+      lock_guard< mutex > lock (waiting_mutex_);
+      not_empty_.notify_one ();
+    }
 }
 
 void
 pump::impl::mark (traits::int_type c, const context& ctx)
 {
-  push (make_shared< bucket > (ctx, c));
+  push (new bucket (ctx, c));
+}
+
+//! Tells whether the brigade has reached its high water mark
+bool
+pump::impl::is_above_high_water_() const
+{
+  return ((high_.octets && high_.octets <= have_octets_)
+          || (high_.buckets
+              && high_.buckets <= streamsize (brigade_.size ())));
+}
+
+//! Tells whether the brigade has drained to its low water mark
+/*! Only those aspects that have a high water mark are considered.
+ */
+bool
+pump::impl::is_below_low_water_() const
+{
+  return ((!high_.octets || have_octets_ <= low_.octets)
+          && (!high_.buckets
+              || streamsize (brigade_.size ()) <= low_.buckets));
 }
 
 pump::pump (idevice::ptr idev)
@@ -479,12 +851,16 @@ pump::~pump ()
 void
 pump::start (odevice::ptr odev)
 {
+  pimpl_->limit (watermark_(option_, HIGH_OCTETS, HIGH_BUCKETS),
+                 watermark_(option_, LOW_OCTETS, LOW_BUCKETS));
   pimpl_->start (odev, value ((*option_)[ASYNC]));
 }
 
 void
 pump::start (stream::ptr str)
 {
+  pimpl_->limit (watermark_(option_, HIGH_OCTETS, HIGH_BUCKETS),
+                 watermark_(option_, LOW_OCTETS, LOW_BUCKETS));
   pimpl_->start (str, value ((*option_)[ASYNC]));
 }
 
@@ -0,0 +1,315 @@
+//  relay.cpp -- image data hand-off to a thread of its own
+//  Copyright (C) 2026  SEIKO EPSON CORPORATION
+//
+//  License: GPL-3.0+
+//  Author : EPSON AVASYS CORPORATION
+//
+//  This file is part of the 'Utsushi' package.
+//  This package is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License or, at
+//  your option, any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//  You ought to have received a copy of the GNU General Public License
+//  along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <algorithm>
+
+#include "utsushi/log.hpp"
+
+#include "relay.hpp"
+
+namespace utsushi {
+
+struct relay::item
+{
+  octet *data_;
+  streamsize capacity_;
+  streamsize size_;
+  bool is_marker_;
+  traits::int_type mark_;
+  context ctx_;
+
+  item (streamsize size)
+    : data_(new octet[size])
+    , capacity_(size)
+    , size_(0)
+    , is_marker_(false)
+    , mark_(traits::eof ())
+  {}
+
+  ~item ()
+  {
+    delete [] data_;
+  }
+};
+
+relay::relay (streamsize buffer_size, std::size_t depth)
+  : depth_(std::max< std::size_t > (depth, 1))
+  , item_(nullptr)
+  , worker_(nullptr)
+  , pending_(0)
+  , is_stopping_(false)
+  , is_failed_(false)
+{
+  buffer_size_ = buffer_size;
+}
+
+relay::~relay ()
+{
+  if (worker_)
+    {
+      {
+        lock_guard< mutex > lock (mutex_);
+        is_stopping_ = true;
+      }
+      not_empty_.notify_one ();
+      worker_->join ();
+      delete worker_;
+    }
+
+  delete item_;
+  while (!queue_.empty ())
+    {
+      delete queue_.front ();
+      queue_.pop_front ();
+    }
+  while (!free_list_.empty ())
+    {
+      delete free_list_.back ();
+      free_list_.pop_back ();
+    }
+}
+
+streamsize
+relay::write (const octet *data, streamsize n)
+{
+  rethrow_();
+
+  const streamsize rv = n;
+
+  while (0 < n)
+    {
+      if (!item_) item_ = make_item_();
+
+      streamsize m = std::min (n, item_->capacity_ - item_->size_);
+
+      traits::copy (item_->data_ + item_->size_, data, m);
+      item_->size_ += m;
+      data += m;
+      n    -= m;
+
+      if (item_->size_ == item_->capacity_) flush_();
+    }
+  return rv;
+}
+
+void
+relay::mark (traits::int_type c, const context& ctx)
+{
+  if (!traits::is_marker (c)) return;
+
+  // Cancellation is typically marked while unwinding because of some
+  // error.  Throwing then would only make matters worse.
+
+  if (traits::eof () != c) rethrow_();
+
+  flush_();
+
+  item *ip = make_item_();
+  ip->is_marker_ = true;
+  ip->mark_ = c;
+  ip->ctx_ = ctx;
+  enqueue_(ip);
+
+  if (traits::eos () == c || traits::eof () == c)
+    {
+      unique_lock< mutex > lock (mutex_);
+      while (0 < pending_)
+        is_idle_.wait (lock);
+
+      if (traits::eof () == c) error_ = exception_ptr ();
+    }
+
+  if (traits::eos () == c) rethrow_();
+}
+
+void
+relay::open (output::ptr output)
+{
+  output_ = output;
+}
+
+//! Queues whatever image data has been collected so far
+void
+relay::flush_()
+{
+  if (!item_) return;
+
+  if (0 < item_->size_)
+    {
+      enqueue_(item_);
+    }
+  else
+    {
+      lock_guard< mutex > lock (mutex_);
+      recycle_(item_);
+    }
+
+  item_ = nullptr;
+}
+
+//! Hands \a ip to the worker, starting it if necessary
+/*! This blocks while the queue is full.
+ */
+void
+relay::enqueue_(item *ip)
+{
+  {
+    unique_lock< mutex > lock (mutex_);
+
+    if (!worker_) worker_ = new thread (&relay::work_, this);
+
+    while (depth_ <= queue_.size ())
+      not_full_.wait (lock);
+
+    queue_.push_back (ip);
+    ++pending_;
+  }
+  not_empty_.notify_one ();
+}
+
+//! Passes any error the worker ran into on to the caller
+void
+relay::rethrow_()
+{
+  exception_ptr e;
+  {
+    lock_guard< mutex > lock (mutex_);
+    if (!error_) return;
+    e = error_;
+    error_ = exception_ptr ();
+  }
+  rethrow_exception (e);
+}
+
+relay::item *
+relay::make_item_()
+{
+  item *rv = nullptr;
+  {
+    lock_guard< mutex > lock (mutex_);
+    if (!free_list_.empty ())
+      {
+        rv = free_list_.back ();
+        free_list_.pop_back ();
+      }
+  }
+  if (!rv) rv = new item (buffer_size_);
+
+  rv->size_ = 0;
+  rv->is_marker_ = false;
+  return rv;
+}
+
+//! Keeps \a ip around for reuse
+/*! \note  The caller needs to hold the mutex_.
+ */
+void
+relay::recycle_(item *ip)
+{
+  if (free_list_.size () < depth_ + 1)
+    free_list_.push_back (ip);
+  else
+    delete ip;
+}
+
+void
+relay::work_()
+{
+  unique_lock< mutex > lock (mutex_);
+
+  for (;;)
+    {
+      while (queue_.empty () && !is_stopping_)
+        not_empty_.wait (lock);
+
+      if (queue_.empty ()) return;
+
+      item *ip = queue_.front ();
+      queue_.pop_front ();
+      not_full_.notify_one ();
+
+      lock.unlock ();
+      process_(ip);
+      lock.lock ();
+
+      recycle_(ip);
+      if (0 == --pending_) is_idle_.notify_all ();
+    }
+}
+
+//! Passes what \a ip holds on to the output_
+/*! Once something has gone wrong, everything is dropped until the end
+ *  of the sequence.  The output_ is only told about cancellation.
+ */
+void
+relay::process_(item *ip)
+{
+  const bool is_end = (ip->is_marker_
+                       && (traits::eos () == ip->mark_
+                           || traits::eof () == ip->mark_));
+
+  if (is_failed_)
+    {
+      if (ip->is_marker_ && traits::eof () == ip->mark_)
+        {
+          try
+            {
+              output_->mark (ip->mark_, ip->ctx_);
+            }
+          catch (...)
+            {}
+        }
+      if (is_end) is_failed_ = false;
+      return;
+    }
+
+  try
+    {
+      if (ip->is_marker_)
+        {
+          output_->mark (ip->mark_, ip->ctx_);
+        }
+      else
+        {
+          const octet *p = ip->data_;
+          streamsize   n = ip->size_;
+
+          while (0 < n)
+            {
+              streamsize m = output_->write (p, n);
+              if (0 == m) log::trace ("relay: cannot write to output");
+              p += m;
+              n -= m;
+            }
+        }
+    }
+  catch (...)
+    {
+      lock_guard< mutex > lock (mutex_);
+      error_ = current_exception ();
+      is_failed_ = !is_end;
+    }
+}
+
+}       // namespace utsushi
@@ -0,0 +1,110 @@
+//  relay.hpp -- image data hand-off to a thread of its own
+//  Copyright (C) 2026  SEIKO EPSON CORPORATION
+//
+//  License: GPL-3.0+
+//  Author : EPSON AVASYS CORPORATION
+//
+//  This file is part of the 'Utsushi' package.
+//  This package is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License or, at
+//  your option, any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//  You ought to have received a copy of the GNU General Public License
+//  along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef _relay_hpp_
+#define _relay_hpp_
+
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+#include "utsushi/condition-variable.hpp"
+#include "utsushi/exception.hpp"
+#include "utsushi/iobase.hpp"
+#include "utsushi/mutex.hpp"
+#include "utsushi/thread.hpp"
+
+namespace utsushi {
+
+//!  Run an %output on a thread of its own
+/*!  A %relay collects image data like a buffer does but, rather than
+ *   writing it to its %output itself, queues it for a worker thread.
+ *   Markers are queued in between the image data so the %output sees
+ *   everything in the original order.  This way, the %output and all
+ *   that it delegates to run concurrently with whatever feeds a relay.
+ *
+ *   The queue holds at most \c depth runs of image data.  Writing to
+ *   a full queue blocks until the worker has caught up.  Marking the
+ *   end of a sequence blocks until the worker has dealt with all that
+ *   was queued so that a sequence has been completely processed when
+ *   mark() returns, just like without a relay.
+ *
+ *   Any exception the worker runs into is rethrown to the thread that
+ *   feeds the relay, on its next call of write() or mark().  Until the
+ *   sequence ends, the worker then drops everything but a cancelling
+ *   traits::eof() marker.
+ */
+class relay
+  : public output
+{
+public:
+  typedef shared_ptr< relay > ptr;
+
+  static const std::size_t default_depth = 4;
+
+  relay (streamsize buffer_size = default_buffer_size,
+         std::size_t depth = default_depth);
+  ~relay ();
+
+  streamsize write (const octet *data, streamsize n);
+  void mark (traits::int_type c, const context& ctx);
+
+  //!  Sets a relay's underlying output object
+  void open (output::ptr output);
+
+private:
+  struct item;
+
+  void flush_();
+  void enqueue_(item *ip);
+  void rethrow_();
+
+  item * make_item_();
+  void recycle_(item *ip);
+
+  void work_();
+  void process_(item *ip);
+
+  output::ptr output_;
+  std::size_t depth_;
+
+  item *item_;                  //!< run of image data being collected
+
+  thread *worker_;
+  mutex mutex_;
+  condition_variable not_empty_;
+  condition_variable not_full_;
+  condition_variable is_idle_;
+
+  std::deque< item * > queue_;
+  std::vector< item * > free_list_;
+  std::size_t pending_;         //!< queued or being processed
+  bool is_stopping_;
+
+  exception_ptr error_;
+  bool is_failed_;
+
+  relay (const relay&);
+  relay& operator= (const relay&);
+};
+
+}       // namespace utsushi
+
+#endif  /* _relay_hpp_ */
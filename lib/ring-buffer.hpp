@@ -0,0 +1,150 @@
+//  ring-buffer.hpp -- lock-free hand-off between two threads
+//  Copyright (C) 2026  SEIKO EPSON CORPORATION
+//
+//  License: GPL-3.0+
+//  Author : EPSON AVASYS CORPORATION
+//
+//  This file is part of the 'Utsushi' package.
+//  This package is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License or, at
+//  your option, any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//  You ought to have received a copy of the GNU General Public License
+//  along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef _ring_buffer_hpp_
+#define _ring_buffer_hpp_
+
+#include <cstddef>
+
+#include "utsushi/atomic.hpp"
+
+namespace utsushi {
+
+//! Fixed capacity queue for a single producer and a single consumer
+/*! Exactly one thread may push() and exactly one other thread may
+ *  pop() at any given time.  Neither operation ever blocks or takes
+ *  a lock.  It is up to the caller to decide what to do when push()
+ *  finds the queue full or pop() finds it empty.
+ *
+ *  The capacity is rounded up to the nearest power of two.  Changing
+ *  it with reserve() is only safe while no other thread accesses the
+ *  queue and drops anything still queued.
+ */
+template< typename T >
+class ring_buffer
+{
+public:
+  typedef std::size_t size_type;
+
+  explicit ring_buffer (size_type capacity = 0)
+    : ring_(nullptr)
+    , mask_(0)
+    , head_(0)
+    , tail_(0)
+  {
+    reserve (capacity);
+  }
+
+  ~ring_buffer ()
+  {
+    delete [] ring_;
+  }
+
+  void reserve (size_type capacity)
+  {
+    size_type n = 1;
+    while (n < capacity) n <<= 1;
+
+    if (ring_ && n == mask_ + 1)
+      {
+        clear ();
+        return;
+      }
+
+    delete [] ring_;
+    ring_ = new T[n];
+    mask_ = n - 1;
+    clear ();
+  }
+
+  void clear ()
+  {
+    head_.store (0, memory_order_relaxed);
+    tail_.store (0, memory_order_relaxed);
+  }
+
+  size_type capacity () const
+  {
+    return mask_ + 1;
+  }
+
+  //! Returns a snapshot of the number of queued elements
+  size_type size () const
+  {
+    return (tail_.load (memory_order_acquire)
+            - head_.load (memory_order_acquire));
+  }
+
+  bool empty () const
+  {
+    return 0 == size ();
+  }
+
+  //! Appends \a t unless the queue is full
+  /*! \return \c true if \a t was queued, \c false otherwise
+   */
+  bool push (const T& t)
+  {
+    const size_type tail = tail_.load (memory_order_relaxed);
+
+    if (tail - head_.load (memory_order_acquire) > mask_)
+      return false;
+
+    ring_[tail & mask_] = t;
+    tail_.store (tail + 1, memory_order_release);
+    return true;
+  }
+
+  //! Removes the oldest element and stores it in \a t
+  /*! \return \c true if an element was removed, \c false if the
+   *          queue is empty.  In the latter case \a t is untouched.
+   */
+  bool pop (T& t)
+  {
+    const size_type head = head_.load (memory_order_relaxed);
+
+    if (head == tail_.load (memory_order_acquire))
+      return false;
+
+    t = ring_[head & mask_];
+    head_.store (head + 1, memory_order_release);
+    return true;
+  }
+
+private:
+  T *ring_;
+  size_type mask_;
+
+  // Give the producer's and consumer's indices their own cache line
+  // so the two threads do not keep stealing it from each other.
+
+  char pad0_[64];
+  atomic< size_type > head_;
+  char pad1_[64 - sizeof (atomic< size_type >)];
+  atomic< size_type > tail_;
+  char pad2_[64 - sizeof (atomic< size_type >)];
+
+  ring_buffer (const ring_buffer&);
+  ring_buffer& operator= (const ring_buffer&);
+};
+
+}       // namespace utsushi
+
+#endif  /* _ring_buffer_hpp_ */
@@ -24,8 +24,15 @@
 
 #include "utsushi/stream.hpp"
 
+#include "profiler.hpp"
+#include "relay.hpp"
+
 namespace utsushi {
 
+stream::stream ()
+  : profiler_(profiler::create ())
+{}
+
 streamsize
 stream::write (const octet *data, streamsize n)
 {
@@ -35,20 +42,35 @@ stream::write (const octet *data, streamsize n)
 void
 stream::mark (traits::int_type c, const context& ctx)
 {
-  out_bottom_->mark (c, ctx);
+  if (!profiler_ || !(traits::eos () == c || traits::eof () == c))
+    {
+      out_bottom_->mark (c, ctx);
+      return;
+    }
+
+  try
+    {
+      out_bottom_->mark (c, ctx);
+    }
+  catch (...)
+    {
+      profiler_->report ();
+      throw;
+    }
+  profiler_->report ();
 }
 
 void
-stream::push (odevice::ptr device)
+stream::push (odevice::ptr device, launch policy)
 {
-  push (device, device);
+  push (device, device, policy);
   device_ = device;
 }
 
 void
-stream::push (filter::ptr filter)
+stream::push (filter::ptr filter, launch policy)
 {
-  push (filter, filter);
+  push (filter, filter, policy);
   filter_ = filter;
 }
 
@@ -65,16 +87,37 @@ stream::get_device () const
 }
 
 void
-stream::attach (output::ptr out, device_ptr device,
-                output::ptr buf, buffer::ptr buffer)
+stream::attach (output::ptr out, device_ptr device, output::ptr buffer)
 {
   if (buffer) {
-    buffer ->open (out);
-    filter_->open (buf);
+    filter_->open (buffer);
   } else {
     out_bottom_ = out;
     dev_bottom_ = device;
   }
 }
 
+output::ptr
+stream::instrument (output::ptr out)
+{
+  return (profiler_ ? profiler_->instrument (out) : out);
+}
+
+output::ptr
+stream::link (output::ptr out, streamsize size, launch policy)
+{
+  if (asynchronous == policy)
+    {
+      relay::ptr rv = make_shared< relay > (size);
+      // time spent waiting for the other thread to catch up
+      output::ptr wait = instrument (rv);
+      rv->open (instrument (out));
+      return wait;
+    }
+
+  buffer::ptr rv = make_shared< buffer > (size);
+  rv->open (instrument (out));
+  return rv;
+}
+
 }       // namespace utsushi
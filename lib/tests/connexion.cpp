@@ -22,9 +22,17 @@
 #include <config.h>
 #endif
 
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+
+#include <boost/filesystem.hpp>
 #include <boost/test/unit_test.hpp>
 
 #include "utsushi/connexion.hpp"
+#include "utsushi/memory.hpp"
+
+#include "../../connexions/capture.hpp"
 
 struct connexion
   : public utsushi::ipc::connexion
@@ -37,6 +45,29 @@ struct connexion
   using utsushi::ipc::connexion::pid_;
   using utsushi::ipc::connexion::port_;
   using utsushi::ipc::connexion::socket_;
+  using utsushi::ipc::connexion::shm_;
+};
+
+//! A connexion to a device that has gone away
+struct broken
+  : public utsushi::connexion
+{
+  void send (const utsushi::octet *, utsushi::streamsize)
+  {
+    throw std::runtime_error ("device gone");
+  }
+  void send (const utsushi::octet *message, utsushi::streamsize size, double)
+  {
+    send (message, size);
+  }
+  void recv (utsushi::octet *, utsushi::streamsize)
+  {
+    throw std::runtime_error ("device gone");
+  }
+  void recv (utsushi::octet *message, utsushi::streamsize size, double)
+  {
+    recv (message, size);
+  }
 };
 
 BOOST_AUTO_TEST_CASE (process_lifetime)
@@ -61,4 +92,125 @@ BOOST_AUTO_TEST_CASE (simple_xfer)
   BOOST_CHECK_EQUAL (std::string ("HELLO"), ibuf);
 }
 
+BOOST_AUTO_TEST_CASE (shared_memory_xfer)
+{
+  connexion cnx ("ipc-cnx", "path");
+
+  BOOST_REQUIRE (cnx.shm_);
+
+  std::string obuf (1024 * 1024, 'x');
+  obuf[0] = 'a';
+  obuf[obuf.size () - 1] = 'z';
+
+  for (int i = 0; i < 2; ++i)   // helper alternates shm offsets
+    {
+      std::string ibuf (obuf.size (), '\0');
+
+      cnx.send (obuf.data (), obuf.size ());
+      cnx.recv (&ibuf[0], ibuf.size ());
+
+      BOOST_CHECK_EQUAL ('A', ibuf[0]);
+      BOOST_CHECK_EQUAL ('X', ibuf[ibuf.size () / 2]);
+      BOOST_CHECK_EQUAL ('Z', ibuf[ibuf.size () - 1]);
+    }
+}
+
+BOOST_AUTO_TEST_CASE (tcp_xfer)
+{
+  setenv ("IPC_CNX_USE_TCP", "1", 1);
+  connexion cnx ("ipc-cnx", "path");
+  unsetenv ("IPC_CNX_USE_TCP");
+
+  BOOST_CHECK_LT (0, cnx.port_);
+  BOOST_CHECK (!cnx.shm_);
+
+  utsushi::octet obuf[] = "hello";
+  utsushi::octet ibuf[] = "hello";
+
+  cnx.send (obuf, sizeof (obuf));
+  cnx.recv (ibuf, sizeof (ibuf));
+
+  BOOST_CHECK_EQUAL (std::string ("HELLO"), ibuf);
+}
+
+BOOST_AUTO_TEST_CASE (record_and_replay)
+{
+  const std::string capture ("connexion.cap");
+
+  utsushi::octet obuf[] = "hello";
+  utsushi::octet ibuf[] = "hello";
+  utsushi::octet jbuf[] = "hi";
+
+  setenv (PACKAGE_ENV_VAR_PREFIX "CNX_RECORD", capture.c_str (), 1);
+  {
+    utsushi::connexion::ptr cnx
+      = utsushi::connexion::create ("ipc-cnx", "path");
+    utsushi::connexion::ptr cnx2
+      = utsushi::connexion::create ("ipc-cnx", "path");
+
+    cnx->send (obuf, sizeof (obuf));
+    cnx->recv (ibuf, sizeof (ibuf));
+    cnx2->send (jbuf, sizeof (jbuf));
+    cnx2->recv (jbuf, sizeof (jbuf));
+  }
+  unsetenv (PACKAGE_ENV_VAR_PREFIX "CNX_RECORD");
+
+  utsushi::connexion::ptr cnx
+    = utsushi::connexion::create ("replay", capture);
+  utsushi::octet rbuf[] = "?????";
+
+  cnx->send (obuf, sizeof (obuf));
+  cnx->recv (rbuf, sizeof (rbuf));
+
+  BOOST_CHECK_EQUAL (std::string ("HELLO"), rbuf);
+  BOOST_CHECK_THROW (cnx->recv (rbuf, sizeof (rbuf)), std::runtime_error);
+
+  utsushi::connexion::ptr cnx2
+    = utsushi::connexion::create ("replay", capture + ".1");
+  utsushi::octet sbuf[] = "hi";
+
+  cnx2->send (sbuf, sizeof (sbuf));
+  cnx2->recv (sbuf, sizeof (sbuf));
+
+  BOOST_CHECK_EQUAL (std::string ("HI"), sbuf);
+
+  utsushi::connexion::ptr diverging
+    = utsushi::connexion::create ("replay", capture);
+  utsushi::octet xbuf[] = "world";
+
+  BOOST_CHECK_THROW (diverging->send (xbuf, sizeof (xbuf)),
+                     std::runtime_error);
+
+  boost::filesystem::remove (capture);
+  boost::filesystem::remove (capture + ".1");
+}
+
+BOOST_AUTO_TEST_CASE (record_and_replay_failure)
+{
+  const std::string capture ("failure.cap");
+
+  utsushi::octet buf[] = "hello";
+  {
+    utsushi::connexion::ptr cnx (utsushi::make_shared< broken > ());
+    utsushi::libcnx_capture_LTX_record_factory (cnx, capture);
+
+    BOOST_CHECK_THROW (cnx->send (buf, sizeof (buf)), std::runtime_error);
+  }
+
+  utsushi::connexion::ptr cnx
+    = utsushi::connexion::create ("replay", capture);
+
+  try
+    {
+      cnx->send (buf, sizeof (buf));
+      BOOST_ERROR ("replayed failure did not throw");
+    }
+  catch (const std::runtime_error& e)
+    {
+      BOOST_CHECK_EQUAL (std::string ("device gone"), e.what ());
+    }
+
+  boost::filesystem::remove (capture);
+}
+
 #include "utsushi/test/runner.ipp"
@@ -31,6 +31,8 @@
 
 #include <boost/filesystem.hpp>
 
+#include <algorithm>
+
 using namespace utsushi;
 
 using boost::filesystem::file_size;
@@ -319,6 +321,54 @@ BOOST_AUTO_TEST_CASE (multi_ifile)
   }
 }
 
+/*!  Test whether reading blocks yields the same image data as reading
+ *   into a buffer of our own
+ */
+BOOST_AUTO_TEST_CASE (zero_copy_ifile)
+{
+  const streamsize octets = (8 << 10) + 1;
+  const std::string name ("file-zero-copy.in");
+  {
+    rawmem_idevice idev (octets);
+    file_odevice   odev (name);
+    idev | odev;
+  }
+
+  file_idevice copy (name);
+  file_idevice zero (name);
+  BOOST_CHECK (!zero.is_zero_copy ());
+
+  const streamsize n = 1 << 10;
+  octet data[n];
+  block blk;
+
+  BOOST_CHECK_EQUAL (traits::bos (), copy.read (data, n));
+  BOOST_CHECK_EQUAL (traits::boi (), copy.read (data, n));
+  BOOST_CHECK_EQUAL (traits::bos (), zero.read (blk, n));
+  BOOST_CHECK_EQUAL (traits::boi (), zero.read (blk, n));
+  BOOST_CHECK (blk.empty ());
+  BOOST_CHECK (zero.is_zero_copy ());
+
+  streamsize count = 0;
+  streamsize rv_copy = copy.read (data, n);
+  streamsize rv_zero = zero.read (blk, n);
+  while (0 < rv_copy)
+    {
+      BOOST_REQUIRE_EQUAL (rv_copy, rv_zero);
+      BOOST_REQUIRE_EQUAL (rv_zero, blk.size ());
+      BOOST_CHECK (std::equal (data, data + rv_copy, blk.data ()));
+      count  += rv_copy;
+      rv_copy = copy.read (data, n);
+      rv_zero = zero.read (blk, n);
+    }
+  BOOST_CHECK_EQUAL (traits::eoi (), rv_copy);
+  BOOST_CHECK_EQUAL (traits::eoi (), rv_zero);
+  BOOST_CHECK (blk.empty ());
+  BOOST_CHECK_EQUAL (octets, count);
+
+  remove (name);
+}
+
 struct named_file_fixture
 {
   const streamsize  octet_count;
@@ -29,6 +29,8 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <unistd.h>
@@ -53,22 +55,43 @@ struct packet
     delete [] payload;
   }
 
-  void recv (int sock);
+  void recv (int sock, int& fd);
   void send (int sock);
 
   octet    *payload;
 };
 
+//!  Receives a packet and a file descriptor \a fd, if one is attached
 void
-packet::recv (int sock)
+packet::recv (int sock, int& fd)
 {
-  read (sock, reinterpret_cast< octet * > (this), sizeof (ipc::header));
+  struct iovec iov;
+  iov.iov_base = static_cast< ipc::header * > (this);
+  iov.iov_len  = sizeof (ipc::header);
+
+  char control[CMSG_SPACE (sizeof (fd))];
+
+  struct msghdr msg;
+  memset (&msg, 0, sizeof (msg));
+  msg.msg_iov        = &iov;
+  msg.msg_iovlen     = 1;
+  msg.msg_control    = control;
+  msg.msg_controllen = sizeof (control);
+
+  fd = -1;
+  if (0 < recvmsg (sock, &msg, 0))
+    {
+      struct cmsghdr *cmsg = CMSG_FIRSTHDR (&msg);
+      if (cmsg && SCM_RIGHTS == cmsg->cmsg_type)
+        memcpy (&fd, CMSG_DATA (cmsg), sizeof (fd));
+    }
 
   if (0 < this->size ())
     {
       delete [] payload;
       payload = new octet[this->size ()];
-      read (sock, payload, this->size ());
+      for (streamsize n = 0, t = 1; n < this->size () && 0 < t; n += t)
+        t = read (sock, payload + n, this->size () - n);
     }
 }
 
@@ -87,17 +110,16 @@ hangup (int signum)
   exit (signum == SIGHUP ? EXIT_SUCCESS : EXIT_FAILURE);
 }
 
-}
-
+//!  Sets up a TCP socket, the way helper programs traditionally do
 int
-main (int argc, char *argv[])
+accept_tcp ()
 {
   errno = 0;
   int s = socket (AF_INET, SOCK_STREAM, 0);
   if (0 > s)
     {
       log::fatal ("socket: %1%") % strerror (errno);
-      return EXIT_FAILURE;
+      exit (EXIT_FAILURE);
     }
 
   struct sockaddr_in addr;
@@ -111,7 +133,7 @@ main (int argc, char *argv[])
   if (rv)
     {
       log::fatal ("bind: %1%") % strerror (errno);
-      return EXIT_FAILURE;
+      exit (EXIT_FAILURE);
     }
 
   socklen_t n = sizeof (addr);
@@ -120,7 +142,7 @@ main (int argc, char *argv[])
   if (rv)
     {
       log::fatal ("getsockname: %1%") % strerror (errno);
-      return EXIT_FAILURE;
+      exit (EXIT_FAILURE);
     }
 
   std::cout << ntohs (addr.sin_port) << std::endl;
@@ -130,7 +152,7 @@ main (int argc, char *argv[])
   if (rv)
     {
       log::fatal ("listen: %1%") % strerror (errno);
-      return EXIT_FAILURE;
+      exit (EXIT_FAILURE);
     }
 
   errno = 0;
@@ -138,28 +160,88 @@ main (int argc, char *argv[])
   if (0 > as)
     {
       log::fatal ("accept: %1%") % strerror (errno);
-      return EXIT_FAILURE;
+      exit (EXIT_FAILURE);
+    }
+  return as;
+}
+
+}
+
+//!  Replies with the upper case version of every message received
+/*!  The Unix domain socket and shared memory offered by the parent
+ *   are used unless \c IPC_CNX_USE_TCP is set in the environment.
+ */
+int
+main (int argc, char *argv[])
+{
+  using utsushi::ipc::header;
+
+  int as = -1;
+  const char *env = getenv (PACKAGE_ENV_VAR_PREFIX "IPC_SOCKET");
+
+  if (env && !getenv ("IPC_CNX_USE_TCP"))
+    {
+      as = atoi (env);
+      std::cout << 0 << std::endl;
+    }
+  else
+    {
+      as = accept_tcp ();
     }
 
   std::signal (SIGHUP, hangup);
 
+  octet     *shm = nullptr;
+  streamsize shm_size = 0;
+  streamsize shm_offset = 0;
+
   for (;;)
     {
-      using utsushi::ipc::header;
-
       packet p;
+      int fd;
 
-      p.recv (as);
+      p.recv (as, fd);
 
       /**/ if (!p.type ())
         {
           p.error (0);
           for (streamsize i = 0; i < p.size (); ++i)
             p.payload[i] = std::toupper (p.payload[i]);
-          p.send (as);
+
+          if (shm && p.size () <= shm_size)
+            {
+              // Alternate between the start and end of shared memory
+              // to check that the offset is honoured.
+
+              shm_offset = (shm_offset ? 0 : shm_size - p.size ());
+              memcpy (shm + shm_offset, p.payload, p.size ());
+
+              uint32_t offset = htonl (shm_offset);
+              p.type (header::SHARED);
+              write (as, static_cast< ipc::header * > (&p),
+                     sizeof (ipc::header));
+              write (as, &offset, sizeof (offset));
+            }
+          else
+            {
+              p.send (as);
+            }
         }
       else if (header::OPEN == p.type ())
         {
+          struct stat st;
+          if (0 <= fd && 0 == fstat (fd, &st))
+            {
+              void *m = mmap (nullptr, st.st_size, PROT_READ | PROT_WRITE,
+                              MAP_SHARED, fd, 0);
+              if (MAP_FAILED != m)
+                {
+                  shm = static_cast< octet * > (m);
+                  shm_size = st.st_size;
+                }
+            }
+          if (0 <= fd) close (fd);
+
           p.error (0);
           p.size (0);
           p.send (as);
@@ -43,7 +43,9 @@
 #endif
 #define ENABLE_LOG_QUARK UTSUSHI_LOG_ARGUMENT_COUNT_CHECK_ENABLED
 
+#include "utsushi/atomic.hpp"
 #include "utsushi/log.hpp"
+#include "utsushi/thread.hpp"
 
 using namespace utsushi;
 
@@ -194,6 +196,86 @@ BOOST_FIXTURE_TEST_CASE (quark_verbosity, fixture)
   BOOST_CHECK_EQUAL (ENABLE_LOG_QUARK, !s.str ().empty ());
 }
 
+static void
+log_from_thread (int i)
+{
+  log::alert ("thread %1%") % i;
+}
+
+BOOST_FIXTURE_TEST_CASE (asynchronous_output, fixture)
+{
+  log::asynchronous (true);
+
+  log::alert ("first");
+  {
+    thread t (log_from_thread, 1);
+    t.join ();
+  }
+  log::trace ("suppressed");
+  log::alert ("last");
+
+  log::flush ();
+  log::asynchronous (false);
+
+  std::string out = s.str ();
+  std::string::size_type first  = out.find ("]: first\n");
+  std::string::size_type thread = out.find ("]: thread 1\n");
+  std::string::size_type last   = out.find ("]: last\n");
+
+  BOOST_REQUIRE (std::string::npos != first);
+  BOOST_REQUIRE (std::string::npos != thread);
+  BOOST_REQUIRE (std::string::npos != last);
+  BOOST_CHECK (first < thread && thread < last);
+  BOOST_CHECK_EQUAL (std::string::npos, out.find ("suppressed"));
+}
+
+static void
+flush_until (const atomic< bool > *done)
+{
+  while (!done->load ())
+    log::flush ();
+}
+
+BOOST_FIXTURE_TEST_CASE (asynchronous_output_while_draining, fixture)
+{
+  const int rounds = 200;
+
+  log::asynchronous (true);
+
+  atomic< bool > done (false);
+  thread drainer (flush_until, &done);
+  for (int i = 0; i < rounds; ++i)
+    {
+      log::alert ("before %1%") % i;
+      {
+        thread t (log_from_thread, i);
+        t.join ();
+      }
+      log::alert ("after %1%") % i;
+    }
+  done.store (true);
+  drainer.join ();
+
+  log::flush ();
+  log::asynchronous (false);
+
+  std::string out = s.str ();
+  for (int i = 0; i < rounds; ++i)
+    {
+      std::ostringstream n;
+      n << i << "\n";
+
+      std::string::size_type before = out.find ("]: before " + n.str ());
+      std::string::size_type thread = out.find ("]: thread " + n.str ());
+      std::string::size_type after  = out.find ("]: after "  + n.str ());
+
+      BOOST_REQUIRE (std::string::npos != before);
+      BOOST_REQUIRE (std::string::npos != thread);
+      BOOST_REQUIRE (std::string::npos != after);
+      BOOST_CHECK (before < thread && thread < after);
+    }
+}
+
 template <typename charT, typename fmtT>
 void
 verbosity (log::priority level)
@@ -0,0 +1,167 @@
+//  pool.cpp -- unit tests for the pool implementation
+//  Copyright (C) 2026  SEIKO EPSON CORPORATION
+//
+//  License: GPL-3.0+
+//  Author : EPSON AVASYS CORPORATION
+//
+//  This file is part of the 'Utsushi' package.
+//  This package is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License or, at
+//  your option, any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//  You ought to have received a copy of the GNU General Public License
+//  along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <boost/test/unit_test.hpp>
+
+#include "utsushi/pool.hpp"
+#include "utsushi/stream.hpp"
+#include "utsushi/test/memory.hpp"
+#include "utsushi/thread.hpp"
+
+#include <unistd.h>
+
+#include <stdexcept>
+#include <vector>
+
+using namespace utsushi;
+
+//!  Replaces image data with the number of the image
+class numbering_filter : public filter
+{
+  octet count_;
+
+public:
+  numbering_filter () : count_(0) {}
+
+  streamsize write (const octet *data, streamsize n)
+  {
+    std::vector< octet > v (n, count_);
+    return output_->write (&v[0], n);
+  }
+
+protected:
+  void eoi (const context&) { ++count_; }
+};
+
+//!  Takes longer for earlier images so that workers finish out of order
+class sleepy_filter : public filter
+{
+  streamsize delay_;
+
+public:
+  sleepy_filter () : delay_(0) {}
+
+  streamsize write (const octet *data, streamsize n)
+  {
+    if (0 > delay_) delay_ = 1000 * (8 - data[0] % 8);
+    return output_->write (data, n);
+  }
+
+  filter::ptr clone () const { return make_shared< sleepy_filter > (); }
+
+protected:
+  void boi (const context& ctx)
+  {
+    filter::boi (ctx);
+    delay_ = -1;
+  }
+
+  void eoi (const context& ctx)
+  {
+    usleep (delay_);
+    filter::eoi (ctx);
+  }
+};
+
+struct pool_fixture
+{
+  const streamsize octet_count;
+  const unsigned   image_count;
+
+  idevice::ptr iptr;
+  shared_ptr< tally_odevice > optr;
+  pool::ptr pptr;
+  stream str;
+
+  pool_fixture ()
+    : octet_count (3 * 8192 + 5), image_count (24)
+    , iptr (make_shared< rawmem_idevice > (octet_count, image_count))
+    , optr (make_shared< tally_odevice > ())
+    , pptr (make_shared< pool > (4))
+  {}
+
+  void check_order ()
+  {
+    BOOST_REQUIRE_EQUAL (image_count, optr->images);
+    BOOST_REQUIRE_EQUAL (image_count, optr->firsts.size ());
+    for (unsigned i = 0; i < image_count; ++i)
+      BOOST_CHECK_EQUAL (i, unsigned (optr->firsts[i]));
+    BOOST_CHECK_EQUAL (image_count * octet_count, optr->octets);
+    BOOST_CHECK (!optr->is_mixed);
+  }
+};
+
+BOOST_FIXTURE_TEST_SUITE (ordering, pool_fixture);
+
+BOOST_AUTO_TEST_CASE (uncloneable_filter)
+{
+  pptr->push (make_shared< sleepy_filter > ());
+  pptr->push (make_shared< thru_filter > ()); // not cloneable
+
+  str.push (make_shared< numbering_filter > ());
+  str.push (pptr);
+  str.push (optr);
+
+  BOOST_CHECK_EQUAL (traits::eos (), *iptr | str);
+  check_order ();
+}
+
+BOOST_AUTO_TEST_CASE (cloned_filters)
+{
+  pptr->push (make_shared< sleepy_filter > ());
+  pptr->push (make_shared< sleepy_filter > ());
+
+  str.push (make_shared< numbering_filter > ());
+  str.push (pptr);
+  str.push (optr);
+
+  BOOST_CHECK_EQUAL (traits::eos (), *iptr | str);
+  check_order ();
+}
+
+BOOST_AUTO_TEST_CASE (no_filters)
+{
+  str.push (make_shared< numbering_filter > ());
+  str.push (pptr);
+  str.push (optr);
+
+  BOOST_CHECK_EQUAL (traits::eos (), *iptr | str);
+  check_order ();
+}
+
+BOOST_AUTO_TEST_CASE (failing_filter)
+{
+  pptr->push (make_shared< ::failing_filter > ());
+
+  str.push (make_shared< numbering_filter > ());
+  str.push (pptr);
+  str.push (optr);
+
+  BOOST_CHECK_THROW (*iptr | str, std::runtime_error);
+  BOOST_CHECK_EQUAL (0, optr->octets);
+}
+
+BOOST_AUTO_TEST_SUITE_END ();
+
+#include "utsushi/test/runner.ipp"
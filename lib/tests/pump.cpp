@@ -0,0 +1,503 @@
+//  pump.cpp -- unit tests for the pump implementation
+//  Copyright (C) 2026  SEIKO EPSON CORPORATION
+//
+//  License: GPL-3.0+
+//  Author : EPSON AVASYS CORPORATION
+//
+//  This file is part of the 'Utsushi' package.
+//  This package is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License or, at
+//  your option, any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//  You ought to have received a copy of the GNU General Public License
+//  along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <boost/test/unit_test.hpp>
+
+#include "utsushi/atomic.hpp"
+#include "utsushi/pump.hpp"
+#include "utsushi/test/memory.hpp"
+
+#include <unistd.h>
+
+#include <cstdlib>
+#include <limits>
+#include <new>
+#include <stdexcept>
+
+using namespace utsushi;
+
+//  Buckets are the only things in a pump that allocate arrays of this
+//  many octets.  Keeping count of those lets the tests see how often a
+//  pump allocates and releases them.
+
+const streamsize bucket_size = 4099;
+
+static atomic< long > buckets_allocated (0);
+static atomic< long > buckets_released (0);
+
+void *
+operator new[] (std::size_t n)
+{
+  std::size_t *p = static_cast< std::size_t * >
+    (std::malloc (n + 2 * sizeof (std::size_t)));
+
+  if (!p) throw std::bad_alloc ();
+
+  p[0] = n;
+  if (std::size_t (bucket_size) == n) ++buckets_allocated;
+  return p + 2;
+}
+
+void *
+operator new[] (std::size_t n, const std::nothrow_t&) throw ()
+{
+  try
+    {
+      return operator new[] (n);
+    }
+  catch (const std::bad_alloc&)
+    {
+      return nullptr;
+    }
+}
+
+void
+operator delete[] (void *q) throw ()
+{
+  if (!q) return;
+
+  std::size_t *p = static_cast< std::size_t * > (q) - 2;
+
+  if (std::size_t (bucket_size) == p[0]) ++buckets_released;
+  std::free (p);
+}
+
+//!  Waits up to a few seconds for \a done to become true
+template< typename predicate >
+bool
+eventually (predicate done)
+{
+  for (int i = 0; i < 5000; ++i)
+    {
+      if (done ()) return true;
+      usleep (1000);
+    }
+  return done ();
+}
+
+//!  Devices that count their data reads and honour cancellation requests
+class counting_idevice : public rawmem_idevice
+{
+public:
+  atomic< long > reads;
+  atomic< long > images;
+  atomic< bool > cancelled;
+
+  counting_idevice (streamsize octet_count = -1, unsigned image_count = 1)
+    : rawmem_idevice (octet_count, image_count)
+    , reads (0)
+    , images (0)
+    , cancelled (false)
+  {
+    buffer_size (bucket_size);
+  }
+
+protected:
+  bool set_up_image ()
+  {
+    bool rv = rawmem_idevice::set_up_image ();
+    if (rv) ++images;
+    return rv;
+  }
+
+  streamsize sgetn (octet *data, streamsize n)
+  {
+    if (cancel_requested ())
+      {
+        cancelled = true;
+        return traits::eof ();
+      }
+    streamsize rv = rawmem_idevice::sgetn (data, n);
+    if (0 < rv) ++reads;
+    return rv;
+  }
+};
+
+//!  Devices that only accept as many writes as they have been allowed
+/*!  Every write() blocks until the test allows it to go ahead.  This
+ *   makes for a consumer that is as slow as the test wants it to be.
+ */
+class gated_odevice : public odevice
+{
+public:
+  atomic< long > allowed;
+  atomic< long > entered;
+  atomic< long > writes;
+  streamsize octets;
+  atomic< streamsize > last;
+  bool fail;
+
+  gated_odevice (long allowed = 0)
+    : allowed (allowed), entered (0), writes (0), octets (0)
+    , last (traits::eos ()), fail (false)
+  {}
+
+  void open ()
+  {
+    allowed = std::numeric_limits< long >::max ();
+  }
+
+  streamsize write (const octet *data, streamsize n)
+  {
+    if (fail)
+      BOOST_THROW_EXCEPTION (std::runtime_error ("gated_odevice"));
+
+    ++entered;
+    while (allowed <= writes)
+      usleep (100);
+    ++writes;
+    octets += n;
+    return n;
+  }
+
+  void mark (traits::int_type c, const context& ctx)
+  {
+    odevice::mark (c, ctx);
+    last = c;
+  }
+};
+
+//!  Predicate that holds once a \a flag has been set
+struct is_set
+{
+  const atomic< bool >& flag;
+
+  is_set (const atomic< bool >& flag) : flag (flag) {}
+
+  bool operator() () const { return flag; }
+};
+
+//!  Predicate that holds once a device has seen a \a marker
+struct has_marked
+{
+  const atomic< streamsize >& last;
+  streamsize marker;
+
+  has_marked (const atomic< streamsize >& last, streamsize marker)
+    : last (last), marker (marker)
+  {}
+
+  bool operator() () const { return marker == last; }
+};
+
+//!  Predicate that holds once a \a count has reached some \a value
+struct has_reached
+{
+  const atomic< long >& count;
+  long value;
+
+  has_reached (const atomic< long >& count, long value)
+    : count (count), value (value)
+  {}
+
+  bool operator() () const { return value <= count; }
+};
+
+//!  Predicate that holds once reads have stopped for a while
+struct is_stalled
+{
+  const counting_idevice& dev;
+  long seen;
+
+  is_stalled (const counting_idevice& dev) : dev (dev), seen (-1) {}
+
+  bool operator() ()
+  {
+    long n = dev.reads;
+    if (n != seen)
+      {
+        seen = n;
+        return false;
+      }
+    usleep (50 * 1000);
+    return seen == dev.reads;
+  }
+};
+
+struct pump_fixture
+{
+  long allocated;
+  long released;
+
+  pump_fixture ()
+    : allocated (buckets_allocated)
+    , released (buckets_released)
+  {}
+
+  long allocations () const { return buckets_allocated - allocated; }
+  long releases () const { return buckets_released - released; }
+
+  void limit (pump& p, quantity::integer_type high,
+              quantity::integer_type low)
+  {
+    (*p.options ())["acquire-high-water-buckets"] = quantity (high);
+    (*p.options ())["acquire-low-water-buckets"]  = quantity (low);
+  }
+
+  void limit_octets (pump& p, quantity::integer_type high,
+                     quantity::integer_type low)
+  {
+    (*p.options ())["acquire-high-water"] = quantity (high);
+    (*p.options ())["acquire-low-water"]  = quantity (low);
+  }
+
+  //!  Lets a stalled consumer drain the pump one write() at a time
+  /*!  Acquisition, suspended at a high water mark of \a high buckets,
+   *   must not resume before the consumer got the pump down to \a low
+   *   buckets.  Once resumed, it must fill the pump up to \a high
+   *   again.
+   */
+  void check_suspend_and_resume (counting_idevice& idev,
+                                 gated_odevice& odev, long high, long low)
+  {
+    BOOST_REQUIRE (eventually (has_reached (odev.entered, 1)));
+    BOOST_REQUIRE (eventually (is_stalled (idev)));
+
+    // Leave out the buckets held by the consumer and the acquiring
+    // side.  Depending on when the consumer got started, up to two
+    // sequence markers may have counted towards the high water mark.
+
+    const long stalled = idev.reads;
+    const long queued  = stalled - 2;
+    BOOST_CHECK_LE (high - 3, queued);
+    BOOST_CHECK_LE (queued, high);
+
+    long k = 0;
+    while (k < queued - low - 1)
+      {
+        odev.allowed = ++k;
+        BOOST_REQUIRE (eventually (has_reached (odev.writes, k)));
+        usleep (20 * 1000);
+        BOOST_CHECK_EQUAL (stalled, idev.reads);
+      }
+
+    odev.allowed = ++k;
+    BOOST_CHECK (eventually (has_reached (idev.reads, stalled + 1)));
+    BOOST_REQUIRE (eventually (is_stalled (idev)));
+    BOOST_CHECK_LE (stalled + high - low - 1, idev.reads);
+  }
+};
+
+BOOST_FIXTURE_TEST_SUITE (buckets, pump_fixture);
+
+BOOST_AUTO_TEST_CASE (recycled)
+{
+  const long reads = 2000;
+
+  shared_ptr< counting_idevice > iptr
+    = make_shared< counting_idevice > (reads * bucket_size);
+  shared_ptr< gated_odevice > optr = make_shared< gated_odevice > ();
+  optr->open ();
+  {
+    pump p (iptr);
+    limit (p, 8, 4);
+    p.start (optr);
+  }
+
+  BOOST_CHECK_EQUAL (traits::eos (), optr->last);
+  BOOST_CHECK_EQUAL (reads * bucket_size, optr->octets);
+  BOOST_CHECK_EQUAL (reads, optr->writes);
+
+  // Never more buckets than the high water mark, the pool on the way
+  // back and one on either end of the pump.
+
+  BOOST_CHECK_LT (0, allocations ());
+  BOOST_CHECK_LE (allocations (), 8 + 32 + 2);
+  BOOST_CHECK_EQUAL (allocations (), releases ());
+}
+
+BOOST_AUTO_TEST_CASE (slow_consumer)
+{
+  const long reads = 200;
+  const unsigned images = 3;
+
+  shared_ptr< counting_idevice > iptr
+    = make_shared< counting_idevice > (reads * bucket_size + 17, images);
+  shared_ptr< gated_odevice > optr = make_shared< gated_odevice > ();
+  {
+    pump p (iptr);
+    limit (p, 4, 2);
+    p.start (optr);
+
+    while (optr->writes < images * (reads + 1))
+      {
+        BOOST_CHECK_LE (iptr->reads - optr->writes, 4 + 3);
+        optr->allowed = optr->writes + 1;
+        usleep (100);
+      }
+  }
+
+  BOOST_CHECK_EQUAL (traits::eos (), optr->last);
+  BOOST_CHECK_EQUAL (images * (reads * bucket_size + 17), optr->octets);
+  BOOST_CHECK_EQUAL (allocations (), releases ());
+}
+
+BOOST_AUTO_TEST_CASE (cancel_while_suspended)
+{
+  shared_ptr< counting_idevice > iptr = make_shared< counting_idevice > ();
+  shared_ptr< gated_odevice > optr = make_shared< gated_odevice > ();
+  {
+    pump p (iptr);
+    limit (p, 4, 2);
+    p.start (optr);
+
+    BOOST_REQUIRE (eventually (is_stalled (*iptr)));
+    BOOST_CHECK_LE (iptr->reads, 4 + 2);
+
+    // The consumer is still stuck in its first write() so only the
+    // cancellation can wake up the acquiring side.
+
+    p.cancel ();
+    BOOST_CHECK (eventually (is_set (iptr->cancelled)));
+    BOOST_CHECK_EQUAL (0, optr->writes);
+
+    optr->open ();
+  }
+
+  BOOST_CHECK_EQUAL (traits::eof (), optr->last);
+  BOOST_CHECK_EQUAL (allocations (), releases ());
+}
+
+BOOST_AUTO_TEST_CASE (cleared_on_restart)
+{
+  const long reads = 100;
+
+  shared_ptr< counting_idevice > iptr
+    = make_shared< counting_idevice > (reads * bucket_size);
+  shared_ptr< gated_odevice > optr = make_shared< gated_odevice > ();
+  shared_ptr< gated_odevice > next = make_shared< gated_odevice > ();
+  {
+    pump p (iptr);
+    limit (p, 16, 8);
+    p.start (optr);
+
+    BOOST_REQUIRE (eventually (is_stalled (*iptr)));
+    p.cancel ();
+    optr->open ();
+    BOOST_REQUIRE (eventually (has_marked (optr->last, traits::eof ())));
+
+    // Restarting clears out whatever the cancelled run left behind.
+
+    iptr->reset ();
+    next->open ();
+    p.start (next);
+  }
+
+  BOOST_CHECK_EQUAL (traits::eos (), next->last);
+  BOOST_CHECK_EQUAL (reads * bucket_size, next->octets);
+  BOOST_CHECK_EQUAL (allocations (), releases ());
+}
+
+BOOST_AUTO_TEST_SUITE_END ();
+
+BOOST_FIXTURE_TEST_SUITE (water_marks, pump_fixture);
+
+BOOST_AUTO_TEST_CASE (buckets)
+{
+  shared_ptr< counting_idevice > iptr = make_shared< counting_idevice > ();
+  shared_ptr< gated_odevice > optr = make_shared< gated_odevice > ();
+  {
+    pump p (iptr);
+    limit (p, 8, 2);
+    p.start (optr);
+
+    check_suspend_and_resume (*iptr, *optr, 8, 2);
+
+    p.cancel ();
+    optr->open ();
+  }
+  BOOST_CHECK_EQUAL (traits::eof (), optr->last);
+}
+
+BOOST_AUTO_TEST_CASE (octets)
+{
+  shared_ptr< counting_idevice > iptr = make_shared< counting_idevice > ();
+  shared_ptr< gated_odevice > optr = make_shared< gated_odevice > ();
+  {
+    pump p (iptr);
+    limit_octets (p, 8 * bucket_size, 2 * bucket_size);
+    p.start (optr);
+
+    check_suspend_and_resume (*iptr, *optr, 8, 2);
+
+    p.cancel ();
+    optr->open ();
+  }
+  BOOST_CHECK_EQUAL (traits::eof (), optr->last);
+}
+
+BOOST_AUTO_TEST_CASE (markers_pass)
+{
+  shared_ptr< counting_idevice > iptr
+    = make_shared< counting_idevice > (2 * bucket_size, 3);
+  shared_ptr< gated_odevice > optr = make_shared< gated_odevice > ();
+  {
+    pump p (iptr);
+    limit_octets (p, 3 * bucket_size, 2 * bucket_size);
+    p.start (optr);
+
+    // The consumer holds on to the first bucket.  The rest of the
+    // first two images reaches the high water mark just before the
+    // end of image marker.  That marker still gets through so that
+    // acquisition can move on to the third image.
+
+    BOOST_REQUIRE (eventually (has_reached (optr->entered, 1)));
+    BOOST_CHECK (eventually (has_reached (iptr->images, 3)));
+    BOOST_REQUIRE (eventually (is_stalled (*iptr)));
+    BOOST_CHECK_EQUAL (5, iptr->reads);
+    BOOST_CHECK_EQUAL (0, optr->writes);
+
+    optr->open ();
+  }
+  BOOST_CHECK_EQUAL (traits::eos (), optr->last);
+  BOOST_CHECK_EQUAL (3 * 2 * bucket_size, optr->octets);
+}
+
+BOOST_AUTO_TEST_CASE (released_when_processing_ends)
+{
+  const long reads = 100;
+
+  shared_ptr< counting_idevice > iptr
+    = make_shared< counting_idevice > (reads * bucket_size);
+  shared_ptr< gated_odevice > optr = make_shared< gated_odevice > ();
+  optr->fail = true;
+  {
+    pump p (iptr);
+    limit (p, 4, 2);
+    p.start (optr);
+
+    // Nobody takes buckets off the pump anymore so acquisition has
+    // to carry on regardless of the water marks.
+
+    bool done = eventually (has_reached (iptr->reads, reads));
+    if (!done) p.cancel ();
+    BOOST_CHECK (done);
+  }
+  BOOST_CHECK_EQUAL (traits::eof (), optr->last);
+  BOOST_CHECK_EQUAL (allocations (), releases ());
+}
+
+BOOST_AUTO_TEST_SUITE_END ();
+
+#include "utsushi/test/runner.ipp"
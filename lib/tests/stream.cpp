@@ -26,9 +26,17 @@
 
 #include "utsushi/device.hpp"
 #include "utsushi/filter.hpp"
+#include "utsushi/format.hpp"
 #include "utsushi/stream.hpp"
 #include "utsushi/test/memory.hpp"
 #include "utsushi/test/null.hpp"
+#include "utsushi/thread.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
 
 using namespace utsushi;
 
@@ -141,4 +149,104 @@ BOOST_AUTO_TEST_CASE (counting_images)
 
 BOOST_AUTO_TEST_SUITE_END ();
 
+struct async_fixture
+{
+  const streamsize octet_count;
+  const unsigned   image_count;
+
+  idevice::ptr iptr;
+  shared_ptr< tally_odevice > optr;
+  stream str;
+
+  async_fixture ()
+    : octet_count (30 * 8192 + 1), image_count (3)
+    , iptr (make_shared< rawmem_idevice > (octet_count, image_count))
+    , optr (make_shared< tally_odevice > ())
+  {}
+};
+
+BOOST_FIXTURE_TEST_SUITE (async, async_fixture);
+
+BOOST_AUTO_TEST_CASE (counting_images)
+{
+  str.push (make_shared< thru_filter > ());
+  str.push (make_shared< thru_filter > (), stream::asynchronous);
+  str.push (optr, stream::asynchronous);
+
+  streamsize rv = *iptr | str;
+
+  BOOST_CHECK_EQUAL (traits::eos (), rv);
+  BOOST_CHECK_EQUAL (image_count, optr->images);
+  BOOST_CHECK_EQUAL (image_count * octet_count, optr->octets);
+  BOOST_CHECK (this_thread::get_id () != optr->writer);
+}
+
+BOOST_AUTO_TEST_CASE (failing_stage)
+{
+  str.push (make_shared< thru_filter > ());
+  str.push (make_shared< failing_filter > (), stream::asynchronous);
+  str.push (optr);
+
+  BOOST_CHECK_THROW (*iptr | str, std::runtime_error);
+  BOOST_CHECK_EQUAL (0, optr->octets);
+}
+
+BOOST_AUTO_TEST_SUITE_END ();
+
+struct profile_fixture
+  : async_fixture
+{
+  const std::string trace_file;
+
+  profile_fixture ()
+    : trace_file ("stream-profile.json")
+  {
+    setenv (PACKAGE_ENV_VAR_PREFIX "PROFILE_TRACE", trace_file.c_str (), 1);
+  }
+
+  ~profile_fixture ()
+  {
+    unsetenv (PACKAGE_ENV_VAR_PREFIX "PROFILE_TRACE");
+    std::remove (trace_file.c_str ());
+  }
+
+  std::size_t count (const std::string& needle) const
+  {
+    std::ifstream is (trace_file.c_str ());
+    std::string trace ((std::istreambuf_iterator< char > (is)),
+                       std::istreambuf_iterator< char > ());
+
+    std::size_t rv = 0;
+    for (std::string::size_type pos = trace.find (needle);
+         std::string::npos != pos; pos = trace.find (needle, pos + 1))
+      ++rv;
+    return rv;
+  }
+};
+
+BOOST_FIXTURE_TEST_SUITE (profile, profile_fixture);
+
+BOOST_AUTO_TEST_CASE (tracing_stages)
+{
+  stream profiled;
+
+  profiled.push (make_shared< thru_filter > ());
+  profiled.push (make_shared< thru_filter > (), stream::asynchronous);
+  profiled.push (optr);
+
+  streamsize rv = *iptr | profiled;
+
+  BOOST_CHECK_EQUAL (traits::eos (), rv);
+  BOOST_CHECK_EQUAL (image_count * octet_count, optr->octets);
+
+  // both filters, the relay between them and the device
+  BOOST_CHECK_EQUAL (4, count ("\"thread_name\""));
+  BOOST_CHECK_EQUAL (4, count ("\"cat\":\"sequence\""));
+  BOOST_CHECK_EQUAL (4 * image_count, count ("\"cat\":\"image\""));
+  BOOST_CHECK_EQUAL (4, count ((format ("\"octets\":%1%,")
+                                % (image_count * octet_count)).str ()));
+}
+
+BOOST_AUTO_TEST_SUITE_END ();
+
 #include "utsushi/test/runner.ipp"
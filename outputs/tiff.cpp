@@ -91,9 +91,10 @@ handle_warning (const char *module, const char *fmt, va_list ap)
 
 }       // namespace
 
-tiff_odevice::tiff_odevice (const std::string& filename)
+tiff_odevice::tiff_odevice (const std::string& filename, bool g4)
   : file_odevice (filename)
   , tiff_(NULL)
+  , g4_(g4)
 {
   if (filename_ == "/dev/stdout")
     {
@@ -112,9 +113,10 @@ tiff_odevice::tiff_odevice (const std::string& filename)
   TIFFSetWarningHandler (handle_warning);
 }
 
-tiff_odevice::tiff_odevice (const path_generator& generator)
+tiff_odevice::tiff_odevice (const path_generator& generator, bool g4)
   : file_odevice (generator)
   , tiff_(NULL)
+  , g4_(g4)
 {
   TIFFSetErrorHandler (handle_error);
   TIFFSetWarningHandler (handle_warning);
@@ -298,7 +300,14 @@ tiff_odevice::boi (const context& ctx)
 
   TIFFSetField (tiff_, TIFFTAG_IMAGEWIDTH , ctx.width ());
   TIFFSetField (tiff_, TIFFTAG_IMAGELENGTH, ctx.height ());
-  TIFFSetField (tiff_, TIFFTAG_ROWSPERSTRIP, 1);
+
+  // A G4 encoded strip is coded relative to its own first line so we
+  // prefer a single strip for the whole image.
+  bool g4 = g4_ && 1 == ctx.depth () && 1 == ctx.comps ();
+  if (g4 && context::unknown_size != ctx.height ())
+    TIFFSetField (tiff_, TIFFTAG_ROWSPERSTRIP, ctx.height ());
+  else
+    TIFFSetField (tiff_, TIFFTAG_ROWSPERSTRIP, 1);
 
   if (0 != ctx.x_resolution () && 0 != ctx.y_resolution ())
     {
@@ -307,7 +316,8 @@ tiff_odevice::boi (const context& ctx)
       TIFFSetField (tiff_, TIFFTAG_RESOLUTIONUNIT, RESUNIT_INCH);
     }
 
-  TIFFSetField (tiff_, TIFFTAG_COMPRESSION, COMPRESSION_NONE);
+  TIFFSetField (tiff_, TIFFTAG_COMPRESSION,
+                (g4 ? COMPRESSION_CCITTFAX4 : COMPRESSION_NONE));
 }
 
 void
@@ -36,8 +36,9 @@ class tiff_odevice
   : public file_odevice
 {
 public:
-  tiff_odevice (const std::string& filename);
-  tiff_odevice (const path_generator& generator);
+  //! \a g4 selects CCITT Group 4 compression for bi-level images
+  tiff_odevice (const std::string& filename, bool g4 = false);
+  tiff_odevice (const path_generator& generator, bool g4 = false);
 
   ~tiff_odevice ();
 
@@ -55,6 +56,7 @@ private:
   TIFF   *tiff_;
   uint32  page_;
   uint32  row_;
+  bool    g4_;
 
   boost::scoped_array< octet > partial_line_;
   streamsize                   partial_size_;
@@ -534,6 +534,9 @@ main (int argc, char *argv[])
               "The explicitly mentioned types are normally inferred from"
               " the output file name.  Some require additional libraries"
               " at build-time in order to be available."))
+        ("g4-compression",
+         CCB_("compress bi-level PDF and TIFF images with CCITT Group 4"
+              " instead of Group 3 (PDF) or no compression (TIFF)"))
         ;
 
       po::options_description cmd_line;
@@ -939,7 +942,8 @@ main (int argc, char *argv[])
 #if HAVE_LIBTIFF
           /**/ if ("TIFF" == fmt)
             {
-              odev = make_shared< _out_::tiff_odevice > (uri);
+              odev = make_shared< _out_::tiff_odevice >
+                (uri, cmd_vm.count ("g4-compression"));
             }
           else
 #endif
@@ -963,7 +967,8 @@ main (int argc, char *argv[])
 #if HAVE_LIBTIFF
           if ("TIFF" == fmt)
             {
-              odev = make_shared< _out_::tiff_odevice > (gen);
+              odev = make_shared< _out_::tiff_odevice >
+                (gen, cmd_vm.count ("g4-compression"));
             }
           else
 #endif
@@ -1147,7 +1152,13 @@ main (int argc, char *argv[])
 
           if ("PDF" == fmt)
             {
-              if (bilevel) str->push (make_shared< g3fax > ());
+              if (bilevel)
+                {
+                  if (cmd_vm.count ("g4-compression"))
+                    str->push (make_shared< g4fax > ());
+                  else
+                    str->push (make_shared< g3fax > ());
+                }
               str->push (make_shared< pdf > (gen));
             }
         }
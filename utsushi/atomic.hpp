@@ -0,0 +1,64 @@
+//  atomic.hpp -- wrapper for lock-free concurrent programming
+//  Copyright (C) 2026  SEIKO EPSON CORPORATION
+//
+//  License: GPL-3.0+
+//  Author : EPSON AVASYS CORPORATION
+//
+//  This file is part of the 'Utsushi' package.
+//  This package is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License or, at
+//  your option, any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//  You ought to have received a copy of the GNU General Public License
+//  along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef utsushi_atomic_hpp_
+#define utsushi_atomic_hpp_
+
+/*! \file
+ *  \brief Inject standard compliant atomic operations support
+ *
+ *  C++ acquired a \c std::atomic class template and memory ordering
+ *  constraints with C++11 [1].  Compiler and standard library
+ *  implementations may need some time to catch up with these
+ *  developments.  Boost.Atomic is supposed to be standards compliant
+ *  enough for our (current) needs so we can use that if the target
+ *  platform is not yet up to snuff.  All the same, we do not want to
+ *  worry about whether we are using the \c std or a \c boost class
+ *  anywhere in the \c utsushi namespace.  This header file lets us.
+ *
+ *  -# http://wikipedia.org/wiki/C++11
+ */
+
+#if __cplusplus >= 201103L && !WITH_INCLUDED_BOOST
+
+#include <atomic>
+#define NAMESPACE std
+
+#else   /* emulate C++11 */
+
+#include <boost/atomic.hpp>
+#define NAMESPACE boost
+
+#endif
+
+namespace utsushi {
+
+using NAMESPACE::atomic;
+using NAMESPACE::atomic_thread_fence;
+using NAMESPACE::memory_order_relaxed;
+using NAMESPACE::memory_order_acquire;
+using NAMESPACE::memory_order_release;
+using NAMESPACE::memory_order_seq_cst;
+
+}       // namespace utsushi
+
+#undef NAMESPACE
+
+#endif  /* utsushi_atomic_hpp_ */
@@ -0,0 +1,38 @@
+//  clock.hpp -- monotonic time keeping and sleeping
+//  Copyright (C) 2026  SEIKO EPSON CORPORATION
+//
+//  License: GPL-3.0+
+//  Author : EPSON AVASYS CORPORATION
+//
+//  This file is part of the 'Utsushi' package.
+//  This package is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License or, at
+//  your option, any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//  You ought to have received a copy of the GNU General Public License
+//  along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef utsushi_clock_hpp_
+#define utsushi_clock_hpp_
+
+#include "cstdint.hpp"
+
+namespace utsushi {
+
+//!  Microseconds on a clock that never jumps
+/*!  Only differences between two values are meaningful.
+ */
+uint64_t microseconds ();
+
+//!  Sleeps for \a usec microseconds, resuming after signals
+void delay (uint64_t usec);
+
+}       // namespace utsushi
+
+#endif  /* utsushi_clock_hpp_ */
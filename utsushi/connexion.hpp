@@ -75,6 +75,7 @@ public:
   enum {                        // \todo get rid of "legacy" types
     OPEN = 4,
     CLOSE,
+    SHARED,                     //!< payload is in shared memory
   };
 
 private:
@@ -84,6 +85,23 @@ private:
   int32_t size_;
 };
 
+//!  Talk to a device via a helper program
+/*!  The helper program is started in a process of its own.  It tells
+ *   where to reach it by printing a TCP port number on its standard
+ *   output.
+ *
+ *   Helpers may use a Unix domain socket instead.  One end of such a
+ *   socket is passed to the helper, with its file descriptor number
+ *   in the \c UTSUSHI_IPC_SOCKET environment variable.  A helper that
+ *   wants to use it prints a port number of zero.  In that case, the
+ *   OPEN message comes with a shared memory file descriptor attached.
+ *   The helper may map that and reply with a SHARED message, rather
+ *   than sending a reply's payload over the socket.  A SHARED message
+ *   header is followed by a four octet offset in network byte order.
+ *   The payload is found at that offset in shared memory.  As there
+ *   is only ever one message awaiting a reply, the helper is free to
+ *   reuse all of the shared memory for every reply.
+ */
 class connexion
   : public utsushi::connexion
 {
@@ -99,8 +117,11 @@ public:
 protected:
   bool connect_();
   bool fork_();
+  void map_shared_memory_();
+  void set_timeout_(double timeout);
 
-  streamsize send_message_(const header& hdr, const octet *  payload);
+  streamsize send_message_(const header& hdr, const octet *  payload,
+                           int fd = -1);
   streamsize recv_message_(      header& hdr,       octet *& payload);
   streamsize send_message_(const void *data, streamsize size);
   streamsize recv_message_(      void *data, streamsize size);
@@ -108,12 +129,20 @@ protected:
   pid_t pid_;
   int   port_;
   int   socket_;
+  int   unix_socket_;           //!< our end, until connect_() is done
+
+  int        shm_fd_;
+  octet     *shm_;
+  streamsize shm_size_;
+
+  double timeout_;              //!< as last set on socket_
 
   std::string name_;
 
   uint32_t id_;
 
   static int default_timeout_;
+  static streamsize default_shm_size_;
 };
 
 }       // namespace ipc
@@ -75,6 +75,7 @@ public:
   typedef shared_ptr< idevice > ptr;
 
   streamsize read (octet *data, streamsize n);
+  streamsize read (block& blk, streamsize n);
   streamsize marker ();
 
   //! Requests cancellation of image data production
@@ -178,6 +179,17 @@ protected:
    */
   virtual streamsize sgetn (octet *data, streamsize n);
 
+  //!  Produces up to \a n octets of image data as a \a blk
+  /*!  This works like the function above but hands out the image data
+   *   as a reference to storage that the implementation owns.  It is
+   *   only ever called by read() if is_zero_copy() returns \c true,
+   *   so implementations overriding one should override the other.
+   *
+   *   The default implementation allocates storage for \a n octets
+   *   and calls sgetn() to fill it.
+   */
+  virtual streamsize sgetn (block& blk, streamsize n);
+
   //! Tells whether cancellation has been requested
   /*! Device implementations that want to support cancellation of the
    *  image acquisition process can use this query to check whether a
@@ -221,7 +233,8 @@ protected:
   option::map::ptr action_;
 
 private:
-  streamsize read_(octet *data, streamsize n);
+  streamsize guarded_read_(octet *data, streamsize n, block *blk);
+  streamsize read_(octet *data, streamsize n, block *blk);
 
   //! Image acquisition process state tracker
   /*! When this variable's value equals \c true, image acquisition is
@@ -282,9 +295,12 @@ public:
   decorator (ptr instance);
 
   streamsize read (octet *data, streamsize n);
+  streamsize read (block& blk, streamsize n);
   streamsize marker ();
   void cancel ();
 
+  bool is_zero_copy () const;
+
   streamsize buffer_size () const;
   void buffer_size (streamsize size);
   context get_context () const;
@@ -82,6 +82,8 @@ public:
 
   ~file_idevice ();
 
+  bool is_zero_copy () const;
+
 protected:
   bool is_consecutive () const;
 
@@ -90,13 +92,25 @@ protected:
   void finish_image ();
 
   streamsize sgetn (octet *data, streamsize n);
+  streamsize sgetn (block& blk, streamsize n);
 
 private:
+  bool map_image_();
+
   std::string    filename_;
   path_generator generator_;
 
   std::basic_filebuf< octet > file_;
   bool used_;
+
+  //! Memory mapped image file contents, if mapping was possible
+  /*! Blocks handed out by sgetn() share ownership of the mapping so
+   *  that it outlives the image if need be.  The file_ is only used
+   *  when the image file could not be mapped.
+   */
+  shared_ptr< const void > mapping_;
+  streamsize map_size_;
+  streamsize map_offset_;
 };
 
 //!  Save an image data sequence to one or more files
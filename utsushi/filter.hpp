@@ -46,7 +46,29 @@ public:
   using output::buffer_size;
   virtual void buffer_size (streamsize size);
 
+  //!  Creates a fresh %filter that is configured just like this one
+  /*!  The copy starts out without any image data or sequence state.
+   *   This allows for several images of a sequence to be processed
+   *   concurrently, each by a %filter of its own.
+   *
+   *   The default implementation returns an empty pointer to signal
+   *   that the %filter does not support this.
+   *
+   *   \sa pool
+   */
+  virtual ptr clone () const;
+
 protected:
+  //!  Implements clone() for filters that are fully configured by
+  //!  their options
+  template< typename T >
+  ptr clone_() const
+  {
+    shared_ptr< T > rv = make_shared< T > ();
+
+    rv->options ()->assign (option_->values ());
+    return rv;
+  }
 
   output::ptr output_;
 };
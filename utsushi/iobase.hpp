@@ -27,6 +27,31 @@
 
 namespace utsushi {
 
+//!  Reference-counted run of image data octets
+/*!  A %block refers to image data that is owned by someone else, most
+ *   likely the producer of that data.  Copying a %block only copies
+ *   the reference, not the data.  The data stays valid for as long as
+ *   any %block refers to it.
+ *
+ *   This allows image data producers to hand out their own storage,
+ *   avoiding the copy that read() into a caller's buffer requires.
+ */
+class block
+{
+public:
+  block ();
+  block (shared_ptr< const void > owner, const octet *data, streamsize n);
+
+  const octet * data () const;
+  streamsize size () const;
+  bool empty () const;
+
+private:
+  shared_ptr< const void > owner_;
+  const octet *data_;
+  streamsize size_;
+};
+
 //!  Common aspects of image data production
 class input
 {
@@ -115,6 +140,23 @@ public:
    */
   virtual streamsize marker () = 0;
 
+  //! Produces up to \a n octets of image data without copying them
+  /*! This works exactly like read() except that image data is handed
+   *  over as a \a blk that refers to storage owned by the producer.
+   *  Whenever a marker is returned, the \a blk will be empty.
+   *
+   *  The default implementation allocates storage for \a n octets
+   *  and read()s into that.  Implementations that can do better need
+   *  to override this function \e and is_zero_copy().
+   */
+  virtual streamsize read (block& blk, streamsize n);
+
+  //! Tells whether read() into a block avoids copying image data
+  /*! Callers should only prefer read() into a block over read() into
+   *  their own buffer when this returns \c true.
+   */
+  virtual bool is_zero_copy () const;
+
   virtual void cancel () {};
 
   virtual streamsize buffer_size () const;
@@ -1,5 +1,5 @@
 //  log.hpp -- formatted messages based on priority and category
-//  Copyright (C) 2012, 2015  SEIKO EPSON CORPORATION
+//  Copyright (C) 2012, 2015, 2026  SEIKO EPSON CORPORATION
 //
 //  License: GPL-3.0+
 //  Author : EPSON AVASYS CORPORATION
@@ -21,6 +21,7 @@
 #ifndef utsushi_log_hpp_
 #define utsushi_log_hpp_
 
+#include <boost/date_time/c_local_time_adjustor.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/optional.hpp>
 #include <boost/throw_exception.hpp>
@@ -41,6 +42,20 @@ class log
     return (threshold >= level && matching & cat);
   }
 
+  inline static boost::posix_time::ptime now ()
+  {
+    return boost::posix_time::microsec_clock::universal_time ();
+  }
+
+  inline static boost::posix_time::ptime
+  local (const boost::posix_time::ptime& utc)
+  {
+    return boost::date_time::c_local_adjustor<
+      boost::posix_time::ptime >::utc_to_local (utc);
+  }
+
+  static bool asynchronous_;
+
 public:
   template <typename charT, typename traits = std::char_traits<charT> >
   class basic_logger
@@ -49,6 +64,63 @@ public:
     static std::basic_ostream<charT, traits>& os_;
   };
 
+  //!  Log message output that has been put off until later
+  /*!  In asynchronous mode, noisy messages are handed off as records
+   *   to a background thread.  That thread takes care of the final
+   *   formatting and the actual output.
+   */
+  class record
+  {
+  public:
+    explicit record (const boost::posix_time::ptime& timestamp)
+      : timestamp_(timestamp)
+    {}
+    virtual ~record () {}
+
+    //!  Formats and outputs the record's message
+    virtual void dump () const = 0;
+
+    const boost::posix_time::ptime& timestamp () const
+    {
+      return timestamp_;
+    }
+
+  protected:
+    boost::posix_time::ptime timestamp_;   //!< in UTC
+  };
+
+  template <typename charT, typename traits, typename Alloc>
+  class basic_record
+    : public record
+  {
+  public:
+    typedef boost::basic_format<charT, traits, Alloc> format_type;
+
+    basic_record (const boost::posix_time::ptime& timestamp,
+                  const thread::id& thread_id)
+      : record (timestamp), thread_id_(thread_id)
+    {}
+
+    void dump () const
+    {
+      basic_logger<charT, traits>::os_
+        << local (timestamp_) << "[" << thread_id_ << "]: " << fmt_
+        << std::endl;
+    }
+
+    format_type& format () { return fmt_; }
+
+  private:
+    thread::id  thread_id_;
+    format_type fmt_;
+  };
+
+  //!  Queues \a r for output by a background thread
+  /*!  Takes ownership of \a r.  Neither locks nor formats as long as
+   *   the calling thread's queue has room.
+   */
+  static void enqueue (record *r);
+
   //!  Formatted, self-outputting log messages
   /*!  Modeled after boost::format, this class provides a convenient,
    *   yet fast, mechanism to add log message support to your code.
@@ -87,16 +159,20 @@ public:
     {
       if (make_noise (lvl, cat))
         {
-          timestamp_ = boost::posix_time::microsec_clock::local_time ();
+          timestamp_ = now ();
           thread_id_ = this_thread::get_id ();
           fmt_ = format_type (fmt);
           cnt_ = fmt_->num_args_;
           clear_exception_bits ();
         }
-      else
+      else if (arg_count_checking)
         {
           cnt_ = format_type (fmt).num_args_;
         }
+      else
+        {
+          cnt_ = 0;
+        }
     }
 
   public:
@@ -116,7 +192,7 @@ public:
       : arg_(0), dumped_(false)                                         \
     { init_args (fmt, lvl, cat); }                                      \
     basic_message (const type& fmt)                                     \
-      : timestamp_(boost::posix_time::microsec_clock::local_time ())    \
+      : timestamp_(now ())                                              \
       , thread_id_(this_thread::get_id ())                              \
       , fmt_(fmt), arg_(0), cnt_(fmt_->num_args_), dumped_(false)       \
     { clear_exception_bits (); }                                        \
@@ -152,6 +228,17 @@ public:
           *this % os.str ();
         }
       }
+      if (!fmt_) return;
+
+      if (asynchronous_)
+        {
+          basic_record<charT, traits, Alloc> *r
+            = new basic_record<charT, traits, Alloc> (*timestamp_,
+                                                      *thread_id_);
+          r->format ().swap (*fmt_);
+          enqueue (r);
+          return;
+        }
       basic_logger<charT, traits>::os_ << *this;
     }
 
@@ -176,7 +263,7 @@ public:
 
       if (fmt_) {
         std::basic_ostringstream <charT, traits> os;
-        os << *timestamp_ << "[" << *thread_id_ << "]: " << *fmt_
+        os << local (*timestamp_) << "[" << *thread_id_ << "]: " << *fmt_
            << std::endl;
         rv = os.str ();
       }
@@ -215,6 +302,31 @@ public:
    */
   static category matching;
 
+  //!  Hands message output off to a background thread
+  /*!  Formatting and writing log messages from the thread that logs
+   *   them makes that thread wait for the output stream.  With \a
+   *   enable set, messages are queued per thread instead, without any
+   *   locking, and a background thread takes care of the rest.  This
+   *   keeps the cost of trace level logging in time critical code to
+   *   a minimum.
+   *
+   *   Asynchronous mode is off by default.  Setting the environment
+   *   variable \c UTSUSHI_LOG_ASYNC to a non-zero number turns it on
+   *   at start-up.
+   *   Messages logged from different threads are written in order of
+   *   their timestamps, as far as they are output together.
+   */
+  static void asynchronous (bool enable);
+  static bool asynchronous ();
+
+  //!  Outputs all queued log messages
+  /*!  Returns once all messages queued by the time of the call have
+   *   been written and the output streams have been flushed.  This
+   *   is called automatically at program exit and is safe to call
+   *   from a std::terminate() handler.
+   */
+  static void flush ();
+
   //!  Convenience type for character log messages
   typedef basic_message<char>    message;
   //!  Convenience type for wide character log messages
@@ -71,6 +71,17 @@ struct null_deleter
   void operator() (const void *) const {}
 };
 
+//! Support \c shared_ptr<T> ownership of arrays allocated with \c new[]
+/*! The default \c shared_ptr<T> deleter uses \c delete, which is not
+ *  the right thing to do for arrays.  Pass an array_deleter with the
+ *  raw pointer to the \c shared_ptr<T> constructor instead.
+ */
+template< typename T >
+struct array_deleter
+{
+  void operator() (T *p) const { delete [] p; }
+};
+
 }       // namespace utsushi
 
 #undef NAMESPACE
@@ -0,0 +1,109 @@
+//  pool.hpp -- process several images of a sequence at once
+//  Copyright (C) 2026  SEIKO EPSON CORPORATION
+//
+//  License: GPL-3.0+
+//  Author : EPSON AVASYS CORPORATION
+//
+//  This file is part of the 'Utsushi' package.
+//  This package is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License or, at
+//  your option, any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//  You ought to have received a copy of the GNU General Public License
+//  along with this package.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef utsushi_pool_hpp_
+#define utsushi_pool_hpp_
+
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+#include "condition-variable.hpp"
+#include "filter.hpp"
+#include "mutex.hpp"
+
+namespace utsushi {
+
+//!  Run a chain of filters on several images at once
+/*!  Filters keep state between the start and end of an image, so one
+ *   chain of filters can only work on one image at a time.  A %pool
+ *   clones() the filters pushed onto it for each of its workers and
+ *   hands every image in a sequence to whichever worker is available.
+ *   The results are passed on in the original order of the images.
+ *
+ *   Use a %pool like any other filter and push it onto a stream.  It
+ *   works best for filters that spend a lot of time on each image,
+ *   such as deskew, autocrop and reorient.  Filters that need to see
+ *   all images of a sequence, such as the PDF filter, should not be
+ *   pushed onto a %pool.
+ *
+ *   Each image is collected in full before it is handed to a worker
+ *   and its results are held until all preceding images have been
+ *   passed on.  At most twice as many images as there are workers
+ *   are held at any one time.
+ *
+ *   If any of the filters cannot be cloned, a single worker uses the
+ *   filters as pushed.  That still overlaps their work with that of
+ *   the filters in front of the %pool.
+ */
+class pool
+  : public filter
+{
+public:
+  typedef shared_ptr< pool > ptr;
+
+  //!  Creates a %pool with up to \a workers threads
+  /*!  A value of zero uses as many workers as the hardware supports.
+   */
+  explicit pool (unsigned workers = 0);
+  ~pool ();
+
+  //!  Appends a \a %filter to the chain run for each image
+  /*!  The \a %filter itself serves as a prototype for the filters that
+   *   are actually used.  Changes to its options take effect from the
+   *   next sequence onwards.
+   */
+  void push (filter::ptr filter);
+
+  streamsize write (const octet *data, streamsize n);
+  void mark (traits::int_type c, const context& ctx);
+
+private:
+  struct page;
+  class recorder;
+  struct lane;
+
+  void set_up_sequence_(const context& ctx);
+  void finish_sequence_(traits::int_type c, const context& ctx);
+
+  void dispatch_(shared_ptr< page > pp);
+  void replay_(std::size_t limit);
+  void stop_();
+
+  void work_(lane *lp);
+
+  unsigned workers_;
+  std::vector< filter::ptr > prototype_;
+  std::vector< lane * > lane_;
+
+  shared_ptr< page > page_;     //!< image being collected
+
+  mutex mutex_;
+  condition_variable has_work_;
+  condition_variable is_done_;
+
+  std::deque< shared_ptr< page > > pages_; //!< in order of arrival
+  std::deque< shared_ptr< page > > todo_;  //!< waiting for a worker
+  bool is_stopping_;
+};
+
+}       // namespace utsushi
+
+#endif  /* utsushi_pool_hpp_ */
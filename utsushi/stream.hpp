@@ -26,6 +26,8 @@
 
 namespace utsushi {
 
+class profiler;
+
 //!  Access or store an image data sequence
 /*!  A %stream encapsulates a %device and zero or more filters.  The
  *   %device and filters are maintained in a stack(-like) fashion.
@@ -38,6 +40,12 @@ namespace utsushi {
  *
  *   \note  Once complete, devices and filters can no longer be pushed
  *          onto a %stream.
+ *
+ *   Setting the \c UTSUSHI_PROFILE environment variable makes every
+ *   %stream report how much time each of its filters and its device
+ *   take when a sequence ends.  Setting \c UTSUSHI_PROFILE_TRACE to
+ *   a file name writes per image timings to that file in the Chrome
+ *   trace event format.
  */
 //!  Image data consuming %streams
 class stream
@@ -46,21 +54,43 @@ class stream
 public:
   typedef shared_ptr<stream> ptr;
 
+  //!  How a pushed %filter or %device is run
+  enum launch {
+    synchronous,    //!< on the thread that feeds it image data
+    asynchronous,   //!< on a thread of its own
+  };
+
+  stream ();
+
   streamsize write (const octet *data, streamsize n);
   void mark (traits::int_type c, const context& ctx);
 
   //!  Pushes a \a %device onto the object's %output stack
   /*!  This completes the object's stack and one can now write() image
    *   data to the \a %device.
+   *
+   *   \sa push(filter::ptr, launch)
    */
-  void push (odevice::ptr device);
+  void push (odevice::ptr device, launch policy = synchronous);
 
   //!  Pushes a \a %filter onto the object's %output stack
   /*!  Image data passed to write() will be processed by all filters
    *   on the stack, starting with the \a %filter that was pushed \e
    *   first, before it is consumed by the object's %device.
+   *
+   *   With an asynchronous launch \a policy, the \a %filter and all
+   *   that is pushed after it run on a thread of their own.  Image
+   *   data and markers are handed over to that thread via a bounded
+   *   queue.  This lets the stages of a stream work concurrently, so
+   *   that throughput is limited by its slowest stage rather than the
+   *   sum of them all.  The policy has no effect on whatever is pushed
+   *   first as that always runs on the thread that feeds the stream.
+   *
+   *   Marking the end of a sequence waits for all threads to finish
+   *   their part of it.  Exceptions thrown on one of these threads
+   *   are rethrown to the thread that feeds the stream.
    */
-  void push (filter::ptr filter);
+  void push (filter::ptr filter, launch policy = synchronous);
 
   streamsize buffer_size () const;
 
@@ -74,30 +104,37 @@ private:
   device_ptr  device_;          //!< %device that caps the stack
   filter::ptr filter_;         //!< top-most %filter on the stack
 
+  shared_ptr< profiler > profiler_;
+
   //!  Handles the internals of pushing a %device or %filter
   /*!  When pushing the first %device or %filter, its I/O aspect and
    *   %device aspect are recorded as the stack's bottom element.  A
    *   \a %buffer is not needed at this point and the caller should
    *   pass \c NULL to indicate this.  Pushing additional filters or
-   *   capping %device requires a %buffer's I/O and %device aspects so
+   *   capping %device requires a %buffer, as obtained via link(), so
    *   we can %stream the I/O efficiently.
-   *
-   *   \note  The %buffer type needed is more derived than we can infer
-   *          in this template.  Hence, derived classes need to create
-   *          one and pass us a pointer to it.
    */
-  void attach (output::ptr out, device_ptr device,
-               output::ptr buf, buffer::ptr buffer);
+  void attach (output::ptr out, device_ptr device, output::ptr buffer);
+
+  //!  Creates a %buffer that writes to \a out as per launch \a policy
+  /*!  Instruments \a out and, for an asynchronous launch, the %relay
+   *   when profiling.
+   */
+  output::ptr link (output::ptr out, streamsize size, launch policy);
+
+  //!  Wraps \a out in a %profiler stage if profiling is enabled
+  output::ptr instrument (output::ptr out);
 
   //!  Pushes %output and %device aspects on to the stack
   template< typename device_ptr >
-  void push (output::ptr out, device_ptr device)
+  void push (output::ptr out, device_ptr device, launch policy)
   {
-    buffer::ptr buf;
+    output::ptr buf;
 
-    if (out_bottom_) buf = make_shared< buffer > (device->buffer_size ());
+    if (out_bottom_) buf = link (out, device->buffer_size (), policy);
+    else             out = instrument (out);
 
-    attach (out, device, buf, buf);
+    attach (out, device, buf);
   }
 };
 
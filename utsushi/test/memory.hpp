@@ -23,11 +23,13 @@
 
 #include "../device.hpp"
 #include "../filter.hpp"
+#include "../thread.hpp"
 
 #include <boost/throw_exception.hpp>
 
 #include <fstream>
 #include <stdexcept>
+#include <vector>
 
 namespace utsushi {
 
@@ -175,6 +177,62 @@ public:
   { file_.sgetn (data, n); }
 };
 
+//!  Devices that keep tabs on the image data written to them
+/*!  Besides counting octets and images, these devices note the first
+ *   octet of every image, whether any image has octets that differ
+ *   from its first one and which thread wrote to them last.
+ */
+class tally_odevice : public odevice
+{
+public:
+  streamsize octets;
+  unsigned   images;
+  std::vector< octet > firsts;
+  bool       is_mixed;
+  thread::id writer;
+
+  tally_odevice () : octets (0), images (0), is_mixed (false) {}
+
+  streamsize write (const octet *data, streamsize n)
+  {
+    writer = this_thread::get_id ();
+    if (0 < n && firsts.size () == images)
+      firsts.push_back (data[0]);
+    for (streamsize i = 0; i < n; ++i)
+      is_mixed |= (data[i] != firsts.back ());
+    octets += n;
+    return n;
+  }
+
+protected:
+  void eoi (const context&) { ++images; }
+};
+
+//!  Devices that collect all image data written to them
+class capture_odevice : public odevice
+{
+public:
+  std::vector< octet > data;
+  unsigned images;
+
+  capture_odevice () : images (0) {}
+
+  streamsize write (const octet *p, streamsize n)
+  {
+    data.insert (data.end (), p, p + n);
+    return n;
+  }
+
+  //!  Returns the \a i-th octet collected as an unsigned value
+  unsigned at (std::size_t i) const
+  {
+    return static_cast< unsigned char > (data[i]);
+  }
+
+protected:
+  void eoi (const context&) { ++images; }
+};
+
 //!  Filters that %output their %input unchanged
 class thru_filter : public filter
 {
@@ -183,6 +241,18 @@ public:
   { return output_->write (data, n); }
 };
 
+//!  Filters that fail on their first write() attempt
+class failing_filter : public filter
+{
+public:
+  streamsize write (const octet *data, streamsize n)
+  {
+    BOOST_THROW_EXCEPTION (std::runtime_error ("failing_filter"));
+  }
+
+  filter::ptr clone () const { return make_shared< failing_filter > (); }
+};
+
 }       // namespace utsushi
 
 #endif  /* utsushi_test_memory_hpp_ */